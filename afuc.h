@@ -12,9 +12,13 @@
 #pragma once
 
 #include <cstdint>
+#include <map>
+#include <shared_mutex>
 #include <string>
 #include <vector>
 
+#include "afuc_isa.h"
+
 /* ─── GPU Versions ─────────────────────────────────────────── */
 
 enum AfucGpuVer {
@@ -67,68 +71,32 @@ static inline AfucReg afuc_dst_reg(uint32_t enc)
 /* ─── Opcodes ──────────────────────────────────────────────── */
 
 enum AfucOp {
-	AFUC_NOP,
-
-	/* ALU ops (register-register and immediate forms) */
-	AFUC_ADD,
-	AFUC_ADDHI,
-	AFUC_SUB,
-	AFUC_SUBHI,
-	AFUC_AND,
-	AFUC_OR,
-	AFUC_XOR,
-	AFUC_NOT,
-	AFUC_SHL,
-	AFUC_USHR,
-	AFUC_ISHR,
-	AFUC_ROT,
-	AFUC_MUL8,
-	AFUC_MIN,
-	AFUC_MAX,
-	AFUC_CMP,
-	AFUC_BIC,
-	AFUC_MSB,
-	AFUC_MOV,     /* pseudo: or $dst, $00, $src */
-
-	/* Move immediate with shift */
-	AFUC_MOVI,
-
-	/* Bit manipulation */
-	AFUC_SETBIT,   /* immediate bit set */
-	AFUC_CLRBIT,   /* immediate bit clear */
-	AFUC_SETBIT_R, /* register bit set/clear (a7xx) */
-	AFUC_UBFX,     /* unsigned bitfield extract (a7xx) */
-	AFUC_BFI,      /* bitfield insert (a7xx) */
-
-	/* Control register access */
-	AFUC_CWRITE,
-	AFUC_CREAD,
-	AFUC_SWRITE,
-	AFUC_SREAD,
-
-	/* Memory access */
-	AFUC_STORE,
-	AFUC_LOAD,
-
-	/* Branch / control flow */
-	AFUC_BRNE_IMM,  /* branch if not equal (immediate) */
-	AFUC_BREQ_IMM,  /* branch if equal (immediate) */
-	AFUC_BRNE_BIT,  /* branch if bit not set */
-	AFUC_BREQ_BIT,  /* branch if bit set */
-	AFUC_JUMP,      /* unconditional relative jump (pseudo: brne $00, b0, #off) */
-	AFUC_CALL,
-	AFUC_RET,
-	AFUC_IRET,
-	AFUC_WAITIN,
-	AFUC_BL,
-	AFUC_JUMPA,     /* absolute jump (a7xx) */
-	AFUC_JUMPR,     /* indirect jump (a7xx) */
-	AFUC_SRET,      /* return from bl (a7xx) */
-	AFUC_SETSECURE,
+#define AFUC_ISA_ENUM(op, name, form, a6r, a6i, a7r, a7i) AFUC_##op,
+	AFUC_ISA(AFUC_ISA_ENUM)
+#undef AFUC_ISA_ENUM
 
 	AFUC_INVALID,
 };
 
+struct AfucIsaDesc {
+	AfucOp op;
+	const char* name;
+	AfucForm form;
+	uint8_t alu[2][2];  /* [a7xx][immediate]: ALU opcode field, 0 = none */
+};
+
+inline constexpr AfucIsaDesc afuc_isa[] = {
+#define AFUC_ISA_DESC(op, name, form, a6r, a6i, a7r, a7i) \
+	{ AFUC_##op, name, AFUC_FORM_##form, { { a6r, a6i }, { a7r, a7i } } },
+	AFUC_ISA(AFUC_ISA_DESC)
+#undef AFUC_ISA_DESC
+};
+
+constexpr AfucForm afuc_op_form(AfucOp op)
+{
+	return op < AFUC_INVALID ? afuc_isa[op].form : AFUC_FORM_NONE;
+}
+
 /* ─── Decoded Instruction ──────────────────────────────────── */
 
 struct AfucInsn {
@@ -180,6 +148,322 @@ struct AfucInsn {
 bool afuc_decode(const uint8_t* data, size_t len, uint64_t addr,
                  AfucInsn& insn, AfucGpuVer gpuver = AFUC_A6XX);
 
+const char* afuc_op_name(AfucOp op);
+
+/* Opcode-field value of an ALU op in the 2-source (sub-opcode) or
+ * 16-bit immediate (top5) encoding; false if the form doesn't exist. */
+bool afuc_alu_opcode(AfucGpuVer gpuver, AfucOp op, bool immed, uint32_t& opc);
+
+/* ─── Operand / control-flow helpers ───────────────────────── */
+
+/*
+ * Register bitmasks are indexed by hardware encoding (bit n = encoding n).
+ * Note 0x1d-0x1f name different registers as source ($memdata, $regdata,
+ * $data) and as destination ($addr, $usraddr, $data).
+ */
+uint32_t afuc_insn_src_regs(const AfucInsn& insn);
+uint32_t afuc_insn_dst_regs(const AfucInsn& insn);
+
+/* Dwords popped from the $data FIFO; -1 if it depends on $rem
+ * ((rep) or (xmovN) forms). */
+int afuc_insn_data_reads(const AfucInsn& insn);
+
+enum AfucFlowKind {
+	AFUC_FLOW_NEXT,       /* falls through */
+	AFUC_FLOW_COND,       /* target or fall through */
+	AFUC_FLOW_JUMP,       /* unconditional, direct */
+	AFUC_FLOW_CALL,       /* call / bl, returns to after the delay slot */
+	AFUC_FLOW_RET,        /* ret / iret / sret */
+	AFUC_FLOW_INDIRECT,   /* jump $reg */
+	AFUC_FLOW_WAITIN,     /* ends the packet handler */
+};
+
+struct AfucFlow {
+	AfucFlowKind kind;
+	uint64_t target;      /* byte address for COND / JUMP / CALL */
+	bool delay_slot;      /* next instruction executes before the transfer */
+};
+
+AfucFlow afuc_insn_flow(const AfucInsn& insn, uint64_t addr);
+
+/* Rough static cost in SQE cycles: ALU ops are 1, control/SQE register
+ * and memory accesses cost more, taken control flow pays for the
+ * pipeline refill. (rep) forms are counted as a single iteration. */
+uint32_t afuc_insn_cost(const AfucInsn& insn);
+
+/* ─── Whole-image control flow ─────────────────────────────── */
+
+/*
+ * Block boundaries of a code image as bitmaps over word indices (bit i
+ * of word i / 64), built in one pass that only decodes control-flow
+ * words:
+ *   leader: a block starts here (a direct branch or call target, the
+ *           word after a transfer's delay slot, a setsecure continuation)
+ *   term:   a transfer that ends its block, after its delay slot if it
+ *           has one; calls don't end blocks
+ */
+struct AfucFlowMap {
+	uint64_t base = 0;
+	std::vector<uint32_t> words;
+	std::vector<uint64_t> leader;
+	std::vector<uint64_t> term;
+
+	bool is_leader(size_t i) const { return i < words.size() && (leader[i / 64] >> (i % 64) & 1); }
+	bool is_term(size_t i) const { return i < words.size() && (term[i / 64] >> (i % 64) & 1); }
+};
+
+void afuc_build_flow_map(AfucGpuVer gpuver, std::vector<uint32_t> words,
+                         uint64_t base, AfucFlowMap& map);
+
+/* First set bit at or after 'from' in a flow-map bitmap; 'limit' if none */
+size_t afuc_flow_next(const std::vector<uint64_t>& bits, size_t from, size_t limit);
+
+/*
+ * Per-word successors for word-level data flow. A transfer with a delay
+ * slot has its slot as only successor and the slot takes the transfer's
+ * targets; a call continues into the callee and after its slot. Targets
+ * outside the image and ret / waitin / indirect jumps leave
+ * AFUC_NO_WORD.
+ */
+#define AFUC_NO_WORD 0xffffffffu
+
+struct AfucWordSuccs {
+	uint32_t s[2];
+};
+
+void afuc_word_succs(AfucGpuVer gpuver, const AfucFlowMap& map, std::vector<AfucWordSuccs>& out);
+
+/* ─── Register liveness ────────────────────────────────────── */
+
+/*
+ * Registers tracked by liveness, as encoding bitmasks: $01-$19, $sp, $lr
+ * and $rem. $00 reads as zero; 0x1d-0x1f are FIFOs and address ports
+ * whose accesses are side effects rather than values.
+ */
+#define AFUC_LIVE_REGS 0x1ffffffeu
+#define AFUC_LIVE_GPRS 0x03fffffeu   /* $01-$19 */
+
+struct AfucLiveBlock {
+	uint32_t first, end;     /* word indices, [first, end) */
+	uint32_t live_in, live_out;
+};
+
+struct AfucLiveness {
+	uint64_t base = 0;
+	std::vector<AfucLiveBlock> blocks;
+	std::vector<uint32_t> block_of;   /* word index -> block */
+	std::vector<uint32_t> live;       /* word index -> live before it executes */
+};
+
+/*
+ * Whole-image backward liveness over the flow map's blocks. A delay slot
+ * runs after its transfer reads its operands; a call adds its callee's
+ * live-in after the slot; ret, waitin and unresolved jumps end with
+ * 'exit_live' live, as the code that runs next is unknown.
+ */
+void afuc_liveness(AfucGpuVer gpuver, const AfucFlowMap& map, AfucLiveness& out,
+                   uint32_t exit_live = AFUC_LIVE_REGS);
+
+/* Registers live just before 'addr' executes; everything if unknown */
+uint32_t afuc_live_before(const AfucLiveness& live, uint64_t addr);
+
+/* ─── Preemption context records ───────────────────────────── */
+
+/*
+ * Context-save records reconstructed from load/store traffic. A record
+ * is addressed through a value read from one of the save-area control
+ * registers (@SAVE_REGISTER_*, @PREEMPT_COOKIE); every load and store
+ * whose address is that value plus a known offset, on any path, is a
+ * field access. Stores are the save path, loads the restore path.
+ */
+struct AfucRecordField {
+	uint32_t offset;          /* bytes from the record base */
+	uint32_t size;            /* 4, or 0 for a (rep) run of $rem dwords */
+	uint32_t stores, loads;   /* accessing instructions */
+	uint32_t value_reg;       /* control register whose value is saved here, ~0u if unknown */
+	std::vector<uint64_t> addrs;
+};
+
+struct AfucContextRecord {
+	uint32_t base_reg;        /* control register holding the record address */
+	std::vector<AfucRecordField> fields;   /* sorted by offset */
+	uint32_t size;            /* bytes up to the end of the last fixed-size field */
+	uint32_t bytes_saved;     /* fixed-size fields stored anywhere, each once */
+	uint32_t bytes_restored;
+	bool variable;            /* has (rep) runs of unknown length */
+};
+
+/* Save-area base registers that exist on this generation */
+std::vector<uint32_t> afuc_context_base_regs(AfucGpuVer gpuver);
+
+/*
+ * The flow starts at 'entries' (the bootstrap and the packet handlers)
+ * and at any handler installed by a constant write to PREEMPT_INSTR.
+ * 'clobbers' maps a callee to the registers it may write, as encoding
+ * bits; the return of a call to a callee not listed loses every register.
+ */
+void afuc_context_records(AfucGpuVer gpuver, const AfucFlowMap& map,
+                          const std::vector<uint32_t>& base_regs,
+                          const std::vector<uint64_t>& entries,
+                          const std::map<uint64_t, uint32_t>& clobbers,
+                          std::vector<AfucContextRecord>& out);
+
+/* ─── Thread synchronization (a7xx) ────────────────────────── */
+
+/*
+ * a7xx images carry the BR, BV and LPAC threads' code one after another,
+ * each starting with a firmware header nop. The threads hand work to
+ * each other through @THREAD_SYNC: one sets flag bits, another reads or
+ * spins on them.
+ */
+#define AFUC_THREAD_COUNT 3
+const char* afuc_thread_name(uint32_t thread);
+
+/* Start of each thread's code (word index in 'map'); the BR thread starts at 0 */
+std::vector<size_t> afuc_thread_starts(const AfucFlowMap& map);
+
+enum AfucSyncKind {
+	AFUC_SYNC_READ,       /* read and tested once */
+	AFUC_SYNC_POLL,       /* read in a loop until the tested bits change */
+	AFUC_SYNC_WRITE,
+};
+
+struct AfucSyncPoint {
+	uint64_t addr;
+	AfucSyncKind kind;
+	uint32_t reg;         /* control register */
+	uint32_t bits;        /* flags written or tested; 0 if not static */
+	uint32_t thread;
+	uint64_t branch;      /* the test (poll loop back edge) of a read, or 0 */
+};
+
+void afuc_sync_points(AfucGpuVer gpuver, const AfucFlowMap& map, std::vector<AfucSyncPoint>& out);
+
+/* Producer/consumer pairs: a write in one thread and a read or poll in
+ * another whose flags overlap (or either side's flags aren't static) */
+struct AfucSyncPair {
+	size_t producer, consumer;   /* indices into the points */
+};
+
+void afuc_sync_pairs(const std::vector<AfucSyncPoint>& points, std::vector<AfucSyncPair>& out);
+
+/* ─── Polling loops ────────────────────────────────────────── */
+
+/*
+ * Short loops that re-read a value and spin until it changes: pending
+ * counters, @REG_READ_TEST_RESULT, sync registers, memory flags. These
+ * are where command processing stalls, so each one records what it
+ * waits on and whether anything bounds it.
+ */
+enum AfucPollSource {
+	AFUC_POLL_CTRL,       /* cread of control register 'reg' */
+	AFUC_POLL_SQE,        /* sread of SQE register 'reg' */
+	AFUC_POLL_MEM,        /* load */
+	AFUC_POLL_REGDATA,    /* $regdata */
+	AFUC_POLL_MEMDATA,    /* $memdata */
+};
+
+struct AfucPollLoop {
+	uint64_t head, end;       /* loop body [head, end), the back edge's delay slot included */
+	uint64_t read;            /* instruction re-reading the polled value */
+	AfucPollSource source;
+	uint32_t reg;             /* register offset for CTRL / SQE */
+	uint64_t test;            /* branch deciding whether to keep spinning */
+	AfucOp test_op;           /* brne / breq, bit or immediate form */
+	uint32_t value;           /* bit number or immediate of the test */
+	uint32_t mask;            /* and / ubfx applied before the test, ~0u if none */
+	bool exit_taken;          /* the loop is left when 'test' is taken */
+	uint32_t counter;         /* timeout counter register encoding, ~0u if none */
+	uint64_t counter_test;    /* branch leaving the loop when the counter runs out */
+	int64_t bound;            /* worst-case iterations, -1 if unbounded or not static */
+};
+
+void afuc_poll_loops(AfucGpuVer gpuver, const AfucFlowMap& map, std::vector<AfucPollLoop>& out);
+
+/* "@CP_WFI_PEND_CTR", "%SQE_REG", "mem", "$regdata" */
+std::string afuc_poll_source_text(AfucGpuVer gpuver, const AfucPollLoop& loop);
+
+/* What ends the loop: "b3 set", "== 0x0", "& 0xf0 != 0x0" */
+std::string afuc_poll_until_text(const AfucPollLoop& loop);
+
+/* ─── Target labels ────────────────────────────────────────── */
+
+/*
+ * Function starts by address, for showing a code address as the
+ * function it falls in plus an offset. Lookups and updates are
+ * O(log n) and take a reader/writer lock, so rendering threads can
+ * share the index with the notifications that keep it up to date.
+ */
+class AfucLabelIndex
+{
+	mutable std::shared_mutex m_lock;
+	std::map<uint64_t, std::string> m_starts;
+
+public:
+	void set(uint64_t start, const std::string& name);
+	/* only if 'start' is still called 'name': a rename may add the new
+	 * symbol before removing the old one */
+	void erase(uint64_t start, const std::string& name);
+	size_t size() const;
+
+	/* "name" at a start, "name+0x1c" past one; false before the first */
+	bool label(uint64_t addr, std::string& out) const;
+};
+
+/* ─── Image diff ───────────────────────────────────────────── */
+
+/*
+ * Difference between two firmware images (header word included) as one
+ * spliced region plus patched words. Words [0, prefix) and the last
+ * 'suffix' words match, allowing branch and call targets that moved by
+ * 'shift' words with the code; the words between were replaced.
+ * 'patched' lists the new image's indices outside that region whose
+ * encoding still differs.
+ */
+struct AfucImageDiff {
+	size_t prefix = 0, suffix = 0;
+	int64_t shift = 0;
+	std::vector<size_t> patched;
+};
+
+void afuc_diff_images(const uint32_t* old_words, size_t old_count,
+                      const uint32_t* new_words, size_t new_count, AfucImageDiff& diff);
+
+/* ─── Firmware identification ──────────────────────────────── */
+
+AfucGpuVer afuc_detect_gpuver(uint32_t fw_id);
+
+/* ─── NOP payload metadata ─────────────────────────────────── */
+
+/*
+ * nop carries a 24-bit payload. The first instruction's payload is the
+ * firmware header (fw_id in bits 12-23, version in bits 0-11); a7xx images
+ * repeat that form at the start of each thread's code. Runs of printable
+ * payloads are build/version tags.
+ */
+enum AfucNopKind {
+	AFUC_NOP_RAW,
+	AFUC_NOP_FW_HEADER,   /* fw_id + version */
+	AFUC_NOP_TAG,         /* part of a printable tag */
+};
+
+struct AfucNopPayload {
+	uint64_t addr;
+	uint32_t payload;
+	AfucNopKind kind;
+};
+
+/* Every nop with a non-zero payload in 'words' (word 0 at 'base') */
+void afuc_nop_payloads(const uint32_t* words, size_t count, uint64_t base,
+                       std::vector<AfucNopPayload>& out);
+
+/* Tag strings assembled from consecutive AFUC_NOP_TAG payloads */
+std::vector<std::string> afuc_nop_tags(const std::vector<AfucNopPayload>& nops);
+
+/* Firmware ID and version from the header; 'image' is the whole file */
+bool afuc_fw_version(const uint32_t* image, size_t image_words,
+                     uint32_t& fw_id, uint32_t& version);
+
 /* ─── Register name helpers ────────────────────────────────── */
 
 const char* afuc_reg_name(AfucReg reg);
@@ -191,3 +475,104 @@ const char* afuc_dst_reg_name(uint32_t enc);
 const char* afuc_ctrl_reg_name(AfucGpuVer gpuver, uint32_t offset);
 const char* afuc_sqe_reg_name(uint32_t offset);
 const char* afuc_pipe_reg_name(AfucGpuVer gpuver, uint32_t offset);
+
+/* Reverse lookups (name without the '@' / '%' / '|' sigil) */
+bool afuc_ctrl_reg_offset(AfucGpuVer gpuver, const char* name, uint32_t& offset);
+bool afuc_sqe_reg_offset(const char* name, uint32_t& offset);
+
+/*
+ * Control registers the extra $data dwords of an (sdsN) cwrite land in,
+ * in pop order: @SDS_BASE lo, @SDS_BASE hi, @SDS_DWORDS. False where the
+ * generation has no set-draw-state registers.
+ */
+bool afuc_sds_regs(AfucGpuVer gpuver, uint32_t (&offsets)[3]);
+
+/*
+ * Register offsets and meanings differ between chips of one generation,
+ * so names come from a generation base plus a per-fw_id overlay, flattened
+ * into direct-indexed arrays. The lookups above use the generation base;
+ * the ones below take the table of a particular chip, which a firmware
+ * view records in its metadata.
+ */
+#define AFUC_CTRL_REG_COUNT 0x1000
+#define AFUC_PIPE_REG_COUNT 0x100
+
+struct AfucRegTable {
+	AfucGpuVer gpuver;
+	uint32_t fw_id;         /* 0 if no overlay applies */
+	const char* ctrl[AFUC_CTRL_REG_COUNT];
+	const char* pipe[AFUC_PIPE_REG_COUNT];
+	std::map<std::string, uint32_t> ctrl_offsets;   /* lowest offset per name */
+};
+
+const AfucRegTable* afuc_reg_table(AfucGpuVer gpuver, uint32_t fw_id);
+
+const char* afuc_ctrl_reg_name(const AfucRegTable* regs, uint32_t offset);
+const char* afuc_pipe_reg_name(const AfucRegTable* regs, uint32_t offset);
+bool afuc_ctrl_reg_offset(const AfucRegTable* regs, const char* name, uint32_t& offset);
+
+/* ─── Instruction pattern search ───────────────────────────── */
+
+/*
+ * Small pattern language over AFUC assembly, e.g.
+ *
+ *   cwrite $*, [$* + @REG_WRITE_ADDR]; ...4; (rep) cwrite $data, [$00 + @REG_WRITE]
+ *
+ * Steps are separated by ';' or newlines. Each step is an instruction
+ * template, '*' (any one instruction) or '...N' (skip 0..N instructions,
+ * N defaults to 8). Operands accept '*' wildcards ($*, @*, b*, #*) and
+ * immediate ranges written 'lo..hi'.
+ *
+ * Each template is compiled to a mask/value pair over the raw word that
+ * is used as a SIMD prefilter, plus field constraints that are verified
+ * on the decoded instruction for the (few) candidate words.
+ */
+
+enum AfucPatField : uint8_t {
+	AFUC_PF_DST,
+	AFUC_PF_SRC1,
+	AFUC_PF_SRC2,
+	AFUC_PF_IMMED,
+	AFUC_PF_SHIFT,
+	AFUC_PF_BIT,
+	AFUC_PF_LO,
+	AFUC_PF_HI,
+	AFUC_PF_BASE,
+	AFUC_PF_TARGET,   /* absolute branch/call target, in bytes */
+	AFUC_PF_PREINC,
+	AFUC_PF_REP,
+	AFUC_PF_SDS,
+	AFUC_PF_XMOV,
+	AFUC_PF_PEEK,
+};
+
+struct AfucPatConstraint {
+	AfucPatField field;
+	uint32_t lo, hi;    /* inclusive */
+};
+
+struct AfucPatInsn {
+	bool any;           /* '*': matches every word */
+	uint32_t mask;
+	uint32_t value;
+	std::vector<AfucOp> ops;
+	std::vector<AfucPatConstraint> cons;
+};
+
+struct AfucPatStep {
+	AfucPatInsn insn;
+	uint32_t max_gap;   /* instructions that may be skipped before this step */
+};
+
+struct AfucPattern {
+	AfucGpuVer gpuver;
+	std::vector<AfucPatStep> steps;
+};
+
+bool afuc_pattern_compile(const std::string& text, AfucGpuVer gpuver,
+                          AfucPattern& pat, std::string& error);
+
+/* Scan a word array (word 0 at byte address 'base') and append the byte
+ * address of the first word of every match to 'hits'. */
+void afuc_pattern_scan(const AfucPattern& pat, const uint32_t* words,
+                       size_t count, uint64_t base, std::vector<uint64_t>& hits);
@@ -0,0 +1,260 @@
+/*
+ * Native basic-block recovery.
+ *
+ * The generic analysis asks GetInstructionInfo about every word and knows
+ * nothing of delay slots or the setsecure skip. Here block boundaries for
+ * the whole image are found once as bitmaps, and each function's blocks
+ * and edges are emitted straight from them.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <bit>
+#include <map>
+
+#include "binaryninjaapi.h"
+#include "afuc.h"
+#include "afuc_scan.h"
+#include "afuc_view.h"
+
+using namespace BinaryNinja;
+using namespace std;
+
+/* ─── Flow map ─────────────────────────────────────────────── */
+
+/* Control flow is opcode group 11xxxx; everything else falls through */
+static const uint32_t s_flow_mask = 0xc0000000;
+
+static void set_bit(vector<uint64_t>& bits, size_t i)
+{
+	bits[i / 64] |= 1ull << (i % 64);
+}
+
+void afuc_build_flow_map(AfucGpuVer gpuver, vector<uint32_t> words,
+                         uint64_t base, AfucFlowMap& map)
+{
+	size_t count = words.size();
+	map.base = base;
+	map.words = std::move(words);
+	map.leader.assign((count + 63) / 64, 0);
+	map.term.assign((count + 63) / 64, 0);
+
+	const uint32_t* code = map.words.data();
+	auto mark_leader = [&](uint64_t addr) {
+		if (addr >= base && (addr - base) / 4 < count)
+			set_bit(map.leader, (addr - base) / 4);
+	};
+
+	if (count)
+		set_bit(map.leader, 0);
+
+	afuc_scan_masked(code, count, s_flow_mask, s_flow_mask, [&](size_t i) {
+		uint64_t addr = base + i * 4;
+		AfucInsn insn;
+		afuc_decode((const uint8_t*)&code[i], 4, addr, insn, gpuver);
+
+		/* undecodable control words end the block without successors */
+		if (insn.op == AFUC_INVALID) {
+			set_bit(map.term, i);
+			mark_leader(addr + 4);
+			return;
+		}
+
+		AfucFlow f = afuc_insn_flow(insn, addr);
+		switch (f.kind) {
+		case AFUC_FLOW_NEXT:
+			return;
+		case AFUC_FLOW_CALL:
+			mark_leader(f.target);
+			return;
+		case AFUC_FLOW_COND:
+		case AFUC_FLOW_JUMP:
+			mark_leader(f.target);
+			break;
+		default:
+			break;
+		}
+		set_bit(map.term, i);
+		mark_leader(addr + (f.delay_slot ? 8 : 4));
+	});
+}
+
+size_t afuc_flow_next(const vector<uint64_t>& bits, size_t from, size_t limit)
+{
+	for (size_t w = from / 64; w < bits.size() && w * 64 < limit; w++) {
+		uint64_t v = bits[w];
+		if (w == from / 64)
+			v &= ~0ull << (from % 64);
+		if (v) {
+			size_t i = w * 64 + countr_zero(v);
+			return i < limit ? i : limit;
+		}
+	}
+	return limit;
+}
+
+void afuc_word_succs(AfucGpuVer gpuver, const AfucFlowMap& map, vector<AfucWordSuccs>& out)
+{
+	size_t count = map.words.size();
+	auto word_at = [&](uint64_t addr) -> uint32_t {
+		if (addr < map.base || (addr - map.base) / 4 >= count)
+			return AFUC_NO_WORD;
+		return (uint32_t)((addr - map.base) / 4);
+	};
+
+	out.assign(count, { { AFUC_NO_WORD, AFUC_NO_WORD } });
+	for (size_t i = 0; i < count; i++)
+		out[i].s[0] = i + 1 < count ? (uint32_t)(i + 1) : AFUC_NO_WORD;
+
+	afuc_scan_masked(map.words.data(), count, s_flow_mask, s_flow_mask, [&](size_t i) {
+		uint64_t addr = map.base + i * 4;
+		AfucInsn insn;
+		afuc_decode((const uint8_t*)&map.words[i], 4, addr, insn, gpuver);
+		if (insn.op == AFUC_INVALID) {
+			out[i].s[0] = AFUC_NO_WORD;
+			return;
+		}
+
+		AfucFlow f = afuc_insn_flow(insn, addr);
+		if (f.kind == AFUC_FLOW_NEXT)
+			return;
+
+		/* targets are taken after the slot, if there is one */
+		size_t from = f.delay_slot && i + 1 < count ? i + 1 : i;
+		uint32_t next = word_at(addr + (f.delay_slot ? 8 : 4));
+		AfucWordSuccs s = { { AFUC_NO_WORD, AFUC_NO_WORD } };
+		switch (f.kind) {
+		case AFUC_FLOW_COND:
+		case AFUC_FLOW_CALL:
+			s = { { word_at(f.target), next } };
+			break;
+		case AFUC_FLOW_JUMP:
+			s.s[0] = word_at(f.target);
+			break;
+		default:
+			break;
+		}
+		out[from] = s;
+	});
+}
+
+/* ─── Binary Ninja glue ────────────────────────────────────── */
+
+bool afuc_analyze_blocks(Architecture* arch, Function* func, BasicBlockAnalysisContext& ctx,
+                         AfucGpuVer gpuver, const AfucFlowMap& map)
+{
+	size_t count = map.words.size();
+	uint64_t entry = func->GetStart();
+	if (entry < map.base || (entry - map.base) / 4 >= count || (entry - map.base) % 4)
+		return false;
+
+	auto index = [&](uint64_t addr) -> size_t {
+		if (addr < map.base || (addr - map.base) % 4)
+			return count;
+		size_t i = (addr - map.base) / 4;
+		return i < count ? i : count;
+	};
+
+	std::map<uint64_t, Ref<BasicBlock>> blocks;
+	vector<uint64_t> work = { entry };
+	uint64_t total = 0;
+
+	while (!work.empty()) {
+		uint64_t start = work.back();
+		work.pop_back();
+		size_t first = index(start);
+		if (first == count || blocks.count(start) || ctx.m_haltedDisassemblyAddresses.count(start))
+			continue;
+		if (ctx.m_maxFunctionSize && total > ctx.m_maxFunctionSize)
+			break;
+
+		Ref<BasicBlock> block = ctx.CreateBasicBlock(arch, start);
+		blocks[start] = block;
+
+		/* the block runs to its first terminator or the next leader */
+		size_t term = afuc_flow_next(map.term, first, count);
+		size_t next = afuc_flow_next(map.leader, first + 1, count);
+
+		auto edge = [&](BNBranchType type, uint64_t target, bool fall) {
+			if (index(target) == count) {
+				block->SetHasUndeterminedOutgoingEdges(true);
+				return;
+			}
+			block->AddPendingOutgoingEdge(type, target, arch, fall);
+			work.push_back(target);
+		};
+
+		/* calls inside the block: the core turns the targets into functions */
+		size_t last = term < next ? term : next - 1;
+		for (size_t i = first; i <= last && i < count; i++) {
+			if ((map.words[i] & s_flow_mask) != s_flow_mask)
+				continue;
+			AfucInsn insn;
+			uint64_t addr = map.base + i * 4;
+			afuc_decode((const uint8_t*)&map.words[i], 4, addr, insn, gpuver);
+			AfucFlow f = afuc_insn_flow(insn, addr);
+			if (f.kind == AFUC_FLOW_CALL)
+				ctx.m_newDirectCodeReferences.insert(ArchAndAddr(arch, f.target));
+		}
+
+		if (term >= next) {
+			/* fell into another block's leader (or off the end) */
+			block->SetEnd(map.base + next * 4);
+			total += (next - first) * 4;
+			if (next < count)
+				edge(UnconditionalBranch, map.base + next * 4, true);
+			else
+				block->SetHasInvalidInstructions(true);
+			continue;
+		}
+
+		uint64_t addr = map.base + term * 4;
+		AfucInsn insn;
+		afuc_decode((const uint8_t*)&map.words[term], 4, addr, insn, gpuver);
+		AfucFlow f = afuc_insn_flow(insn, addr);
+		size_t end = term + (f.delay_slot ? 2 : 1);
+		if (end > count)
+			end = count;
+		block->SetEnd(map.base + end * 4);
+		total += (end - first) * 4;
+
+		if (insn.op == AFUC_INVALID) {
+			block->SetHasInvalidInstructions(true);
+			continue;
+		}
+
+		switch (f.kind) {
+		case AFUC_FLOW_COND:
+			/* setsecure's fall through is the next word, branches skip the slot */
+			edge(TrueBranch, f.target, false);
+			edge(FalseBranch, map.base + end * 4, true);
+			break;
+		case AFUC_FLOW_JUMP:
+			edge(UnconditionalBranch, f.target, false);
+			break;
+		case AFUC_FLOW_INDIRECT:
+		{
+			/* targets resolved by data flow or set by the user */
+			auto it = ctx.m_indirectBranches.find(ArchAndAddr(arch, addr));
+			if (it == ctx.m_indirectBranches.end() || it->second.empty()) {
+				block->SetHasUndeterminedOutgoingEdges(true);
+				break;
+			}
+			for (const ArchAndAddr& t : it->second)
+				edge(IndirectBranch, t.address, false);
+			break;
+		}
+		default:
+			/* ret / iret / sret / waitin */
+			block->SetCanExit(true);
+			break;
+		}
+	}
+
+	for (const auto& [start, block] : blocks)
+		ctx.AddFunctionBasicBlock(block);
+	ctx.Finalize();
+	return true;
+}
@@ -0,0 +1,282 @@
+/*
+ * Packet handler overview: one row per packet-table entry with the
+ * handler's size, payload consumption, static cost, expected cost under
+ * the estimated branch probabilities and the control registers it
+ * writes.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <set>
+
+#include "binaryninjaapi.h"
+#include "afuc.h"
+#include "afuc_pm4.h"
+#include "afuc_view.h"
+
+using namespace BinaryNinja;
+using namespace std;
+
+/* Bumped whenever the metrics below change meaning */
+static const uint64_t s_metrics_version = 2;
+static const char* s_metrics_key = "afuc.handler_metrics";
+
+struct HandlerMetrics {
+	uint64_t insns = 0;
+	uint64_t payload = 0;       /* dwords, ~0 if not static */
+	uint64_t cost = 0;
+	uint64_t expected = 0;      /* cycles, weighted by block frequency */
+	vector<string> ctrl_writes;
+};
+
+/* ─── Metrics ──────────────────────────────────────────────── */
+
+static HandlerMetrics compute_metrics(AfucGpuVer gpuver, const AfucRegTable* regs,
+                                      const uint32_t* code, size_t count, uint64_t entry,
+                                      const map<uint64_t, uint32_t>& overrides)
+{
+	HandlerMetrics m;
+	vector<uint64_t> addrs;
+	afuc_handler_insns(gpuver, code, count, entry, addrs);
+	m.insns = addrs.size();
+
+	for (uint64_t addr : addrs) {
+		AfucInsn insn;
+		if (!afuc_decode((const uint8_t*)&code[addr / 4], 4, addr, insn, gpuver))
+			continue;
+		m.cost += afuc_insn_cost(insn);
+		if (insn.op != AFUC_CWRITE)
+			continue;
+
+		const char* name = afuc_ctrl_reg_name(regs, insn.base);
+		char buf[32];
+		if (!name) {
+			snprintf(buf, sizeof(buf), "0x%03x", insn.base);
+			name = buf;
+		}
+		if (find(m.ctrl_writes.begin(), m.ctrl_writes.end(), name) == m.ctrl_writes.end())
+			m.ctrl_writes.push_back(name);
+	}
+
+	vector<AfucPayloadRead> reads;
+	int dwords;
+	afuc_payload_reads(gpuver, code, count, entry, reads, &dwords);
+	m.payload = dwords < 0 ? ~0ull : (uint64_t)dwords;
+	m.expected = (uint64_t)llround(afuc_expected_cost(gpuver, code, count, entry, overrides));
+	return m;
+}
+
+/* Metrics are cached on the handler's function so reopening is free */
+static bool load_metrics(Function* func, HandlerMetrics& m)
+{
+	Ref<Metadata> md = func->QueryMetadata(s_metrics_key);
+	if (!md || !md->IsKeyValueStore())
+		return false;
+	auto kv = md->GetKeyValueStore();
+	if (!kv.count("version") || kv["version"]->GetUnsignedInteger() != s_metrics_version)
+		return false;
+	m.insns = kv["insns"]->GetUnsignedInteger();
+	m.payload = kv["payload"]->GetUnsignedInteger();
+	m.cost = kv["cost"]->GetUnsignedInteger();
+	m.expected = kv["expected"]->GetUnsignedInteger();
+	m.ctrl_writes.clear();
+	for (const Ref<Metadata>& r : kv["ctrl_writes"]->GetArray())
+		m.ctrl_writes.push_back(r->GetString());
+	return true;
+}
+
+static void store_metrics(Function* func, const HandlerMetrics& m)
+{
+	map<string, Ref<Metadata>> kv;
+	kv["version"] = new Metadata(s_metrics_version);
+	kv["insns"] = new Metadata(m.insns);
+	kv["payload"] = new Metadata(m.payload);
+	kv["cost"] = new Metadata(m.cost);
+	kv["expected"] = new Metadata(m.expected);
+	kv["ctrl_writes"] = new Metadata(m.ctrl_writes);
+	func->StoreMetadata(s_metrics_key, new Metadata(kv), true);
+}
+
+/* Views whose invalidation is held while a reload writes */
+static mutex s_hold_lock;
+static map<BNBinaryView*, size_t> s_held;
+
+void afuc_hold_handler_metrics(BinaryView* view, bool hold)
+{
+	lock_guard<mutex> lock(s_hold_lock);
+	size_t& n = s_held[view->GetObject()];
+	n += hold ? 1 : -1;
+	if (!n)
+		s_held.erase(view->GetObject());
+}
+
+void afuc_invalidate_handler_metrics(BinaryView* view, const set<uint64_t>& changed, bool all)
+{
+	{
+		lock_guard<mutex> lock(s_hold_lock);
+		if (s_held.count(view->GetObject()))
+			return;
+	}
+	AfucGpuVer gpuver;
+	if (!afuc_view_gpuver(view, gpuver))
+		return;
+	uint64_t base;
+	vector<uint32_t> code;
+	bool have_code = false;
+
+	for (const Ref<Function>& func : view->GetAnalysisFunctionList()) {
+		if (!func->QueryMetadata(s_metrics_key) && !func->QueryMetadata(AFUC_HANDLER_EFFECTS_KEY))
+			continue;
+		bool stale = all;
+		if (!stale) {
+			/* this runs from change notifications; most views have nothing cached */
+			if (!have_code) {
+				code = afuc_read_code(view, base);
+				have_code = true;
+			}
+			/* the handler's reach crosses function boundaries */
+			vector<uint64_t> addrs;
+			afuc_handler_insns(gpuver, code.data(), code.size(), func->GetStart(), addrs);
+			stale = any_of(addrs.begin(), addrs.end(), [&](uint64_t a) { return changed.count(a); });
+		}
+		if (stale) {
+			func->RemoveMetadata(s_metrics_key);
+			func->RemoveMetadata(AFUC_HANDLER_EFFECTS_KEY);
+		}
+	}
+}
+
+/* ─── Plugin command ───────────────────────────────────────── */
+
+static string handlers_report(AfucGpuVer gpuver, const vector<uint64_t>& table,
+                              const map<uint64_t, size_t>& users,
+                              const map<uint64_t, HandlerMetrics>& metrics,
+                              size_t computed, size_t skipped)
+{
+	string report = "# AFUC packet handlers\n\n"
+		"| Opcode | Packet | Handler | Insns | Payload | Cost | Expected | Control registers written |\n"
+		"|---|---|---|---|---|---|---|---|\n";
+	char buf[128];
+	bool default_shown = false;
+	for (size_t op = 0; op < table.size(); op++) {
+		uint64_t addr = table[op];
+		auto it = metrics.find(addr);
+		if (it == metrics.end())
+			continue;
+
+		string packet;
+		size_t n = users.at(addr);
+		if (n > AFUC_PM4_SHARED_HANDLER_MAX) {
+			if (default_shown)
+				continue;
+			default_shown = true;
+			snprintf(buf, sizeof(buf), "*default* (%zu opcodes)", n);
+			packet = buf;
+		} else {
+			const char* name = afuc_pm4_packet_name(gpuver, (uint32_t)op);
+			packet = name ? name : "?";
+		}
+
+		const HandlerMetrics& m = it->second;
+		string payload = m.payload == ~0ull ? "dynamic" : to_string(m.payload);
+		string regs;
+		for (const string& r : m.ctrl_writes)
+			regs += (regs.empty() ? "@" : ", @") + r;
+
+		snprintf(buf, sizeof(buf), "| 0x%02zx | %s | 0x%" PRIx64 " | %" PRIu64 " | ",
+			op, packet.c_str(), addr, m.insns);
+		report += buf + payload + " | " + to_string(m.cost) + " | " + to_string(m.expected) +
+			" | " + regs + " |\n";
+	}
+
+	snprintf(buf, sizeof(buf), "\n%zu handlers (%zu computed, %zu cached)\n",
+		metrics.size(), computed, metrics.size() - computed);
+	report += buf;
+	if (skipped) {
+		snprintf(buf, sizeof(buf), "\n*Cancelled: %zu handlers not measured.*\n", skipped);
+		report += buf;
+	}
+	return report;
+}
+
+static void show_handlers(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	if (!afuc_view_gpuver(view, gpuver))
+		return;
+
+	Ref<Metadata> md = view->QueryMetadata("afuc.packet_table");
+	if (!md || !md->IsArray()) {
+		LogError("AFUC: no packet table recovered for this firmware");
+		return;
+	}
+	vector<uint64_t> table = md->GetUnsignedIntegerList();
+
+	Ref<BinaryView> ref = view;
+	const AfucRegTable* regs = afuc_view_reg_table(view);
+	WorkerEnqueue([=]() {
+		Ref<BackgroundTask> task = new BackgroundTask("Computing AFUC handler metrics...", true);
+		uint64_t base;
+		vector<uint32_t> code = afuc_read_code(ref, base);
+		Ref<Platform> plat = ref->GetDefaultPlatform();
+		map<uint64_t, uint32_t> overrides = afuc_branch_overrides(ref);
+
+		map<uint64_t, size_t> users;
+		for (uint64_t h : table)
+			users[h]++;
+
+		/* cached metrics first, so cancelling still shows everything known */
+		map<uint64_t, HandlerMetrics> metrics;
+		vector<pair<uint64_t, Ref<Function>>> todo;
+		for (const auto& [addr, n] : users) {
+			if (addr / 4 >= code.size())
+				continue;
+			Ref<Function> func = plat ? ref->GetAnalysisFunction(plat, addr) : nullptr;
+			HandlerMetrics m;
+			if (func && load_metrics(func, m))
+				metrics[addr] = m;
+			else
+				todo.push_back({ addr, func });
+		}
+
+		size_t computed = 0;
+		char buf[96];
+		for (const auto& [addr, func] : todo) {
+			if (task->IsCancelled())
+				break;
+			snprintf(buf, sizeof(buf), "Computing AFUC handler metrics (%zu/%zu)...", computed + 1, todo.size());
+			task->SetProgressText(buf);
+			HandlerMetrics m = compute_metrics(gpuver, regs, code.data(), code.size(), addr, overrides);
+			if (func)
+				store_metrics(func, m);
+			metrics[addr] = m;
+			computed++;
+		}
+
+		task->Finish();
+		string report = handlers_report(gpuver, table, users, metrics, computed,
+			todo.size() - computed);
+		ShowMarkdownReport("AFUC Packet Handlers", report, report);
+	}, "AFUC handler metrics");
+}
+
+static bool has_packet_table(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	return afuc_view_gpuver(view, gpuver) && view->QueryMetadata("afuc.packet_table");
+}
+
+void afuc_register_dashboard_commands()
+{
+	PluginCommand::Register("AFUC\\Packet Handlers",
+		"List every packet-table entry with its handler's size, payload and cost",
+		show_handlers, has_packet_table);
+}
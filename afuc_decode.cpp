@@ -61,212 +61,46 @@ const char* afuc_reg_name(AfucReg reg)
 
 /* ─── ALU Opcode Lookup Tables ─────────────────────────────── */
 
-struct AluEntry {
-	AfucOp op;
-	int nsrc; /* 1 or 2 */
+/* Opcode field → op, expanded from the ISA description at compile time */
+struct AluTable {
+	AfucOp op[32];
 };
 
-/* 2-source register sub-opcodes (bits[0:4]) for a5xx/a6xx */
-static const AluEntry s_alu2src_a6[32] = {
-	/* 0x00 */ { AFUC_INVALID, 0 },
-	/* 0x01 */ { AFUC_ADD, 2 },
-	/* 0x02 */ { AFUC_ADDHI, 2 },
-	/* 0x03 */ { AFUC_SUB, 2 },
-	/* 0x04 */ { AFUC_SUBHI, 2 },
-	/* 0x05 */ { AFUC_AND, 2 },
-	/* 0x06 */ { AFUC_OR, 2 },
-	/* 0x07 */ { AFUC_XOR, 2 },
-	/* 0x08 */ { AFUC_NOT, 1 },
-	/* 0x09 */ { AFUC_SHL, 2 },
-	/* 0x0a */ { AFUC_USHR, 2 },
-	/* 0x0b */ { AFUC_ISHR, 2 },
-	/* 0x0c */ { AFUC_ROT, 2 },
-	/* 0x0d */ { AFUC_MUL8, 2 },
-	/* 0x0e */ { AFUC_MIN, 2 },
-	/* 0x0f */ { AFUC_MAX, 2 },
-	/* 0x10 */ { AFUC_CMP, 2 },
-	/* 0x11 */ { AFUC_INVALID, 0 },
-	/* 0x12 */ { AFUC_INVALID, 0 },
-	/* 0x13 */ { AFUC_INVALID, 0 },
-	/* 0x14 */ { AFUC_MSB, 1 },
-	/* 0x15 */ { AFUC_INVALID, 0 },
-	/* 0x16 */ { AFUC_INVALID, 0 },
-	/* 0x17 */ { AFUC_INVALID, 0 },
-	/* 0x18 */ { AFUC_INVALID, 0 },
-	/* 0x19 */ { AFUC_INVALID, 0 },
-	/* 0x1a */ { AFUC_INVALID, 0 },
-	/* 0x1b */ { AFUC_INVALID, 0 },
-	/* 0x1c */ { AFUC_INVALID, 0 },
-	/* 0x1d */ { AFUC_INVALID, 0 },
-	/* 0x1e */ { AFUC_INVALID, 0 },
-	/* 0x1f */ { AFUC_INVALID, 0 },
-};
+static constexpr AluTable make_alu_table(bool a7, bool immed)
+{
+	AluTable t = {};
+	for (AfucOp& op : t.op)
+		op = AFUC_INVALID;
+	for (const AfucIsaDesc& d : afuc_isa) {
+		uint8_t opc = d.alu[a7][immed];
+		if (opc)
+			t.op[opc] = d.op;
+	}
+	return t;
+}
 
-/* 2-source register sub-opcodes for a7xx */
-static const AluEntry s_alu2src_a7[32] = {
-	/* 0x00 */ { AFUC_INVALID, 0 },
-	/* 0x01 */ { AFUC_ADD, 2 },
-	/* 0x02 */ { AFUC_ADDHI, 2 },
-	/* 0x03 */ { AFUC_SUB, 2 },
-	/* 0x04 */ { AFUC_SUBHI, 2 },
-	/* 0x05 */ { AFUC_AND, 2 },
-	/* 0x06 */ { AFUC_OR, 2 },
-	/* 0x07 */ { AFUC_XOR, 2 },
-	/* 0x08 */ { AFUC_NOT, 1 },
-	/* 0x09 */ { AFUC_BIC, 2 },
-	/* 0x0a */ { AFUC_MIN, 2 },
-	/* 0x0b */ { AFUC_MAX, 2 },
-	/* 0x0c */ { AFUC_MUL8, 2 },
-	/* 0x0d */ { AFUC_CMP, 2 },
-	/* 0x0e */ { AFUC_INVALID, 0 },
-	/* 0x0f */ { AFUC_INVALID, 0 },
-	/* 0x10 */ { AFUC_INVALID, 0 },
-	/* 0x11 */ { AFUC_INVALID, 0 },
-	/* 0x12 */ { AFUC_SHL, 2 },
-	/* 0x13 */ { AFUC_USHR, 2 },
-	/* 0x14 */ { AFUC_ISHR, 2 },
-	/* 0x15 */ { AFUC_ROT, 2 },
-	/* 0x16 */ { AFUC_SETBIT_R, 2 },
-	/* 0x17 */ { AFUC_INVALID, 0 },
-	/* 0x18 */ { AFUC_INVALID, 0 },
-	/* 0x19 */ { AFUC_MSB, 1 },
-	/* 0x1a */ { AFUC_INVALID, 0 },
-	/* 0x1b */ { AFUC_INVALID, 0 },
-	/* 0x1c */ { AFUC_INVALID, 0 },
-	/* 0x1d */ { AFUC_INVALID, 0 },
-	/* 0x1e */ { AFUC_INVALID, 0 },
-	/* 0x1f */ { AFUC_INVALID, 0 },
+/* [a7xx][immediate] */
+static constexpr AluTable s_alu[2][2] = {
+	{ make_alu_table(false, false), make_alu_table(false, true) },
+	{ make_alu_table(true, false),  make_alu_table(true, true) },
 };
 
-/* ALU immediate opcodes (bits[27:31]) for a5xx/a6xx */
-struct AluImmEntry {
-	AfucOp op;
-	bool has_src1;
-};
+static_assert(s_alu[0][0].op[0x06] == AFUC_OR && s_alu[1][0].op[0x12] == AFUC_SHL,
+              "ALU tables out of sync with AFUC_ISA");
 
-static const AluImmEntry s_aluimm_a6[32] = {
-	/* 0x00 */ { AFUC_INVALID, false },
-	/* 0x01 */ { AFUC_ADD, true },
-	/* 0x02 */ { AFUC_ADDHI, true },
-	/* 0x03 */ { AFUC_SUB, true },
-	/* 0x04 */ { AFUC_SUBHI, true },
-	/* 0x05 */ { AFUC_AND, true },
-	/* 0x06 */ { AFUC_OR, true },
-	/* 0x07 */ { AFUC_XOR, true },
-	/* 0x08 */ { AFUC_NOT, false },
-	/* 0x09 */ { AFUC_SHL, true },
-	/* 0x0a */ { AFUC_USHR, true },
-	/* 0x0b */ { AFUC_ISHR, true },
-	/* 0x0c */ { AFUC_ROT, true },
-	/* 0x0d */ { AFUC_MUL8, true },
-	/* 0x0e */ { AFUC_MIN, true },
-	/* 0x0f */ { AFUC_MAX, true },
-	/* 0x10 */ { AFUC_CMP, true },
-	/* 0x11 */ { AFUC_INVALID, false },
-	/* 0x12 */ { AFUC_INVALID, false },
-	/* 0x13 */ { AFUC_INVALID, false },
-	/* 0x14 */ { AFUC_INVALID, false },
-	/* 0x15 */ { AFUC_INVALID, false },
-	/* 0x16 */ { AFUC_INVALID, false },
-	/* 0x17 */ { AFUC_INVALID, false },
-	/* 0x18 */ { AFUC_INVALID, false },
-	/* 0x19 */ { AFUC_INVALID, false },
-	/* 0x1a */ { AFUC_INVALID, false },
-	/* 0x1b */ { AFUC_INVALID, false },
-	/* 0x1c */ { AFUC_INVALID, false },
-	/* 0x1d */ { AFUC_INVALID, false },
-	/* 0x1e */ { AFUC_INVALID, false },
-	/* 0x1f */ { AFUC_INVALID, false },
-};
-
-static const AluImmEntry s_aluimm_a7[32] = {
-	/* 0x00 */ { AFUC_INVALID, false },
-	/* 0x01 */ { AFUC_ADD, true },
-	/* 0x02 */ { AFUC_ADDHI, true },
-	/* 0x03 */ { AFUC_SUB, true },
-	/* 0x04 */ { AFUC_SUBHI, true },
-	/* 0x05 */ { AFUC_AND, true },
-	/* 0x06 */ { AFUC_OR, true },
-	/* 0x07 */ { AFUC_XOR, true },
-	/* 0x08 */ { AFUC_NOT, false },
-	/* 0x09 */ { AFUC_BIC, true },
-	/* 0x0a */ { AFUC_MIN, true },
-	/* 0x0b */ { AFUC_MAX, true },
-	/* 0x0c */ { AFUC_MUL8, true },
-	/* 0x0d */ { AFUC_CMP, true },
-	/* 0x0e */ { AFUC_INVALID, false },
-	/* 0x0f */ { AFUC_INVALID, false },
-	/* 0x10 */ { AFUC_INVALID, false },
-	/* 0x11 */ { AFUC_INVALID, false },
-	/* 0x12 */ { AFUC_INVALID, false },
-	/* 0x13 */ { AFUC_INVALID, false },
-	/* 0x14 */ { AFUC_INVALID, false },
-	/* 0x15 */ { AFUC_INVALID, false },
-	/* 0x16 */ { AFUC_INVALID, false },
-	/* 0x17 */ { AFUC_INVALID, false },
-	/* 0x18 */ { AFUC_INVALID, false },
-	/* 0x19 */ { AFUC_INVALID, false },
-	/* 0x1a */ { AFUC_INVALID, false },
-	/* 0x1b */ { AFUC_INVALID, false },
-	/* 0x1c */ { AFUC_INVALID, false },
-	/* 0x1d */ { AFUC_INVALID, false },
-	/* 0x1e */ { AFUC_INVALID, false },
-	/* 0x1f */ { AFUC_INVALID, false },
-};
+bool afuc_alu_opcode(AfucGpuVer gpuver, AfucOp op, bool immed, uint32_t& opc)
+{
+	if (op >= AFUC_INVALID)
+		return false;
+	opc = afuc_isa[op].alu[gpuver >= AFUC_A7XX][immed];
+	return opc != 0;
+}
 
 /* ─── Mnemonic Names ───────────────────────────────────────── */
 
 const char* afuc_op_name(AfucOp op)
 {
-	switch (op) {
-	case AFUC_NOP:       return "nop";
-	case AFUC_ADD:       return "add";
-	case AFUC_ADDHI:     return "addhi";
-	case AFUC_SUB:       return "sub";
-	case AFUC_SUBHI:     return "subhi";
-	case AFUC_AND:       return "and";
-	case AFUC_OR:        return "or";
-	case AFUC_XOR:       return "xor";
-	case AFUC_NOT:       return "not";
-	case AFUC_SHL:       return "shl";
-	case AFUC_USHR:      return "ushr";
-	case AFUC_ISHR:      return "ishr";
-	case AFUC_ROT:       return "rot";
-	case AFUC_MUL8:      return "mul8";
-	case AFUC_MIN:       return "min";
-	case AFUC_MAX:       return "max";
-	case AFUC_CMP:       return "cmp";
-	case AFUC_BIC:       return "bic";
-	case AFUC_MSB:       return "msb";
-	case AFUC_MOV:       return "mov";
-	case AFUC_MOVI:      return "mov";
-	case AFUC_SETBIT:    return "setbit";
-	case AFUC_CLRBIT:    return "clrbit";
-	case AFUC_SETBIT_R:  return "setbit";
-	case AFUC_UBFX:      return "ubfx";
-	case AFUC_BFI:       return "bfi";
-	case AFUC_CWRITE:    return "cwrite";
-	case AFUC_CREAD:     return "cread";
-	case AFUC_SWRITE:    return "swrite";
-	case AFUC_SREAD:     return "sread";
-	case AFUC_STORE:     return "store";
-	case AFUC_LOAD:      return "load";
-	case AFUC_BRNE_IMM:  return "brne";
-	case AFUC_BREQ_IMM:  return "breq";
-	case AFUC_BRNE_BIT:  return "brne";
-	case AFUC_BREQ_BIT:  return "breq";
-	case AFUC_JUMP:      return "jump";
-	case AFUC_CALL:      return "call";
-	case AFUC_RET:       return "ret";
-	case AFUC_IRET:      return "iret";
-	case AFUC_WAITIN:    return "waitin";
-	case AFUC_BL:        return "bl";
-	case AFUC_JUMPA:     return "jumpa";
-	case AFUC_JUMPR:     return "jump";
-	case AFUC_SRET:      return "sret";
-	case AFUC_SETSECURE: return "setsecure";
-	default:             return "???";
-	}
+	return op < AFUC_INVALID ? afuc_isa[op].name : "???";
 }
 
 /* ─── Helper: sign-extend ──────────────────────────────────── */
@@ -395,10 +229,9 @@ bool afuc_decode(const uint8_t* data, size_t len, uint64_t addr,
 	/* ─── ALU 2-source register ────────────────────────── */
 	if (top5 == 0x13) { /* 10011 */
 		uint32_t sub_opc = w & 0x1f;
-		const AluEntry* table = (gpuver >= AFUC_A7XX) ? s_alu2src_a7 : s_alu2src_a6;
-		const AluEntry& e = table[sub_opc];
+		AfucOp op = s_alu[gpuver >= AFUC_A7XX][0].op[sub_opc];
 
-		if (e.op == AFUC_INVALID && sub_opc != 0)
+		if (op == AFUC_INVALID && sub_opc != 0)
 			return true; /* unknown sub-opcode */
 
 		insn.peek = (w >> 8) & 1;
@@ -412,12 +245,12 @@ bool afuc_decode(const uint8_t* data, size_t len, uint64_t addr,
 		insn.src2 = afuc_src_reg(insn.src2_enc);
 
 		/* Special: OR with src1=0 → MOV */
-		if (e.op == AFUC_OR && insn.src1_enc == 0) {
+		if (op == AFUC_OR && insn.src1_enc == 0) {
 			insn.op = AFUC_MOV;
 			insn.is_1src = true;
 		} else {
-			insn.op = e.op;
-			insn.is_1src = (e.nsrc == 1);
+			insn.op = op;
+			insn.is_1src = (afuc_op_form(op) == AFUC_FORM_ALU1);
 		}
 		return true;
 	}
@@ -564,17 +397,16 @@ bool afuc_decode(const uint8_t* data, size_t len, uint64_t addr,
 
 	/* ─── ALU with 16-bit immediate ────────────────────── */
 	{
-		const AluImmEntry* table = (gpuver >= AFUC_A7XX) ? s_aluimm_a7 : s_aluimm_a6;
-		if (top5 >= 1 && top5 <= 0x10 && table[top5].op != AFUC_INVALID) {
-			const AluImmEntry& e = table[top5];
-			insn.op = e.op;
+		AfucOp op = s_alu[gpuver >= AFUC_A7XX][1].op[top5];
+		if (top5 >= 1 && top5 <= 0x10 && op != AFUC_INVALID) {
+			insn.op = op;
 			insn.immed = w & 0xffff;
 			insn.dst_enc = (w >> 16) & 0x1f;
 			insn.src1_enc = (w >> 21) & 0x1f;
 			insn.dst = afuc_dst_reg(insn.dst_enc);
 			insn.src1 = afuc_src_reg(insn.src1_enc);
 			insn.is_immed = true;
-			insn.is_1src = !e.has_src1;
+			insn.is_1src = (afuc_op_form(op) == AFUC_FORM_ALU1);
 			return true;
 		}
 	}
@@ -583,3 +415,225 @@ bool afuc_decode(const uint8_t* data, size_t len, uint64_t addr,
 	insn.op = AFUC_INVALID;
 	return true;
 }
+
+/* ─── Operand / control-flow helpers ───────────────────────── */
+
+static inline uint32_t reg_bit(uint32_t enc)
+{
+	return 1u << enc;
+}
+
+uint32_t afuc_insn_src_regs(const AfucInsn& insn)
+{
+	uint32_t m = 0;
+
+	switch (insn.op) {
+	case AFUC_ADD: case AFUC_ADDHI: case AFUC_SUB: case AFUC_SUBHI:
+	case AFUC_AND: case AFUC_OR: case AFUC_XOR:
+	case AFUC_SHL: case AFUC_USHR: case AFUC_ISHR: case AFUC_ROT:
+	case AFUC_MUL8: case AFUC_MIN: case AFUC_MAX: case AFUC_CMP:
+	case AFUC_BIC: case AFUC_SETBIT_R:
+		m = reg_bit(insn.src1_enc);
+		if (!insn.is_immed)
+			m |= reg_bit(insn.src2_enc);
+		break;
+	case AFUC_NOT:
+	case AFUC_MSB:
+	case AFUC_MOV:
+		if (!insn.is_immed)
+			m = reg_bit(insn.src2_enc);
+		break;
+	case AFUC_MOVI:
+		break;
+	case AFUC_BFI:
+		/* inserts into the old destination value */
+		if (insn.dst_enc < 0x1d)
+			m = reg_bit(insn.dst_enc);
+		/* fallthrough */
+	case AFUC_SETBIT: case AFUC_CLRBIT: case AFUC_UBFX:
+	case AFUC_LOAD: case AFUC_CREAD: case AFUC_SREAD:
+	case AFUC_BRNE_IMM: case AFUC_BREQ_IMM:
+	case AFUC_BRNE_BIT: case AFUC_BREQ_BIT:
+	case AFUC_JUMPR:
+		m |= reg_bit(insn.src1_enc);
+		break;
+	case AFUC_STORE: case AFUC_CWRITE: case AFUC_SWRITE:
+		m = reg_bit(insn.src1_enc) | reg_bit(insn.src2_enc);
+		/* (sdsN) pops N more dwords for the draw-state registers */
+		if (insn.sds)
+			m |= reg_bit(REG_DATA);
+		break;
+	case AFUC_SRET:
+		m = reg_bit(REG_LR);
+		break;
+	case AFUC_SETSECURE:
+		m = reg_bit(REG_R02);
+		break;
+	default:
+		break;
+	}
+
+	/* (rep) and (xmovN) count down $rem */
+	if (insn.rep || insn.xmov)
+		m |= reg_bit(REG_REM);
+	return m & ~reg_bit(REG_R00);
+}
+
+uint32_t afuc_insn_dst_regs(const AfucInsn& insn)
+{
+	uint32_t m = 0;
+
+	switch (insn.op) {
+	case AFUC_ADD: case AFUC_ADDHI: case AFUC_SUB: case AFUC_SUBHI:
+	case AFUC_AND: case AFUC_OR: case AFUC_XOR: case AFUC_NOT:
+	case AFUC_SHL: case AFUC_USHR: case AFUC_ISHR: case AFUC_ROT:
+	case AFUC_MUL8: case AFUC_MIN: case AFUC_MAX: case AFUC_CMP:
+	case AFUC_BIC: case AFUC_MSB: case AFUC_MOV: case AFUC_MOVI:
+	case AFUC_SETBIT: case AFUC_CLRBIT: case AFUC_SETBIT_R:
+	case AFUC_UBFX: case AFUC_BFI:
+	case AFUC_LOAD: case AFUC_CREAD: case AFUC_SREAD:
+		m = reg_bit(insn.dst_enc);
+		break;
+	case AFUC_BL:
+		m = reg_bit(REG_LR);
+		break;
+	default:
+		break;
+	}
+
+	/* '!' writes the incremented address back to the base register */
+	if (insn.preincrement) {
+		switch (insn.op) {
+		case AFUC_STORE: case AFUC_CWRITE: case AFUC_SWRITE:
+			m |= reg_bit(insn.src2_enc);
+			break;
+		case AFUC_LOAD: case AFUC_CREAD: case AFUC_SREAD:
+			m |= reg_bit(insn.src1_enc);
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (insn.rep || insn.xmov)
+		m |= reg_bit(REG_REM);
+	return m & ~reg_bit(REG_R00);
+}
+
+int afuc_insn_data_reads(const AfucInsn& insn)
+{
+	uint32_t src = afuc_insn_src_regs(insn);
+	if (!(src & reg_bit(REG_DATA)) || insn.peek)
+		return 0;
+	if (insn.rep || insn.xmov)
+		return -1;
+
+	/* both operands may name $data, each read pops one dword */
+	int n = 0;
+	switch (insn.op) {
+	case AFUC_STORE: case AFUC_CWRITE: case AFUC_SWRITE:
+		n = (insn.src1_enc == 0x1f) + (insn.src2_enc == 0x1f) + insn.sds;
+		break;
+	default:
+		if (!insn.is_immed && insn.src1_enc == 0x1f && insn.src2_enc == 0x1f &&
+		    !insn.is_1src && insn.op != AFUC_MOV)
+			n = 2;
+		else
+			n = 1;
+		break;
+	}
+	return n;
+}
+
+AfucFlow afuc_insn_flow(const AfucInsn& insn, uint64_t addr)
+{
+	AfucFlow f = { AFUC_FLOW_NEXT, 0, false };
+
+	switch (insn.op) {
+	case AFUC_BRNE_IMM: case AFUC_BREQ_IMM:
+	case AFUC_BRNE_BIT: case AFUC_BREQ_BIT:
+		f.kind = AFUC_FLOW_COND;
+		f.target = addr + 4 + (int64_t)insn.branch_offset * 4;
+		f.delay_slot = true;
+		break;
+	case AFUC_JUMP:
+		f.kind = AFUC_FLOW_JUMP;
+		f.target = addr + 4 + (int64_t)insn.branch_offset * 4;
+		f.delay_slot = true;
+		break;
+	case AFUC_JUMPA:
+		f.kind = AFUC_FLOW_JUMP;
+		f.target = (uint64_t)insn.branch_target * 4;
+		f.delay_slot = true;
+		break;
+	case AFUC_CALL:
+	case AFUC_BL:
+		f.kind = AFUC_FLOW_CALL;
+		f.target = (uint64_t)insn.branch_target * 4;
+		f.delay_slot = true;
+		break;
+	case AFUC_RET: case AFUC_IRET: case AFUC_SRET:
+		f.kind = AFUC_FLOW_RET;
+		f.delay_slot = true;
+		break;
+	case AFUC_JUMPR:
+		f.kind = AFUC_FLOW_INDIRECT;
+		f.delay_slot = true;
+		break;
+	case AFUC_WAITIN:
+		f.kind = AFUC_FLOW_WAITIN;
+		f.delay_slot = true;
+		break;
+	case AFUC_SETSECURE:
+		/* on success execution resumes three instructions later */
+		f.kind = AFUC_FLOW_COND;
+		f.target = addr + 4 + 3 * 4;
+		break;
+	default:
+		break;
+	}
+	return f;
+}
+
+uint32_t afuc_insn_cost(const AfucInsn& insn)
+{
+	uint32_t cost;
+	switch (insn.op) {
+	case AFUC_NOP:
+		return 1;
+	case AFUC_CREAD: case AFUC_SREAD:
+		cost = 2;
+		break;
+	case AFUC_CWRITE: case AFUC_SWRITE:
+		cost = 1;
+		break;
+	case AFUC_LOAD:
+		cost = 4;
+		break;
+	case AFUC_STORE:
+		cost = 2;
+		break;
+	case AFUC_BRNE_IMM: case AFUC_BREQ_IMM:
+	case AFUC_BRNE_BIT: case AFUC_BREQ_BIT:
+	case AFUC_JUMP: case AFUC_JUMPA: case AFUC_JUMPR:
+	case AFUC_CALL: case AFUC_BL:
+	case AFUC_RET: case AFUC_IRET: case AFUC_SRET:
+		cost = 2;
+		break;
+	case AFUC_WAITIN:
+		cost = 3;
+		break;
+	case AFUC_SETSECURE:
+		cost = 8;
+		break;
+	default:
+		cost = 1;
+		break;
+	}
+
+	/* $memdata / $regdata reads wait on the fetch stream */
+	uint32_t src = afuc_insn_src_regs(insn);
+	if (src & (reg_bit(REG_MEMDATA) | reg_bit(REG_REGDATA)))
+		cost += 2;
+	return cost;
+}
@@ -0,0 +1,150 @@
+/*
+ * On-demand handler analysis.
+ *
+ * With afuc.analysis.onDemand set, a view only maps its code and names
+ * the packet handlers on load; nothing is queued for analysis, so
+ * opening dozens of images costs little more than reading them. A
+ * handler is analyzed when it is asked for (Analyze Handler, or making a
+ * function at it), which also names its payload reads and prefetches
+ * its direct callees on a worker thread, so the functions one is likely
+ * to step into next are ready by the time they are visited.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <set>
+
+#include "binaryninjaapi.h"
+#include "afuc.h"
+#include "afuc_view.h"
+
+using namespace BinaryNinja;
+using namespace std;
+
+static const char* s_demanded_key = "afuc.demanded";
+
+/* ─── Call-graph neighbors ─────────────────────────────────── */
+
+/* Direct call targets of the code reached from 'entry', not following calls */
+static set<uint64_t> direct_callees(AfucGpuVer gpuver, const AfucFlowMap& map, uint64_t entry)
+{
+	set<uint64_t> callees, seen;
+	vector<uint64_t> work = { entry };
+	size_t count = map.words.size();
+
+	while (!work.empty()) {
+		uint64_t pc = work.back();
+		work.pop_back();
+
+		for (; pc >= map.base && (pc - map.base) / 4 < count && seen.insert(pc).second; pc += 4) {
+			/* only the 11xxxx opcode group transfers control */
+			const uint32_t* word = &map.words[(pc - map.base) / 4];
+			if ((*word >> 30) != 3)
+				continue;
+			AfucInsn insn;
+			if (!afuc_decode((const uint8_t*)word, 4, pc, insn, gpuver))
+				break;
+			AfucFlow f = afuc_insn_flow(insn, pc);
+			if (f.kind == AFUC_FLOW_CALL) {
+				callees.insert(f.target);
+				continue;
+			}
+			if (f.kind == AFUC_FLOW_NEXT)
+				continue;
+			uint64_t next = pc + (f.delay_slot ? 8 : 4);
+			if (f.kind == AFUC_FLOW_COND) {
+				work.push_back(f.target);
+				work.push_back(next);
+			} else if (f.kind == AFUC_FLOW_JUMP) {
+				work.push_back(f.target);
+			}
+			break;
+		}
+	}
+	return callees;
+}
+
+static void prefetch_callees(BinaryView* view, uint64_t addr)
+{
+	AfucGpuVer gpuver;
+	Ref<Platform> plat = view->GetDefaultPlatform();
+	shared_ptr<const AfucFlowMap> map = afuc_view_flow_map(view);
+	if (!plat || !map || !afuc_view_gpuver(view, gpuver))
+		return;
+
+	size_t queued = 0;
+	for (uint64_t callee : direct_callees(gpuver, *map, addr)) {
+		if ((callee - map->base) / 4 >= map->words.size() || view->GetAnalysisFunction(plat, callee))
+			continue;
+		view->AddFunctionForAnalysis(plat, callee);
+		queued++;
+	}
+	if (queued)
+		view->UpdateAnalysis();
+}
+
+/* ─── Demand ───────────────────────────────────────────────── */
+
+bool afuc_view_on_demand(BinaryView* view)
+{
+	Ref<Settings> settings = Settings::Instance();
+	return settings->Contains(AFUC_ON_DEMAND_SETTING) &&
+		settings->Get<bool>(AFUC_ON_DEMAND_SETTING, view);
+}
+
+void afuc_demand_function(BinaryView* view, uint64_t addr)
+{
+	Ref<Platform> plat = view->GetDefaultPlatform();
+	if (!plat)
+		return;
+
+	/* a user function: the workflow annotates it and prefetches once
+	 * it has been analyzed */
+	if (!view->GetAnalysisFunction(plat, addr))
+		view->CreateUserFunction(plat, addr);
+	view->UpdateAnalysis();
+}
+
+void afuc_demand_analyzed(Function* func)
+{
+	Ref<BinaryView> view = func->GetView();
+	if (!afuc_view_on_demand(view) || func->WasAutomaticallyDiscovered() ||
+	    func->QueryMetadata(s_demanded_key))
+		return;
+	func->StoreMetadata(s_demanded_key, new Metadata(true), true);
+
+	/* field names and new functions are made outside the analysis pass */
+	uint64_t addr = func->GetStart();
+	WorkerEnqueue([=]() {
+		afuc_annotate_packet_handler(view, addr);
+		prefetch_callees(view, addr);
+	}, "AFUC handler prefetch");
+}
+
+/* ─── Binary Ninja glue ────────────────────────────────────── */
+
+static bool can_demand(BinaryView* view, uint64_t addr)
+{
+	AfucGpuVer gpuver;
+	Ref<Platform> plat = view->GetDefaultPlatform();
+	return afuc_view_gpuver(view, gpuver) && afuc_view_on_demand(view) && plat &&
+		!view->GetAnalysisFunction(plat, addr);
+}
+
+void afuc_register_demand_commands()
+{
+	Ref<Settings> settings = Settings::Instance();
+	settings->RegisterGroup("afuc", "AFUC");
+	settings->RegisterSetting(AFUC_ON_DEMAND_SETTING,
+		R"({"title": "On-Demand Handler Analysis", "type": "boolean", "default": false,)"
+		R"( "description": "Only map the code and name the packet handlers when an AFUC firmware is)"
+		R"( opened. Each handler is analyzed when it is first asked for, and its callees are)"
+		R"( prefetched in the background. Useful when opening many images at once.",)"
+		R"( "ignore": []})");
+
+	PluginCommand::RegisterForAddress("AFUC\\Analyze Handler",
+		"Analyze the handler or function here and prefetch its callees (on-demand views)",
+		afuc_demand_function, can_demand);
+}
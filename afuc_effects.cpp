@@ -0,0 +1,846 @@
+/*
+ * Symbolic handler effect summaries: what each packet handler writes to
+ * control registers, GPU registers and memory, as expressions over the
+ * payload dwords and the register state it starts with.
+ *
+ * The executor runs over the handler's blocks with one state per block
+ * entry and call stack. States meeting at a block are merged value by
+ * value, so a loop settles after widening whatever it changes to
+ * unknown; its effects are kept once and marked as repeated. GPU
+ * registers written at a constant address are remembered the same way,
+ * so a write of the value the register already holds on every incoming
+ * path is marked unchanged.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <tuple>
+
+#include "binaryninjaapi.h"
+#include "afuc_pm4.h"
+#include "afuc_view.h"
+
+using namespace BinaryNinja;
+using namespace std;
+
+/* ─── Expressions ──────────────────────────────────────────── */
+
+static const uint32_t s_unknown = 0;
+static const uint32_t s_none = ~0u;     /* stream position no longer known */
+
+namespace {
+
+/* Hash-consed expression pool, so equal expressions compare by index */
+class ExprPool
+{
+	vector<AfucExpr>& m_exprs;
+	map<tuple<int, int, uint32_t, uint32_t, uint32_t>, uint32_t> m_index;
+
+public:
+	explicit ExprPool(vector<AfucExpr>& exprs) : m_exprs(exprs)
+	{
+		m_exprs.assign(1, { AFUC_EXPR_UNKNOWN, AFUC_INVALID, 0, 0, 0 });
+	}
+
+	const AfucExpr& operator[](uint32_t id) const { return m_exprs[id]; }
+
+	uint32_t make(AfucExprKind kind, uint32_t value, AfucOp op = AFUC_INVALID,
+	              uint32_t a = 0, uint32_t b = 0)
+	{
+		auto key = make_tuple((int)kind, (int)op, value, a, b);
+		auto it = m_index.find(key);
+		if (it != m_index.end())
+			return it->second;
+		m_exprs.push_back({ kind, op, value, a, b });
+		m_index[key] = (uint32_t)m_exprs.size() - 1;
+		return (uint32_t)m_exprs.size() - 1;
+	}
+
+	uint32_t konst(uint32_t v) { return make(AFUC_EXPR_CONST, v); }
+
+	bool is_const(uint32_t id, uint32_t& v) const
+	{
+		if (m_exprs[id].kind != AFUC_EXPR_CONST)
+			return false;
+		v = m_exprs[id].value;
+		return true;
+	}
+
+	uint32_t op(AfucOp op, uint32_t a, uint32_t b = 0);
+};
+
+}
+
+static bool unary(AfucOp op)
+{
+	return op == AFUC_NOT || op == AFUC_MSB;
+}
+
+static bool commutative(AfucOp op)
+{
+	switch (op) {
+	case AFUC_ADD: case AFUC_AND: case AFUC_OR: case AFUC_XOR:
+	case AFUC_MUL8: case AFUC_MIN: case AFUC_MAX:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* Constant folding, same results as the emulator; false if 'op' isn't foldable */
+static bool fold(AfucOp op, uint32_t a, uint32_t b, uint32_t& r)
+{
+	switch (op) {
+	case AFUC_ADD:  r = a + b; return true;
+	case AFUC_SUB:  r = a - b; return true;
+	case AFUC_AND:  r = a & b; return true;
+	case AFUC_OR:   r = a | b; return true;
+	case AFUC_XOR:  r = a ^ b; return true;
+	case AFUC_BIC:  r = a & ~b; return true;
+	case AFUC_NOT:  r = ~a; return true;
+	case AFUC_SHL:  r = b >= 32 ? 0 : a << b; return true;
+	case AFUC_USHR: r = b >= 32 ? 0 : a >> b; return true;
+	case AFUC_ISHR: r = (uint32_t)((int32_t)a >> (b >= 32 ? 31 : b)); return true;
+	case AFUC_ROT:  b &= 31; r = b ? (a << b) | (a >> (32 - b)) : a; return true;
+	case AFUC_MUL8: r = (a & 0xff) * (b & 0xff); return true;
+	case AFUC_MIN:  r = min(a, b); return true;
+	case AFUC_MAX:  r = max(a, b); return true;
+	case AFUC_CMP:  r = a > b ? 0x00 : a == b ? 0x2b : 0x1e; return true;
+	case AFUC_MSB:
+		for (r = 0; a >>= 1; r++)
+			;
+		return true;
+	default:
+		return false;
+	}
+}
+
+uint32_t ExprPool::op(AfucOp op, uint32_t a, uint32_t b)
+{
+	if (a == s_unknown || (!unary(op) && b == s_unknown))
+		return s_unknown;
+
+	uint32_t ca, cb, r;
+	bool ka = is_const(a, ca), kb = !unary(op) && is_const(b, cb);
+	if (ka && (unary(op) || kb) && fold(op, ca, unary(op) ? 0 : cb, r))
+		return konst(r);
+
+	/* constants go on the right of commutative ops */
+	if (ka && !unary(op) && commutative(op)) {
+		swap(a, b);
+		swap(ca, cb);
+		swap(ka, kb);
+	}
+	if (kb) {
+		switch (op) {
+		case AFUC_ADD: case AFUC_SUB: case AFUC_OR: case AFUC_XOR:
+		case AFUC_SHL: case AFUC_USHR: case AFUC_ISHR: case AFUC_BIC:
+			if (!cb)
+				return a;
+			break;
+		case AFUC_AND:
+			if (!cb)
+				return konst(0);
+			if (cb == ~0u)
+				return a;
+			break;
+		default:
+			break;
+		}
+
+		/* (x + c1) + c2 -> x + (c1 + c2), likewise for and/or */
+		const AfucExpr& ea = m_exprs[a];
+		uint32_t c1;
+		if (ea.kind == AFUC_EXPR_OP && ea.op == op && is_const(ea.b, c1) &&
+		    (op == AFUC_ADD || op == AFUC_AND || op == AFUC_OR)) {
+			fold(op, c1, cb, r);
+			return this->op(op, ea.a, konst(r));
+		}
+		if (op == AFUC_SUB)
+			return this->op(AFUC_ADD, a, konst(0 - cb));
+	}
+	return make(AFUC_EXPR_OP, 0, op, a, unary(op) ? 0 : b);
+}
+
+/* True if 'id' reads memory, a control register it didn't write or a
+ * stream dword: two reads can see different values under the same
+ * expression. Stream dwords are numbered from the last setup, so the
+ * same one of two setups looks alike. */
+static bool volatile_expr(const ExprPool& pool, uint32_t id)
+{
+	const AfucExpr& e = pool[id];
+	if (e.kind == AFUC_EXPR_LOAD || e.kind == AFUC_EXPR_CTRL ||
+	    e.kind == AFUC_EXPR_MEMDATA || e.kind == AFUC_EXPR_REGDATA)
+		return true;
+	if (e.kind != AFUC_EXPR_OP)
+		return false;
+	return volatile_expr(pool, e.a) || (!unary(e.op) && volatile_expr(pool, e.b));
+}
+
+/* ─── Executor ─────────────────────────────────────────────── */
+
+static const size_t s_max_steps = 200000;
+static const size_t s_max_call_depth = 4;
+
+namespace {
+
+struct SymState {
+	uint32_t gpr[0x1d];
+	uint32_t reg_addr;          /* $addr / @REG_WRITE_ADDR */
+	uint32_t payload;           /* next payload dword */
+	uint32_t memdata, regdata;  /* dwords read since each stream was set up */
+	map<uint32_t, uint32_t> ctrl;   /* control registers written so far */
+	map<uint32_t, uint32_t> gpu;    /* GPU registers written so far, by constant address */
+};
+
+typedef pair<uint64_t, vector<uint64_t>> BlockKey;
+
+/* Control register offsets the executor gives meaning to, ~0u if absent */
+struct EffectRegs {
+	uint32_t reg_write_addr, reg_write, mem_read_dwords, reg_read_addr;
+	uint32_t sds[3];
+	bool has_sds;
+
+	explicit EffectRegs(AfucGpuVer gpuver)
+	{
+		auto ctrl = [&](const char* name) {
+			uint32_t off;
+			return afuc_ctrl_reg_offset(gpuver, name, off) ? off : ~0u;
+		};
+		reg_write_addr = ctrl("REG_WRITE_ADDR");
+		reg_write = ctrl("REG_WRITE");
+		mem_read_dwords = ctrl("MEM_READ_DWORDS");
+		reg_read_addr = ctrl("REG_READ_ADDR");
+		has_sds = afuc_sds_regs(gpuver, sds);
+	}
+};
+
+}
+
+/* Merge 'in' into 'into'; true if 'into' changed */
+static bool join(SymState& into, const SymState& in, ExprPool& pool)
+{
+	bool changed = false;
+	auto meet = [&](uint32_t& a, uint32_t b, uint32_t top) {
+		if (a != b && a != top) {
+			a = top;
+			changed = true;
+		}
+	};
+	for (uint32_t r = 0; r < 0x1d; r++)
+		meet(into.gpr[r], in.gpr[r], s_unknown);
+	meet(into.reg_addr, in.reg_addr, s_unknown);
+	meet(into.payload, in.payload, s_none);
+	meet(into.memdata, in.memdata, s_none);
+	meet(into.regdata, in.regdata, s_none);
+
+	/* a register written on one side only still holds its entry value on the other */
+	for (auto& [off, v] : into.ctrl) {
+		auto it = in.ctrl.find(off);
+		meet(v, it == in.ctrl.end() ? pool.make(AFUC_EXPR_CTRL, off) : it->second, s_unknown);
+	}
+	for (const auto& [off, v] : in.ctrl) {
+		if (into.ctrl.count(off))
+			continue;
+		uint32_t entry = pool.make(AFUC_EXPR_CTRL, off);
+		into.ctrl[off] = v == entry ? v : s_unknown;
+		changed = true;
+	}
+
+	/* nothing is known about a GPU register's entry value: keep what agrees */
+	for (auto it = into.gpu.begin(); it != into.gpu.end();) {
+		auto other = in.gpu.find(it->first);
+		if (other != in.gpu.end() && other->second == it->second) {
+			++it;
+			continue;
+		}
+		it = into.gpu.erase(it);
+		changed = true;
+	}
+	return changed;
+}
+
+void afuc_handler_effects(AfucGpuVer gpuver, const uint32_t* code, size_t count,
+                          uint64_t entry, AfucEffectSummary& out)
+{
+	out = AfucEffectSummary();
+	ExprPool pool(out.exprs);
+	EffectRegs regs(gpuver);
+
+	map<tuple<uint64_t, int, uint32_t>, AfucEffect> effects;
+	vector<pair<uint64_t, uint64_t>> loops;   /* [head, back edge] */
+
+	auto effect = [&](uint64_t site, AfucEffectKind kind, uint32_t n, uint32_t addr,
+	                  uint32_t value, bool in_loop, bool unchanged = false) {
+		auto [it, fresh] = effects.try_emplace({ site, kind, n },
+			AfucEffect{ site, kind, addr, value, in_loop, unchanged });
+		if (fresh)
+			return;
+		if (it->second.addr != addr)
+			it->second.addr = s_unknown;
+		if (it->second.value != value)
+			it->second.value = s_unknown;
+		/* unchanged only if it is on every visit */
+		it->second.unchanged &= unchanged;
+	};
+
+	auto apply = [&](const AfucInsn& insn, uint64_t site, SymState& st) {
+		bool rep = insn.rep || insn.xmov;
+		uint32_t n = 0;   /* effects of this instruction so far */
+
+		auto get = [&](uint32_t enc) -> uint32_t {
+			uint32_t* pos;
+			AfucExprKind kind;
+			switch (enc) {
+			case 0x00: return pool.konst(0);
+			case 0x1d: pos = &st.memdata; kind = AFUC_EXPR_MEMDATA; break;
+			case 0x1e: pos = &st.regdata; kind = AFUC_EXPR_REGDATA; break;
+			case 0x1f: pos = &st.payload; kind = AFUC_EXPR_PAYLOAD; break;
+			default:   return st.gpr[enc];
+			}
+			if (*pos == s_none)
+				return s_unknown;
+			uint32_t v = pool.make(kind, *pos);
+			if (!insn.peek)
+				(*pos)++;
+			return v;
+		};
+
+		auto gpu_write = [&](uint32_t v) {
+			uint32_t a;
+			if (pool.is_const(st.reg_addr, a) && (a >> 24)) {
+				effect(site, AFUC_EFFECT_PIPE_REG, n++, pool.konst(a >> 24), v, rep);
+				return;
+			}
+			bool k = pool.is_const(st.reg_addr, a);
+			if (!k || rep) {
+				/* may alias any register, or writes a run of them */
+				effect(site, AFUC_EFFECT_GPU_REG, n++, k ? pool.konst(a & 0x3ffff) : st.reg_addr, v, rep);
+				st.gpu.clear();
+			} else {
+				auto it = st.gpu.find(a & 0x3ffff);
+				bool same = v != s_unknown && it != st.gpu.end() && it->second == v &&
+					!volatile_expr(pool, v);
+				effect(site, AFUC_EFFECT_GPU_REG, n++, pool.konst(a & 0x3ffff), v, rep, same);
+				st.gpu[a & 0x3ffff] = v;
+			}
+
+			/* b18 disables auto-increment */
+			if (!k || !(a & 0x40000))
+				st.reg_addr = pool.op(AFUC_ADD, st.reg_addr, pool.konst(1));
+		};
+
+		auto ctrl_write = [&](uint32_t off_expr, uint32_t v) {
+			uint32_t off;
+			if (!pool.is_const(off_expr, off)) {
+				effect(site, AFUC_EFFECT_CTRL, n++, off_expr, v, rep);
+				return;
+			}
+			off &= 0xfff;
+			if (off == regs.reg_write_addr) {
+				st.reg_addr = v;
+				return;
+			}
+			if (off == regs.reg_write) {
+				gpu_write(v);
+				return;
+			}
+			if (off == regs.mem_read_dwords) {
+				st.memdata = 0;
+			} else if (off == regs.reg_read_addr) {
+				/* the handler is about to read registers back: their
+				 * contents are the hardware's, not what was written */
+				st.regdata = 0;
+				st.gpu.clear();
+			}
+			st.ctrl[off] = v;
+			effect(site, AFUC_EFFECT_CTRL, n++, pool.konst(off), v, rep);
+		};
+
+		auto set_dst = [&](uint32_t enc, uint32_t v) {
+			if (enc == 0)
+				return;
+			if (enc < 0x1d)
+				st.gpr[enc] = v;
+			else if (enc < 0x1f)
+				st.reg_addr = v;
+			else
+				gpu_write(v);
+		};
+
+		uint32_t a, b, v, addr;
+		switch (afuc_op_form(insn.op)) {
+		case AFUC_FORM_ALU:
+			a = get(insn.src1_enc);
+			b = insn.is_immed ? pool.konst(insn.immed) : get(insn.src2_enc);
+			if (insn.op == AFUC_SETBIT_R)
+				v = pool.op(AFUC_OR, a, pool.op(AFUC_SHL, pool.konst(1), b));
+			else if (insn.op == AFUC_ADDHI || insn.op == AFUC_SUBHI)
+				v = s_unknown;   /* depends on the carry */
+			else
+				v = pool.op(insn.op, a, b);
+			set_dst(insn.dst_enc, v);
+			break;
+		case AFUC_FORM_ALU1:
+			b = insn.is_immed ? pool.konst(insn.immed) : get(insn.src2_enc);
+			set_dst(insn.dst_enc, pool.op(insn.op, b));
+			break;
+		case AFUC_FORM_MOV:
+			set_dst(insn.dst_enc, get(insn.src2_enc));
+			break;
+		case AFUC_FORM_MOVI:
+			set_dst(insn.dst_enc, pool.konst(insn.immed << insn.shift));
+			break;
+		case AFUC_FORM_BIT:
+			a = get(insn.src1_enc);
+			v = insn.op == AFUC_SETBIT ? pool.op(AFUC_OR, a, pool.konst(1u << insn.bit))
+				: pool.op(AFUC_AND, a, pool.konst(~(1u << insn.bit)));
+			set_dst(insn.dst_enc, v);
+			break;
+		case AFUC_FORM_BITFIELD:
+		{
+			a = get(insn.src1_enc);
+			uint32_t width = insn.hi - insn.lo + 1;
+			uint32_t mask = width >= 32 ? ~0u : (1u << width) - 1;
+			if (insn.op == AFUC_UBFX) {
+				v = pool.op(AFUC_AND, pool.op(AFUC_USHR, a, pool.konst(insn.lo)), pool.konst(mask));
+			} else {
+				uint32_t old = insn.dst_enc < 0x1d ? st.gpr[insn.dst_enc] : s_unknown;
+				v = pool.op(AFUC_OR, pool.op(AFUC_AND, old, pool.konst(~(mask << insn.lo))),
+					pool.op(AFUC_AND, pool.op(AFUC_SHL, a, pool.konst(insn.lo)), pool.konst(mask << insn.lo)));
+			}
+			set_dst(insn.dst_enc, v);
+			break;
+		}
+		case AFUC_FORM_CREAD:
+		{
+			addr = pool.op(AFUC_ADD, get(insn.src1_enc), pool.konst(insn.base));
+			if (insn.preincrement)
+				set_dst(insn.src1_enc, addr);
+			uint32_t off;
+			v = s_unknown;
+			if (insn.op == AFUC_CREAD && pool.is_const(addr, off)) {
+				auto it = st.ctrl.find(off & 0xfff);
+				v = it != st.ctrl.end() ? it->second : pool.make(AFUC_EXPR_CTRL, off & 0xfff);
+			}
+			set_dst(insn.dst_enc, v);
+			break;
+		}
+		case AFUC_FORM_LOAD:
+			addr = pool.op(AFUC_ADD, get(insn.src1_enc), pool.konst(insn.immed));
+			if (insn.preincrement)
+				set_dst(insn.src1_enc, addr);
+			set_dst(insn.dst_enc, pool.make(AFUC_EXPR_LOAD, 0, AFUC_INVALID, addr));
+			break;
+		case AFUC_FORM_STORE:
+			v = get(insn.src1_enc);
+			addr = pool.op(AFUC_ADD, get(insn.src2_enc), pool.konst(insn.immed));
+			if (insn.preincrement)
+				set_dst(insn.src2_enc, addr);
+			effect(site, AFUC_EFFECT_MEM, n++, addr, v, rep);
+			break;
+		case AFUC_FORM_CWRITE:
+			v = get(insn.src1_enc);
+			addr = pool.op(AFUC_ADD, get(insn.src2_enc), pool.konst(insn.base));
+			if (insn.preincrement)
+				set_dst(insn.src2_enc, addr);
+			if (insn.op == AFUC_SWRITE) {
+				effect(site, AFUC_EFFECT_SQE, n++, pool.op(AFUC_AND, addr, pool.konst(0xff)), v, rep);
+				break;
+			}
+			ctrl_write(addr, v);
+			for (uint32_t k = 0; k < insn.sds; k++) {
+				uint32_t d = get(0x1f);
+				if (regs.has_sds)
+					ctrl_write(pool.konst(regs.sds[k]), d);
+			}
+			break;
+		case AFUC_FORM_BR_IMM:
+		case AFUC_FORM_BR_BIT:
+		case AFUC_FORM_INDIRECT:
+			get(insn.src1_enc);
+			break;
+		default:
+			break;
+		}
+
+		/* a (rep)/(xmovN) run was summarized by its first iteration:
+		 * everything it touched past that is unknown, $rem is spent */
+		if (rep) {
+			uint32_t src = afuc_insn_src_regs(insn), dst = afuc_insn_dst_regs(insn);
+			for (uint32_t r = 1; r < 0x1d; r++)
+				if (dst & (1u << r))
+					st.gpr[r] = s_unknown;
+			if (src & (1u << 0x1d))
+				st.memdata = s_none;
+			if (src & (1u << 0x1e))
+				st.regdata = s_none;
+			if (src & (1u << 0x1f))
+				st.payload = s_none;
+			if (n)
+				st.reg_addr = s_unknown;
+			st.gpr[REG_REM] = insn.rep ? pool.konst(0) : s_unknown;
+		}
+	};
+
+	auto decode = [&](uint64_t addr, AfucInsn& insn) {
+		if (addr / 4 >= count)
+			return false;
+		return afuc_decode((const uint8_t*)&code[addr / 4], 4, addr, insn, gpuver);
+	};
+
+	map<BlockKey, SymState> in;
+	set<BlockKey> pending;
+	vector<BlockKey> work;
+
+	auto flow_to = [&](BlockKey key, const SymState& st) {
+		auto it = in.find(key);
+		bool changed;
+		if (it == in.end()) {
+			in.emplace(key, st);
+			changed = true;
+		} else {
+			changed = join(it->second, st, pool);
+		}
+		if (changed && pending.insert(key).second)
+			work.push_back(key);
+	};
+
+	SymState first;
+	for (uint32_t r = 0; r < 0x1d; r++)
+		first.gpr[r] = r ? pool.make(AFUC_EXPR_GPR, r) : pool.konst(0);
+	first.reg_addr = pool.make(AFUC_EXPR_GPR, 0x1d);
+	first.payload = 0;
+	first.memdata = first.regdata = s_none;
+	flow_to({ entry, {} }, first);
+
+	size_t steps = 0;
+	while (!work.empty()) {
+		BlockKey key = work.back();
+		work.pop_back();
+		pending.erase(key);
+		SymState st = in[key];
+		uint64_t pc = key.first;
+		const vector<uint64_t>& stack = key.second;
+
+		for (;;) {
+			AfucInsn insn;
+			if (++steps > s_max_steps) {
+				out.complete = false;
+				work.clear();
+				break;
+			}
+			if (!decode(pc, insn) || insn.op == AFUC_INVALID) {
+				out.complete = false;
+				break;
+			}
+			apply(insn, pc, st);
+
+			AfucFlow f = afuc_insn_flow(insn, pc);
+			if (f.kind == AFUC_FLOW_NEXT) {
+				pc += 4;
+				continue;
+			}
+
+			/* waitin's delay slot already reads the next packet header */
+			if (f.kind == AFUC_FLOW_WAITIN)
+				break;
+
+			uint64_t next = pc + (f.delay_slot ? 8 : 4);
+			AfucInsn slot;
+			if (f.delay_slot && decode(pc + 4, slot))
+				apply(slot, pc + 4, st);
+
+			if (f.kind == AFUC_FLOW_COND || f.kind == AFUC_FLOW_JUMP) {
+				if (f.target <= pc)
+					loops.push_back({ f.target, next - 4 });
+				flow_to({ f.target, stack }, st);
+				if (f.kind == AFUC_FLOW_COND)
+					flow_to({ next, stack }, st);
+			} else if (f.kind == AFUC_FLOW_CALL) {
+				if (stack.size() < s_max_call_depth) {
+					vector<uint64_t> callee = stack;
+					callee.push_back(next);
+					flow_to({ f.target, callee }, st);
+				} else {
+					out.complete = false;
+				}
+			} else if (f.kind == AFUC_FLOW_RET && !stack.empty()) {
+				vector<uint64_t> caller(stack.begin(), stack.end() - 1);
+				flow_to({ stack.back(), caller }, st);
+			} else if (f.kind == AFUC_FLOW_INDIRECT) {
+				out.complete = false;
+			}
+			break;
+		}
+	}
+
+	for (auto& [k, e] : effects) {
+		for (const auto& [head, tail] : loops)
+			if (e.site >= head && e.site <= tail)
+				e.in_loop = true;
+		out.effects.push_back(e);
+	}
+}
+
+/* ─── Text ─────────────────────────────────────────────────── */
+
+static const char* op_symbol(AfucOp op)
+{
+	switch (op) {
+	case AFUC_ADD:  return "+";
+	case AFUC_SUB:  return "-";
+	case AFUC_AND:  return "&";
+	case AFUC_OR:   return "|";
+	case AFUC_XOR:  return "^";
+	case AFUC_SHL:  return "<<";
+	case AFUC_USHR: return ">>";
+	default:        return nullptr;
+	}
+}
+
+string afuc_expr_text(AfucGpuVer gpuver, const AfucEffectSummary& s, uint32_t expr)
+{
+	if (expr >= s.exprs.size())
+		return "?";
+	const AfucExpr& e = s.exprs[expr];
+	char buf[32];
+	switch (e.kind) {
+	case AFUC_EXPR_CONST:
+		snprintf(buf, sizeof(buf), e.value < 10 ? "%u" : "0x%x", e.value);
+		return buf;
+	case AFUC_EXPR_PAYLOAD:
+		return "p" + to_string(e.value);
+	case AFUC_EXPR_GPR:
+		if (e.value == 0x1d)
+			return "$addr";
+		snprintf(buf, sizeof(buf), "$%02x", e.value);
+		return buf;
+	case AFUC_EXPR_CTRL:
+	{
+		const char* name = afuc_ctrl_reg_name(gpuver, e.value);
+		snprintf(buf, sizeof(buf), "@0x%03x", e.value);
+		return name ? string("@") + name : buf;
+	}
+	case AFUC_EXPR_MEMDATA:
+		return "memdata[" + to_string(e.value) + "]";
+	case AFUC_EXPR_REGDATA:
+		return "regdata[" + to_string(e.value) + "]";
+	case AFUC_EXPR_LOAD:
+		return "mem[" + afuc_expr_text(gpuver, s, e.a) + "]";
+	case AFUC_EXPR_OP:
+		if (const char* sym = op_symbol(e.op))
+			return "(" + afuc_expr_text(gpuver, s, e.a) + " " + sym + " " +
+				afuc_expr_text(gpuver, s, e.b) + ")";
+		if (unary(e.op))
+			return string(afuc_op_name(e.op)) + "(" + afuc_expr_text(gpuver, s, e.a) + ")";
+		return string(afuc_op_name(e.op)) + "(" + afuc_expr_text(gpuver, s, e.a) + ", " +
+			afuc_expr_text(gpuver, s, e.b) + ")";
+	default:
+		return "?";
+	}
+}
+
+string afuc_effect_text(AfucGpuVer gpuver, const AfucEffectSummary& s, const AfucEffect& e)
+{
+	string target;
+	const AfucExpr& a = s.exprs[e.addr];
+	const char* name = nullptr;
+	switch (e.kind) {
+	case AFUC_EFFECT_CTRL:
+		if (a.kind == AFUC_EXPR_CONST && (name = afuc_ctrl_reg_name(gpuver, a.value)))
+			target = string("@") + name;
+		else
+			target = "@[" + afuc_expr_text(gpuver, s, e.addr) + "]";
+		break;
+	case AFUC_EFFECT_SQE:
+		if (a.kind == AFUC_EXPR_CONST && (name = afuc_sqe_reg_name(a.value)))
+			target = string("%") + name;
+		else
+			target = "%[" + afuc_expr_text(gpuver, s, e.addr) + "]";
+		break;
+	case AFUC_EFFECT_PIPE_REG:
+		if (a.kind == AFUC_EXPR_CONST && (name = afuc_pipe_reg_name(gpuver, a.value)))
+			target = string("|") + name;
+		else
+			target = "|[" + afuc_expr_text(gpuver, s, e.addr) + "]";
+		break;
+	case AFUC_EFFECT_GPU_REG:
+		target = "REG[" + afuc_expr_text(gpuver, s, e.addr) + "]";
+		break;
+	case AFUC_EFFECT_MEM:
+		target = "MEM[" + afuc_expr_text(gpuver, s, e.addr) + "]";
+		break;
+	}
+	return target + " = " + afuc_expr_text(gpuver, s, e.value) + (e.in_loop ? " (repeated)" : "") +
+		(e.unchanged ? " (unchanged)" : "");
+}
+
+/* ─── Binary Ninja glue ────────────────────────────────────── */
+
+/* Bumped whenever the summary text changes meaning */
+static const uint64_t s_effects_version = 2;
+static const char* s_effects_key = AFUC_HANDLER_EFFECTS_KEY;
+
+/* Summaries are cached on the handler's function like the dashboard
+ * metrics, and dropped with them by afuc_invalidate_handler_metrics()
+ * when a write to the view touches any instruction the handler reaches */
+static bool load_effects(Function* func, vector<string>& lines, bool& complete)
+{
+	Ref<Metadata> md = func->QueryMetadata(s_effects_key);
+	if (!md || !md->IsKeyValueStore())
+		return false;
+	auto kv = md->GetKeyValueStore();
+	if (!kv.count("version") || kv["version"]->GetUnsignedInteger() != s_effects_version)
+		return false;
+	complete = kv["complete"]->GetBoolean();
+	lines.clear();
+	for (const Ref<Metadata>& r : kv["effects"]->GetArray())
+		lines.push_back(r->GetString());
+	return true;
+}
+
+static void store_effects(Function* func, const vector<string>& lines, bool complete)
+{
+	map<string, Ref<Metadata>> kv;
+	kv["version"] = new Metadata(s_effects_version);
+	kv["complete"] = new Metadata(complete);
+	kv["effects"] = new Metadata(lines);
+	func->StoreMetadata(s_effects_key, new Metadata(kv), true);
+}
+
+static void summarize(AfucGpuVer gpuver, const vector<uint32_t>& code, uint64_t entry,
+                      vector<string>& lines, bool& complete)
+{
+	AfucEffectSummary s;
+	afuc_handler_effects(gpuver, code.data(), code.size(), entry, s);
+	lines.clear();
+	char buf[32];
+	for (const AfucEffect& e : s.effects) {
+		snprintf(buf, sizeof(buf), "0x%" PRIx64 ": ", e.site);
+		lines.push_back(buf + afuc_effect_text(gpuver, s, e));
+	}
+	complete = s.complete;
+}
+
+static void show_effects(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	if (!afuc_view_gpuver(view, gpuver))
+		return;
+
+	Ref<Metadata> md = view->QueryMetadata("afuc.packet_table");
+	if (!md || !md->IsArray()) {
+		LogError("AFUC: no packet table recovered for this firmware");
+		return;
+	}
+	vector<uint64_t> table = md->GetUnsignedIntegerList();
+
+	Ref<BinaryView> ref = view;
+	WorkerEnqueue([=]() {
+		Ref<BackgroundTask> task = new BackgroundTask("Summarizing AFUC handler effects...", true);
+		uint64_t base;
+		vector<uint32_t> code = afuc_read_code(ref, base);
+		Ref<Platform> plat = ref->GetDefaultPlatform();
+
+		std::map<uint64_t, vector<uint32_t>> ops;
+		for (size_t op = 0; op < table.size(); op++)
+			ops[table[op]].push_back((uint32_t)op);
+
+		string report = "# AFUC handler effects\n\n";
+		char buf[160];
+		size_t cached = 0, partial = 0;
+
+		for (const auto& [addr, opcodes] : ops) {
+			if (task->IsCancelled()) {
+				task->Finish();
+				return;
+			}
+			if (addr / 4 >= code.size() || opcodes.size() > AFUC_PM4_SHARED_HANDLER_MAX)
+				continue;
+
+			vector<string> lines;
+			bool complete;
+			Ref<Function> func = plat ? ref->GetAnalysisFunction(plat, addr) : nullptr;
+			if (func && load_effects(func, lines, complete)) {
+				cached++;
+			} else {
+				summarize(gpuver, code, addr, lines, complete);
+				if (func)
+					store_effects(func, lines, complete);
+			}
+			if (!complete)
+				partial++;
+
+			string packet;
+			for (uint32_t op : opcodes) {
+				const char* name = afuc_pm4_packet_name(gpuver, op);
+				snprintf(buf, sizeof(buf), "CP_UNKNOWN_%02x", op);
+				packet += (packet.empty() ? "" : ", ") + string(name ? name : buf);
+			}
+			snprintf(buf, sizeof(buf), " (0x%" PRIx64 ")%s\n\n", addr, complete ? "" : " — partial");
+			report += "## " + packet + buf;
+			if (lines.empty())
+				report += "No writes.\n\n";
+			else {
+				report += "```\n";
+				for (const string& l : lines)
+					report += l + "\n";
+				report += "```\n\n";
+			}
+		}
+
+		snprintf(buf, sizeof(buf), "%zu summaries reused from the function cache, %zu partial\n", cached, partial);
+		report += buf;
+
+		task->Finish();
+		ShowMarkdownReport("AFUC Handler Effects", report, report);
+	}, "AFUC handler effects");
+}
+
+static void show_function_effects(BinaryView* view, Function* func)
+{
+	AfucGpuVer gpuver;
+	if (!afuc_view_gpuver(view, gpuver))
+		return;
+
+	vector<string> lines;
+	bool complete;
+	if (!load_effects(func, lines, complete)) {
+		uint64_t base;
+		summarize(gpuver, afuc_read_code(view, base), func->GetStart(), lines, complete);
+		store_effects(func, lines, complete);
+	}
+
+	string report = "# Effects of " + func->GetSymbol()->GetShortName() + "\n\n";
+	if (!complete)
+		report += "The walk hit an indirect jump or a bound; the summary is partial.\n\n";
+	report += "```\n";
+	for (const string& l : lines)
+		report += l + "\n";
+	report += "```\n";
+	ShowMarkdownReport("AFUC Handler Effects", report, report);
+}
+
+static bool has_packet_table(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	return afuc_view_gpuver(view, gpuver) && view->QueryMetadata("afuc.packet_table");
+}
+
+void afuc_register_effects_commands()
+{
+	PluginCommand::Register("AFUC\\Handler Effects",
+		"Summarize the registers and memory every packet handler writes as functions of its payload",
+		show_effects, has_packet_table);
+	PluginCommand::RegisterForFunction("AFUC\\Handler Effects (Function)",
+		"Summarize the registers and memory this function writes as functions of the payload",
+		show_function_effects, afuc_is_function);
+}
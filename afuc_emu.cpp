@@ -0,0 +1,462 @@
+/*
+ * Minimal concrete AFUC emulator.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <cstring>
+
+#include "afuc_emu.h"
+
+/* Upper bound on (rep) iterations, $rem may hold garbage */
+static const uint32_t s_max_rep = 0x10000;
+
+/* Hardware call stack depth is small; anything deeper is a runaway */
+static const size_t s_max_call_depth = 64;
+
+static uint32_t ctrl_offset(AfucGpuVer gpuver, const char* name)
+{
+	uint32_t off;
+	return afuc_ctrl_reg_offset(gpuver, name, off) ? off : ~0u;
+}
+
+AfucEmu::AfucEmu(AfucGpuVer gpuver, const uint32_t* code, size_t code_words)
+	: m_gpuver(gpuver), m_code(code), m_code_words(code_words)
+{
+	m_off_mem_read_addr   = ctrl_offset(gpuver, "MEM_READ_ADDR");
+	m_off_mem_read_dwords = ctrl_offset(gpuver, "MEM_READ_DWORDS");
+	m_off_reg_write_addr  = ctrl_offset(gpuver, "REG_WRITE_ADDR");
+	m_off_reg_write       = ctrl_offset(gpuver, "REG_WRITE");
+	m_off_reg_read_addr   = ctrl_offset(gpuver, "REG_READ_ADDR");
+	m_off_pt_write_addr   = ctrl_offset(gpuver, "PACKET_TABLE_WRITE_ADDR");
+	m_off_pt_write        = ctrl_offset(gpuver, "PACKET_TABLE_WRITE");
+	m_off_load_store_hi   = ctrl_offset(gpuver, "LOAD_STORE_HI");
+	m_has_sds = afuc_sds_regs(gpuver, m_off_sds);
+}
+
+/* ─── Register / FIFO access ───────────────────────────────── */
+
+uint32_t AfucEmu::ReadSrc(uint32_t enc, bool peek)
+{
+	switch (enc) {
+	case 0x00:
+		return 0;
+	case 0x1d: /* $memdata */
+	{
+		if (!m_mem_read_dwords)
+			return 0;
+		uint64_t idx = m_mem_read_addr / 4;
+		uint32_t val = (m_mem && idx < m_mem_words) ? m_mem[idx] : 0;
+		if (!peek) {
+			m_mem_read_addr += 4;
+			m_mem_read_dwords--;
+		}
+		return val;
+	}
+	case 0x1e: /* $regdata */
+	{
+		uint32_t val = m_gpu_regs[m_reg_read_addr];
+		if (!peek)
+			m_reg_read_addr++;
+		return val;
+	}
+	case 0x1f: /* $data */
+	{
+		if (m_data.empty()) {
+			m_data_underrun = true;
+			return 0;
+		}
+		uint32_t val = m_data.front();
+		if (!peek)
+			m_data.pop_front();
+		return val;
+	}
+	default:
+		return m_gpr[enc & 0x1f];
+	}
+}
+
+void AfucEmu::WriteGpuReg(uint32_t val)
+{
+	/* Pipe registers live in the top byte of the address (see |NAME) */
+	if (m_reg_write_addr >> 24) {
+		m_effects.push_back({ AFUC_EFF_PIPE_REG, m_reg_write_addr >> 24, val });
+		return;
+	}
+
+	uint32_t reg = m_reg_write_addr & 0x3ffff;
+	m_gpu_regs[reg] = val;
+	m_effects.push_back({ AFUC_EFF_GPU_REG, reg, val });
+
+	/* b18 disables auto-increment */
+	if (!(m_reg_write_addr & 0x40000))
+		m_reg_write_addr++;
+}
+
+void AfucEmu::WriteDst(uint32_t enc, uint32_t val)
+{
+	switch (enc) {
+	case 0x00:
+		break;
+	case 0x1d: /* $addr */
+	case 0x1e: /* $usraddr */
+		m_reg_write_addr = val;
+		break;
+	case 0x1f: /* $data: write to the register at $addr */
+		WriteGpuReg(val);
+		break;
+	default:
+		m_gpr[enc & 0x1f] = val;
+		break;
+	}
+}
+
+uint32_t AfucEmu::ReadCtrl(uint32_t off)
+{
+	return m_ctrl[off & 0xfff];
+}
+
+void AfucEmu::WriteCtrl(uint32_t off, uint32_t val)
+{
+	off &= 0xfff;
+	m_effects.push_back({ AFUC_EFF_CTRL, off, val });
+
+	if (off == m_off_pt_write) {
+		uint32_t idx = m_ctrl[m_off_pt_write_addr & 0xfff]++;
+		if (idx < AFUC_PACKET_TABLE_SIZE)
+			m_packet_table[idx] = val;
+		m_packet_table_writes++;
+		return;
+	}
+
+	m_ctrl[off] = val;
+
+	if (off == m_off_mem_read_dwords) {
+		m_mem_read_addr = ((uint64_t)m_ctrl[(m_off_mem_read_addr + 1) & 0xfff] << 32) |
+		                  m_ctrl[m_off_mem_read_addr & 0xfff];
+		m_mem_read_dwords = val;
+	} else if (off == m_off_reg_write_addr) {
+		m_reg_write_addr = val;
+	} else if (off == m_off_reg_write) {
+		WriteGpuReg(val);
+	} else if (off == m_off_reg_read_addr) {
+		m_reg_read_addr = val;
+	}
+}
+
+/* ─── ALU ──────────────────────────────────────────────────── */
+
+uint32_t AfucEmu::Alu(AfucOp op, uint32_t a, uint32_t b)
+{
+	switch (op) {
+	case AFUC_ADD:
+	{
+		uint64_t r = (uint64_t)a + b;
+		m_carry = r >> 32;
+		return (uint32_t)r;
+	}
+	case AFUC_ADDHI:
+	{
+		uint64_t r = (uint64_t)a + b + m_carry;
+		m_carry = r >> 32;
+		return (uint32_t)r;
+	}
+	case AFUC_SUB:
+		m_carry = a < b;
+		return a - b;
+	case AFUC_SUBHI:
+	{
+		uint32_t borrow = m_carry;
+		m_carry = (uint64_t)a < (uint64_t)b + borrow;
+		return a - b - borrow;
+	}
+	case AFUC_AND:  return a & b;
+	case AFUC_OR:   return a | b;
+	case AFUC_XOR:  return a ^ b;
+	case AFUC_NOT:  return ~b;
+	case AFUC_BIC:  return a & ~b;
+	case AFUC_SHL:  return (b >= 32) ? 0 : a << b;
+	case AFUC_USHR: return (b >= 32) ? 0 : a >> b;
+	case AFUC_ISHR: return (uint32_t)((int32_t)a >> (b >= 32 ? 31 : b));
+	case AFUC_ROT:  b &= 31; return b ? (a << b) | (a >> (32 - b)) : a;
+	case AFUC_MUL8: return (a & 0xff) * (b & 0xff);
+	case AFUC_MIN:  return a < b ? a : b;
+	case AFUC_MAX:  return a > b ? a : b;
+	case AFUC_CMP:
+		/* values as observed by freedreno: gt = 0x00, eq = 0x2b, lt = 0x1e */
+		if (a > b)
+			return 0x00;
+		return (a == b) ? 0x2b : 0x1e;
+	case AFUC_MSB:
+	{
+		uint32_t n = 0;
+		while (b >>= 1)
+			n++;
+		return n;
+	}
+	default:
+		return 0;
+	}
+}
+
+/* ─── Execution ────────────────────────────────────────────── */
+
+void AfucEmu::Execute(const AfucInsn& insn)
+{
+	switch (insn.op) {
+	case AFUC_NOP:
+		break;
+
+	case AFUC_ADD: case AFUC_ADDHI: case AFUC_SUB: case AFUC_SUBHI:
+	case AFUC_AND: case AFUC_OR: case AFUC_XOR:
+	case AFUC_SHL: case AFUC_USHR: case AFUC_ISHR: case AFUC_ROT:
+	case AFUC_MUL8: case AFUC_MIN: case AFUC_MAX: case AFUC_CMP:
+	case AFUC_BIC:
+	{
+		uint32_t a = ReadSrc(insn.src1_enc, insn.peek);
+		uint32_t b = insn.is_immed ? insn.immed : ReadSrc(insn.src2_enc, insn.peek);
+		WriteDst(insn.dst_enc, Alu(insn.op, a, b));
+		break;
+	}
+
+	case AFUC_NOT:
+	case AFUC_MSB:
+	case AFUC_MOV:
+	{
+		uint32_t b = insn.is_immed ? insn.immed : ReadSrc(insn.src2_enc, insn.peek);
+		WriteDst(insn.dst_enc, insn.op == AFUC_MOV ? b : Alu(insn.op, 0, b));
+		break;
+	}
+
+	case AFUC_MOVI:
+		WriteDst(insn.dst_enc, insn.immed << insn.shift);
+		break;
+
+	case AFUC_SETBIT:
+		WriteDst(insn.dst_enc, ReadSrc(insn.src1_enc, false) | (1u << insn.bit));
+		break;
+	case AFUC_CLRBIT:
+		WriteDst(insn.dst_enc, ReadSrc(insn.src1_enc, false) & ~(1u << insn.bit));
+		break;
+	case AFUC_SETBIT_R:
+	{
+		uint32_t a = ReadSrc(insn.src1_enc, false);
+		uint32_t b = ReadSrc(insn.src2_enc, false);
+		WriteDst(insn.dst_enc, a | (1u << (b & 31)));
+		break;
+	}
+	case AFUC_UBFX:
+	{
+		uint32_t width = insn.hi - insn.lo + 1;
+		uint32_t mask = (width >= 32) ? ~0u : ((1u << width) - 1);
+		WriteDst(insn.dst_enc, (ReadSrc(insn.src1_enc, false) >> insn.lo) & mask);
+		break;
+	}
+	case AFUC_BFI:
+	{
+		uint32_t width = insn.hi - insn.lo + 1;
+		uint32_t mask = ((width >= 32) ? ~0u : ((1u << width) - 1)) << insn.lo;
+		uint32_t old = (insn.dst_enc < 0x1d) ? m_gpr[insn.dst_enc] : 0;
+		uint32_t src = ReadSrc(insn.src1_enc, false);
+		WriteDst(insn.dst_enc, (old & ~mask) | ((src << insn.lo) & mask));
+		break;
+	}
+
+	case AFUC_LOAD:
+	{
+		uint32_t addr = ReadSrc(insn.src1_enc, false) + insn.immed;
+		if (insn.preincrement)
+			SetGpr(insn.src1_enc, addr);
+		uint64_t full = ((uint64_t)m_ctrl[m_off_load_store_hi & 0xfff] << 32) | addr;
+		auto it = m_scratch.find(full);
+		WriteDst(insn.dst_enc, it == m_scratch.end() ? 0 : it->second);
+		break;
+	}
+	case AFUC_STORE:
+	{
+		uint32_t val = ReadSrc(insn.src1_enc, false);
+		uint32_t addr = ReadSrc(insn.src2_enc, false) + insn.immed;
+		if (insn.preincrement)
+			SetGpr(insn.src2_enc, addr);
+		uint64_t full = ((uint64_t)m_ctrl[m_off_load_store_hi & 0xfff] << 32) | addr;
+		m_scratch[full] = val;
+		m_effects.push_back({ AFUC_EFF_MEM, full, val });
+		break;
+	}
+
+	case AFUC_CWRITE:
+	case AFUC_SWRITE:
+	{
+		uint32_t val = ReadSrc(insn.src1_enc, false);
+		uint32_t off = ReadSrc(insn.src2_enc, false) + insn.base;
+		if (insn.preincrement)
+			SetGpr(insn.src2_enc, off);
+		if (insn.op == AFUC_SWRITE) {
+			m_sqe[off & 0xff] = val;
+			m_effects.push_back({ AFUC_EFF_SQE, off & 0xff, val });
+		} else {
+			WriteCtrl(off, val);
+		}
+
+		/* (sdsN) loads N more payload dwords into @SDS_BASE/@SDS_DWORDS */
+		for (uint32_t k = 0; k < insn.sds; k++) {
+			uint32_t d = ReadSrc(0x1f, false);
+			if (m_has_sds)
+				WriteCtrl(m_off_sds[k], d);
+		}
+		break;
+	}
+	case AFUC_CREAD:
+	case AFUC_SREAD:
+	{
+		uint32_t off = ReadSrc(insn.src1_enc, false) + insn.base;
+		if (insn.preincrement)
+			SetGpr(insn.src1_enc, off);
+		WriteDst(insn.dst_enc, insn.op == AFUC_SREAD ? m_sqe[off & 0xff] : ReadCtrl(off));
+		break;
+	}
+
+	case AFUC_BRNE_IMM:
+	case AFUC_BREQ_IMM:
+	case AFUC_BRNE_BIT:
+	case AFUC_BREQ_BIT:
+	case AFUC_JUMP:
+	{
+		uint32_t v = ReadSrc(insn.src1_enc, false);
+		bool taken;
+		switch (insn.op) {
+		case AFUC_BRNE_IMM: taken = v != insn.immed; break;
+		case AFUC_BREQ_IMM: taken = v == insn.immed; break;
+		case AFUC_BREQ_BIT: taken = (v >> insn.bit) & 1; break;
+		default:            taken = !((v >> insn.bit) & 1); break;
+		}
+		if (taken) {
+			m_branch_pending = true;
+			m_branch_target = m_pc + 1 + insn.branch_offset;
+		}
+		break;
+	}
+
+	case AFUC_JUMPA:
+		m_branch_pending = true;
+		m_branch_target = insn.branch_target;
+		break;
+
+	case AFUC_CALL:
+		if (m_call_stack.size() < s_max_call_depth)
+			m_call_stack.push_back(m_pc + 2);
+		m_branch_pending = true;
+		m_branch_target = insn.branch_target;
+		break;
+
+	case AFUC_BL:
+		m_gpr[REG_LR] = m_pc + 2;
+		m_branch_pending = true;
+		m_branch_target = insn.branch_target;
+		break;
+
+	case AFUC_RET:
+	case AFUC_IRET:
+		if (m_call_stack.empty()) {
+			m_stop_after_slot = true;
+		} else {
+			m_branch_target = m_call_stack.back();
+			m_call_stack.pop_back();
+		}
+		m_branch_pending = true;
+		break;
+
+	case AFUC_SRET:
+		m_branch_pending = true;
+		m_branch_target = m_gpr[REG_LR];
+		break;
+
+	case AFUC_JUMPR:
+		m_branch_pending = true;
+		m_branch_target = ReadSrc(insn.src1_enc, false);
+		break;
+
+	case AFUC_WAITIN:
+		m_branch_pending = true;
+		m_stop_after_slot = true;
+		break;
+
+	case AFUC_SETSECURE:
+	default:
+		/* setsecure: model the failure path, which falls through */
+		break;
+	}
+}
+
+AfucEmuStop AfucEmu::Step()
+{
+	if (m_pc >= m_code_words)
+		return AFUC_EMU_BAD_PC;
+
+	AfucInsn insn;
+	afuc_decode(reinterpret_cast<const uint8_t*>(&m_code[m_pc]), 4,
+		(uint64_t)m_pc * 4, insn, m_gpuver);
+	if (insn.op == AFUC_INVALID)
+		return AFUC_EMU_BAD_PC;
+
+	/* A transfer set up by the previous instruction happens after this one */
+	bool in_slot = m_branch_pending;
+	bool stop_after = m_stop_after_slot;
+	uint32_t target = m_branch_target;
+	m_branch_pending = false;
+	m_stop_after_slot = false;
+
+	if (insn.rep) {
+		/* (rep) repeats while $rem is non-zero, counting it down */
+		for (uint32_t n = 0; m_gpr[REG_REM] && n < s_max_rep; n++) {
+			Execute(insn);
+			m_gpr[REG_REM]--;
+		}
+	} else {
+		Execute(insn);
+	}
+
+	if (in_slot) {
+		/* control flow in a delay slot is undefined; ignore it */
+		m_branch_pending = false;
+		if (stop_after) {
+			m_stop_after_slot = false;
+			return AFUC_EMU_WAITIN;
+		}
+		if (target >= m_code_words)
+			return AFUC_EMU_INDIRECT;
+		m_pc = target;
+	} else {
+		m_pc++;
+	}
+	return AFUC_EMU_RUNNING;
+}
+
+/* ─── Packet table recovery ───────────────────────────────── */
+
+/* The bootstrap is a short copy loop; this is generous */
+static const uint64_t s_bootstrap_steps = 1 << 20;
+
+uint32_t afuc_find_packet_table(AfucGpuVer gpuver, const uint32_t* image,
+                                size_t image_words,
+                                uint32_t table[AFUC_PACKET_TABLE_SIZE])
+{
+	uint32_t pt_addr;
+	if (image_words < 2 || !afuc_ctrl_reg_offset(gpuver, "PACKET_TABLE_WRITE_ADDR", pt_addr))
+		return 0;
+
+	/* Word 0 of the file is the header; instructions follow */
+	AfucEmu emu(gpuver, image + 1, image_words - 1);
+	emu.SetMemory(image, image_words);
+	emu.Run(0, s_bootstrap_steps, [pt_addr](const AfucEmu& e) {
+		return e.Ctrl(pt_addr) >= AFUC_PACKET_TABLE_SIZE;
+	});
+
+	uint32_t n = emu.PacketTableWrites();
+	if (n > AFUC_PACKET_TABLE_SIZE)
+		n = AFUC_PACKET_TABLE_SIZE;
+	memcpy(table, emu.PacketTable(), sizeof(uint32_t) * AFUC_PACKET_TABLE_SIZE);
+	return n;
+}
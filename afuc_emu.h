@@ -0,0 +1,162 @@
+/*
+ * Minimal concrete AFUC emulator.
+ *
+ * Enough of the SQE to run the bootstrap routine (packet table setup)
+ * and to replay a packet handler against a given payload. Modelled on
+ * freedreno's afuc emulator (emu.c), without the interactive parts.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "afuc.h"
+
+/* Number of packet table entries (one per type-7 opcode) */
+#define AFUC_PACKET_TABLE_SIZE 0x80
+
+enum AfucEmuStop {
+	AFUC_EMU_RUNNING,
+	AFUC_EMU_WAITIN,      /* handler finished */
+	AFUC_EMU_STEP_LIMIT,
+	AFUC_EMU_BAD_PC,      /* ran off the code or hit an invalid word */
+	AFUC_EMU_INDIRECT,    /* indirect jump outside the code */
+	AFUC_EMU_STOPPED,     /* the 'stop' predicate asked to stop */
+};
+
+/* Externally visible side effects, in program order */
+enum AfucEmuEffectKind {
+	AFUC_EFF_CTRL,        /* control register write */
+	AFUC_EFF_SQE,         /* SQE register write */
+	AFUC_EFF_GPU_REG,     /* GPU register write ($addr / @REG_WRITE path) */
+	AFUC_EFF_PIPE_REG,    /* pipe register write */
+	AFUC_EFF_MEM,         /* store */
+};
+
+struct AfucEmuEffect {
+	AfucEmuEffectKind kind;
+	uint64_t addr;
+	uint32_t value;
+};
+
+class AfucEmu
+{
+public:
+	AfucEmu(AfucGpuVer gpuver, const uint32_t* code, size_t code_words);
+
+	/* GPU memory visible through $memdata, word 0 at address 0 */
+	void SetMemory(const uint32_t* mem, size_t words) { m_mem = mem; m_mem_words = words; }
+
+	/* Queue PM4 payload dwords for $data */
+	void PushData(uint32_t dw) { m_data.push_back(dw); }
+
+	/* Run from word index 'pc' until waitin or 'max_steps' instructions */
+	template <typename Stop>
+	AfucEmuStop Run(uint32_t pc, uint64_t max_steps, Stop stop)
+	{
+		m_pc = pc;
+		m_branch_pending = false;
+		for (m_steps = 0; m_steps < max_steps; m_steps++) {
+			AfucEmuStop s = Step();
+			if (s != AFUC_EMU_RUNNING)
+				return s;
+			if (stop(*this))
+				return AFUC_EMU_STOPPED;
+		}
+		return AFUC_EMU_STEP_LIMIT;
+	}
+
+	AfucEmuStop Run(uint32_t pc, uint64_t max_steps)
+	{
+		return Run(pc, max_steps, [](const AfucEmu&) { return false; });
+	}
+
+	AfucEmuStop Step();
+
+	uint32_t Gpr(uint32_t enc) const { return m_gpr[enc & 0x1f]; }
+	void SetGpr(uint32_t enc, uint32_t val) { if (enc & 0x1f) m_gpr[enc & 0x1f] = val; }
+	uint32_t Ctrl(uint32_t off) const { return m_ctrl[off & 0xfff]; }
+	uint32_t Pc() const { return m_pc; }
+	uint64_t Steps() const { return m_steps; }
+	size_t DataRemaining() const { return m_data.size(); }
+	bool DataUnderrun() const { return m_data_underrun; }
+
+	const uint32_t* PacketTable() const { return m_packet_table; }
+	uint32_t PacketTableWrites() const { return m_packet_table_writes; }
+	const std::vector<AfucEmuEffect>& Effects() const { return m_effects; }
+
+	/* Scratch memory / GPU registers as left by the run */
+	const std::map<uint64_t, uint32_t>& Scratch() const { return m_scratch; }
+
+private:
+	uint32_t ReadSrc(uint32_t enc, bool peek);
+	void WriteDst(uint32_t enc, uint32_t val);
+	void WriteCtrl(uint32_t off, uint32_t val);
+	uint32_t ReadCtrl(uint32_t off);
+	void WriteGpuReg(uint32_t val);
+	uint32_t Alu(AfucOp op, uint32_t a, uint32_t b);
+	void Execute(const AfucInsn& insn);
+
+	AfucGpuVer m_gpuver;
+	const uint32_t* m_code;
+	size_t m_code_words;
+	const uint32_t* m_mem = nullptr;
+	size_t m_mem_words = 0;
+
+	uint32_t m_gpr[0x20] = {};
+	bool m_carry = false;
+	uint32_t m_ctrl[0x1000] = {};
+	uint32_t m_sqe[0x100] = {};
+
+	uint32_t m_pc = 0;
+	uint64_t m_steps = 0;
+	bool m_branch_pending = false;
+	uint32_t m_branch_target = 0;
+	bool m_stop_after_slot = false;
+	std::vector<uint32_t> m_call_stack;
+
+	std::deque<uint32_t> m_data;
+	bool m_data_underrun = false;
+
+	/* $memdata stream */
+	uint64_t m_mem_read_addr = 0;
+	uint32_t m_mem_read_dwords = 0;
+
+	/* $regdata stream and register write address */
+	uint32_t m_reg_read_addr = 0;
+	uint32_t m_reg_write_addr = 0;
+	std::map<uint32_t, uint32_t> m_gpu_regs;
+
+	std::map<uint64_t, uint32_t> m_scratch;
+	std::vector<AfucEmuEffect> m_effects;
+
+	uint32_t m_packet_table[AFUC_PACKET_TABLE_SIZE] = {};
+	uint32_t m_packet_table_writes = 0;
+
+	/* Generation-specific control register offsets (~0u if absent) */
+	uint32_t m_off_mem_read_addr, m_off_mem_read_dwords;
+	uint32_t m_off_reg_write_addr, m_off_reg_write;
+	uint32_t m_off_reg_read_addr;
+	uint32_t m_off_pt_write_addr, m_off_pt_write;
+	uint32_t m_off_load_store_hi;
+	uint32_t m_off_sds[3];
+	bool m_has_sds;
+};
+
+/*
+ * Recover the packet table by running the bootstrap routine, like
+ * freedreno's emu_run_bootstrap(). 'image' is the whole firmware file,
+ * which is where the bootstrap fetches the table from. Returns the
+ * number of entries written (AFUC_PACKET_TABLE_SIZE on success);
+ * handlers are word indices into the instruction space.
+ */
+uint32_t afuc_find_packet_table(AfucGpuVer gpuver, const uint32_t* image,
+                                size_t image_words,
+                                uint32_t table[AFUC_PACKET_TABLE_SIZE]);
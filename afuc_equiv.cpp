@@ -0,0 +1,536 @@
+/*
+ * Bounded equivalence check between two versions of a packet handler,
+ * e.g. the shipping firmware and an optimized or instrumented rebuild.
+ *
+ * The symbolic effect summaries are compared first. For branch-free
+ * handlers they are exact and settle the check on their own. Otherwise
+ * they merge paths, so both versions are run side by side in the
+ * emulator on payloads built from the values their branches test, and
+ * the first payload that makes their writes differ is reported. When the
+ * summaries differ but no payload shows it, the verdict stays open.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+
+#include "binaryninjaapi.h"
+#include "afuc_emu.h"
+#include "afuc_pm4.h"
+#include "afuc_view.h"
+
+using namespace BinaryNinja;
+using namespace std;
+
+/* ─── Concrete runs ────────────────────────────────────────── */
+
+static const uint64_t s_max_steps = 20000;
+static const size_t s_max_payload = 256;
+static const size_t s_mem_words = 1024;
+
+namespace {
+
+struct RunResult {
+	AfucEmuStop stop;
+	vector<AfucEmuEffect> effects;
+	size_t consumed;
+};
+
+/* splitmix64, so a check is reproducible from its handler addresses */
+struct Rng {
+	uint64_t s;
+	uint64_t next()
+	{
+		uint64_t z = (s += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+};
+
+}
+
+static RunResult run(AfucGpuVer gpuver, const uint32_t* code, size_t count, uint64_t entry,
+                     const vector<uint32_t>& payload, const uint32_t (&gprs)[0x1d],
+                     const vector<uint32_t>& mem)
+{
+	auto emu = make_unique<AfucEmu>(gpuver, code, count);
+	emu->SetMemory(mem.data(), mem.size());
+	for (uint32_t r = 1; r < 0x1d; r++)
+		emu->SetGpr(r, gprs[r]);
+	for (uint32_t dw : payload)
+		emu->PushData(dw);
+
+	RunResult r;
+	r.stop = emu->Run((uint32_t)(entry / 4), s_max_steps);
+	r.effects = emu->Effects();
+	r.consumed = payload.size() - emu->DataRemaining();
+	return r;
+}
+
+static string effect_text(AfucGpuVer gpuver, const AfucEmuEffect& e)
+{
+	char buf[96];
+	const char* name = nullptr;
+	switch (e.kind) {
+	case AFUC_EFF_CTRL:
+		if ((name = afuc_ctrl_reg_name(gpuver, (uint32_t)e.addr)))
+			snprintf(buf, sizeof(buf), "@%s = 0x%x", name, e.value);
+		else
+			snprintf(buf, sizeof(buf), "@0x%03" PRIx64 " = 0x%x", e.addr, e.value);
+		break;
+	case AFUC_EFF_SQE:
+		if ((name = afuc_sqe_reg_name((uint32_t)e.addr)))
+			snprintf(buf, sizeof(buf), "%%%s = 0x%x", name, e.value);
+		else
+			snprintf(buf, sizeof(buf), "%%0x%02" PRIx64 " = 0x%x", e.addr, e.value);
+		break;
+	case AFUC_EFF_PIPE_REG:
+		if ((name = afuc_pipe_reg_name(gpuver, (uint32_t)e.addr)))
+			snprintf(buf, sizeof(buf), "|%s = 0x%x", name, e.value);
+		else
+			snprintf(buf, sizeof(buf), "|0x%02" PRIx64 " = 0x%x", e.addr, e.value);
+		break;
+	case AFUC_EFF_GPU_REG:
+		snprintf(buf, sizeof(buf), "REG[0x%" PRIx64 "] = 0x%x", e.addr, e.value);
+		break;
+	case AFUC_EFF_MEM:
+		snprintf(buf, sizeof(buf), "MEM[0x%" PRIx64 "] = 0x%x", e.addr, e.value);
+		break;
+	}
+	return buf;
+}
+
+static const char* stop_text(AfucEmuStop stop)
+{
+	switch (stop) {
+	case AFUC_EMU_WAITIN:     return "reaches waitin";
+	case AFUC_EMU_STEP_LIMIT: return "runs out of steps";
+	case AFUC_EMU_BAD_PC:     return "runs off the code";
+	case AFUC_EMU_INDIRECT:   return "jumps outside the code";
+	default:                  return "stops";
+	}
+}
+
+/* Empty if 'a' and 'b' are indistinguishable */
+static string compare(AfucGpuVer gpuver, const RunResult& a, const RunResult& b)
+{
+	char buf[256];
+	if (a.stop != b.stop) {
+		snprintf(buf, sizeof(buf), "A %s, B %s", stop_text(a.stop), stop_text(b.stop));
+		return buf;
+	}
+	size_t n = min(a.effects.size(), b.effects.size());
+	for (size_t i = 0; i < n; i++) {
+		const AfucEmuEffect& x = a.effects[i];
+		const AfucEmuEffect& y = b.effects[i];
+		if (x.kind != y.kind || x.addr != y.addr || x.value != y.value) {
+			snprintf(buf, sizeof(buf), "write %zu: A %s, B %s", i,
+				effect_text(gpuver, x).c_str(), effect_text(gpuver, y).c_str());
+			return buf;
+		}
+	}
+	if (a.effects.size() != b.effects.size()) {
+		const AfucEmuEffect& extra = a.effects.size() > n ? a.effects[n] : b.effects[n];
+		snprintf(buf, sizeof(buf), "A makes %zu writes, B %zu; first extra: %s",
+			a.effects.size(), b.effects.size(), effect_text(gpuver, extra).c_str());
+		return buf;
+	}
+	if (a.consumed != b.consumed) {
+		snprintf(buf, sizeof(buf), "A consumes %zu payload dwords, B %zu", a.consumed, b.consumed);
+		return buf;
+	}
+	return "";
+}
+
+/* ─── Payload generation ───────────────────────────────────── */
+
+/* Values the handler's branches test, and their neighbours */
+static void branch_values(AfucGpuVer gpuver, const uint32_t* code, size_t count,
+                          uint64_t entry, set<uint32_t>& out)
+{
+	vector<uint64_t> addrs;
+	afuc_handler_insns(gpuver, code, count, entry, addrs);
+	for (uint64_t addr : addrs) {
+		AfucInsn insn;
+		if (!afuc_decode((const uint8_t*)&code[addr / 4], 4, addr, insn, gpuver))
+			continue;
+		if (afuc_op_form(insn.op) == AFUC_FORM_BR_IMM) {
+			out.insert(insn.immed);
+			out.insert(insn.immed + 1);
+			out.insert(insn.immed - 1);
+		} else if (afuc_op_form(insn.op) == AFUC_FORM_BR_BIT) {
+			out.insert(1u << insn.bit);
+			out.insert(~(1u << insn.bit));
+		}
+	}
+}
+
+static size_t payload_size(AfucGpuVer gpuver, const uint32_t* code, size_t count, uint64_t entry)
+{
+	vector<AfucPayloadRead> reads;
+	int dwords;
+	afuc_payload_reads(gpuver, code, count, entry, reads, &dwords);
+	return dwords < 0 ? 64 : (size_t)dwords;
+}
+
+/* ─── Summaries ────────────────────────────────────────────── */
+
+namespace {
+
+enum SummaryVerdict {
+	SUMMARY_UNDECIDED,
+	SUMMARY_EQUAL,        /* exact and identical */
+	SUMMARY_DIFFER,       /* exact effect sets that differ */
+};
+
+}
+
+/* No conditional or indirect branch anywhere the handler reaches */
+static bool single_path(AfucGpuVer gpuver, const uint32_t* code, size_t count, uint64_t entry)
+{
+	vector<uint64_t> addrs;
+	afuc_handler_insns(gpuver, code, count, entry, addrs);
+	for (uint64_t addr : addrs) {
+		AfucInsn insn;
+		if (!afuc_decode((const uint8_t*)&code[addr / 4], 4, addr, insn, gpuver))
+			return false;
+		AfucFlowKind k = afuc_insn_flow(insn, addr).kind;
+		if (k == AFUC_FLOW_COND || k == AFUC_FLOW_INDIRECT)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Summaries without unknowns give every write exactly. If the effect
+ * sets differ, some path writes something the other version never
+ * writes (or the two only spell the same value differently, hence the
+ * concrete runs still look for a counterexample). Equal summaries only
+ * prove equivalence when neither side branches or repeats a write,
+ * since merged paths hide which payloads reach a write.
+ */
+static SummaryVerdict compare_summaries(AfucGpuVer gpuver,
+                                        const uint32_t* code_a, size_t count_a, uint64_t entry_a,
+                                        const uint32_t* code_b, size_t count_b, uint64_t entry_b,
+                                        string& reason)
+{
+	AfucEffectSummary sa, sb;
+	afuc_handler_effects(gpuver, code_a, count_a, entry_a, sa);
+	afuc_handler_effects(gpuver, code_b, count_b, entry_b, sb);
+	if (!sa.complete || !sb.complete)
+		return SUMMARY_UNDECIDED;
+
+	bool repeated = false;
+	vector<string> ta, tb;
+	for (const AfucEffect& e : sa.effects) {
+		ta.push_back(afuc_effect_text(gpuver, sa, e));
+		repeated |= e.in_loop;
+	}
+	for (const AfucEffect& e : sb.effects) {
+		tb.push_back(afuc_effect_text(gpuver, sb, e));
+		repeated |= e.in_loop;
+	}
+	auto unknown = [](const string& t) { return t.find('?') != string::npos; };
+	if (any_of(ta.begin(), ta.end(), unknown) || any_of(tb.begin(), tb.end(), unknown))
+		return SUMMARY_UNDECIDED;
+
+	if (ta == tb)
+		return !repeated && single_path(gpuver, code_a, count_a, entry_a) &&
+			single_path(gpuver, code_b, count_b, entry_b) ? SUMMARY_EQUAL : SUMMARY_UNDECIDED;
+
+	vector<string> sorted_a = ta, sorted_b = tb;
+	sort(sorted_a.begin(), sorted_a.end());
+	sort(sorted_b.begin(), sorted_b.end());
+	if (sorted_a == sorted_b)
+		return SUMMARY_UNDECIDED;   /* same writes, different order of sites */
+
+	vector<string> only_a, only_b;
+	set_difference(sorted_a.begin(), sorted_a.end(), sorted_b.begin(), sorted_b.end(), back_inserter(only_a));
+	set_difference(sorted_b.begin(), sorted_b.end(), sorted_a.begin(), sorted_a.end(), back_inserter(only_b));
+	reason = !only_a.empty() ? "summaries differ: only A writes " + only_a[0]
+		: "summaries differ: only B writes " + only_b[0];
+	return SUMMARY_DIFFER;
+}
+
+/* ─── Check ────────────────────────────────────────────────── */
+
+void afuc_check_equivalence(AfucGpuVer gpuver,
+                            const uint32_t* code_a, size_t count_a, uint64_t entry_a,
+                            const uint32_t* code_b, size_t count_b, uint64_t entry_b,
+                            uint32_t samples, AfucEquivResult& out)
+{
+	out = AfucEquivResult();
+
+	/* Untouched handlers are common in a patched image, skip them cheaply */
+	vector<uint64_t> insns_a, insns_b;
+	afuc_handler_insns(gpuver, code_a, count_a, entry_a, insns_a);
+	afuc_handler_insns(gpuver, code_b, count_b, entry_b, insns_b);
+	if (entry_a == entry_b && insns_a == insns_b &&
+	    all_of(insns_a.begin(), insns_a.end(), [&](uint64_t a) { return code_a[a / 4] == code_b[a / 4]; })) {
+		out.verdict = AFUC_EQUIV_IDENTICAL;
+		out.symbolic_equal = true;
+		return;
+	}
+
+	string summary_diff;
+	SummaryVerdict summaries = compare_summaries(gpuver, code_a, count_a, entry_a,
+		code_b, count_b, entry_b, summary_diff);
+	if (summaries == SUMMARY_EQUAL) {
+		out.symbolic_equal = true;
+		return;
+	}
+
+	set<uint32_t> interesting = { 0, 1, ~0u };
+	branch_values(gpuver, code_a, count_a, entry_a, interesting);
+	branch_values(gpuver, code_b, count_b, entry_b, interesting);
+	vector<uint32_t> values(interesting.begin(), interesting.end());
+
+	size_t len = min(s_max_payload, max(payload_size(gpuver, code_a, count_a, entry_a),
+		payload_size(gpuver, code_b, count_b, entry_b)) + 4);
+
+	Rng rng = { entry_a * 0x100000001b3ull ^ entry_b };
+	vector<uint32_t> mem(s_mem_words);
+	for (uint32_t& w : mem)
+		w = (uint32_t)rng.next();
+
+	for (uint32_t s = 0; s < samples; s++) {
+		vector<uint32_t> payload(len);
+		uint32_t gprs[0x1d] = {};
+		for (size_t i = 0; i < len; i++) {
+			/* all zeros, all ones, then the tested values mixed with noise */
+			if (s == 0)
+				payload[i] = 0;
+			else if (s == 1)
+				payload[i] = ~0u;
+			else if (rng.next() & 1)
+				payload[i] = values[rng.next() % values.size()];
+			else
+				payload[i] = (uint32_t)rng.next();
+		}
+		if (s)
+			for (uint32_t r = 1; r < 0x1d; r++)
+				gprs[r] = r == REG_REM ? (uint32_t)(rng.next() % 16) : (uint32_t)rng.next();
+
+		RunResult ra = run(gpuver, code_a, count_a, entry_a, payload, gprs, mem);
+		RunResult rb = run(gpuver, code_b, count_b, entry_b, payload, gprs, mem);
+		out.samples++;
+		string diff = compare(gpuver, ra, rb);
+		if (diff.empty())
+			continue;
+
+		/* trim the counterexample to what either version read */
+		payload.resize(max(ra.consumed, rb.consumed));
+		out.verdict = AFUC_EQUIV_MISMATCH;
+		out.payload = payload;
+		out.reason = diff;
+		return;
+	}
+
+	if (summaries == SUMMARY_DIFFER) {
+		out.verdict = AFUC_EQUIV_UNKNOWN;
+		out.reason = summary_diff;
+	}
+}
+
+/* ─── Binary Ninja glue ────────────────────────────────────── */
+
+static const uint32_t s_samples = 256;
+
+/* Instruction words and packet table of another firmware file */
+static bool load_other(const string& path, AfucGpuVer gpuver, vector<uint32_t>& image,
+                       uint32_t table[AFUC_PACKET_TABLE_SIZE], bool& has_table)
+{
+	ifstream f(path, ios::binary);
+	vector<char> bytes((istreambuf_iterator<char>(f)), istreambuf_iterator<char>());
+	if (bytes.size() < 8)
+		return false;
+	image.resize(bytes.size() / 4);
+	memcpy(image.data(), bytes.data(), image.size() * 4);
+
+	uint32_t fw_id, version;
+	if (!afuc_fw_version(image.data(), image.size(), fw_id, version) ||
+	    afuc_detect_gpuver(fw_id) != gpuver)
+		return false;
+	has_table = afuc_find_packet_table(gpuver, image.data(), image.size(), table) == AFUC_PACKET_TABLE_SIZE;
+	return true;
+}
+
+static string verdict_text(const AfucEquivResult& r)
+{
+	switch (r.verdict) {
+	case AFUC_EQUIV_IDENTICAL:
+		return "identical";
+	case AFUC_EQUIV_EQUIVALENT:
+		return r.symbolic_equal ? "equivalent (summaries agree)" : "equivalent (" + to_string(r.samples) + " runs)";
+	case AFUC_EQUIV_UNKNOWN:
+		return "undecided (" + r.reason + "; no difference in " + to_string(r.samples) + " runs)";
+	default:
+		return "**differs**";
+	}
+}
+
+static string payload_text(const vector<uint32_t>& payload)
+{
+	string text;
+	char buf[16];
+	for (uint32_t dw : payload) {
+		snprintf(buf, sizeof(buf), "%s0x%08x", text.empty() ? "" : " ", dw);
+		text += buf;
+	}
+	return text.empty() ? "(empty)" : text;
+}
+
+static void check_packets(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	if (!afuc_view_gpuver(view, gpuver))
+		return;
+
+	Ref<Metadata> md = view->QueryMetadata("afuc.packet_table");
+	if (!md || !md->IsArray()) {
+		LogError("AFUC: no packet table recovered for this firmware");
+		return;
+	}
+	vector<uint64_t> table_a = md->GetUnsignedIntegerList();
+
+	string path;
+	if (!GetOpenFileNameInput(path, "Firmware to compare against"))
+		return;
+
+	Ref<BinaryView> ref = view;
+	WorkerEnqueue([=]() {
+		Ref<BackgroundTask> task = new BackgroundTask("Checking AFUC handler equivalence...", true);
+		uint64_t base;
+		vector<uint32_t> code_a = afuc_read_code(ref, base);
+
+		vector<uint32_t> image;
+		uint32_t table_b[AFUC_PACKET_TABLE_SIZE];
+		bool has_table;
+		if (!load_other(path, gpuver, image, table_b, has_table) || !has_table) {
+			task->Finish();
+			LogError("AFUC: %s is not a firmware of the same generation with a packet table", path.c_str());
+			return;
+		}
+		const uint32_t* code_b = image.data() + 1;
+		size_t count_b = image.size() - 1;
+
+		/* opcodes sharing a handler in both versions are checked once */
+		std::map<pair<uint64_t, uint64_t>, vector<uint32_t>> pairs;
+		std::map<uint64_t, size_t> users_a, users_b;
+		size_t n = min(table_a.size(), (size_t)AFUC_PACKET_TABLE_SIZE);
+		for (size_t op = 0; op < n; op++) {
+			users_a[table_a[op]]++;
+			users_b[(uint64_t)table_b[op] * 4]++;
+		}
+		for (size_t op = 0; op < n; op++) {
+			uint64_t a = table_a[op], b = (uint64_t)table_b[op] * 4;
+			if (a / 4 >= code_a.size() || b / 4 >= count_b ||
+			    users_a[a] > AFUC_PM4_SHARED_HANDLER_MAX || users_b[b] > AFUC_PM4_SHARED_HANDLER_MAX)
+				continue;
+			pairs[{ a, b }].push_back((uint32_t)op);
+		}
+
+		string report = "# AFUC handler equivalence\n\nA: this view, B: " + path + "\n\n"
+			"| Packet | A | B | Result |\n|---|---|---|---|\n";
+		string details;
+		char buf[160];
+		size_t identical = 0, differ = 0, undecided = 0;
+		auto t0 = chrono::steady_clock::now();
+
+		for (const auto& [addrs, opcodes] : pairs) {
+			if (task->IsCancelled()) {
+				task->Finish();
+				return;
+			}
+			const char* name = afuc_pm4_packet_name(gpuver, opcodes[0]);
+			snprintf(buf, sizeof(buf), "CP_UNKNOWN_%02x", opcodes[0]);
+			string packet = name ? name : buf;
+			task->SetProgressText("Checking AFUC handler equivalence: " + packet);
+
+			AfucEquivResult r;
+			afuc_check_equivalence(gpuver, code_a.data(), code_a.size(), addrs.first,
+				code_b, count_b, addrs.second, s_samples, r);
+			if (r.verdict == AFUC_EQUIV_IDENTICAL) {
+				identical++;
+				continue;
+			}
+
+			snprintf(buf, sizeof(buf), " | 0x%" PRIx64 " | 0x%" PRIx64 " | ", addrs.first, addrs.second);
+			report += "| " + packet + buf + verdict_text(r) + " |\n";
+			undecided += r.verdict == AFUC_EQUIV_UNKNOWN;
+			if (r.verdict != AFUC_EQUIV_MISMATCH)
+				continue;
+			differ++;
+			details += "- **" + packet + "**: " + r.reason + "\n  - payload: `" + payload_text(r.payload) + "`\n";
+		}
+
+		if (!details.empty())
+			report += "\n## Counterexamples\n\n" + details;
+		auto ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - t0).count();
+		snprintf(buf, sizeof(buf), "\n%zu handlers compared, %zu identical, %zu differ, %zu undecided (%lld ms)\n",
+			pairs.size(), identical, differ, undecided, (long long)ms);
+		report += buf;
+
+		task->Finish();
+		ShowMarkdownReport("AFUC Handler Equivalence", report, report);
+	}, "AFUC handler equivalence");
+}
+
+static void check_function(BinaryView* view, Function* func)
+{
+	AfucGpuVer gpuver;
+	if (!afuc_view_gpuver(view, gpuver))
+		return;
+
+	string path;
+	int64_t other;
+	if (!GetOpenFileNameInput(path, "Firmware to compare against") ||
+	    !GetIntegerInput(other, "Handler address in that firmware", "Check Handler Equivalence"))
+		return;
+
+	vector<uint32_t> image;
+	uint32_t table[AFUC_PACKET_TABLE_SIZE];
+	bool has_table;
+	if (!load_other(path, gpuver, image, table, has_table) || (uint64_t)other / 4 >= image.size() - 1) {
+		LogError("AFUC: %s has no code at 0x%" PRIx64 " for this generation", path.c_str(), (uint64_t)other);
+		return;
+	}
+
+	uint64_t base;
+	vector<uint32_t> code = afuc_read_code(view, base);
+	AfucEquivResult r;
+	afuc_check_equivalence(gpuver, code.data(), code.size(), func->GetStart(),
+		image.data() + 1, image.size() - 1, (uint64_t)other, s_samples, r);
+
+	string report = "# Equivalence of " + func->GetSymbol()->GetShortName() + "\n\n" + verdict_text(r) + "\n";
+	if (r.verdict == AFUC_EQUIV_MISMATCH)
+		report += "\n" + r.reason + "\n\npayload: `" + payload_text(r.payload) + "`\n";
+	ShowMarkdownReport("AFUC Handler Equivalence", report, report);
+}
+
+static bool has_packet_table(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	return afuc_view_gpuver(view, gpuver) && view->QueryMetadata("afuc.packet_table");
+}
+
+void afuc_register_equiv_commands()
+{
+	PluginCommand::Register("AFUC\\Check Handler Equivalence...",
+		"Compare every packet handler against another build of this firmware",
+		check_packets, has_packet_table);
+	PluginCommand::RegisterForFunction("AFUC\\Check Function Equivalence...",
+		"Compare this handler against a handler at a given address in another build",
+		check_function, afuc_is_function);
+}
@@ -0,0 +1,457 @@
+/*
+ * Memory fetch and register readback volume per packet handler.
+ *
+ * Handlers pull GPU memory through $memdata after sizing the stream with
+ * @MEM_READ_DWORDS, and read GPU registers back through $regdata after
+ * writing @REG_READ_ADDR. A path walk like the payload-read one keeps a
+ * small symbolic value per GPR (a constant or a payload dword) so stream
+ * sizes taken from the packet show up as such.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <tuple>
+
+#include "binaryninjaapi.h"
+#include "afuc_pm4.h"
+#include "afuc_view.h"
+
+using namespace BinaryNinja;
+using namespace std;
+
+/* ─── Symbolic values ──────────────────────────────────────── */
+
+static const AfucSymVal s_unknown = { AFUC_SYM_UNKNOWN, 0, false };
+
+static AfucSymVal sym_const(uint32_t v)
+{
+	return { AFUC_SYM_CONST, v, false };
+}
+
+string afuc_sym_text(const AfucSymVal& v)
+{
+	switch (v.kind) {
+	case AFUC_SYM_CONST:
+		return to_string(v.value);
+	case AFUC_SYM_PAYLOAD:
+		return (v.derived ? "f(payload[" : "payload[") + to_string(v.value) + (v.derived ? "])" : "]");
+	default:
+		return "?";
+	}
+}
+
+static bool same_sym(const AfucSymVal& a, const AfucSymVal& b)
+{
+	return a.kind == b.kind && a.value == b.value && a.derived == b.derived;
+}
+
+/* Result of an ALU op: folded if both inputs are constant, a derived
+ * payload value if exactly one comes from the payload */
+static AfucSymVal sym_alu(AfucOp op, const AfucSymVal& a, const AfucSymVal& b)
+{
+	if (a.kind == AFUC_SYM_CONST && b.kind == AFUC_SYM_CONST) {
+		switch (op) {
+		case AFUC_ADD:  return sym_const(a.value + b.value);
+		case AFUC_SUB:  return sym_const(a.value - b.value);
+		case AFUC_AND:  return sym_const(a.value & b.value);
+		case AFUC_OR:   return sym_const(a.value | b.value);
+		case AFUC_XOR:  return sym_const(a.value ^ b.value);
+		case AFUC_SHL:  return sym_const(a.value << (b.value & 31));
+		case AFUC_USHR: return sym_const(a.value >> (b.value & 31));
+		default:        return s_unknown;
+		}
+	}
+	if (a.kind == AFUC_SYM_PAYLOAD && b.kind == AFUC_SYM_CONST)
+		return (op == AFUC_ADD || op == AFUC_OR) && b.value == 0 ? a : AfucSymVal{ AFUC_SYM_PAYLOAD, a.value, true };
+	if (b.kind == AFUC_SYM_PAYLOAD && a.kind == AFUC_SYM_CONST)
+		return (op == AFUC_ADD || op == AFUC_OR) && a.value == 0 ? b : AfucSymVal{ AFUC_SYM_PAYLOAD, b.value, true };
+	return s_unknown;
+}
+
+/* ─── Handler walk ─────────────────────────────────────────── */
+
+static const size_t s_max_states = 20000;
+static const size_t s_max_call_depth = 4;
+static const uint32_t s_no_dword = ~0u;
+
+namespace {
+
+struct FetchState {
+	uint64_t pc;
+	vector<uint64_t> stack;
+	uint32_t dword;                       /* next payload dword, s_no_dword once unknown */
+	array<AfucSymVal, 0x1d> regs;
+	bool sized[2];
+	uint64_t size_const[2], read_const[2];
+	uint32_t readbacks;
+	vector<pair<uint64_t, size_t>> back;  /* backward edges taken: branch site, call depth */
+
+	/* everything the totals at the path's end depend on */
+	auto key() const
+	{
+		return make_tuple(pc, dword, stack, back, sized[0], sized[1], size_const[0], size_const[1],
+		                  read_const[0], read_const[1], readbacks);
+	}
+};
+
+}
+
+void afuc_fetch_volume(AfucGpuVer gpuver, const uint32_t* code, size_t count,
+                       uint64_t entry, AfucFetchSummary& out)
+{
+	out = AfucFetchSummary();
+	uint32_t off_mem_dwords = ~0u, off_reg_dwords = ~0u, off_reg_addr = ~0u;
+	afuc_ctrl_reg_offset(gpuver, "MEM_READ_DWORDS", off_mem_dwords);
+	afuc_ctrl_reg_offset(gpuver, "REG_READ_DWORDS", off_reg_dwords);
+	afuc_ctrl_reg_offset(gpuver, "REG_READ_ADDR", off_reg_addr);
+
+	set<decltype(FetchState().key())> visited;
+	map<pair<uint64_t, int>, AfucStreamAccess> accesses;
+
+	auto record = [&](uint64_t addr, AfucStream s, bool setup, const AfucSymVal& n) {
+		auto it = accesses.try_emplace({ addr, s }, AfucStreamAccess{ addr, s, setup, n }).first;
+		if (!same_sym(it->second.dwords, n))
+			it->second.dwords = s_unknown;
+	};
+	auto add_symbolic = [&](int s, const AfucSymVal& v) {
+		for (const AfucSymVal& e : out.symbolic[s])
+			if (same_sym(e, v))
+				return;
+		out.symbolic[s].push_back(v);
+	};
+	auto account = [&](FetchState& st, int s, bool sizing, const AfucSymVal& n) {
+		if (n.kind == AFUC_SYM_CONST)
+			(sizing ? st.size_const : st.read_const)[s] += n.value;
+		else
+			add_symbolic(s, n);
+	};
+
+	auto apply = [&](const AfucInsn& insn, uint64_t addr, FetchState& st) {
+		auto get = [&](uint32_t enc) -> AfucSymVal {
+			if (enc == 0)
+				return sym_const(0);
+			if (enc < 0x1d)
+				return st.regs[enc];
+			if (enc == 0x1f) {
+				if (insn.rep || insn.xmov || st.dword == s_no_dword) {
+					st.dword = s_no_dword;
+					return s_unknown;
+				}
+				AfucSymVal v = { AFUC_SYM_PAYLOAD, st.dword, false };
+				if (!insn.peek)
+					st.dword++;
+				return v;
+			}
+
+			/* $memdata / $regdata: (rep) reads $rem dwords */
+			int s = enc == 0x1d ? AFUC_STREAM_MEM : AFUC_STREAM_REG;
+			AfucSymVal n = insn.rep ? st.regs[REG_REM] : sym_const(1);
+			record(addr, (AfucStream)s, false, n);
+			account(st, s, false, n);
+			return s_unknown;
+		};
+
+		AfucSymVal a = s_unknown, b = s_unknown, result = s_unknown;
+		switch (afuc_op_form(insn.op)) {
+		case AFUC_FORM_ALU:
+			a = get(insn.src1_enc);
+			b = insn.is_immed ? sym_const(insn.immed) : get(insn.src2_enc);
+			result = sym_alu(insn.op, a, b);
+			break;
+		case AFUC_FORM_ALU1:
+			get(insn.is_immed ? 0 : insn.src2_enc);
+			break;
+		case AFUC_FORM_MOV:
+			result = get(insn.src2_enc);
+			break;
+		case AFUC_FORM_MOVI:
+			result = sym_const(insn.immed << insn.shift);
+			break;
+		case AFUC_FORM_BITFIELD:
+		case AFUC_FORM_BIT:
+			a = get(insn.src1_enc);
+			if (a.kind == AFUC_SYM_PAYLOAD && insn.op == AFUC_UBFX)
+				result = { AFUC_SYM_PAYLOAD, a.value, true };
+			break;
+		case AFUC_FORM_CREAD:
+		case AFUC_FORM_LOAD:
+		case AFUC_FORM_BR_IMM:
+		case AFUC_FORM_BR_BIT:
+		case AFUC_FORM_INDIRECT:
+			get(insn.src1_enc);
+			break;
+		case AFUC_FORM_CWRITE:
+		case AFUC_FORM_STORE:
+			a = get(insn.src1_enc);
+			get(insn.src2_enc);
+			for (uint32_t k = 0; k < insn.sds; k++)
+				get(0x1f);
+			break;
+		default:
+			break;
+		}
+		if (insn.rep)
+			result = s_unknown;
+
+		if (insn.op == AFUC_CWRITE && insn.src2_enc == 0 && !insn.sds) {
+			if (insn.base == off_mem_dwords || insn.base == off_reg_dwords) {
+				int s = insn.base == off_mem_dwords ? AFUC_STREAM_MEM : AFUC_STREAM_REG;
+				record(addr, (AfucStream)s, true, a);
+				account(st, s, true, a);
+				st.sized[s] = true;
+			} else if (insn.base == off_reg_addr) {
+				record(addr, AFUC_STREAM_REG, true, s_unknown);
+				st.readbacks++;
+			}
+		}
+
+		uint32_t dst = afuc_insn_dst_regs(insn);
+		for (uint32_t r = 1; r < 0x1d; r++)
+			if (dst & (1u << r))
+				st.regs[r] = r == insn.dst_enc ? result : s_unknown;
+	};
+
+	auto finish = [&](const FetchState& st) {
+		for (int s = 0; s < 2; s++)
+			out.dwords[s] = max(out.dwords[s], st.sized[s] ? st.size_const[s] : st.read_const[s]);
+		out.readbacks = max(out.readbacks, st.readbacks);
+	};
+
+	/* A backward edge is followed once per path and call depth; the
+	 * second time it is refused, so a loop body counts at most twice */
+	auto follow_back = [&](FetchState& st, uint64_t from, uint64_t to) {
+		if (to > from)
+			return true;
+		pair<uint64_t, size_t> e = { from, st.stack.size() };
+		if (find(st.back.begin(), st.back.end(), e) != st.back.end())
+			return false;
+		st.back.push_back(e);
+		return true;
+	};
+
+	auto decode = [&](uint64_t addr, AfucInsn& insn) {
+		if (addr / 4 >= count)
+			return false;
+		return afuc_decode((const uint8_t*)&code[addr / 4], 4, addr, insn, gpuver);
+	};
+
+	vector<FetchState> work;
+	FetchState first = { entry, {}, 0, {}, { false, false }, { 0, 0 }, { 0, 0 }, 0, {} };
+	first.regs.fill(s_unknown);
+	work.push_back(first);
+
+	while (!work.empty() && visited.size() < s_max_states) {
+		FetchState st = std::move(work.back());
+		work.pop_back();
+
+		for (;;) {
+			/* an identical state already reached the same path ends */
+			if (!visited.insert(st.key()).second)
+				break;
+			AfucInsn insn;
+			if (!decode(st.pc, insn)) {
+				out.complete = false;
+				finish(st);
+				break;
+			}
+			apply(insn, st.pc, st);
+
+			AfucFlow f = afuc_insn_flow(insn, st.pc);
+			if (f.kind == AFUC_FLOW_NEXT) {
+				st.pc += 4;
+				continue;
+			}
+
+			uint64_t next = st.pc + (f.delay_slot ? 8 : 4);
+			AfucInsn slot;
+			if (f.delay_slot && decode(st.pc + 4, slot) && f.kind != AFUC_FLOW_WAITIN)
+				apply(slot, st.pc + 4, st);
+
+			if (f.kind == AFUC_FLOW_COND) {
+				FetchState taken = st;
+				if (follow_back(taken, st.pc, f.target)) {
+					taken.pc = f.target;
+					work.push_back(std::move(taken));
+				}
+				st.pc = next;
+			} else if (f.kind == AFUC_FLOW_JUMP) {
+				if (!follow_back(st, st.pc, f.target)) {
+					finish(st);
+					break;
+				}
+				st.pc = f.target;
+			} else if (f.kind == AFUC_FLOW_CALL && st.stack.size() < s_max_call_depth) {
+				st.stack.push_back(next);
+				st.pc = f.target;
+			} else if (f.kind == AFUC_FLOW_RET && !st.stack.empty()) {
+				st.pc = st.stack.back();
+				st.stack.pop_back();
+				/* the callee's loops start afresh on its next call */
+				erase_if(st.back, [&](const pair<uint64_t, size_t>& e) { return e.second > st.stack.size(); });
+			} else {
+				if (f.kind != AFUC_FLOW_RET && f.kind != AFUC_FLOW_WAITIN)
+					out.complete = false;
+				finish(st);
+				break;
+			}
+		}
+	}
+	if (!work.empty())
+		out.complete = false;
+
+	for (const auto& [key, acc] : accesses)
+		out.accesses.push_back(acc);
+}
+
+/* ─── Binary Ninja glue ────────────────────────────────────── */
+
+static const size_t s_ranked = 25;
+
+namespace {
+
+struct HandlerFetch {
+	uint64_t addr;
+	string packet;
+	AfucFetchSummary s;
+};
+
+}
+
+static string volume_text(const AfucFetchSummary& s, int stream)
+{
+	string text = s.dwords[stream] || s.symbolic[stream].empty() ? to_string(s.dwords[stream]) : "";
+	for (const AfucSymVal& v : s.symbolic[stream])
+		text += (text.empty() ? "" : " + ") + afuc_sym_text(v);
+	return text;
+}
+
+static void show_fetch_volume(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	if (!afuc_view_gpuver(view, gpuver))
+		return;
+
+	Ref<Metadata> md = view->QueryMetadata("afuc.packet_table");
+	if (!md || !md->IsArray()) {
+		LogError("AFUC: no packet table recovered for this firmware");
+		return;
+	}
+	vector<uint64_t> table = md->GetUnsignedIntegerList();
+
+	Ref<BinaryView> ref = view;
+	WorkerEnqueue([=]() {
+		Ref<BackgroundTask> task = new BackgroundTask("Measuring AFUC fetch volume...", true);
+		uint64_t base;
+		vector<uint32_t> code = afuc_read_code(ref, base);
+
+		std::map<uint64_t, vector<uint32_t>> ops;
+		for (size_t op = 0; op < table.size(); op++)
+			ops[table[op]].push_back((uint32_t)op);
+
+		vector<HandlerFetch> handlers;
+		char buf[160];
+		for (const auto& [addr, opcodes] : ops) {
+			if (task->IsCancelled()) {
+				task->Finish();
+				return;
+			}
+			if (addr / 4 >= code.size() || opcodes.size() > AFUC_PM4_SHARED_HANDLER_MAX)
+				continue;
+
+			HandlerFetch h = { addr, "", {} };
+			afuc_fetch_volume(gpuver, code.data(), code.size(), addr, h.s);
+			if (h.s.accesses.empty())
+				continue;
+			const char* name = afuc_pm4_packet_name(gpuver, opcodes[0]);
+			snprintf(buf, sizeof(buf), "CP_UNKNOWN_%02x", opcodes[0]);
+			h.packet = name ? name : buf;
+
+			for (const AfucStreamAccess& a : h.s.accesses) {
+				if (!a.setup || !ref->GetCommentForAddress(a.addr).empty())
+					continue;
+				string text = a.stream == AFUC_STREAM_MEM ? "memdata fetch of " + afuc_sym_text(a.dwords) + " dwords"
+					: a.dwords.kind == AFUC_SYM_UNKNOWN ? "register readback"
+					: "regdata readback of " + afuc_sym_text(a.dwords) + " dwords";
+				ref->SetCommentForAddress(a.addr, text);
+			}
+			handlers.push_back(std::move(h));
+		}
+
+		/* payload-sized streams rank above any constant volume */
+		auto rank = [&](int stream) {
+			vector<const HandlerFetch*> order;
+			for (const HandlerFetch& h : handlers)
+				if (h.s.dwords[stream] || !h.s.symbolic[stream].empty() || (stream && h.s.readbacks))
+					order.push_back(&h);
+			sort(order.begin(), order.end(), [&](const HandlerFetch* a, const HandlerFetch* b) {
+				bool sa = !a->s.symbolic[stream].empty(), sb = !b->s.symbolic[stream].empty();
+				if (sa != sb)
+					return sa;
+				if (a->s.dwords[stream] != b->s.dwords[stream])
+					return a->s.dwords[stream] > b->s.dwords[stream];
+				return a->s.readbacks > b->s.readbacks;
+			});
+			if (order.size() > s_ranked)
+				order.resize(s_ranked);
+			return order;
+		};
+
+		string report = "# AFUC fetch volume\n\n"
+			"Volumes are the largest over all paths through a handler. A loop is followed back "
+			"once per path, so its body counts for at most two iterations; volumes of longer loops "
+			"are lower bounds unless the loop uses `(rep)`, which is sized by `$rem`. *(partial)* "
+			"marks handlers whose walk was cut short.\n\n## $memdata fetch\n\n"
+			"| Packet | Handler | Dwords | Fetch sites |\n|---|---|---|---|\n";
+		for (const HandlerFetch* h : rank(AFUC_STREAM_MEM)) {
+			string sites;
+			for (const AfucStreamAccess& a : h->s.accesses)
+				if (a.stream == AFUC_STREAM_MEM) {
+					snprintf(buf, sizeof(buf), "%s0x%" PRIx64, sites.empty() ? "" : " ", a.addr);
+					sites += buf;
+				}
+			snprintf(buf, sizeof(buf), " | 0x%" PRIx64 "%s | ", h->addr, h->s.complete ? "" : " (partial)");
+			report += "| " + h->packet + buf + volume_text(h->s, AFUC_STREAM_MEM) + " | " + sites + " |\n";
+		}
+
+		report += "\n## Register readback\n\n"
+			"| Packet | Handler | Readbacks | Dwords | Read sites |\n|---|---|---|---|---|\n";
+		for (const HandlerFetch* h : rank(AFUC_STREAM_REG)) {
+			string sites;
+			for (const AfucStreamAccess& a : h->s.accesses)
+				if (a.stream == AFUC_STREAM_REG) {
+					snprintf(buf, sizeof(buf), "%s0x%" PRIx64, sites.empty() ? "" : " ", a.addr);
+					sites += buf;
+				}
+			snprintf(buf, sizeof(buf), " | 0x%" PRIx64 "%s | %u | ", h->addr,
+				h->s.complete ? "" : " (partial)", h->s.readbacks);
+			report += "| " + h->packet + buf + volume_text(h->s, AFUC_STREAM_REG) + " | " + sites + " |\n";
+		}
+
+		snprintf(buf, sizeof(buf), "\n%zu handlers use $memdata or $regdata\n", handlers.size());
+		report += buf;
+
+		task->Finish();
+		ShowMarkdownReport("AFUC Fetch Volume", report, report);
+	}, "AFUC fetch volume");
+}
+
+static bool has_packet_table(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	return afuc_view_gpuver(view, gpuver) && view->QueryMetadata("afuc.packet_table");
+}
+
+void afuc_register_fetch_commands()
+{
+	PluginCommand::Register("AFUC\\Fetch Volume",
+		"Rank packet handlers by $memdata fetch and $regdata readback volume",
+		show_fetch_volume, has_packet_table);
+}
@@ -0,0 +1,251 @@
+/*
+ * GPU register footprint of each packet handler.
+ *
+ * Built on the handler effect summaries: every @REG_WRITE / $data write
+ * whose register address folds to a constant is attributed to that
+ * register, the rest are listed as unresolved. Writes the executor saw
+ * re-store the value the register already held on every path are
+ * counted as unchanged; they are candidates for removal. A register
+ * written with the same constant every time is also flagged, since a
+ * run of the same packet rewrites it for nothing.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <map>
+
+#include "binaryninjaapi.h"
+#include "afuc_pm4.h"
+#include "afuc_view.h"
+
+using namespace BinaryNinja;
+using namespace std;
+
+/* ─── Footprint ────────────────────────────────────────────── */
+
+void afuc_reg_footprint(const AfucEffectSummary& s, AfucRegFootprint& out)
+{
+	out = AfucRegFootprint();
+	out.complete = s.complete;
+
+	map<uint32_t, AfucRegWrite> regs;
+	map<uint32_t, uint32_t> value;   /* register -> constant written, ~0u if not one */
+	for (const AfucEffect& e : s.effects) {
+		if (e.kind == AFUC_EFFECT_PIPE_REG) {
+			out.pipe_writes++;
+			continue;
+		}
+		if (e.kind != AFUC_EFFECT_GPU_REG)
+			continue;
+		const AfucExpr& a = s.exprs[e.addr];
+		if (a.kind != AFUC_EXPR_CONST) {
+			out.unresolved.push_back(e.site);
+			continue;
+		}
+
+		auto [it, fresh] = regs.try_emplace(a.value, AfucRegWrite{ a.value, 0, 0, true, false, {} });
+		AfucRegWrite& r = it->second;
+		r.writes++;
+		r.unchanged += e.unchanged;
+		r.repeated |= e.in_loop;
+		r.sites.push_back(e.site);
+
+		const AfucExpr& v = s.exprs[e.value];
+		uint32_t k = v.kind == AFUC_EXPR_CONST ? v.value : ~0u;
+		if (fresh)
+			value[a.value] = k;
+		if (v.kind != AFUC_EXPR_CONST || value[a.value] != k)
+			r.constant = false;
+	}
+	for (auto& [reg, r] : regs)
+		out.regs.push_back(move(r));
+}
+
+/* "0x8800-0x8803, 0x8810" */
+static string ranges_text(const vector<AfucRegWrite>& regs)
+{
+	string text;
+	char buf[32];
+	for (size_t i = 0; i < regs.size();) {
+		size_t j = i;
+		while (j + 1 < regs.size() && regs[j + 1].reg == regs[j].reg + 1)
+			j++;
+		if (j == i)
+			snprintf(buf, sizeof(buf), "0x%04x", regs[i].reg);
+		else
+			snprintf(buf, sizeof(buf), "0x%04x-0x%04x", regs[i].reg, regs[j].reg);
+		text += (text.empty() ? "" : ", ") + string(buf);
+		i = j + 1;
+	}
+	return text;
+}
+
+/* ─── Binary Ninja glue ────────────────────────────────────── */
+
+namespace {
+
+struct HandlerFootprint {
+	uint64_t entry;
+	string packet;
+	AfucRegFootprint fp;
+	uint32_t writes = 0, unchanged = 0, constant = 0;
+	vector<pair<uint64_t, string>> unchanged_text;   /* site, effect */
+};
+
+}
+
+static void show_footprint(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	if (!afuc_view_gpuver(view, gpuver))
+		return;
+
+	Ref<Metadata> md = view->QueryMetadata("afuc.packet_table");
+	if (!md || !md->IsArray()) {
+		LogError("AFUC: no packet table recovered for this firmware");
+		return;
+	}
+	vector<uint64_t> table = md->GetUnsignedIntegerList();
+
+	Ref<BinaryView> ref = view;
+	WorkerEnqueue([=]() {
+		Ref<BackgroundTask> task = new BackgroundTask("Resolving AFUC GPU register writes...", true);
+		uint64_t base;
+		vector<uint32_t> code = afuc_read_code(ref, base);
+
+		std::map<uint64_t, vector<uint32_t>> ops;
+		for (size_t op = 0; op < table.size(); op++)
+			ops[table[op]].push_back((uint32_t)op);
+
+		vector<HandlerFootprint> handlers;
+		char buf[160];
+		for (const auto& [addr, opcodes] : ops) {
+			if (task->IsCancelled()) {
+				task->Finish();
+				return;
+			}
+			if (addr / 4 >= code.size() || opcodes.size() > AFUC_PM4_SHARED_HANDLER_MAX)
+				continue;
+
+			AfucEffectSummary s;
+			afuc_handler_effects(gpuver, code.data(), code.size(), addr, s);
+			HandlerFootprint h;
+			h.entry = addr;
+			afuc_reg_footprint(s, h.fp);
+			if (h.fp.regs.empty() && h.fp.unresolved.empty())
+				continue;
+
+			for (uint32_t op : opcodes) {
+				const char* name = afuc_pm4_packet_name(gpuver, op);
+				snprintf(buf, sizeof(buf), "CP_UNKNOWN_%02x", op);
+				h.packet += (h.packet.empty() ? "" : ", ") + string(name ? name : buf);
+			}
+			for (const AfucRegWrite& r : h.fp.regs) {
+				h.writes += r.writes;
+				h.unchanged += r.unchanged;
+				h.constant += r.constant;
+			}
+			h.writes += (uint32_t)h.fp.unresolved.size();
+			for (const AfucEffect& e : s.effects)
+				if (e.unchanged)
+					h.unchanged_text.push_back({ e.site, afuc_effect_text(gpuver, s, e) });
+			handlers.push_back(move(h));
+		}
+
+		stable_sort(handlers.begin(), handlers.end(), [](const HandlerFootprint& a, const HandlerFootprint& b) {
+			return a.unchanged != b.unchanged ? a.unchanged > b.unchanged : a.writes > b.writes;
+		});
+
+		string report = "# AFUC GPU register footprint\n\n"
+			"Writes through `@REG_WRITE_ADDR`/`@REG_WRITE` and `$addr`/`$data`, resolved where the "
+			"register address is constant. *Unchanged* writes store the value the register already "
+			"holds on every path to them; *constant* registers get the same value on every run of "
+			"the packet.\n\n"
+			"| Packet | Handler | Registers | Writes | Unchanged | Constant | Unresolved |\n"
+			"|---|---|---|---|---|---|---|\n";
+		std::map<uint32_t, pair<uint32_t, uint32_t>> shared;   /* register -> packets, constant */
+		vector<uint64_t> unchanged_sites;
+		uint32_t total_unchanged = 0;
+		for (const HandlerFootprint& h : handlers) {
+			snprintf(buf, sizeof(buf), " | 0x%" PRIx64 "%s | %zu | %u | %u | %u | %zu |\n", h.entry,
+				h.fp.complete ? "" : " (partial)", h.fp.regs.size(), h.writes, h.unchanged,
+				h.constant, h.fp.unresolved.size());
+			report += "| " + h.packet + buf;
+			for (const AfucRegWrite& r : h.fp.regs) {
+				shared[r.reg].first++;
+				shared[r.reg].second += r.constant;
+			}
+			total_unchanged += h.unchanged;
+		}
+
+		report += "\n## Per packet\n\n";
+		for (const HandlerFootprint& h : handlers) {
+			snprintf(buf, sizeof(buf), " (0x%" PRIx64 ")\n\n", h.entry);
+			report += "### " + h.packet + buf;
+			if (!h.fp.regs.empty())
+				report += "Registers: " + ranges_text(h.fp.regs) + "\n\n";
+			if (!h.fp.unresolved.empty()) {
+				report += "Unresolved at:";
+				for (uint64_t site : h.fp.unresolved) {
+					snprintf(buf, sizeof(buf), " 0x%" PRIx64, site);
+					report += buf;
+				}
+				report += "\n\n";
+			}
+			if (!h.unchanged_text.empty()) {
+				report += "```\n";
+				for (const auto& [site, text] : h.unchanged_text) {
+					snprintf(buf, sizeof(buf), "0x%" PRIx64 ": ", site);
+					report += buf + text + "\n";
+					if (ref->GetCommentForAddress(site).empty())
+						ref->SetCommentForAddress(site, "unchanged: " + text);
+					unchanged_sites.push_back(site);
+				}
+				report += "```\n\n";
+			}
+		}
+
+		vector<pair<uint32_t, pair<uint32_t, uint32_t>>> common(shared.begin(), shared.end());
+		stable_sort(common.begin(), common.end(), [](const auto& a, const auto& b) {
+			return a.second.first > b.second.first;
+		});
+		report += "## Registers written by most packets\n\n| Register | Packets | With a constant |\n|---|---|---|\n";
+		for (size_t i = 0; i < common.size() && i < 20; i++) {
+			snprintf(buf, sizeof(buf), "| 0x%04x | %u | %u |\n", common[i].first,
+				common[i].second.first, common[i].second.second);
+			report += buf;
+		}
+
+		snprintf(buf, sizeof(buf), "\n%zu handlers write %zu distinct GPU registers; %u writes are unchanged\n",
+			handlers.size(), shared.size(), total_unchanged);
+		report += buf;
+
+		/* sites worth patching out, for comparing builds */
+		sort(unchanged_sites.begin(), unchanged_sites.end());
+		std::map<string, Ref<Metadata>> kv;
+		kv["unchanged"] = new Metadata(unchanged_sites);
+		kv["registers"] = new Metadata((uint64_t)shared.size());
+		ref->StoreMetadata("afuc.reg_footprint", new Metadata(kv), true);
+
+		task->Finish();
+		ShowMarkdownReport("AFUC GPU Register Footprint", report, report);
+	}, "AFUC GPU register footprint");
+}
+
+static bool has_packet_table(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	return afuc_view_gpuver(view, gpuver) && view->QueryMetadata("afuc.packet_table");
+}
+
+void afuc_register_footprint_commands()
+{
+	PluginCommand::Register("AFUC\\GPU Register Footprint",
+		"List the GPU registers each packet handler writes and the writes that leave them unchanged",
+		show_footprint, has_packet_table);
+}
@@ -0,0 +1,472 @@
+/*
+ * Static branch probabilities and block frequencies.
+ *
+ * A flat sum of instruction costs weighs an error path behind a
+ * "breq $x, b31" as heavily as the common case and a polling loop as a
+ * single pass. Each conditional branch instead gets a taken probability
+ * from the first heuristic that applies (a user override, a poll or loop
+ * exit, an error-bit test, a side that never finishes, an equality
+ * test), and block frequencies follow from propagating the entry's
+ * single execution along the weighted edges.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <set>
+
+#include "binaryninjaapi.h"
+#include "afuc_pm4.h"
+#include "afuc_view.h"
+
+using namespace BinaryNinja;
+using namespace std;
+
+static const size_t s_max_blocks = 4096;
+static const uint32_t s_max_rounds = 10000;
+static const uint32_t s_max_call_depth = 4;
+static const double s_max_freq = 1000.0;
+
+/* Taken probabilities of the heuristics */
+static const double s_poll_stay = 0.95;     /* ~20 reads until the counter settles */
+static const double s_loop_stay = 0.88;     /* ~8 iterations */
+static const double s_error_bit = 0.05;
+static const double s_no_exit = 0.1;
+static const double s_compare_eq = 0.4;
+
+static const uint64_t s_none = ~0ull;
+
+const char* afuc_branch_hint_name(AfucBranchHint hint)
+{
+	switch (hint) {
+	case AFUC_HINT_USER:      return "user";
+	case AFUC_HINT_POLL:      return "poll";
+	case AFUC_HINT_LOOP:      return "loop";
+	case AFUC_HINT_ERROR_BIT: return "error bit";
+	case AFUC_HINT_NO_EXIT:   return "no exit";
+	case AFUC_HINT_COMPARE:   return "compare";
+	default:                  return "none";
+	}
+}
+
+/* ─── Blocks ───────────────────────────────────────────────── */
+
+namespace {
+
+struct Edges {
+	uint64_t succ[2] = { s_none, s_none };   /* block starts */
+	double prob[2] = { 0, 0 };
+	bool exits = false;                        /* waitin, ret, indirect or leaves the image */
+	AfucInsn insn;                             /* the conditional branch, if any */
+};
+
+struct LoopRange {
+	uint64_t head, tail;                       /* [head, tail) */
+};
+
+}
+
+void afuc_block_frequencies(AfucGpuVer gpuver, const uint32_t* code, size_t count,
+                            uint64_t entry, const map<uint64_t, uint32_t>& overrides,
+                            vector<AfucFreqBlock>& out)
+{
+	out.clear();
+	auto decode = [&](uint64_t a, AfucInsn& insn) {
+		return a % 4 == 0 && a / 4 < count &&
+			afuc_decode((const uint8_t*)&code[a / 4], 4, a, insn, gpuver);
+	};
+
+	/* Leaders: the entry, branch targets and the word after a transfer's
+	 * delay slot. Calls don't end blocks. */
+	set<uint64_t> leaders, scanned;
+	vector<uint64_t> work = { entry };
+	while (!work.empty() && leaders.size() < s_max_blocks) {
+		uint64_t pc = work.back();
+		work.pop_back();
+		if (pc % 4 || pc / 4 >= count || !leaders.insert(pc).second)
+			continue;
+		for (; scanned.insert(pc).second; pc += 4) {
+			AfucInsn insn;
+			if (!decode(pc, insn))
+				break;
+			AfucFlow f = afuc_insn_flow(insn, pc);
+			if (f.kind == AFUC_FLOW_NEXT || f.kind == AFUC_FLOW_CALL)
+				continue;
+			uint64_t next = pc + (f.delay_slot ? 8 : 4);
+			if (f.kind == AFUC_FLOW_COND) {
+				work.push_back(f.target);
+				work.push_back(next);
+			} else if (f.kind == AFUC_FLOW_JUMP) {
+				work.push_back(f.target);
+			}
+			break;
+		}
+	}
+	if (!leaders.count(entry))
+		return;
+
+	/* Blocks run to a transfer (and its delay slot) or the next leader */
+	vector<Edges> edges;
+	map<uint64_t, size_t> index;
+	for (uint64_t start : leaders) {
+		AfucFreqBlock b = { start, start, 0, 0.0, s_none, 0.0, AFUC_HINT_NONE, {} };
+		Edges e;
+		for (uint64_t pc = start;;) {
+			AfucInsn insn;
+			if (!decode(pc, insn)) {
+				b.end = pc;
+				break;
+			}
+			b.cost += afuc_insn_cost(insn);
+			AfucFlow f = afuc_insn_flow(insn, pc);
+			if (f.kind == AFUC_FLOW_NEXT || f.kind == AFUC_FLOW_CALL) {
+				if (f.kind == AFUC_FLOW_CALL)
+					b.calls.push_back(f.target);
+				pc += 4;
+				if (leaders.count(pc)) {
+					b.end = pc;
+					e.succ[0] = pc;
+					e.prob[0] = 1.0;
+					break;
+				}
+				continue;
+			}
+
+			AfucInsn slot;
+			if (f.delay_slot && decode(pc + 4, slot))
+				b.cost += afuc_insn_cost(slot);
+			b.end = pc + (f.delay_slot ? 8 : 4);
+			if (f.kind == AFUC_FLOW_COND) {
+				b.branch = pc;
+				e.insn = insn;
+				e.succ[0] = f.target;
+				e.succ[1] = b.end;
+			} else if (f.kind == AFUC_FLOW_JUMP) {
+				e.succ[0] = f.target;
+				e.prob[0] = 1.0;
+			} else {
+				e.exits = true;
+			}
+			break;
+		}
+		/* targets outside the image leave the handler */
+		for (uint64_t& s : e.succ) {
+			if (s != s_none && !leaders.count(s)) {
+				s = s_none;
+				e.exits = true;
+			}
+		}
+		index[start] = out.size();
+		out.push_back(b);
+		edges.push_back(e);
+	}
+	size_t n = out.size();
+
+	/* Blocks that can finish the handler or return */
+	vector<bool> finishes(n);
+	for (bool changed = true; changed;) {
+		changed = false;
+		for (size_t i = n; i-- > 0;) {
+			bool f = edges[i].exits;
+			for (uint64_t s : edges[i].succ)
+				f = f || (s != s_none && finishes[index[s]]);
+			if (f && !finishes[i]) {
+				finishes[i] = true;
+				changed = true;
+			}
+		}
+	}
+
+	/* Loops from the back edges of branches and jumps */
+	vector<LoopRange> loops;
+	for (size_t i = 0; i < n; i++) {
+		uint64_t from = out[i].end - 4;
+		for (uint64_t s : edges[i].succ)
+			if (s != s_none && s <= from)
+				loops.push_back({ s, out[i].end });
+	}
+
+	auto polls = [&](const LoopRange& l, const AfucInsn& br) {
+		if (br.src1_enc == REG_MEMDATA || br.src1_enc == REG_REGDATA)
+			return true;
+		for (uint64_t a = l.head; a < l.tail; a += 4) {
+			AfucInsn insn;
+			if (!decode(a, insn) || insn.dst_enc != br.src1_enc ||
+			    !(afuc_insn_dst_regs(insn) & (1u << br.src1_enc)))
+				continue;
+			bool fetched = afuc_insn_src_regs(insn) & ((1u << REG_MEMDATA) | (1u << REG_REGDATA));
+			if (insn.op == AFUC_CREAD || insn.op == AFUC_SREAD || insn.op == AFUC_LOAD || fetched)
+				return true;
+		}
+		return false;
+	};
+
+	/* Taken probability of each conditional branch */
+	for (size_t i = 0; i < n; i++) {
+		AfucFreqBlock& b = out[i];
+		Edges& e = edges[i];
+		if (b.branch == s_none)
+			continue;
+		uint64_t target = e.succ[0], next = e.succ[1];
+		double p = 0.5;
+		const LoopRange* inner = nullptr;
+		for (const LoopRange& l : loops)
+			if (l.head <= b.branch && b.branch < l.tail &&
+			    (!inner || l.tail - l.head < inner->tail - inner->head))
+				inner = &l;
+		auto in_loop = [&](uint64_t s) { return s != s_none && s >= inner->head && s < inner->tail; };
+		auto fin = [&](uint64_t s) { return s == s_none || finishes[index[s]]; };
+		auto ov = overrides.find(b.branch);
+
+		if (ov != overrides.end()) {
+			p = min(ov->second, 100u) / 100.0;
+			b.hint = AFUC_HINT_USER;
+		} else if (inner && in_loop(target) != in_loop(next)) {
+			bool poll = polls(*inner, e.insn);
+			double stay = poll ? s_poll_stay : s_loop_stay;
+			p = in_loop(target) ? stay : 1.0 - stay;
+			b.hint = poll ? AFUC_HINT_POLL : AFUC_HINT_LOOP;
+		} else if ((e.insn.op == AFUC_BREQ_BIT || e.insn.op == AFUC_BRNE_BIT) && e.insn.bit == 31) {
+			/* breq on a bit branches when it is set */
+			p = e.insn.op == AFUC_BREQ_BIT ? s_error_bit : 1.0 - s_error_bit;
+			b.hint = AFUC_HINT_ERROR_BIT;
+		} else if (fin(target) != fin(next)) {
+			p = fin(target) ? 1.0 - s_no_exit : s_no_exit;
+			b.hint = AFUC_HINT_NO_EXIT;
+		} else if (e.insn.op == AFUC_BREQ_IMM || e.insn.op == AFUC_BRNE_IMM) {
+			p = e.insn.op == AFUC_BREQ_IMM ? s_compare_eq : 1.0 - s_compare_eq;
+			b.hint = AFUC_HINT_COMPARE;
+		}
+		b.taken = p;
+		e.prob[0] = p;
+		e.prob[1] = 1.0 - p;
+	}
+
+	/* Entry executes once; everything else is what flows in. Solved by
+	 * Gauss-Seidel rounds in address order. A hang (a loop that never
+	 * finishes, like an error trap) is entered once rather than spun. */
+	vector<vector<pair<size_t, double>>> preds(n);
+	for (size_t i = 0; i < n; i++) {
+		for (int k = 0; k < 2; k++) {
+			uint64_t s = edges[i].succ[k];
+			if (s != s_none && (finishes[i] || s > out[i].end - 4))
+				preds[index[s]].push_back({ i, edges[i].prob[k] });
+		}
+	}
+
+	size_t entry_block = index[entry];
+	for (uint32_t round = 0; round < s_max_rounds; round++) {
+		double delta = 0;
+		for (size_t i = 0; i < n; i++) {
+			double f = i == entry_block ? 1.0 : 0.0;
+			for (const auto& [p, q] : preds[i])
+				f += out[p].freq * q;
+			f = min(f, s_max_freq);
+			delta = max(delta, fabs(f - out[i].freq) / max(f, 1.0));
+			out[i].freq = f;
+		}
+		if (delta < 1e-9)
+			break;
+	}
+}
+
+static double expected_cost(AfucGpuVer gpuver, const uint32_t* code, size_t count,
+                            uint64_t entry, const map<uint64_t, uint32_t>& overrides,
+                            map<uint64_t, double>& memo, uint32_t depth)
+{
+	auto it = memo.find(entry);
+	if (it != memo.end())
+		return it->second;
+	/* recursion adds nothing */
+	memo[entry] = 0;
+
+	vector<AfucFreqBlock> blocks;
+	afuc_block_frequencies(gpuver, code, count, entry, overrides, blocks);
+	double cost = 0;
+	for (const AfucFreqBlock& b : blocks) {
+		double c = b.cost;
+		if (depth < s_max_call_depth)
+			for (uint64_t callee : b.calls)
+				c += expected_cost(gpuver, code, count, callee, overrides, memo, depth + 1);
+		cost += b.freq * c;
+	}
+	memo[entry] = cost;
+	return cost;
+}
+
+double afuc_expected_cost(AfucGpuVer gpuver, const uint32_t* code, size_t count,
+                          uint64_t entry, const map<uint64_t, uint32_t>& overrides)
+{
+	map<uint64_t, double> memo;
+	return expected_cost(gpuver, code, count, entry, overrides, memo, 0);
+}
+
+/* ─── Binary Ninja glue ────────────────────────────────────── */
+
+map<uint64_t, uint32_t> afuc_branch_overrides(BinaryView* view)
+{
+	map<uint64_t, uint32_t> overrides;
+	Ref<Metadata> md = view->QueryMetadata(AFUC_BRANCH_PROB_KEY);
+	if (!md || !md->IsKeyValueStore())
+		return overrides;
+	auto kv = md->GetKeyValueStore();
+	if (!kv.count("addrs") || !kv.count("percent"))
+		return overrides;
+	vector<uint64_t> addrs = kv["addrs"]->GetUnsignedIntegerList();
+	vector<uint64_t> percent = kv["percent"]->GetUnsignedIntegerList();
+	for (size_t i = 0; i < addrs.size() && i < percent.size(); i++)
+		overrides[addrs[i]] = (uint32_t)percent[i];
+	return overrides;
+}
+
+static bool is_cond_branch(BinaryView* view, uint64_t addr)
+{
+	AfucGpuVer gpuver;
+	if (!afuc_view_gpuver(view, gpuver))
+		return false;
+	DataBuffer buf = view->ReadBuffer(addr, 4);
+	AfucInsn insn;
+	return buf.GetLength() == 4 &&
+		afuc_decode((const uint8_t*)buf.GetData(), 4, addr, insn, gpuver) &&
+		afuc_insn_flow(insn, addr).kind == AFUC_FLOW_COND;
+}
+
+static void set_branch_probability(BinaryView* view, uint64_t addr)
+{
+	map<uint64_t, uint32_t> overrides = afuc_branch_overrides(view);
+	int64_t percent = overrides.count(addr) ? overrides[addr] : -1;
+	if (!GetIntegerInput(percent, "Taken probability in percent (-1 to use the heuristics)",
+	                     "Set Branch Probability"))
+		return;
+	if (percent < 0)
+		overrides.erase(addr);
+	else
+		overrides[addr] = (uint32_t)min<int64_t>(percent, 100);
+
+	vector<uint64_t> addrs, values;
+	for (const auto& [a, p] : overrides) {
+		addrs.push_back(a);
+		values.push_back(p);
+	}
+	map<string, Ref<Metadata>> kv;
+	kv["addrs"] = new Metadata(addrs);
+	kv["percent"] = new Metadata(values);
+	/* user data, not auto: it has to survive saving the database */
+	view->StoreMetadata(AFUC_BRANCH_PROB_KEY, new Metadata(kv), false);
+
+	for (const Ref<Function>& f : view->GetAnalysisFunctionsContainingAddress(addr))
+		f->Reanalyze();
+	afuc_invalidate_handler_metrics(view, { addr }, false);
+}
+
+/* ─── Render layer ─────────────────────────────────────────── */
+
+class AfucBlockFreqLayer : public RenderLayer
+{
+	struct Info {
+		double freq;
+		uint64_t branch;
+		uint32_t taken;
+		AfucBranchHint hint;
+	};
+
+	/* The stored block covering 'addr' */
+	static bool lookup(Function* func, uint64_t addr, Info& info)
+	{
+		Ref<Metadata> md = func->QueryMetadata(AFUC_BLOCK_FREQ_KEY);
+		if (!md || !md->IsKeyValueStore())
+			return false;
+		auto kv = md->GetKeyValueStore();
+		vector<uint64_t> starts = kv["starts"]->GetUnsignedIntegerList();
+		auto it = upper_bound(starts.begin(), starts.end(), addr);
+		if (it == starts.begin())
+			return false;
+		size_t i = it - starts.begin() - 1;
+		info.freq = kv["freq"]->GetUnsignedIntegerList()[i] / 1000.0;
+		info.branch = kv["branches"]->GetUnsignedIntegerList()[i];
+		info.taken = (uint32_t)kv["taken"]->GetUnsignedIntegerList()[i];
+		info.hint = (AfucBranchHint)kv["hints"]->GetUnsignedIntegerList()[i];
+		return true;
+	}
+
+	static void annotate(BasicBlock* block, vector<DisassemblyTextLine*>& lines)
+	{
+		AfucGpuVer gpuver;
+		Ref<Function> func = block ? block->GetFunction() : nullptr;
+		Info info;
+		if (!func || !afuc_arch_gpuver(block->GetArchitecture(), gpuver) ||
+		    !lookup(func, block->GetStart(), info))
+			return;
+
+		/* likely path orange, loop bodies red */
+		BNHighlightColor color = {};
+		color.style = StandardHighlightColor;
+		color.color = info.freq >= 2.0 ? RedHighlightColor :
+			info.freq >= 0.5 ? OrangeHighlightColor : NoHighlightColor;
+		color.alpha = 255;
+
+		bool first = true;
+		char buf[64];
+		for (DisassemblyTextLine* line : lines) {
+			if (line->addr < block->GetStart() || line->addr >= block->GetEnd())
+				continue;
+			bool insn = any_of(line->tokens.begin(), line->tokens.end(),
+				[](const InstructionTextToken& t) { return t.type == InstructionToken; });
+			if (!insn)
+				continue;
+			if (color.color != NoHighlightColor)
+				line->highlight = color;
+			if (first) {
+				snprintf(buf, sizeof(buf), "  ; freq %.3g", info.freq);
+				line->tokens.emplace_back(AnnotationToken, buf);
+				first = false;
+			}
+			if (line->addr == info.branch) {
+				snprintf(buf, sizeof(buf), "  ; taken %u%% (%s)", info.taken,
+					afuc_branch_hint_name(info.hint));
+				line->tokens.emplace_back(AnnotationToken, buf);
+			}
+		}
+	}
+
+public:
+	AfucBlockFreqLayer() : RenderLayer("AFUC Block Frequency") {}
+
+	void ApplyToDisassemblyBlock(Ref<BasicBlock> block, vector<DisassemblyTextLine>& lines) override
+	{
+		vector<DisassemblyTextLine*> ptrs;
+		for (DisassemblyTextLine& l : lines)
+			ptrs.push_back(&l);
+		annotate(block, ptrs);
+	}
+
+	void ApplyToLinearViewObject(Ref<LinearViewObject>, Ref<LinearViewObject>, Ref<LinearViewObject>,
+	                             vector<LinearDisassemblyLine>& lines) override
+	{
+		for (size_t i = 0; i < lines.size();) {
+			size_t j = i;
+			vector<DisassemblyTextLine*> ptrs;
+			for (; j < lines.size() && lines[j].block.GetPtr() == lines[i].block.GetPtr(); j++)
+				ptrs.push_back(&lines[j].contents);
+			if (lines[i].block)
+				annotate(lines[i].block, ptrs);
+			i = j;
+		}
+	}
+};
+
+void afuc_register_freq_commands()
+{
+	PluginCommand::RegisterForAddress("AFUC\\Set Branch Probability...",
+		"Override the estimated taken probability of the conditional branch here",
+		set_branch_probability, is_cond_branch);
+
+	/* off by default, like the liveness layer */
+	RenderLayer::Register(new AfucBlockFreqLayer());
+}
@@ -0,0 +1,478 @@
+/*
+ * IB-level aware handler paths.
+ *
+ * Packets run from the ring buffer, from IB1 or from IB2 (IB3 on a7xx),
+ * and the firmware tells them apart by reading @IB_LEVEL: CP_INDIRECT_BUFFER
+ * picks which IBn_BASE / IBn_DWORDS pair to load, other handlers refuse
+ * to run nested or take a cheaper path. Each handler is walked once per
+ * level with @IB_LEVEL fixed, following the values derived from it, so
+ * branches on the level only go the way they can at that level.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <tuple>
+
+#include "binaryninjaapi.h"
+#include "afuc_pm4.h"
+#include "afuc_view.h"
+
+using namespace BinaryNinja;
+using namespace std;
+
+/* ─── Level walk ───────────────────────────────────────────── */
+
+static const size_t s_max_states = 20000;
+static const size_t s_max_call_depth = 4;
+static const uint32_t s_unknown = ~0u;
+
+static const char* const s_level_names[AFUC_IB_LEVELS] = { "RB", "IB1", "IB2", "IB3" };
+
+const char* afuc_ib_level_name(uint32_t level)
+{
+	return level < AFUC_IB_LEVELS ? s_level_names[level] : "?";
+}
+
+namespace {
+
+/* Control registers the walk looks at, ~0u where absent */
+struct IbRegs {
+	uint32_t level;
+	set<uint32_t> ib;         /* IBn_BASE / IBn_DWORDS */
+	uint32_t levels;
+
+	explicit IbRegs(AfucGpuVer gpuver)
+	{
+		if (!afuc_ctrl_reg_offset(gpuver, "IB_LEVEL", level))
+			level = ~0u;
+		static const char* const names[] = {
+			"IB1_BASE", "IB1_DWORDS", "IB2_BASE", "IB2_DWORDS", "IB3_BASE", "IB3_DWORDS",
+		};
+		for (const char* name : names) {
+			uint32_t off;
+			if (afuc_ctrl_reg_offset(gpuver, name, off))
+				ib.insert(off);
+		}
+		uint32_t ib3;
+		levels = level == ~0u ? 0 : afuc_ctrl_reg_offset(gpuver, "IB3_BASE", ib3) ? 4 : 3;
+	}
+};
+
+/* GPRs holding a value computed from the level, by encoding. Nothing
+ * else is tracked, not even constants, so a counting loop can't
+ * multiply states and only branches on the level get decided. */
+typedef map<uint32_t, uint32_t> Known;
+
+struct LevelState {
+	uint64_t pc;
+	vector<uint64_t> stack;
+	uint32_t level;           /* what @IB_LEVEL reads, s_unknown once overwritten */
+	Known known;
+};
+
+}
+
+/* The ALU ops worth folding on a level value */
+static uint32_t fold(AfucOp op, uint32_t a, uint32_t b)
+{
+	switch (op) {
+	case AFUC_ADD:  return a + b;
+	case AFUC_SUB:  return a - b;
+	case AFUC_AND:  return a & b;
+	case AFUC_OR:   return a | b;
+	case AFUC_XOR:  return a ^ b;
+	case AFUC_BIC:  return a & ~b;
+	case AFUC_NOT:  return ~b;
+	case AFUC_SHL:  return b >= 32 ? 0 : a << b;
+	case AFUC_USHR: return b >= 32 ? 0 : a >> b;
+	case AFUC_MIN:  return min(a, b);
+	case AFUC_MAX:  return max(a, b);
+	case AFUC_CMP:  return a > b ? 0x00 : a == b ? 0x2b : 0x1e;
+	default:        return s_unknown;
+	}
+}
+
+/* Source 'enc' as an operand: $00 is a plain 0, a GPR is only known if
+ * it holds a level-derived value, which sets 'derived' */
+static uint32_t value_of(const Known& known, uint32_t enc, bool& derived)
+{
+	if (enc == 0)
+		return 0;
+	auto it = known.find(enc);
+	if (it == known.end())
+		return s_unknown;
+	derived = true;
+	return it->second;
+}
+
+/* Apply one instruction to the known values */
+static void step(const AfucInsn& insn, const IbRegs& regs, LevelState& st, uint64_t addr,
+                 set<uint64_t>& reads, set<pair<uint64_t, uint32_t>>& writes)
+{
+	uint32_t v = s_unknown, a, b;
+	bool derived = false;   /* some input came from the level */
+	switch (afuc_op_form(insn.op)) {
+	case AFUC_FORM_ALU:
+		a = value_of(st.known, insn.src1_enc, derived);
+		b = insn.is_immed ? insn.immed : value_of(st.known, insn.src2_enc, derived);
+		if (a != s_unknown && b != s_unknown)
+			v = fold(insn.op, a, b);
+		break;
+	case AFUC_FORM_ALU1:
+		b = insn.is_immed ? insn.immed : value_of(st.known, insn.src2_enc, derived);
+		if (b != s_unknown)
+			v = fold(insn.op, 0, b);
+		break;
+	case AFUC_FORM_MOV:
+		v = value_of(st.known, insn.src2_enc, derived);
+		break;
+	case AFUC_FORM_BIT:
+		a = value_of(st.known, insn.src1_enc, derived);
+		if (a != s_unknown)
+			v = insn.op == AFUC_SETBIT ? a | (1u << insn.bit) : a & ~(1u << insn.bit);
+		break;
+	case AFUC_FORM_BITFIELD:
+		a = value_of(st.known, insn.src1_enc, derived);
+		if (a != s_unknown && insn.op == AFUC_UBFX) {
+			uint32_t width = insn.hi - insn.lo + 1;
+			v = (a >> insn.lo) & (width >= 32 ? ~0u : (1u << width) - 1);
+		}
+		break;
+	case AFUC_FORM_CREAD:
+		if (insn.op == AFUC_CREAD && insn.src1_enc == 0 && insn.base == regs.level) {
+			reads.insert(addr);
+			v = st.level;
+			derived = true;
+		}
+		break;
+	case AFUC_FORM_CWRITE:
+		if (insn.op != AFUC_CWRITE || insn.src2_enc != 0)
+			break;
+		if (insn.base == regs.level) {
+			writes.insert({ addr, insn.base });
+			st.level = value_of(st.known, insn.src1_enc, derived);
+		} else if (regs.ib.count(insn.base)) {
+			writes.insert({ addr, insn.base });
+		}
+		break;
+	default:
+		break;
+	}
+
+	uint32_t dst = afuc_insn_dst_regs(insn);
+	for (uint32_t r = 1; r < 0x1d; r++) {
+		if (!(dst & (1u << r)))
+			continue;
+		if (r == insn.dst_enc && v != s_unknown && derived && !insn.rep && !insn.xmov)
+			st.known[r] = v;
+		else
+			st.known.erase(r);
+	}
+}
+
+void afuc_ib_level_paths(AfucGpuVer gpuver, const uint32_t* code, size_t count,
+                         uint64_t entry, AfucIbLevelSummary& out)
+{
+	out = AfucIbLevelSummary();
+	IbRegs regs(gpuver);
+	out.levels = regs.levels;
+
+	auto decode = [&](uint64_t addr, AfucInsn& insn) {
+		if (addr / 4 >= count)
+			return false;
+		return afuc_decode((const uint8_t*)&code[addr / 4], 4, addr, insn, gpuver);
+	};
+
+	set<uint64_t> reads;
+	map<uint64_t, AfucIbBranch> branches;
+	for (uint32_t level = 0; level < out.levels; level++) {
+		AfucIbLevelPath& path = out.path[level];
+		set<uint64_t> insns;
+		set<pair<uint64_t, uint32_t>> writes;
+		set<tuple<uint64_t, vector<uint64_t>, uint32_t, Known>> visited;
+
+		vector<LevelState> work;
+		work.push_back({ entry, {}, level, {} });
+		while (!work.empty()) {
+			if (visited.size() >= s_max_states) {
+				out.complete = false;
+				break;
+			}
+			LevelState st = std::move(work.back());
+			work.pop_back();
+
+			for (;;) {
+				if (!visited.insert({ st.pc, st.stack, st.level, st.known }).second)
+					break;
+				AfucInsn insn;
+				if (!decode(st.pc, insn) || insn.op == AFUC_INVALID) {
+					out.complete = false;
+					break;
+				}
+				insns.insert(st.pc);
+
+				AfucFlow f = afuc_insn_flow(insn, st.pc);
+				if (f.kind == AFUC_FLOW_NEXT) {
+					step(insn, regs, st, st.pc, reads, writes);
+					st.pc += 4;
+					continue;
+				}
+
+				/* the condition is read before the delay slot runs */
+				bool take = true, fall = f.kind == AFUC_FLOW_COND;
+				if (f.kind == AFUC_FLOW_COND) {
+					bool derived = false;
+					uint32_t v = value_of(st.known, insn.src1_enc, derived);
+					if (derived) {
+						switch (insn.op) {
+						case AFUC_BRNE_IMM: take = v != insn.immed; break;
+						case AFUC_BREQ_IMM: take = v == insn.immed; break;
+						case AFUC_BRNE_BIT: take = !(v >> insn.bit & 1); break;
+						case AFUC_BREQ_BIT: take = v >> insn.bit & 1; break;
+						default: break;
+						}
+						fall = !take;
+						AfucIbBranch& br = branches.try_emplace(st.pc, AfucIbBranch{ st.pc, 0, 0 }).first->second;
+						(take ? br.taken : br.not_taken) |= 1u << level;
+					}
+				}
+				step(insn, regs, st, st.pc, reads, writes);
+
+				uint64_t next = st.pc + (f.delay_slot ? 8 : 4);
+				if (f.delay_slot) {
+					AfucInsn slot;
+					if (!decode(st.pc + 4, slot))
+						break;
+					insns.insert(st.pc + 4);
+					step(slot, regs, st, st.pc + 4, reads, writes);
+				}
+
+				if (f.kind == AFUC_FLOW_WAITIN) {
+					path.finishes = true;
+					break;
+				}
+				if (f.kind == AFUC_FLOW_COND) {
+					if (take && fall) {
+						work.push_back(st);
+						work.back().pc = f.target;
+						st.pc = next;
+					} else {
+						st.pc = take ? f.target : next;
+					}
+				} else if (f.kind == AFUC_FLOW_JUMP) {
+					st.pc = f.target;
+				} else if (f.kind == AFUC_FLOW_CALL && st.stack.size() < s_max_call_depth) {
+					st.stack.push_back(next);
+					st.pc = f.target;
+				} else if (f.kind == AFUC_FLOW_RET && !st.stack.empty()) {
+					st.pc = st.stack.back();
+					st.stack.pop_back();
+				} else {
+					if (f.kind == AFUC_FLOW_INDIRECT || f.kind == AFUC_FLOW_CALL)
+						out.complete = false;
+					break;
+				}
+			}
+		}
+
+		path.insns.assign(insns.begin(), insns.end());
+		for (uint64_t addr : path.insns) {
+			AfucInsn insn;
+			if (decode(addr, insn))
+				path.cost += afuc_insn_cost(insn);
+		}
+		path.ib_writes.assign(writes.begin(), writes.end());
+	}
+
+	out.level_reads.assign(reads.begin(), reads.end());
+
+	/* keep the branches that go another way at some level than at
+	 * another; levels that never reach one don't count */
+	for (const auto& [addr, br] : branches) {
+		int first = -1;
+		bool differs = false;
+		for (uint32_t level = 0; level < out.levels; level++) {
+			int dirs = (br.taken >> level & 1) | (br.not_taken >> level & 1) << 1;
+			if (!dirs)
+				continue;
+			differs |= first >= 0 && dirs != first;
+			if (first < 0)
+				first = dirs;
+		}
+		if (differs)
+			out.branches.push_back(br);
+	}
+}
+
+bool afuc_ib_level_differs(const AfucIbLevelSummary& s)
+{
+	for (uint32_t level = 1; level < s.levels; level++)
+		if (s.path[level].insns != s.path[0].insns || s.path[level].finishes != s.path[0].finishes)
+			return true;
+	return false;
+}
+
+/* ─── Binary Ninja glue ────────────────────────────────────── */
+
+static string levels_text(uint8_t mask, uint32_t levels)
+{
+	string text;
+	for (uint32_t level = 0; level < levels; level++)
+		if (mask & (1u << level))
+			text += (text.empty() ? "" : ", ") + string(afuc_ib_level_name(level));
+	return text.empty() ? "never" : text;
+}
+
+static void show_ib_levels(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	if (!afuc_view_gpuver(view, gpuver))
+		return;
+
+	Ref<Metadata> md = view->QueryMetadata("afuc.packet_table");
+	if (!md || !md->IsArray()) {
+		LogError("AFUC: no packet table recovered for this firmware");
+		return;
+	}
+	vector<uint64_t> table = md->GetUnsignedIntegerList();
+
+	Ref<BinaryView> ref = view;
+	const AfucRegTable* regs = afuc_view_reg_table(view);
+	WorkerEnqueue([=]() {
+		Ref<BackgroundTask> task = new BackgroundTask("Walking AFUC handlers per IB level...", true);
+		uint64_t base;
+		vector<uint32_t> code = afuc_read_code(ref, base);
+
+		std::map<uint64_t, vector<uint32_t>> ops;
+		for (size_t op = 0; op < table.size(); op++)
+			ops[table[op]].push_back((uint32_t)op);
+
+		string report = "# AFUC handlers by IB level\n\n";
+		string details;
+		char buf[160];
+		uint32_t levels = 0;
+		size_t differ = 0, walked = 0;
+		vector<uint64_t> sensitive;
+
+		for (const auto& [addr, opcodes] : ops) {
+			if (task->IsCancelled()) {
+				task->Finish();
+				return;
+			}
+			if (addr / 4 >= code.size() || opcodes.size() > AFUC_PM4_SHARED_HANDLER_MAX)
+				continue;
+
+			AfucIbLevelSummary s;
+			afuc_ib_level_paths(gpuver, code.data(), code.size(), addr, s);
+			if (!s.levels) {
+				task->Finish();
+				ShowMarkdownReport("AFUC IB Levels", "This generation has no `@IB_LEVEL`.\n", "");
+				return;
+			}
+			if (!levels) {
+				levels = s.levels;
+				report += "Instructions reachable / their cost when the packet runs at each level; "
+					"*no waitin* marks a level whose every path traps or spins.\n\n| Packet | Handler |";
+				for (uint32_t l = 0; l < levels; l++)
+					report += string(" ") + afuc_ib_level_name(l) + " |";
+				report += " Writes |\n|---|---|";
+				for (uint32_t l = 0; l <= levels; l++)
+					report += "---|";
+				report += "\n";
+			}
+			walked++;
+			if (!afuc_ib_level_differs(s))
+				continue;
+			differ++;
+			sensitive.push_back(addr);
+
+			string packet;
+			for (uint32_t op : opcodes) {
+				const char* name = afuc_pm4_packet_name(gpuver, op);
+				snprintf(buf, sizeof(buf), "CP_UNKNOWN_%02x", op);
+				packet += (packet.empty() ? "" : ", ") + string(name ? name : buf);
+			}
+			snprintf(buf, sizeof(buf), " | 0x%" PRIx64 "%s |", addr, s.complete ? "" : " (partial)");
+			report += "| " + packet + buf;
+			for (uint32_t l = 0; l < levels; l++) {
+				const AfucIbLevelPath& p = s.path[l];
+				snprintf(buf, sizeof(buf), " %zu / %u%s |", p.insns.size(), p.cost, p.finishes ? "" : ", no waitin");
+				report += buf;
+			}
+
+			/* which IB registers each level programs */
+			std::map<uint32_t, uint8_t> written;
+			for (uint32_t l = 0; l < levels; l++)
+				for (const auto& [site, off] : s.path[l].ib_writes)
+					written[off] |= 1u << l;
+			string writes;
+			for (const auto& [off, mask] : written) {
+				const char* name = afuc_ctrl_reg_name(regs, off);
+				writes += (writes.empty() ? "" : ", ") + string("@") + (name ? name : "?") +
+					" (" + levels_text(mask, levels) + ")";
+			}
+			report += " " + writes + " |\n";
+
+			details += "### " + packet + "\n\n";
+			for (const AfucIbBranch& br : s.branches) {
+				string taken = levels_text(br.taken, levels), not_taken = levels_text(br.not_taken, levels);
+				snprintf(buf, sizeof(buf), "- 0x%" PRIx64 ": taken at ", br.addr);
+				details += buf + taken + ", falls through at " + not_taken + "\n";
+				if (ref->GetCommentForAddress(br.addr).empty())
+					ref->SetCommentForAddress(br.addr, "IB level: taken at " + taken + ", falls through at " + not_taken);
+			}
+			for (uint32_t l = 0; l < levels; l++) {
+				/* instructions this level reaches and some other level doesn't */
+				size_t only = 0;
+				for (uint64_t a : s.path[l].insns)
+					for (uint32_t m = 0; m < levels; m++)
+						if (m != l && !binary_search(s.path[m].insns.begin(), s.path[m].insns.end(), a)) {
+							only++;
+							break;
+						}
+				if (only) {
+					snprintf(buf, sizeof(buf), "- %s reaches %zu instructions some other level doesn't\n",
+						afuc_ib_level_name(l), only);
+					details += buf;
+				}
+			}
+			details += "\n";
+		}
+
+		if (!differ)
+			report += "\nNo handler behaves differently by IB level.\n";
+		else
+			report += "\n## Level-dependent branches\n\n" + details;
+		snprintf(buf, sizeof(buf), "\n%zu of %zu handlers behave differently by IB level\n", differ, walked);
+		report += buf;
+
+		std::map<string, Ref<Metadata>> kv;
+		kv["handlers"] = new Metadata(sensitive);
+		ref->StoreMetadata("afuc.ib_levels", new Metadata(kv), true);
+
+		task->Finish();
+		ShowMarkdownReport("AFUC IB Levels", report, report);
+	}, "AFUC IB levels");
+}
+
+static bool has_ib_level(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	uint32_t off;
+	return afuc_view_gpuver(view, gpuver) && afuc_ctrl_reg_offset(gpuver, "IB_LEVEL", off) &&
+		view->QueryMetadata("afuc.packet_table");
+}
+
+void afuc_register_iblevel_commands()
+{
+	PluginCommand::Register("AFUC\\Handlers by IB Level",
+		"Walk every packet handler at each IB nesting level and report the ones that behave differently",
+		show_ib_levels, has_ib_level);
+}
@@ -8,6 +8,9 @@
  * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
  */
 
+#include <algorithm>
+#include <map>
+
 #include "binaryninjaapi.h"
 #include "lowlevelilinstruction.h"
 #include "afuc.h"
@@ -15,6 +18,15 @@
 using namespace BinaryNinja;
 using namespace std;
 
+/*
+ * LLIL temporaries: (sdsN) cwrite uses 0 (address), 1 (value) and
+ * 2..4 ($data dwords without SDS registers). The setsecure result and
+ * a branch operand saved across its delay slot get their own, since the
+ * slot may itself be an (sdsN) cwrite.
+ */
+static const uint32_t s_temp_setsecure = LLIL_TEMP(5);
+static const uint32_t s_temp_branch_src = LLIL_TEMP(6);
+
 /* Helper: read a source register as an IL expression */
 static ExprId ilReg(LowLevelILFunction& il, AfucReg reg)
 {
@@ -81,20 +93,8 @@ static ExprId ilAluBinOp(LowLevelILFunction& il, AfucOp op,
 bool afuc_get_llil(Architecture* arch, uint64_t addr, LowLevelILFunction& il,
                    const AfucInsn& insn, AfucGpuVer gpuver)
 {
-	switch (insn.op) {
-
-	/* ── NOP ──────────────────────────────────────────── */
-	case AFUC_NOP:
-		il.AddInstruction(il.Nop());
-		break;
-
-	/* ── ALU binary ops ───────────────────────────────── */
-	case AFUC_ADD: case AFUC_ADDHI: case AFUC_SUB: case AFUC_SUBHI:
-	case AFUC_AND: case AFUC_OR: case AFUC_XOR:
-	case AFUC_SHL: case AFUC_USHR: case AFUC_ISHR: case AFUC_ROT:
-	case AFUC_MUL8: case AFUC_MIN: case AFUC_MAX: case AFUC_CMP:
-	case AFUC_BIC:
-	{
+	/* ── ALU binary ops (every ALU-form op but setbit $reg) ── */
+	if (afuc_op_form(insn.op) == AFUC_FORM_ALU && insn.op != AFUC_SETBIT_R) {
 		ExprId src1, src2;
 		if (insn.is_immed) {
 			src1 = ilSrcReg(il, insn.src1_enc);
@@ -113,9 +113,16 @@ bool afuc_get_llil(Architecture* arch, uint64_t addr, LowLevelILFunction& il,
 		} else {
 			il.AddInstruction(ilSetDst(il, insn.dst_enc, result));
 		}
-		break;
+		return true;
 	}
 
+	switch (insn.op) {
+
+	/* ── NOP ──────────────────────────────────────────── */
+	case AFUC_NOP:
+		il.AddInstruction(il.Nop());
+		break;
+
 	/* ── NOT ──────────────────────────────────────────── */
 	case AFUC_NOT:
 	{
@@ -235,7 +242,34 @@ bool afuc_get_llil(Architecture* arch, uint64_t addr, LowLevelILFunction& il,
 		ExprId base = ilSrcReg(il, insn.src2_enc);
 		ExprId addr_expr = il.Add(4, base, il.Const(4, insn.base));
 		ExprId val = ilSrcReg(il, insn.src1_enc);
-		il.AddInstruction(il.Store(4, addr_expr, val));
+		if (!insn.sds) {
+			il.AddInstruction(il.Store(4, addr_expr, val));
+			break;
+		}
+
+		/* (sdsN): the header is written as usual, then N more $data
+		 * dwords load @SDS_BASE lo/hi and @SDS_DWORDS, in that order,
+		 * and the draw state group is loaded from them */
+		il.AddInstruction(il.SetRegister(4, LLIL_TEMP(0), addr_expr));
+		il.AddInstruction(il.SetRegister(4, LLIL_TEMP(1), val));
+		il.AddInstruction(il.Store(4, il.Register(4, LLIL_TEMP(0)), il.Register(4, LLIL_TEMP(1))));
+
+		uint32_t sds[3];
+		bool has_sds = afuc_sds_regs(gpuver, sds);
+		for (uint32_t k = 0; k < insn.sds; k++) {
+			ExprId d = il.Register(4, REG_DATA);
+			il.AddInstruction(has_sds ? il.Store(4, il.Const(4, sds[k]), d)
+				: il.SetRegister(4, LLIL_TEMP(2 + k), d));
+		}
+		if (!has_sds)
+			break;
+
+		ExprId sds_base = il.Or(8,
+			il.ZeroExtend(8, il.Load(4, il.Const(4, sds[0]))),
+			il.ShiftLeft(8, il.ZeroExtend(8, il.Load(4, il.Const(4, sds[1]))), il.Const(1, 32)));
+		il.AddInstruction(il.Intrinsic({}, 5 /* set_draw_state */, {
+			il.Register(4, LLIL_TEMP(0)), il.Register(4, LLIL_TEMP(1)),
+			sds_base, il.Load(4, il.Const(4, sds[2])) }));
 		break;
 	}
 
@@ -374,8 +408,10 @@ bool afuc_get_llil(Architecture* arch, uint64_t addr, LowLevelILFunction& il,
 
 	/* ── SETSECURE ────────────────────────────────────── */
 	case AFUC_SETSECURE:
-		il.AddInstruction(il.Intrinsic({}, 4 /* setsecure */,
-			{il.Register(4, REG_R02)}));
+		/* the result (switch succeeded) only matters to the function
+		 * lifter, which turns it into the three-instruction skip */
+		il.AddInstruction(il.Intrinsic({RegisterOrFlag::Register(s_temp_setsecure)},
+			4 /* setsecure */, {il.Register(4, REG_R02)}));
 		break;
 
 	default:
@@ -385,3 +421,248 @@ bool afuc_get_llil(Architecture* arch, uint64_t addr, LowLevelILFunction& il,
 
 	return true;
 }
+
+/* ─── Whole-function lifting ───────────────────────────────── */
+
+/*
+ * The per-instruction callback above sees one word at a time. Lifting a
+ * function's blocks in one pass from a predecoded array lets us order
+ * delay slots correctly, turn (rep) into a loop, take the setsecure skip,
+ * fold mov/or constant pairs and branch to our own labels.
+ */
+
+namespace {
+
+struct LiftBlock {
+	uint64_t start;
+	uint64_t end;
+	vector<AfucInsn> insns;   /* one word past 'end' for a trailing delay slot */
+};
+
+}
+
+/* Registers 0x1d-0x1f pop a FIFO on read, so their order matters too */
+static const uint32_t s_fifo_srcs = 0xe0000000;
+
+bool afuc_lift_function(Architecture* arch, LowLevelILFunction& il,
+                        FunctionLifterContext& ctx, AfucGpuVer gpuver)
+{
+	Ref<Function> func = il.GetFunction();
+	if (!func)
+		return false;
+	Ref<BinaryView> view = func->GetView();
+	uint64_t entry = func->GetStart();
+
+	/* Predecode everything before emitting, so a failure can still fall
+	 * back to the default lifter */
+	vector<LiftBlock> blocks;
+	for (const Ref<BasicBlock>& bb : ctx.GetBasicBlocks()) {
+		LiftBlock b;
+		b.start = bb->GetStart();
+		b.end = bb->GetEnd();
+		DataBuffer buf = view->ReadBuffer(b.start, b.end - b.start + 4);
+		const uint8_t* data = (const uint8_t*)buf.GetData();
+		size_t len = buf.GetLength() & ~(size_t)3;
+		if (len < b.end - b.start)
+			return false;
+		for (size_t off = 0; off < len; off += 4) {
+			AfucInsn insn;
+			if (!afuc_decode(data + off, 4, b.start + off, insn, gpuver))
+				return false;
+			b.insns.push_back(insn);
+		}
+		blocks.push_back(std::move(b));
+	}
+	if (blocks.empty())
+		return false;
+
+	/* The entry block is lifted first, the rest in address order */
+	sort(blocks.begin(), blocks.end(), [entry](const LiftBlock& a, const LiftBlock& b) {
+		if ((a.start == entry) != (b.start == entry))
+			return a.start == entry;
+		return a.start < b.start;
+	});
+
+	auto lifted = [&](uint64_t addr) {
+		for (const LiftBlock& b : blocks)
+			if (addr >= b.start && addr < b.end)
+				return true;
+		return false;
+	};
+
+	/* Labels for every block start plus setsecure's two continuations,
+	 * which the generic block recovery doesn't split on */
+	map<uint64_t, LowLevelILLabel> labels;
+	for (const LiftBlock& b : blocks) {
+		labels[b.start];
+		for (size_t i = 0; i + 1 < b.insns.size(); i++) {
+			if (b.insns[i].op != AFUC_SETSECURE)
+				continue;
+			uint64_t addr = b.start + i * 4;
+			AfucFlow f = afuc_insn_flow(b.insns[i], addr);
+			if (lifted(f.target) && lifted(addr + 4)) {
+				labels[f.target];
+				labels[addr + 4];
+			}
+		}
+	}
+
+	auto label_at = [&](uint64_t addr) -> LowLevelILLabel* {
+		auto it = labels.find(addr);
+		return it == labels.end() ? nullptr : &it->second;
+	};
+
+	auto jump_to = [&](uint64_t target) {
+		if (LowLevelILLabel* l = label_at(target))
+			il.AddInstruction(il.Goto(*l));
+		else
+			il.AddInstruction(il.Jump(il.ConstPointer(4, target)));
+	};
+
+	auto branch = [&](ExprId cond, uint64_t t, uint64_t f) {
+		LowLevelILLabel* tl = label_at(t);
+		LowLevelILLabel* fl = label_at(f);
+		LowLevelILLabel taken, not_taken;
+		il.AddInstruction(il.If(cond, tl ? *tl : taken, fl ? *fl : not_taken));
+		if (!tl) {
+			il.MarkLabel(taken);
+			il.AddInstruction(il.Jump(il.ConstPointer(4, t)));
+		}
+		if (!fl) {
+			il.MarkLabel(not_taken);
+			il.AddInstruction(il.Jump(il.ConstPointer(4, f)));
+		}
+	};
+
+	/* One non-branch instruction, with (rep) and mov/or folded in */
+	auto lift_op = [&](uint64_t addr, const AfucInsn& insn, const AfucInsn* prev) {
+		il.SetCurrentAddress(arch, addr);
+
+		/* mov $r, hi << 16; or $r, $r, lo -> one 32-bit constant */
+		if (prev && prev->op == AFUC_MOVI && !prev->rep && insn.op == AFUC_OR &&
+		    insn.is_immed && !insn.rep && insn.dst_enc == prev->dst_enc &&
+		    insn.src1_enc == insn.dst_enc && afuc_dst_reg(insn.dst_enc) < REG_REM &&
+		    insn.dst_enc != 0) {
+			uint32_t val = (prev->immed << prev->shift) | insn.immed;
+			il.AddInstruction(ilSetDst(il, insn.dst_enc, il.Const(4, val)));
+			return;
+		}
+
+		if (!insn.rep) {
+			afuc_get_llil(arch, addr, il, insn, gpuver);
+			return;
+		}
+
+		/* (rep) repeats while $rem is non-zero, counting it down */
+		LowLevelILLabel head, body, done;
+		il.MarkLabel(head);
+		il.AddInstruction(il.If(il.CompareEqual(4, il.Register(4, REG_REM), il.Const(4, 0)),
+			done, body));
+		il.MarkLabel(body);
+		afuc_get_llil(arch, addr, il, insn, gpuver);
+		il.AddInstruction(il.SetRegister(4, REG_REM,
+			il.Sub(4, il.Register(4, REG_REM), il.Const(4, 1))));
+		il.AddInstruction(il.Goto(head));
+		il.MarkLabel(done);
+	};
+
+	for (const LiftBlock& b : blocks) {
+		size_t n = (b.end - b.start) / 4;
+		bool terminated = false;
+
+		for (size_t i = 0; i < n && !terminated; i++) {
+			uint64_t addr = b.start + i * 4;
+			const AfucInsn& insn = b.insns[i];
+			const AfucInsn* prev = i ? &b.insns[i - 1] : nullptr;
+
+			if (LowLevelILLabel* l = label_at(addr))
+				il.MarkLabel(*l);
+
+			if (insn.op == AFUC_INVALID) {
+				il.SetCurrentAddress(arch, addr);
+				il.AddInstruction(il.Undefined());
+				terminated = true;
+				break;
+			}
+
+			AfucFlow f = afuc_insn_flow(insn, addr);
+			if (f.kind == AFUC_FLOW_NEXT) {
+				lift_op(addr, insn, prev);
+				continue;
+			}
+
+			if (insn.op == AFUC_SETSECURE) {
+				il.SetCurrentAddress(arch, addr);
+				afuc_get_llil(arch, addr, il, insn, gpuver);
+				if (label_at(f.target)) {
+					branch(il.CompareNotEqual(4, il.Register(4, s_temp_setsecure), il.Const(4, 0)),
+						f.target, addr + 4);
+					terminated = true;
+				}
+				continue;
+			}
+
+			/*
+			 * The delay slot executes before the transfer but after the
+			 * branch has read its operands: snapshot them when the slot
+			 * would change what the branch sees.
+			 */
+			AfucInsn slot = {};
+			slot.op = AFUC_INVALID;
+			if (i + 1 < b.insns.size())
+				slot = b.insns[i + 1];
+			bool uses_src1 = f.kind == AFUC_FLOW_COND || f.kind == AFUC_FLOW_INDIRECT;
+			bool snapshot = uses_src1 && slot.op != AFUC_INVALID &&
+				(afuc_insn_src_regs(insn) & (afuc_insn_dst_regs(slot) | s_fifo_srcs));
+
+			il.SetCurrentAddress(arch, addr);
+			if (snapshot)
+				il.AddInstruction(il.SetRegister(4, s_temp_branch_src, ilSrcReg(il, insn.src1_enc)));
+
+			if (slot.op != AFUC_INVALID)
+				lift_op(addr + 4, slot, nullptr);
+			il.SetCurrentAddress(arch, addr);
+
+			ExprId src1 = 0;
+			if (uses_src1)
+				src1 = snapshot ? il.Register(4, s_temp_branch_src) : ilSrcReg(il, insn.src1_enc);
+
+			switch (insn.op) {
+			case AFUC_BRNE_IMM:
+				branch(il.CompareNotEqual(4, src1, il.Const(4, insn.immed)), f.target, addr + 8);
+				break;
+			case AFUC_BREQ_IMM:
+				branch(il.CompareEqual(4, src1, il.Const(4, insn.immed)), f.target, addr + 8);
+				break;
+			case AFUC_BRNE_BIT:
+				branch(il.CompareEqual(4, il.And(4, src1, il.Const(4, 1u << insn.bit)),
+					il.Const(4, 0)), f.target, addr + 8);
+				break;
+			case AFUC_BREQ_BIT:
+				branch(il.CompareNotEqual(4, il.And(4, src1, il.Const(4, 1u << insn.bit)),
+					il.Const(4, 0)), f.target, addr + 8);
+				break;
+			case AFUC_JUMP:
+			case AFUC_JUMPA:
+				jump_to(f.target);
+				break;
+			case AFUC_JUMPR:
+				il.AddInstruction(il.Jump(src1));
+				break;
+			default:
+				/* call / bl / ret / iret / sret / waitin */
+				afuc_get_llil(arch, addr, il, insn, gpuver);
+				break;
+			}
+
+			/* calls return past the delay slot into the same block */
+			terminated = f.kind != AFUC_FLOW_CALL;
+			i++;
+		}
+
+		if (!terminated)
+			jump_to(b.end);
+	}
+
+	return true;
+}
@@ -0,0 +1,104 @@
+/*
+ * AFUC ISA description.
+ *
+ * Single source for the opcode list: the AfucOp enum, mnemonics, operand
+ * forms and the per-generation ALU opcode tables used by the decoder,
+ * encoder, disassembler and lifter are all expanded from AFUC_ISA below.
+ * Adding an ALU encoding is a one-row change.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/* ─── Operand forms ────────────────────────────────────────── */
+
+/* How an instruction's operands are printed and lifted */
+enum AfucForm : uint8_t {
+	AFUC_FORM_NONE,       /* no operands */
+	AFUC_FORM_NOP,        /* optional 24-bit payload */
+	AFUC_FORM_ALU,        /* dst, src1, src2 | immed */
+	AFUC_FORM_ALU1,       /* dst, src2 | immed */
+	AFUC_FORM_MOV,        /* dst, src2 */
+	AFUC_FORM_MOVI,       /* dst, immed << shift */
+	AFUC_FORM_BIT,        /* dst, src1, bN */
+	AFUC_FORM_BITFIELD,   /* dst, src1, b<lo>, b<hi> */
+	AFUC_FORM_CWRITE,     /* src1, [src2 + base] */
+	AFUC_FORM_CREAD,      /* dst, [src1 + base] */
+	AFUC_FORM_STORE,      /* src1, [src2 + immed] */
+	AFUC_FORM_LOAD,       /* dst, [src1 + immed] */
+	AFUC_FORM_BR_IMM,     /* src1, immed, #rel */
+	AFUC_FORM_BR_BIT,     /* src1, bN, #rel */
+	AFUC_FORM_REL,        /* #rel */
+	AFUC_FORM_ABS,        /* #abs */
+	AFUC_FORM_INDIRECT,   /* src1 */
+	AFUC_FORM_SECURE,     /* $02, #+3 */
+};
+
+/* ─── Instruction table ────────────────────────────────────── */
+
+/*
+ * X(op, mnemonic, form, a5xx/a6xx 2-src sub-opcode, a5xx/a6xx immediate
+ *   opcode, a7xx 2-src sub-opcode, a7xx immediate opcode)
+ *
+ * The 2-src sub-opcode lives in bits[0:4] of opcode group 10011, the
+ * immediate opcode in bits[27:31]; 0 means the form doesn't exist on that
+ * generation. Non-ALU encodings are fixed-format and decoded by group.
+ */
+#define AFUC_ISA(X)                                                              \
+	X(NOP,       "nop",       NOP,      0x00, 0x00, 0x00, 0x00)                \
+	/* ALU */                                                                    \
+	X(ADD,       "add",       ALU,      0x01, 0x01, 0x01, 0x01)                \
+	X(ADDHI,     "addhi",     ALU,      0x02, 0x02, 0x02, 0x02)                \
+	X(SUB,       "sub",       ALU,      0x03, 0x03, 0x03, 0x03)                \
+	X(SUBHI,     "subhi",     ALU,      0x04, 0x04, 0x04, 0x04)                \
+	X(AND,       "and",       ALU,      0x05, 0x05, 0x05, 0x05)                \
+	X(OR,        "or",        ALU,      0x06, 0x06, 0x06, 0x06)                \
+	X(XOR,       "xor",       ALU,      0x07, 0x07, 0x07, 0x07)                \
+	X(NOT,       "not",       ALU1,     0x08, 0x08, 0x08, 0x08)                \
+	X(SHL,       "shl",       ALU,      0x09, 0x09, 0x12, 0x00)                \
+	X(USHR,      "ushr",      ALU,      0x0a, 0x0a, 0x13, 0x00)                \
+	X(ISHR,      "ishr",      ALU,      0x0b, 0x0b, 0x14, 0x00)                \
+	X(ROT,       "rot",       ALU,      0x0c, 0x0c, 0x15, 0x00)                \
+	X(MUL8,      "mul8",      ALU,      0x0d, 0x0d, 0x0c, 0x0c)                \
+	X(MIN,       "min",       ALU,      0x0e, 0x0e, 0x0a, 0x0a)                \
+	X(MAX,       "max",       ALU,      0x0f, 0x0f, 0x0b, 0x0b)                \
+	X(CMP,       "cmp",       ALU,      0x10, 0x10, 0x0d, 0x0d)                \
+	X(BIC,       "bic",       ALU,      0x00, 0x00, 0x09, 0x09)                \
+	X(MSB,       "msb",       ALU1,     0x14, 0x00, 0x19, 0x00)                \
+	X(MOV,       "mov",       MOV,      0x00, 0x00, 0x00, 0x00) /* or $00 */   \
+	/* Move immediate with shift */                                              \
+	X(MOVI,      "mov",       MOVI,     0x00, 0x00, 0x00, 0x00)                \
+	/* Bit manipulation */                                                       \
+	X(SETBIT,    "setbit",    BIT,      0x00, 0x00, 0x00, 0x00)                \
+	X(CLRBIT,    "clrbit",    BIT,      0x00, 0x00, 0x00, 0x00)                \
+	X(SETBIT_R,  "setbit",    ALU,      0x00, 0x00, 0x16, 0x00)                \
+	X(UBFX,      "ubfx",      BITFIELD, 0x00, 0x00, 0x00, 0x00)                \
+	X(BFI,       "bfi",       BITFIELD, 0x00, 0x00, 0x00, 0x00)                \
+	/* Control register access */                                                \
+	X(CWRITE,    "cwrite",    CWRITE,   0x00, 0x00, 0x00, 0x00)                \
+	X(CREAD,     "cread",     CREAD,    0x00, 0x00, 0x00, 0x00)                \
+	X(SWRITE,    "swrite",    CWRITE,   0x00, 0x00, 0x00, 0x00)                \
+	X(SREAD,     "sread",     CREAD,    0x00, 0x00, 0x00, 0x00)                \
+	/* Memory access */                                                          \
+	X(STORE,     "store",     STORE,    0x00, 0x00, 0x00, 0x00)                \
+	X(LOAD,      "load",      LOAD,     0x00, 0x00, 0x00, 0x00)                \
+	/* Branch / control flow */                                                  \
+	X(BRNE_IMM,  "brne",      BR_IMM,   0x00, 0x00, 0x00, 0x00)                \
+	X(BREQ_IMM,  "breq",      BR_IMM,   0x00, 0x00, 0x00, 0x00)                \
+	X(BRNE_BIT,  "brne",      BR_BIT,   0x00, 0x00, 0x00, 0x00)                \
+	X(BREQ_BIT,  "breq",      BR_BIT,   0x00, 0x00, 0x00, 0x00)                \
+	X(JUMP,      "jump",      REL,      0x00, 0x00, 0x00, 0x00) /* brne $00, b0 */ \
+	X(CALL,      "call",      ABS,      0x00, 0x00, 0x00, 0x00)                \
+	X(RET,       "ret",       NONE,     0x00, 0x00, 0x00, 0x00)                \
+	X(IRET,      "iret",      NONE,     0x00, 0x00, 0x00, 0x00)                \
+	X(WAITIN,    "waitin",    NONE,     0x00, 0x00, 0x00, 0x00)                \
+	X(BL,        "bl",        ABS,      0x00, 0x00, 0x00, 0x00)                \
+	X(JUMPA,     "jumpa",     ABS,      0x00, 0x00, 0x00, 0x00) /* a7xx */     \
+	X(JUMPR,     "jump",      INDIRECT, 0x00, 0x00, 0x00, 0x00) /* a7xx */     \
+	X(SRET,      "sret",      NONE,     0x00, 0x00, 0x00, 0x00) /* a7xx */     \
+	X(SETSECURE, "setsecure", SECURE,   0x00, 0x00, 0x00, 0x00)
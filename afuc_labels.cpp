@@ -0,0 +1,162 @@
+/*
+ * Symbolic branch targets.
+ *
+ * The disassembler prints branch and call targets as raw "#0x1a3c"
+ * addresses, since an architecture doesn't know the view it renders
+ * for. This layer rewrites them as the nearest function symbol at or
+ * before the target plus an offset ("#CP_DRAW_INDX_OFFSET+0x1c",
+ * "#sub_290"). Names come from a per-view index of function symbols
+ * that is built once and then updated one symbol at a time, so the
+ * rendering cost doesn't grow with the number of functions.
+ *
+ * The same goes for control registers: the disassembler names them
+ * from the generation's table, and this layer renames the cread/cwrite
+ * operands of views whose chip has a register overlay.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <mutex>
+
+#include "binaryninjaapi.h"
+#include "afuc.h"
+#include "afuc_view.h"
+
+using namespace BinaryNinja;
+using namespace std;
+
+/* ─── Index ────────────────────────────────────────────────── */
+
+void AfucLabelIndex::set(uint64_t start, const string& name)
+{
+	unique_lock<shared_mutex> lock(m_lock);
+	m_starts[start] = name;
+}
+
+void AfucLabelIndex::erase(uint64_t start, const string& name)
+{
+	unique_lock<shared_mutex> lock(m_lock);
+	auto it = m_starts.find(start);
+	if (it != m_starts.end() && it->second == name)
+		m_starts.erase(it);
+}
+
+size_t AfucLabelIndex::size() const
+{
+	shared_lock<shared_mutex> lock(m_lock);
+	return m_starts.size();
+}
+
+bool AfucLabelIndex::label(uint64_t addr, string& out) const
+{
+	shared_lock<shared_mutex> lock(m_lock);
+	auto it = m_starts.upper_bound(addr);
+	if (it == m_starts.begin())
+		return false;
+	--it;
+	out = it->second;
+	if (addr != it->first) {
+		char buf[24];
+		snprintf(buf, sizeof(buf), "+0x%" PRIx64, addr - it->first);
+		out += buf;
+	}
+	return true;
+}
+
+/* ─── Binary Ninja glue ────────────────────────────────────── */
+
+class AfucLabelsLayer : public RenderLayer
+{
+	static void relabel(BasicBlock* block, vector<DisassemblyTextLine*>& lines)
+	{
+		AfucGpuVer gpuver;
+		Ref<Function> func = block ? block->GetFunction() : nullptr;
+		if (!func || !afuc_arch_gpuver(block->GetArchitecture(), gpuver))
+			return;
+		shared_ptr<AfucLabelIndex> index = afuc_view_label_index(func->GetView());
+		const AfucRegTable* regs = afuc_view_reg_table(func->GetView());
+		if (regs && !regs->fw_id)
+			regs = nullptr;     /* the disassembler's names already apply */
+
+		string label;
+		for (DisassemblyTextLine* line : lines) {
+			if (regs)
+				rename_ctrl_reg(regs, line->tokens);
+			if (!index)
+				continue;
+			for (InstructionTextToken& t : line->tokens) {
+				/* only the disassembler's own "#0x..." targets */
+				if (t.type != PossibleAddressToken || t.text.compare(0, 3, "#0x") != 0 ||
+				    !index->label(t.value, label))
+					continue;
+				t.text = "#" + label;
+				t.width = t.text.size();
+			}
+		}
+	}
+
+	/* The "[$src + @NAME]" operand of a cread/cwrite, whose value is the
+	 * register offset, named from the chip's table */
+	static void rename_ctrl_reg(const AfucRegTable* regs, vector<InstructionTextToken>& tokens)
+	{
+		auto mnem = find_if(tokens.begin(), tokens.end(),
+			[](const InstructionTextToken& t) { return t.type == InstructionToken; });
+		if (mnem == tokens.end() || (mnem->text != "cread" && mnem->text != "cwrite"))
+			return;
+		for (size_t i = 0; i + 1 < tokens.size(); i++) {
+			if (tokens[i].type != TextToken || tokens[i].text != " + ")
+				continue;
+			InstructionTextToken& t = tokens[i + 1];
+			uint32_t off = (uint32_t)t.value;
+			const char* name = afuc_ctrl_reg_name(regs, off);
+			if (name) {
+				t.type = TextToken;
+				t.text = string("@") + name;
+			} else {
+				char buf[16];
+				snprintf(buf, sizeof(buf), "0x%03x", off);
+				t.type = IntegerToken;
+				t.text = buf;
+			}
+			t.width = t.text.size();
+			return;
+		}
+	}
+
+public:
+	AfucLabelsLayer() : RenderLayer("AFUC Symbolic Targets") {}
+
+	void ApplyToDisassemblyBlock(Ref<BasicBlock> block, vector<DisassemblyTextLine>& lines) override
+	{
+		vector<DisassemblyTextLine*> ptrs;
+		for (DisassemblyTextLine& l : lines)
+			ptrs.push_back(&l);
+		relabel(block, ptrs);
+	}
+
+	void ApplyToLinearViewObject(Ref<LinearViewObject>, Ref<LinearViewObject>, Ref<LinearViewObject>,
+	                             vector<LinearDisassemblyLine>& lines) override
+	{
+		/* lines arrive grouped by block */
+		for (size_t i = 0; i < lines.size();) {
+			size_t j = i;
+			vector<DisassemblyTextLine*> ptrs;
+			for (; j < lines.size() && lines[j].block.GetPtr() == lines[i].block.GetPtr(); j++)
+				ptrs.push_back(&lines[j].contents);
+			if (lines[i].block)
+				relabel(lines[i].block, ptrs);
+			i = j;
+		}
+	}
+};
+
+void afuc_register_labels_layer()
+{
+	/* on by default; turning it off shows the raw addresses again */
+	RenderLayer::Register(new AfucLabelsLayer(), EnabledByDefaultRenderLayerDefaultEnableState);
+}
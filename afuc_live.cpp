@@ -0,0 +1,215 @@
+/*
+ * Register liveness.
+ *
+ * Liveness is solved once for the whole code image with 32-bit register
+ * bitsets (bit n = register encoding n) over the flow map's blocks, and
+ * cached per view. A render layer shows the dead $01-$19 at each
+ * instruction.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <algorithm>
+
+#include "binaryninjaapi.h"
+#include "afuc.h"
+#include "afuc_view.h"
+
+using namespace BinaryNinja;
+using namespace std;
+
+/* ─── Solver ───────────────────────────────────────────────── */
+
+static const uint32_t s_none = ~0u;
+
+void afuc_liveness(AfucGpuVer gpuver, const AfucFlowMap& map, AfucLiveness& out,
+                   uint32_t exit_live)
+{
+	size_t count = map.words.size();
+	out.base = map.base;
+	out.blocks.clear();
+	out.block_of.assign(count, 0);
+	out.live.assign(count, 0);
+
+	/* Per-word use/def sets, and the word a call's callee live-in joins
+	 * at (its delay slot, walking backwards) */
+	vector<uint32_t> use(count), def(count), callee(count, s_none);
+	for (size_t i = 0; i < count; i++) {
+		AfucInsn insn;
+		uint64_t addr = map.base + i * 4;
+		if (!afuc_decode((const uint8_t*)&map.words[i], 4, addr, insn, gpuver))
+			continue;
+		use[i] = afuc_insn_src_regs(insn) & AFUC_LIVE_REGS;
+		def[i] = afuc_insn_dst_regs(insn) & AFUC_LIVE_REGS;
+		if (!map.is_term(i) && (map.words[i] >> 30) == 3) {
+			AfucFlow f = afuc_insn_flow(insn, addr);
+			if (f.kind == AFUC_FLOW_CALL && i + 1 < count) {
+				uint64_t t = (f.target - map.base) / 4;
+				callee[i + 1] = f.target >= map.base && t < count ? (uint32_t)t : s_none - 1;
+			}
+		}
+	}
+
+	/* Blocks run from a leader to the next terminator (and its delay
+	 * slot) or the next leader */
+	struct Succ { uint32_t a, b; bool exits; };
+	vector<Succ> succs;
+	auto word_at = [&](uint64_t addr) -> uint32_t {
+		if (addr < map.base || (addr - map.base) / 4 >= count)
+			return s_none;
+		return (uint32_t)((addr - map.base) / 4);
+	};
+
+	for (size_t i = 0; i < count;) {
+		size_t t = afuc_flow_next(map.term, i, count);
+		size_t l = afuc_flow_next(map.leader, i + 1, count);
+		Succ s = { s_none, s_none, false };
+		size_t end;
+		if (t < l) {
+			AfucInsn insn;
+			uint64_t addr = map.base + t * 4;
+			afuc_decode((const uint8_t*)&map.words[t], 4, addr, insn, gpuver);
+			AfucFlow f = afuc_insn_flow(insn, addr);
+			end = min(count, t + (f.delay_slot ? 2 : 1));
+			if (insn.op == AFUC_INVALID) {
+				s.exits = true;
+			} else if (f.kind == AFUC_FLOW_COND) {
+				s.a = word_at(f.target);
+				s.b = word_at(map.base + end * 4);
+				s.exits = s.a == s_none || s.b == s_none;
+			} else if (f.kind == AFUC_FLOW_JUMP) {
+				s.a = word_at(f.target);
+				s.exits = s.a == s_none;
+			} else {
+				s.exits = true;
+			}
+		} else {
+			end = l;
+			s.a = word_at(map.base + end * 4);
+			s.exits = s.a == s_none;
+		}
+		for (size_t j = i; j < end; j++)
+			out.block_of[j] = (uint32_t)out.blocks.size();
+		out.blocks.push_back({ (uint32_t)i, (uint32_t)end, 0, 0 });
+		succs.push_back(s);
+		i = end;
+	}
+
+	/* Iterate to a fixed point, last block first */
+	for (bool changed = true; changed;) {
+		changed = false;
+		for (size_t b = out.blocks.size(); b-- > 0;) {
+			AfucLiveBlock& blk = out.blocks[b];
+			const Succ& s = succs[b];
+			uint32_t live = s.exits ? exit_live : 0;
+			if (s.a != s_none)
+				live |= out.live[s.a];
+			if (s.b != s_none)
+				live |= out.live[s.b];
+			blk.live_out = live;
+
+			for (size_t j = blk.end; j-- > blk.first;) {
+				if (callee[j] != s_none)
+					live |= callee[j] < count ? out.live[callee[j]] : exit_live;
+				live = (live & ~def[j]) | use[j];
+				if (out.live[j] != live) {
+					out.live[j] = live;
+					changed = true;
+				}
+			}
+			blk.live_in = live;
+		}
+	}
+}
+
+uint32_t afuc_live_before(const AfucLiveness& live, uint64_t addr)
+{
+	if (addr < live.base || (addr - live.base) % 4 || (addr - live.base) / 4 >= live.live.size())
+		return AFUC_LIVE_REGS;
+	return live.live[(addr - live.base) / 4];
+}
+
+/* ─── Render layer ─────────────────────────────────────────── */
+
+/* "$01-$05 $0a" */
+static string reg_set_text(uint32_t mask)
+{
+	string text;
+	for (uint32_t r = 0; r < 32; r++) {
+		if (!(mask & (1u << r)))
+			continue;
+		uint32_t last = r;
+		while (last + 1 < 32 && (mask & (1u << (last + 1))))
+			last++;
+		if (!text.empty())
+			text += " ";
+		text += afuc_src_reg_name(r);
+		if (last > r)
+			text += string(last > r + 1 ? "-" : " ") + afuc_src_reg_name(last);
+		r = last;
+	}
+	return text;
+}
+
+class AfucLivenessLayer : public RenderLayer
+{
+	static void annotate(BasicBlock* block, vector<DisassemblyTextLine*>& lines)
+	{
+		AfucGpuVer gpuver;
+		Ref<Function> func = block ? block->GetFunction() : nullptr;
+		if (!func || !afuc_arch_gpuver(block->GetArchitecture(), gpuver))
+			return;
+		shared_ptr<const AfucLiveness> live = afuc_view_liveness(func->GetView());
+		if (!live)
+			return;
+
+		uint64_t last = ~0ull;
+		for (DisassemblyTextLine* line : lines) {
+			if (line->addr == last || line->addr < block->GetStart() || line->addr >= block->GetEnd())
+				continue;
+			bool insn = any_of(line->tokens.begin(), line->tokens.end(),
+				[](const InstructionTextToken& t) { return t.type == InstructionToken; });
+			if (!insn)
+				continue;
+			last = line->addr;
+
+			uint32_t dead = ~afuc_live_before(*live, line->addr) & AFUC_LIVE_GPRS;
+			if (dead)
+				line->tokens.emplace_back(AnnotationToken, "  ; dead " + reg_set_text(dead));
+		}
+	}
+
+public:
+	AfucLivenessLayer() : RenderLayer("AFUC Dead Registers") {}
+
+	void ApplyToDisassemblyBlock(Ref<BasicBlock> block, vector<DisassemblyTextLine>& lines) override
+	{
+		vector<DisassemblyTextLine*> ptrs;
+		for (DisassemblyTextLine& l : lines)
+			ptrs.push_back(&l);
+		annotate(block, ptrs);
+	}
+
+	void ApplyToLinearViewObject(Ref<LinearViewObject>, Ref<LinearViewObject>, Ref<LinearViewObject>,
+	                             vector<LinearDisassemblyLine>& lines) override
+	{
+		/* lines arrive grouped by block */
+		for (size_t i = 0; i < lines.size();) {
+			size_t j = i;
+			vector<DisassemblyTextLine*> ptrs;
+			for (; j < lines.size() && lines[j].block.GetPtr() == lines[i].block.GetPtr(); j++)
+				ptrs.push_back(&lines[j].contents);
+			if (lines[i].block)
+				annotate(lines[i].block, ptrs);
+			i = j;
+		}
+	}
+};
+
+void afuc_register_liveness_layer()
+{
+	/* off by default, enabled from the view's render layer menu */
+	RenderLayer::Register(new AfucLivenessLayer());
+}
@@ -0,0 +1,166 @@
+/*
+ * Firmware metadata carried in nop payloads.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <cstdio>
+#include <map>
+
+#include "binaryninjaapi.h"
+#include "afuc.h"
+#include "afuc_scan.h"
+#include "afuc_view.h"
+
+using namespace BinaryNinja;
+using namespace std;
+
+/* ─── Payload classification ──────────────────────────────── */
+
+/* nop: bits 27-31 clear (bit 26 is the ignored (rep) flag) */
+static const uint32_t s_nop_mask = 0xf8000000;
+static const uint32_t s_payload_mask = 0x00ffffff;
+
+static bool known_fw_id(uint32_t fw_id)
+{
+	switch (fw_id) {
+	case 0x730: case 0x740: case 0x512: case 0x520:
+	case 0x6ee: case 0x6dc: case 0x6dd:
+	case 0x5ff:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* Three little-endian bytes of text, NUL padding allowed at the end */
+static bool printable(uint32_t payload)
+{
+	bool ended = false;
+	for (int i = 0; i < 3; i++) {
+		uint8_t c = (payload >> (i * 8)) & 0xff;
+		if (c == 0) {
+			if (i == 0)
+				return false;
+			ended = true;
+		} else if (ended || c < 0x20 || c > 0x7e) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void afuc_nop_payloads(const uint32_t* words, size_t count, uint64_t base,
+                       vector<AfucNopPayload>& out)
+{
+	size_t first = out.size();
+	afuc_scan_masked(words, count, s_nop_mask, 0, [&](size_t i) {
+		uint32_t payload = words[i] & s_payload_mask;
+		if (!payload)
+			return;
+		AfucNopKind kind = AFUC_NOP_RAW;
+		if (known_fw_id(payload >> 12))
+			kind = AFUC_NOP_FW_HEADER;
+		else if (printable(payload))
+			kind = AFUC_NOP_TAG;
+		out.push_back({ base + i * 4, payload, kind });
+	});
+
+	/* A single printable word is as likely to be a constant; tags are
+	 * runs of at least two adjacent ones. */
+	for (size_t i = first; i < out.size();) {
+		size_t j = i;
+		while (j < out.size() && out[j].kind == AFUC_NOP_TAG &&
+		       out[j].addr == out[i].addr + (j - i) * 4)
+			j++;
+		if (j - i == 1)
+			out[i].kind = AFUC_NOP_RAW;
+		i = j > i ? j : i + 1;
+	}
+}
+
+vector<string> afuc_nop_tags(const vector<AfucNopPayload>& nops)
+{
+	vector<string> tags;
+	uint64_t next = ~0ull;
+	for (const AfucNopPayload& n : nops) {
+		if (n.kind != AFUC_NOP_TAG) {
+			next = ~0ull;
+			continue;
+		}
+		if (n.addr != next)
+			tags.emplace_back();
+		for (int i = 0; i < 3; i++) {
+			char c = (n.payload >> (i * 8)) & 0xff;
+			if (c)
+				tags.back() += c;
+		}
+		next = n.addr + 4;
+	}
+	return tags;
+}
+
+bool afuc_fw_version(const uint32_t* image, size_t image_words,
+                     uint32_t& fw_id, uint32_t& version)
+{
+	/* word 0 is the file header, word 1 the header nop */
+	if (image_words < 2 || (image[1] & s_nop_mask))
+		return false;
+	fw_id = (image[1] >> 12) & 0xfff;
+	version = image[1] & 0xfff;
+	return true;
+}
+
+/* ─── Binary Ninja glue ────────────────────────────────────── */
+
+void afuc_apply_nop_metadata(BinaryView* view, const vector<uint32_t>& image)
+{
+	if (image.size() < 2)
+		return;
+
+	vector<AfucNopPayload> nops;
+	afuc_nop_payloads(image.data() + 1, image.size() - 1, 0, nops);
+
+	vector<uint64_t> addrs, payloads;
+	for (size_t i = 0; i < nops.size(); i++) {
+		const AfucNopPayload& n = nops[i];
+		addrs.push_back(n.addr);
+		payloads.push_back(n.payload);
+
+		string text;
+		if (n.kind == AFUC_NOP_FW_HEADER) {
+			char buf[64];
+			snprintf(buf, sizeof(buf), "fw_id 0x%03x, version 0x%03x",
+				n.payload >> 12, n.payload & 0xfff);
+			text = buf;
+		} else if (n.kind == AFUC_NOP_TAG &&
+		           (i == 0 || nops[i - 1].kind != AFUC_NOP_TAG || nops[i - 1].addr + 4 != n.addr)) {
+			/* comment the start of each tag with the whole string */
+			size_t j = i + 1;
+			while (j < nops.size() && nops[j].kind == AFUC_NOP_TAG &&
+			       nops[j].addr == nops[j - 1].addr + 4)
+				j++;
+			vector<AfucNopPayload> run(nops.begin() + i, nops.begin() + j);
+			text = "tag \"" + afuc_nop_tags(run)[0] + "\"";
+		}
+
+		if (!text.empty() && view->GetCommentForAddress(n.addr).empty())
+			view->SetCommentForAddress(n.addr, text);
+	}
+
+	map<string, Ref<Metadata>> fw;
+	uint32_t fw_id, version;
+	if (afuc_fw_version(image.data(), image.size(), fw_id, version)) {
+		fw["fw_id"] = new Metadata((uint64_t)fw_id);
+		fw["version"] = new Metadata((uint64_t)version);
+	}
+	fw["tags"] = new Metadata(afuc_nop_tags(nops));
+	view->StoreMetadata("afuc.firmware", new Metadata(fw), true);
+
+	map<string, Ref<Metadata>> np;
+	np["addrs"] = new Metadata(addrs);
+	np["payloads"] = new Metadata(payloads);
+	view->StoreMetadata("afuc.nop_payloads", new Metadata(np), true);
+}
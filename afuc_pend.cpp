@@ -0,0 +1,381 @@
+/*
+ * Pending-counter inventory: which packets increment the WFI, query and
+ * cache-flush counters, where the matching decrements are queued and
+ * where the firmware waits for them.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+#include <tuple>
+
+#include "binaryninjaapi.h"
+#include "afuc_pm4.h"
+#include "afuc_view.h"
+
+using namespace BinaryNinja;
+using namespace std;
+
+/* ─── Path walk ────────────────────────────────────────────── */
+
+static const size_t s_max_states = 20000;
+static const size_t s_max_call_depth = 4;
+static const uint8_t s_max_pending = 3;
+
+static const char* const s_counter_names[AFUC_PEND_COUNTERS] = { "WFI", "QUERY", "CACHE" };
+
+const char* afuc_pend_counter_name(AfucPendCounter counter)
+{
+	return counter < AFUC_PEND_COUNTERS ? s_counter_names[counter] : "?";
+}
+
+namespace {
+
+/* Register offsets for one generation, ~0u where absent */
+struct PendRegs {
+	uint32_t incr[AFUC_PEND_COUNTERS];
+	uint32_t ctr[AFUC_PEND_COUNTERS];
+	uint32_t decr[AFUC_PEND_COUNTERS];    /* pipe */
+	uint32_t wait_idle, event_cmd;       /* pipe */
+
+	explicit PendRegs(AfucGpuVer gpuver)
+	{
+		auto ctrl = [&](const char* a, const char* b = nullptr) {
+			uint32_t off;
+			if (afuc_ctrl_reg_offset(gpuver, a, off) || (b && afuc_ctrl_reg_offset(gpuver, b, off)))
+				return off;
+			return ~0u;
+		};
+		auto pipe = [&](const char* name) {
+			for (uint32_t off = 0; off < AFUC_PIPE_REG_COUNT; off++) {
+				const char* n = afuc_pipe_reg_name(gpuver, off);
+				if (n && !strcmp(n, name))
+					return off;
+			}
+			return ~0u;
+		};
+
+		incr[AFUC_PEND_WFI] = ctrl("WFI_PEND_INCR");
+		incr[AFUC_PEND_QUERY] = ctrl("QUERY_PEND_INCR");
+		incr[AFUC_PEND_CACHE] = ctrl("CACHE_FLUSH_PEND_INCR", "CACHE_CLEAN_PEND_INCR");
+		ctr[AFUC_PEND_WFI] = ctrl("WFI_PEND_CTR");
+		ctr[AFUC_PEND_QUERY] = ctrl("QUERY_PEND_CTR");
+		ctr[AFUC_PEND_CACHE] = ctrl("CACHE_FLUSH_PEND_CTR", "CACHE_CLEAN_PEND_CTR");
+		decr[AFUC_PEND_WFI] = pipe("WFI_PEND_DECR");
+		decr[AFUC_PEND_QUERY] = pipe("QUERY_PEND_DECR");
+		decr[AFUC_PEND_CACHE] = ~0u;   /* the flush completing drops it */
+		wait_idle = pipe("WAIT_FOR_IDLE");
+		event_cmd = pipe("EVENT_CMD");
+	}
+
+	int find(const uint32_t (&regs)[AFUC_PEND_COUNTERS], uint32_t off) const
+	{
+		for (int k = 0; k < AFUC_PEND_COUNTERS; k++)
+			if (regs[k] == off)
+				return k;
+		return -1;
+	}
+};
+
+struct PendState {
+	uint64_t pc;
+	vector<uint64_t> stack;
+	uint8_t pending[AFUC_PEND_COUNTERS];
+	uint64_t last_incr[AFUC_PEND_COUNTERS];
+	uint8_t waited;           /* counters waited on with nothing incremented since */
+	uint32_t pipe;            /* pipe register $addr selects, ~0u if none */
+};
+
+}
+
+void afuc_pending_counters(AfucGpuVer gpuver, const uint32_t* code, size_t count,
+                           uint64_t entry, AfucPendSummary& out)
+{
+	out = AfucPendSummary();
+	PendRegs regs(gpuver);
+
+	set<tuple<uint64_t, size_t, uint64_t, uint32_t, uint32_t>> visited;
+	set<tuple<uint64_t, int, int>> sites, issues;
+	set<pair<uint64_t, uint64_t>> pairs;
+
+	auto site = [&](uint64_t addr, AfucPendOp op, int k) {
+		if (sites.insert({ addr, op, k }).second)
+			out.sites.push_back({ addr, op, (AfucPendCounter)k });
+	};
+	auto issue = [&](uint64_t addr, AfucPendIssueKind kind, int k) {
+		if (issues.insert({ addr, kind, k }).second)
+			out.issues.push_back({ addr, kind, (AfucPendCounter)k });
+	};
+
+	auto wait = [&](uint64_t addr, int k, PendState& st) {
+		site(addr, AFUC_PEND_WAIT, k);
+		if (st.pending[k] && k != AFUC_PEND_CACHE)
+			issue(addr, AFUC_PEND_EARLY_WAIT, k);
+		else if (st.waited & (1u << k))
+			issue(addr, AFUC_PEND_REPEATED_WAIT, k);
+		st.waited |= 1u << k;
+	};
+
+	/* A path ends: what it still has pending was never decremented, or is
+	 * unknown if the walk lost the path */
+	auto finish = [&](const PendState& st, bool known) {
+		if (!known)
+			out.complete = false;
+		/* the cache counter drops when its flush completes */
+		for (int k = 0; k < AFUC_PEND_CACHE; k++)
+			if (st.pending[k])
+				issue(st.last_incr[k], known ? AFUC_PEND_UNMATCHED_INCR : AFUC_PEND_UNKNOWN_INCR, k);
+	};
+
+	/* Apply one instruction's counter effects */
+	auto apply = [&](const AfucInsn& insn, uint64_t addr, PendState& st) {
+		int k;
+		if (insn.op == AFUC_CWRITE && (k = regs.find(regs.incr, insn.base)) >= 0) {
+			site(addr, AFUC_PEND_INCR, k);
+			if (st.pending[k] < s_max_pending)
+				st.pending[k]++;
+			st.last_incr[k] = addr;
+			st.waited &= ~(1u << k);
+			if (k == AFUC_PEND_CACHE)
+				out.flush = true;
+		} else if (insn.op == AFUC_CREAD && (k = regs.find(regs.ctr, insn.base)) >= 0) {
+			wait(addr, k, st);
+		}
+
+		uint32_t dst = afuc_insn_dst_regs(insn);
+		if (dst & (1u << 0x1f) && st.pipe != ~0u) {
+			/* a $data write goes to the selected pipe register */
+			if ((k = regs.find(regs.decr, st.pipe)) >= 0) {
+				site(addr, AFUC_PEND_DECR, k);
+				if (st.pending[k]) {
+					pairs.insert({ st.last_incr[k], addr });
+					st.pending[k]--;
+				} else {
+					issue(addr, AFUC_PEND_UNMATCHED_DECR, k);
+				}
+			} else if (st.pipe == regs.wait_idle) {
+				wait(addr, AFUC_PEND_WFI, st);
+			} else if (st.pipe == regs.event_cmd) {
+				site(addr, AFUC_PEND_EVENT, AFUC_PEND_WFI);
+				out.event = true;
+			}
+		}
+
+		if (dst & (1u << 0x1d)) {
+			/* pipe registers are selected by the top byte of $addr */
+			uint32_t val = (insn.immed << insn.shift) & ~0x40000u;
+			st.pipe = insn.op == AFUC_MOVI && !(val & 0x00ffffffu) ? val >> 24 : ~0u;
+		}
+	};
+
+	auto decode = [&](uint64_t addr, AfucInsn& insn) {
+		if (addr / 4 >= count)
+			return false;
+		return afuc_decode((const uint8_t*)&code[addr / 4], 4, addr, insn, gpuver);
+	};
+
+	vector<PendState> work;
+	PendState first = { entry, {}, {}, {}, 0, ~0u };
+	work.push_back(first);
+	while (!work.empty() && visited.size() < s_max_states) {
+		PendState st = std::move(work.back());
+		work.pop_back();
+
+		for (;;) {
+			uint64_t top = st.stack.empty() ? ~0ull : st.stack.back();
+			uint32_t pend = st.pending[0] | st.pending[1] << 8 | st.pending[2] << 16 | st.waited << 24;
+			if (!visited.insert({ st.pc, st.stack.size(), top, pend, st.pipe }).second)
+				break;
+
+			AfucInsn insn;
+			if (!decode(st.pc, insn)) {
+				finish(st, false);
+				break;
+			}
+			apply(insn, st.pc, st);
+
+			AfucFlow f = afuc_insn_flow(insn, st.pc);
+			if (f.kind == AFUC_FLOW_NEXT) {
+				st.pc += 4;
+				continue;
+			}
+
+			uint64_t next = st.pc + (f.delay_slot ? 8 : 4);
+			if (f.delay_slot) {
+				AfucInsn slot;
+				if (!decode(st.pc + 4, slot)) {
+					finish(st, false);
+					break;
+				}
+				apply(slot, st.pc + 4, st);
+			}
+
+			/* a ret with nothing to return to goes back to the dispatcher */
+			if (f.kind == AFUC_FLOW_WAITIN || (f.kind == AFUC_FLOW_RET && st.stack.empty())) {
+				finish(st, true);
+				break;
+			}
+
+			if (f.kind == AFUC_FLOW_COND) {
+				work.push_back(st);
+				work.back().pc = f.target;
+				st.pc = next;
+			} else if (f.kind == AFUC_FLOW_JUMP) {
+				st.pc = f.target;
+			} else if (f.kind == AFUC_FLOW_CALL && st.stack.size() < s_max_call_depth) {
+				st.stack.push_back(next);
+				st.pc = f.target;
+			} else if (f.kind == AFUC_FLOW_RET) {
+				st.pc = st.stack.back();
+				st.stack.pop_back();
+			} else {
+				/* indirect jump, or a call past the depth bound */
+				finish(st, false);
+				break;
+			}
+		}
+	}
+
+	/* paths the state bound cut off */
+	for (const PendState& st : work)
+		finish(st, false);
+
+	sort(out.sites.begin(), out.sites.end(), [](const AfucPendSite& a, const AfucPendSite& b) {
+		return a.addr < b.addr;
+	});
+	out.pairs.assign(pairs.begin(), pairs.end());
+}
+
+/* ─── Binary Ninja glue ────────────────────────────────────── */
+
+static const char* s_issue_text[] = {
+	"increment never decremented in this handler",
+	"decrement without an increment in this handler",
+	"waits before queueing its own decrement",
+	"waits again with nothing incremented since the last wait",
+	"increment still pending where the walk loses the path",
+};
+
+static void show_pending_counters(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	if (!afuc_view_gpuver(view, gpuver))
+		return;
+
+	Ref<Metadata> md = view->QueryMetadata("afuc.packet_table");
+	if (!md || !md->IsArray()) {
+		LogError("AFUC: no packet table recovered for this firmware");
+		return;
+	}
+	vector<uint64_t> table = md->GetUnsignedIntegerList();
+
+	Ref<BinaryView> ref = view;
+	WorkerEnqueue([=]() {
+		Ref<BackgroundTask> task = new BackgroundTask("Pairing AFUC pending counters...", true);
+		uint64_t base;
+		vector<uint32_t> code = afuc_read_code(ref, base);
+
+		std::map<uint64_t, vector<uint32_t>> ops;
+		for (size_t op = 0; op < table.size(); op++)
+			ops[table[op]].push_back((uint32_t)op);
+
+		string report = "# AFUC pending counters\n\n"
+			"| Packet | Handler | Increments | Decrements | Waits | Events | Flush | Issues |\n"
+			"|---|---|---|---|---|---|---|---|\n";
+		string details;
+		char buf[192];
+		size_t flushing = 0, with_issues = 0;
+		vector<Ref<Metadata>> flush_packets;
+
+		for (const auto& [addr, opcodes] : ops) {
+			if (task->IsCancelled()) {
+				task->Finish();
+				return;
+			}
+			if (addr / 4 >= code.size() || opcodes.size() > AFUC_PM4_SHARED_HANDLER_MAX)
+				continue;
+
+			AfucPendSummary s;
+			afuc_pending_counters(gpuver, code.data(), code.size(), addr, s);
+			if (s.sites.empty())
+				continue;
+
+			string packet;
+			for (uint32_t op : opcodes) {
+				const char* name = afuc_pm4_packet_name(gpuver, op);
+				snprintf(buf, sizeof(buf), "CP_UNKNOWN_%02x", op);
+				packet += (packet.empty() ? "" : ", ") + string(name ? name : buf);
+			}
+
+			/* "WFI QUERY" style lists per operation */
+			auto list = [&](AfucPendOp op) {
+				set<int> ks;
+				size_t n = 0;
+				for (const AfucPendSite& site : s.sites)
+					if (site.op == op) {
+						ks.insert(site.counter);
+						n++;
+					}
+				if (op == AFUC_PEND_EVENT)
+					return n ? to_string(n) : string();
+				string text;
+				for (int k : ks)
+					text += (text.empty() ? "" : " ") + string(afuc_pend_counter_name((AfucPendCounter)k));
+				return text;
+			};
+
+			snprintf(buf, sizeof(buf), " | 0x%" PRIx64 "%s | ", addr, s.complete ? "" : " (partial)");
+			report += "| " + packet + buf + list(AFUC_PEND_INCR) + " | " + list(AFUC_PEND_DECR) + " | " +
+				list(AFUC_PEND_WAIT) + " | " + list(AFUC_PEND_EVENT) + " | " + (s.flush ? "yes" : "") +
+				" | " + to_string(s.issues.size()) + " |\n";
+
+			if (s.flush) {
+				flushing++;
+				for (uint32_t op : opcodes)
+					flush_packets.push_back(new Metadata((uint64_t)op));
+			}
+			if (s.issues.empty())
+				continue;
+			with_issues++;
+			details += "- **" + packet + "**\n";
+			for (const AfucPendIssue& is : s.issues) {
+				snprintf(buf, sizeof(buf), "  - 0x%" PRIx64 ": %s %s\n", is.addr,
+					afuc_pend_counter_name(is.counter), s_issue_text[is.kind]);
+				details += buf;
+				snprintf(buf, sizeof(buf), "%s: %s", afuc_pend_counter_name(is.counter), s_issue_text[is.kind]);
+				if (ref->GetCommentForAddress(is.addr).empty())
+					ref->SetCommentForAddress(is.addr, buf);
+			}
+		}
+
+		if (!details.empty())
+			report += "\n## Issues\n\n" + details;
+		snprintf(buf, sizeof(buf), "\n%zu handlers trigger cache flushes, %zu have issues\n",
+			flushing, with_issues);
+		report += buf;
+		ref->StoreMetadata("afuc.flush_packets", new Metadata(flush_packets), true);
+
+		task->Finish();
+		ShowMarkdownReport("AFUC Pending Counters", report, report);
+	}, "AFUC pending counters");
+}
+
+static bool has_packet_table(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	return afuc_view_gpuver(view, gpuver) && view->QueryMetadata("afuc.packet_table");
+}
+
+void afuc_register_pend_commands()
+{
+	PluginCommand::Register("AFUC\\Pending Counters",
+		"Pair pending-counter increments with their decrements and waits per packet handler",
+		show_pending_counters, has_packet_table);
+}
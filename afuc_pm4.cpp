@@ -0,0 +1,509 @@
+/*
+ * PM4 packet descriptions and packet-handler payload analysis.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <tuple>
+
+#include "binaryninjaapi.h"
+#include "afuc_pm4.h"
+#include "afuc_emu.h"
+#include "afuc_view.h"
+
+#include "afuc_pm4_table.h"
+
+using namespace BinaryNinja;
+using namespace std;
+
+/* ─── Packet descriptions ──────────────────────────────────── */
+
+/* Direct-indexed by [generation][opcode], built on first use */
+static const AfucPm4Packet* s_by_opcode[3][AFUC_PACKET_TABLE_SIZE];
+static once_flag s_by_opcode_once;
+
+static unsigned gen_index(AfucGpuVer gpuver)
+{
+	switch (gpuver) {
+	case AFUC_A5XX: return 0;
+	case AFUC_A7XX: return 2;
+	default:        return 1;
+	}
+}
+
+const AfucPm4Packet* afuc_pm4_packet(AfucGpuVer gpuver, uint32_t opcode)
+{
+	if (opcode >= AFUC_PACKET_TABLE_SIZE)
+		return nullptr;
+	call_once(s_by_opcode_once, [] {
+		for (const AfucPm4Packet& p : s_pm4_packets)
+			for (unsigned g = 0; g < 3; g++)
+				if ((p.gens & (1u << g)) && p.opcode < AFUC_PACKET_TABLE_SIZE)
+					s_by_opcode[g][p.opcode] = &p;
+	});
+	return s_by_opcode[gen_index(gpuver)][opcode];
+}
+
+const char* afuc_pm4_packet_name(AfucGpuVer gpuver, uint32_t opcode)
+{
+	const AfucPm4Packet* p = afuc_pm4_packet(gpuver, opcode);
+	return p ? p->name : nullptr;
+}
+
+static vector<string> split_fields(const char* fields)
+{
+	vector<string> out;
+	if (!*fields)
+		return out;
+	const char* s = fields;
+	for (;;) {
+		const char* e = strchr(s, '|');
+		out.emplace_back(s, e ? e - s : strlen(s));
+		if (!e)
+			break;
+		s = e + 1;
+	}
+	return out;
+}
+
+uint32_t afuc_pm4_field_count(const AfucPm4Packet& pkt)
+{
+	return (uint32_t)split_fields(pkt.fields).size();
+}
+
+string afuc_pm4_field_name(const AfucPm4Packet& pkt, uint32_t dword)
+{
+	vector<string> names = split_fields(pkt.fields);
+
+	if (pkt.repeat_stride && dword >= pkt.repeat_from) {
+		uint32_t rel = dword - pkt.repeat_from;
+		uint32_t idx = pkt.repeat_from + rel % pkt.repeat_stride;
+		if (idx < names.size())
+			return names[idx] + "[" + to_string(rel / pkt.repeat_stride) + "]";
+	} else if (dword < names.size()) {
+		return names[dword];
+	}
+	return "dword" + to_string(dword);
+}
+
+/* ─── Handler payload reads ────────────────────────────────── */
+
+/* Bounds on the walk; handlers are short and read few fixed dwords */
+static const uint32_t s_max_dwords = 32;
+static const size_t s_max_states = 20000;
+static const size_t s_max_call_depth = 4;
+
+namespace {
+
+struct WalkState {
+	uint64_t pc;
+	uint32_t dword;
+	vector<uint64_t> stack;     /* return addresses */
+};
+
+}
+
+void afuc_payload_reads(AfucGpuVer gpuver, const uint32_t* code, size_t count,
+                        uint64_t entry, vector<AfucPayloadRead>& reads,
+                        int* max_dwords)
+{
+	set<tuple<uint64_t, uint32_t, size_t, uint64_t>> visited;
+	vector<WalkState> work;
+	set<pair<uint64_t, uint32_t>> seen_reads;
+	int max_seen = 0;
+	bool unknown = false;
+
+	auto decode = [&](uint64_t addr, AfucInsn& insn) {
+		if (addr / 4 >= count)
+			return false;
+		return afuc_decode((const uint8_t*)&code[addr / 4], 4, addr, insn, gpuver);
+	};
+
+	/* Account for the $data reads of one instruction; false ends the path */
+	auto consume = [&](const AfucInsn& insn, uint64_t addr, uint32_t& dword) {
+		int n = afuc_insn_data_reads(insn);
+		if (n < 0) {
+			if (seen_reads.insert({ addr, dword }).second)
+				reads.push_back({ addr, dword, true });
+			unknown = true;
+			return false;
+		}
+		for (int i = 0; i < n; i++, dword++) {
+			if (seen_reads.insert({ addr, dword }).second)
+				reads.push_back({ addr, dword, false });
+		}
+		max_seen = max(max_seen, (int)dword);
+		if (dword >= s_max_dwords) {
+			/* the rest of the path isn't counted */
+			unknown = true;
+			return false;
+		}
+		return true;
+	};
+
+	work.push_back({ entry, 0, {} });
+	while (!work.empty() && visited.size() < s_max_states) {
+		WalkState st = std::move(work.back());
+		work.pop_back();
+
+		for (;;) {
+			uint64_t top = st.stack.empty() ? ~0ull : st.stack.back();
+			if (!visited.insert({ st.pc, st.dword, st.stack.size(), top }).second)
+				break;
+
+			AfucInsn insn;
+			if (!decode(st.pc, insn))
+				break;
+			if (!consume(insn, st.pc, st.dword))
+				break;
+
+			AfucFlow f = afuc_insn_flow(insn, st.pc);
+			if (f.kind == AFUC_FLOW_NEXT) {
+				st.pc += 4;
+				continue;
+			}
+
+			/* waitin's delay slot already reads the next packet header */
+			if (f.kind == AFUC_FLOW_WAITIN)
+				break;
+
+			uint64_t next = st.pc + (f.delay_slot ? 8 : 4);
+			if (f.delay_slot) {
+				AfucInsn slot;
+				if (!decode(st.pc + 4, slot) || !consume(slot, st.pc + 4, st.dword))
+					break;
+			}
+
+			if (f.kind == AFUC_FLOW_COND) {
+				work.push_back({ f.target, st.dword, st.stack });
+				st.pc = next;
+			} else if (f.kind == AFUC_FLOW_JUMP) {
+				st.pc = f.target;
+			} else if (f.kind == AFUC_FLOW_CALL) {
+				if (st.stack.size() >= s_max_call_depth) {
+					/* don't know what the callee consumed */
+					unknown = true;
+					break;
+				}
+				st.stack.push_back(next);
+				st.pc = f.target;
+			} else if (f.kind == AFUC_FLOW_RET) {
+				if (st.stack.empty())
+					break;
+				st.pc = st.stack.back();
+				st.stack.pop_back();
+			} else {
+				unknown = true;
+				break;
+			}
+		}
+	}
+
+	sort(reads.begin(), reads.end(), [](const AfucPayloadRead& a, const AfucPayloadRead& b) {
+		return a.addr != b.addr ? a.addr < b.addr : a.dword < b.dword;
+	});
+	if (max_dwords)
+		*max_dwords = unknown ? -1 : max_seen;
+}
+
+void afuc_handler_insns(AfucGpuVer gpuver, const uint32_t* code, size_t count,
+                        uint64_t entry, vector<uint64_t>& addrs)
+{
+	set<uint64_t> seen;
+	vector<uint64_t> work = { entry };
+
+	while (!work.empty() && seen.size() < s_max_states) {
+		uint64_t pc = work.back();
+		work.pop_back();
+
+		while (pc / 4 < count && seen.insert(pc).second) {
+			AfucInsn insn;
+			if (!afuc_decode((const uint8_t*)&code[pc / 4], 4, pc, insn, gpuver))
+				break;
+
+			AfucFlow f = afuc_insn_flow(insn, pc);
+			if (f.kind == AFUC_FLOW_NEXT) {
+				pc += 4;
+				continue;
+			}
+			if (f.delay_slot && (pc + 4) / 4 < count)
+				seen.insert(pc + 4);
+
+			uint64_t next = pc + (f.delay_slot ? 8 : 4);
+			if (f.kind == AFUC_FLOW_COND) {
+				work.push_back(f.target);
+				pc = next;
+			} else if (f.kind == AFUC_FLOW_JUMP) {
+				pc = f.target;
+			} else if (f.kind == AFUC_FLOW_CALL) {
+				/* callee returns to 'next'; no stack needed for reachability */
+				work.push_back(f.target);
+				pc = next;
+			} else {
+				break;
+			}
+		}
+	}
+
+	addrs.assign(seen.begin(), seen.end());
+}
+
+/* ─── Binary Ninja glue ────────────────────────────────────── */
+
+static string read_comment(const AfucPm4Packet& pkt, const vector<AfucPayloadRead>& reads)
+{
+	/* Several dwords of one repeat group collapse to "field[*]" */
+	vector<string> names;
+	for (const AfucPayloadRead& r : reads) {
+		string n = afuc_pm4_field_name(pkt, r.dword);
+		size_t br = n.find('[');
+		if (br != string::npos)
+			n = n.substr(0, br) + "[*]";
+		if (r.bulk)
+			n += "...";
+		if (find(names.begin(), names.end(), n) == names.end())
+			names.push_back(n);
+	}
+
+	string text;
+	for (const string& n : names) {
+		if (!text.empty())
+			text += ", ";
+		text += string(pkt.name) + "." + n;
+	}
+	return text;
+}
+
+static void define_packet_type(BinaryView* view, const AfucPm4Packet& pkt)
+{
+	if (view->GetTypeByName(QualifiedName(pkt.name)))
+		return;
+
+	vector<string> names = split_fields(pkt.fields);
+	if (names.empty())
+		return;
+
+	StructureBuilder sb;
+	for (size_t i = 0; i < names.size(); i++)
+		sb.AddMemberAtOffset(Type::IntegerType(4, false), names[i], i * 4);
+	view->DefineType(string("afuc:pm4:") + pkt.name, QualifiedName(pkt.name),
+		Type::StructureType(sb.Finalize()));
+}
+
+/* Define the packet's type and name each payload read of its handler */
+static void annotate_handler(BinaryView* view, AfucGpuVer gpuver, const AfucPm4Packet& pkt,
+                             const uint32_t* code, size_t count, uint64_t addr,
+                             map<uint64_t, string>& notes)
+{
+	define_packet_type(view, pkt);
+
+	vector<AfucPayloadRead> reads;
+	afuc_payload_reads(gpuver, code, count, addr, reads);
+
+	/* reads are sorted by address; one note per instruction */
+	for (size_t i = 0; i < reads.size();) {
+		size_t j = i;
+		while (j < reads.size() && reads[j].addr == reads[i].addr)
+			j++;
+		notes.emplace(reads[i].addr, read_comment(pkt,
+			vector<AfucPayloadRead>(reads.begin() + i, reads.begin() + j)));
+		i = j;
+	}
+}
+
+/*
+ * The field names live in auto metadata and are drawn by a render
+ * layer rather than set as comments, so they never shadow a user's
+ * comment and a reload or reanalysis replaces them. 'merge' keeps the
+ * stored names of other handlers.
+ */
+static mutex s_notes_lock;
+
+static void store_field_notes(BinaryView* view, map<uint64_t, string> notes, bool merge)
+{
+	lock_guard<mutex> lock(s_notes_lock);
+	Ref<Metadata> md = view->QueryMetadata(AFUC_PM4_FIELDS_KEY);
+	if (merge && md && md->IsKeyValueStore()) {
+		auto kv = md->GetKeyValueStore();
+		vector<uint64_t> addrs = kv["addrs"]->GetUnsignedIntegerList();
+		vector<Ref<Metadata>> texts = kv["text"]->GetArray();
+		for (size_t i = 0; i < addrs.size() && i < texts.size(); i++)
+			notes.emplace(addrs[i], texts[i]->GetString());
+	}
+
+	vector<uint64_t> addrs;
+	vector<string> texts;
+	for (const auto& [a, t] : notes) {
+		addrs.push_back(a);
+		texts.push_back(t);
+	}
+	map<string, Ref<Metadata>> kv;
+	kv["addrs"] = new Metadata(addrs);
+	kv["text"] = new Metadata(texts);
+	view->StoreMetadata(AFUC_PM4_FIELDS_KEY, new Metadata(kv), true);
+}
+
+void afuc_apply_packet_table(BinaryView* view, Platform* plat, AfucGpuVer gpuver,
+                             const vector<uint32_t>& image, bool on_demand)
+{
+	uint32_t table[AFUC_PACKET_TABLE_SIZE];
+	uint32_t n = afuc_find_packet_table(gpuver, image.data(), image.size(), table);
+	if (n < AFUC_PACKET_TABLE_SIZE) {
+		LogWarn("AFUC: packet table not recovered from bootstrap (%u entries)", n);
+		return;
+	}
+
+	const uint32_t* code = image.data() + 1;
+	size_t count = image.size() - 1;
+
+	vector<uint64_t> handlers;
+	map<uint32_t, vector<uint32_t>> by_handler;
+	for (uint32_t op = 0; op < AFUC_PACKET_TABLE_SIZE; op++) {
+		handlers.push_back((uint64_t)table[op] * 4);
+		if (table[op] < count)
+			by_handler[table[op]].push_back(op);
+	}
+	view->StoreMetadata("afuc.packet_table", new Metadata(handlers), true);
+
+	map<uint64_t, string> notes;
+	for (const auto& [word, ops] : by_handler) {
+		uint64_t addr = (uint64_t)word * 4;
+
+		const AfucPm4Packet* pkt = nullptr;
+		for (uint32_t op : ops)
+			if ((pkt = afuc_pm4_packet(gpuver, op)))
+				break;
+
+		char name[64];
+		if (ops.size() > AFUC_PM4_SHARED_HANDLER_MAX)
+			snprintf(name, sizeof(name), "pm4_default_handler");
+		else if (pkt)
+			snprintf(name, sizeof(name), "%s", pkt->name);
+		else
+			snprintf(name, sizeof(name), "CP_UNKNOWN_%02x", ops[0]);
+
+		view->DefineAutoSymbol(new Symbol(FunctionSymbol, name, addr));
+
+		/* on demand, the rest happens when the handler is first asked for */
+		if (on_demand)
+			continue;
+		if (plat)
+			view->AddFunctionForAnalysis(plat, addr);
+
+		if (!pkt || ops.size() > AFUC_PM4_SHARED_HANDLER_MAX)
+			continue;
+		annotate_handler(view, gpuver, *pkt, code, count, addr, notes);
+	}
+	/* a reload starts over, dropping the names of handlers that moved */
+	size_t annotated = notes.size();
+	store_field_notes(view, std::move(notes), false);
+
+	if (on_demand)
+		LogInfo("AFUC: %zu packet handlers named, analysis on demand", by_handler.size());
+	else
+		LogInfo("AFUC: %zu packet handlers, %zu payload reads annotated",
+			by_handler.size(), annotated);
+}
+
+void afuc_annotate_packet_handler(BinaryView* view, uint64_t addr)
+{
+	AfucGpuVer gpuver;
+	Ref<Metadata> md = view->QueryMetadata("afuc.packet_table");
+	if (!afuc_view_gpuver(view, gpuver) || !md || !md->IsArray())
+		return;
+
+	vector<uint32_t> ops;
+	vector<uint64_t> table = md->GetUnsignedIntegerList();
+	for (size_t op = 0; op < table.size(); op++)
+		if (table[op] == addr)
+			ops.push_back((uint32_t)op);
+	if (ops.empty() || ops.size() > AFUC_PM4_SHARED_HANDLER_MAX)
+		return;
+
+	const AfucPm4Packet* pkt = nullptr;
+	for (uint32_t op : ops)
+		if ((pkt = afuc_pm4_packet(gpuver, op)))
+			break;
+	if (!pkt)
+		return;
+
+	uint64_t base;
+	vector<uint32_t> code = afuc_read_code(view, base);
+	map<uint64_t, string> notes;
+	annotate_handler(view, gpuver, *pkt, code.data(), code.size(), addr, notes);
+	store_field_notes(view, std::move(notes), true);
+}
+
+/* ─── Render layer ─────────────────────────────────────────── */
+
+class AfucPm4FieldsLayer : public RenderLayer
+{
+	static void annotate(BasicBlock* block, vector<DisassemblyTextLine*>& lines)
+	{
+		AfucGpuVer gpuver;
+		Ref<Function> func = block ? block->GetFunction() : nullptr;
+		if (!func || !afuc_arch_gpuver(block->GetArchitecture(), gpuver))
+			return;
+		Ref<Metadata> md = func->GetView()->QueryMetadata(AFUC_PM4_FIELDS_KEY);
+		if (!md || !md->IsKeyValueStore())
+			return;
+		auto kv = md->GetKeyValueStore();
+		vector<uint64_t> addrs = kv["addrs"]->GetUnsignedIntegerList();
+		vector<Ref<Metadata>> texts = kv["text"]->GetArray();
+
+		uint64_t last = ~0ull;
+		for (DisassemblyTextLine* line : lines) {
+			if (line->addr == last || line->addr < block->GetStart() || line->addr >= block->GetEnd())
+				continue;
+			bool insn = any_of(line->tokens.begin(), line->tokens.end(),
+				[](const InstructionTextToken& t) { return t.type == InstructionToken; });
+			if (!insn)
+				continue;
+			last = line->addr;
+
+			auto it = lower_bound(addrs.begin(), addrs.end(), line->addr);
+			size_t i = it - addrs.begin();
+			if (it != addrs.end() && *it == line->addr && i < texts.size())
+				line->tokens.emplace_back(AnnotationToken, "  ; " + texts[i]->GetString());
+		}
+	}
+
+public:
+	AfucPm4FieldsLayer() : RenderLayer("AFUC Payload Fields") {}
+
+	void ApplyToDisassemblyBlock(Ref<BasicBlock> block, vector<DisassemblyTextLine>& lines) override
+	{
+		vector<DisassemblyTextLine*> ptrs;
+		for (DisassemblyTextLine& l : lines)
+			ptrs.push_back(&l);
+		annotate(block, ptrs);
+	}
+
+	void ApplyToLinearViewObject(Ref<LinearViewObject>, Ref<LinearViewObject>, Ref<LinearViewObject>,
+	                             vector<LinearDisassemblyLine>& lines) override
+	{
+		/* lines arrive grouped by block */
+		for (size_t i = 0; i < lines.size();) {
+			size_t j = i;
+			vector<DisassemblyTextLine*> ptrs;
+			for (; j < lines.size() && lines[j].block.GetPtr() == lines[i].block.GetPtr(); j++)
+				ptrs.push_back(&lines[j].contents);
+			if (lines[i].block)
+				annotate(lines[i].block, ptrs);
+			i = j;
+		}
+	}
+};
+
+void afuc_register_pm4_layer()
+{
+	/* on by default, this is where the field names show */
+	RenderLayer::Register(new AfucPm4FieldsLayer(), EnabledByDefaultRenderLayerDefaultEnableState);
+}
@@ -0,0 +1,418 @@
+/*
+ * PM4 packet descriptions and packet-handler payload analysis.
+ *
+ * The packet table is generated from freedreno's adreno_pm4.xml by
+ * gen_pm4.py, so nothing is parsed at runtime.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "afuc.h"
+
+/* ─── Packet descriptions ──────────────────────────────────── */
+
+/* Generations a packet exists on (bit per AfucGpuVer) */
+#define AFUC_PM4_A5XX (1u << 0)
+#define AFUC_PM4_A6XX (1u << 1)
+#define AFUC_PM4_A7XX (1u << 2)
+#define AFUC_PM4_ALL  (AFUC_PM4_A5XX | AFUC_PM4_A6XX | AFUC_PM4_A7XX)
+
+struct AfucPm4Packet {
+	uint8_t opcode;
+	uint8_t gens;
+	uint8_t repeat_from;    /* payload repeats from this dword ... */
+	uint8_t repeat_stride;  /* ... every N dwords (0 = no repeat) */
+	const char* name;
+	const char* fields;     /* '|'-separated dword names */
+};
+
+const AfucPm4Packet* afuc_pm4_packet(AfucGpuVer gpuver, uint32_t opcode);
+const char* afuc_pm4_packet_name(AfucGpuVer gpuver, uint32_t opcode);
+
+/* Name of payload dword 'dword', e.g. "num_indices" or "addr_lo[2]" */
+std::string afuc_pm4_field_name(const AfucPm4Packet& pkt, uint32_t dword);
+
+/* Number of named dwords in the fixed part of the payload */
+uint32_t afuc_pm4_field_count(const AfucPm4Packet& pkt);
+
+/* A handler shared by more opcodes than this is the "unknown packet" stub */
+#define AFUC_PM4_SHARED_HANDLER_MAX 8
+
+/* ─── Handler payload reads ────────────────────────────────── */
+
+struct AfucPayloadRead {
+	uint64_t addr;      /* instruction reading $data */
+	uint32_t dword;     /* payload dword index it consumes */
+	bool bulk;          /* (rep)/(xmovN) run starting at 'dword' */
+};
+
+/*
+ * Follow a handler from 'entry' (a byte address in 'code', word 0 at
+ * address 0) and record which payload dword every $data read consumes.
+ * Callees are followed; paths stop when the count stops being static
+ * ((rep)/(xmovN) reads, indirect jumps). 'max_dwords' receives the
+ * largest statically consumed payload size, or -1 if unknown, which
+ * includes a path that reads past the walk's 32-dword bound.
+ */
+void afuc_payload_reads(AfucGpuVer gpuver, const uint32_t* code, size_t count,
+                        uint64_t entry, std::vector<AfucPayloadRead>& reads,
+                        int* max_dwords = nullptr);
+
+/*
+ * Every instruction reachable from handler 'entry' up to its waitin,
+ * callees included, as sorted byte addresses. Indirect jumps end a path.
+ */
+void afuc_handler_insns(AfucGpuVer gpuver, const uint32_t* code, size_t count,
+                        uint64_t entry, std::vector<uint64_t>& addrs);
+
+/* ─── Pending counters ─────────────────────────────────────── */
+
+/*
+ * The WFI, query and cache-flush pending counters are incremented through
+ * @*_PEND_INCR, decremented by the pipe when it reaches a |*_PEND_DECR
+ * write (the cache counter by the flush itself) and waited on by
+ * reading @*_PEND_CTR or writing |WAIT_FOR_IDLE.
+ */
+enum AfucPendCounter {
+	AFUC_PEND_WFI,
+	AFUC_PEND_QUERY,
+	AFUC_PEND_CACHE,
+	AFUC_PEND_COUNTERS,
+};
+
+enum AfucPendOp {
+	AFUC_PEND_INCR,
+	AFUC_PEND_DECR,
+	AFUC_PEND_WAIT,       /* counter read, or |WAIT_FOR_IDLE (WFI) */
+	AFUC_PEND_EVENT,      /* |EVENT_CMD write; counter unused */
+};
+
+struct AfucPendSite {
+	uint64_t addr;
+	AfucPendOp op;
+	AfucPendCounter counter;
+};
+
+/*
+ * "Early" waits are the two kinds a handler can get rid of by itself: a
+ * wait issued while its own increment's decrement isn't queued yet (it
+ * drains the pipe for work the handler could release first), and a wait
+ * with nothing incremented since the previous one on the same path.
+ */
+enum AfucPendIssueKind {
+	AFUC_PEND_UNMATCHED_INCR,   /* still pending at waitin or the handler's ret */
+	AFUC_PEND_UNMATCHED_DECR,   /* nothing this handler incremented */
+	AFUC_PEND_EARLY_WAIT,       /* waits before queueing its own decrement */
+	AFUC_PEND_REPEATED_WAIT,    /* nothing incremented since the last wait */
+	AFUC_PEND_UNKNOWN_INCR,     /* still pending where the walk loses the path */
+};
+
+struct AfucPendIssue {
+	uint64_t addr;
+	AfucPendIssueKind kind;
+	AfucPendCounter counter;
+};
+
+struct AfucPendSummary {
+	std::vector<AfucPendSite> sites;                      /* sorted by address */
+	std::vector<std::pair<uint64_t, uint64_t>> pairs;     /* increment, decrement */
+	std::vector<AfucPendIssue> issues;
+	bool flush = false;         /* increments the cache-flush counter */
+	bool event = false;         /* writes |EVENT_CMD */
+	bool complete = true;       /* false if an indirect jump or a walk bound cut a path */
+};
+
+/*
+ * Walk every path of handler 'entry' (callees included) tracking the
+ * counts it has incremented but not yet queued decrements for. Paths
+ * end at waitin or a ret with nothing to return to; one cut short by an
+ * indirect jump or a bound reports what it still had pending as
+ * unknown rather than unmatched.
+ */
+void afuc_pending_counters(AfucGpuVer gpuver, const uint32_t* code, size_t count,
+                           uint64_t entry, AfucPendSummary& out);
+
+const char* afuc_pend_counter_name(AfucPendCounter counter);
+
+/* ─── Memory fetch and register readback ───────────────────── */
+
+/* A GPR value as far as the handler walk knows it */
+enum AfucSymKind {
+	AFUC_SYM_UNKNOWN,
+	AFUC_SYM_CONST,       /* 'value' */
+	AFUC_SYM_PAYLOAD,     /* payload dword 'value', masked or shifted if 'derived' */
+};
+
+struct AfucSymVal {
+	AfucSymKind kind;
+	uint32_t value;
+	bool derived;
+};
+
+/* "16", "payload[2]", "f(payload[2])" or "?" */
+std::string afuc_sym_text(const AfucSymVal& v);
+
+enum AfucStream {
+	AFUC_STREAM_MEM,      /* $memdata, sized by @MEM_READ_DWORDS */
+	AFUC_STREAM_REG,      /* $regdata, started by @REG_READ_ADDR */
+};
+
+struct AfucStreamAccess {
+	uint64_t addr;
+	AfucStream stream;
+	bool setup;           /* sets the stream size or address rather than reading it */
+	AfucSymVal dwords;    /* dwords set up or read here */
+};
+
+struct AfucFetchSummary {
+	std::vector<AfucStreamAccess> accesses;   /* sorted by address */
+
+	/* Largest constant volume over all paths, plus the payload-dependent
+	 * sizes seen on any path */
+	uint64_t dwords[2] = { 0, 0 };
+	std::vector<AfucSymVal> symbolic[2];
+	uint32_t readbacks = 0;                    /* most @REG_READ_ADDR writes on one path */
+	bool complete = true;                      /* false if some path was cut short */
+};
+
+/*
+ * Walk handler 'entry' and account the dwords it pulls through each
+ * stream. A stream's volume on a path is what its size registers were
+ * set to, or the dwords actually read if it was never sized; the
+ * summary keeps the largest over all paths. Each backward edge is
+ * followed once per path, so a loop body counts for at most two
+ * iterations and a longer loop's volume is a lower bound.
+ */
+void afuc_fetch_volume(AfucGpuVer gpuver, const uint32_t* code, size_t count,
+                       uint64_t entry, AfucFetchSummary& out);
+
+/* ─── Block frequencies ────────────────────────────────────── */
+
+enum AfucBranchHint {
+	AFUC_HINT_NONE,       /* no heuristic applies, 50/50 */
+	AFUC_HINT_USER,       /* overridden by the user */
+	AFUC_HINT_POLL,       /* loop spinning on a re-read control register, memory or FIFO */
+	AFUC_HINT_LOOP,       /* one side stays in a loop, the other leaves it */
+	AFUC_HINT_ERROR_BIT,  /* tests bit 31, set on errors and rare modes */
+	AFUC_HINT_NO_EXIT,    /* one side never reaches waitin or ret */
+	AFUC_HINT_COMPARE,    /* equality against an immediate */
+};
+
+const char* afuc_branch_hint_name(AfucBranchHint hint);
+
+struct AfucFreqBlock {
+	uint64_t start, end;     /* byte addresses, [start, end) */
+	uint32_t cost;           /* afuc_insn_cost of its instructions */
+	double freq;             /* expected executions per entry */
+	uint64_t branch;         /* conditional branch ending the block, ~0 if none */
+	double taken;            /* probability the branch is taken */
+	AfucBranchHint hint;
+	std::vector<uint64_t> calls;   /* callee entries */
+};
+
+/*
+ * Blocks reached from 'entry' without following calls, with static
+ * branch probabilities and the expected executions of each block per
+ * execution of 'entry' (which is 1). 'overrides' maps a branch address
+ * to its taken probability in percent and wins over the heuristics.
+ * Frequencies are capped, and a loop that can never finish (an error
+ * trap) counts as entered once rather than spun.
+ */
+void afuc_block_frequencies(AfucGpuVer gpuver, const uint32_t* code, size_t count,
+                            uint64_t entry, const std::map<uint64_t, uint32_t>& overrides,
+                            std::vector<AfucFreqBlock>& out);
+
+/* Expected cycles per execution of 'entry': block costs weighted by
+ * frequency, each call adding its callee's expected cost */
+double afuc_expected_cost(AfucGpuVer gpuver, const uint32_t* code, size_t count,
+                          uint64_t entry, const std::map<uint64_t, uint32_t>& overrides);
+
+/* ─── Handler cost across firmware ─────────────────────────── */
+
+struct AfucImageHandler {
+	uint32_t opcode;
+	std::string packet;      /* this generation's name, "0x%02x" if unknown */
+	uint64_t entry;          /* byte address in the instruction space */
+	uint32_t insns;          /* reachable instructions, callees included */
+	uint32_t cost;           /* their summed afuc_insn_cost */
+	double expected;         /* afuc_expected_cost without overrides */
+};
+
+struct AfucImageCosts {
+	AfucGpuVer gpuver;
+	uint32_t fw_id, version;
+	bool has_table;
+	std::vector<AfucImageHandler> handlers;   /* by opcode; the shared stub is left out */
+};
+
+/*
+ * Recover the packet table of a firmware file ('image', header word
+ * included) and measure every handler with its generation's decoder.
+ * False if the image has no AFUC firmware header.
+ */
+bool afuc_image_handler_costs(const std::vector<uint32_t>& image, AfucImageCosts& out);
+
+/* ─── Handler effect summaries ─────────────────────────────── */
+
+enum AfucExprKind {
+	AFUC_EXPR_UNKNOWN,    /* merged from different paths or loop-carried */
+	AFUC_EXPR_CONST,      /* 'value' */
+	AFUC_EXPR_PAYLOAD,    /* payload dword 'value' */
+	AFUC_EXPR_GPR,        /* GPR 'value' on entry */
+	AFUC_EXPR_CTRL,       /* control register 'value' on entry */
+	AFUC_EXPR_MEMDATA,    /* 'value'th $memdata dword since the stream was sized */
+	AFUC_EXPR_REGDATA,    /* 'value'th $regdata dword since @REG_READ_ADDR */
+	AFUC_EXPR_LOAD,       /* memory at expression 'a' */
+	AFUC_EXPR_OP,         /* 'op' of expressions 'a' and 'b' ('b' unused for not/msb) */
+};
+
+struct AfucExpr {
+	AfucExprKind kind;
+	AfucOp op;
+	uint32_t value;
+	uint32_t a, b;        /* indices into AfucEffectSummary::exprs */
+};
+
+enum AfucEffectKind {
+	AFUC_EFFECT_CTRL,     /* cwrite */
+	AFUC_EFFECT_SQE,      /* swrite */
+	AFUC_EFFECT_GPU_REG,  /* $data or @REG_WRITE through the register address */
+	AFUC_EFFECT_PIPE_REG, /* the same with a pipe register selected */
+	AFUC_EFFECT_MEM,      /* store */
+};
+
+struct AfucEffect {
+	uint64_t site;        /* instruction */
+	AfucEffectKind kind;
+	uint32_t addr;        /* expression of the register or address written */
+	uint32_t value;       /* expression of the value */
+	bool in_loop;         /* repeated: inside a loop or a (rep) run */
+	bool unchanged;       /* GPU register already holds 'value' on every path here */
+};
+
+struct AfucEffectSummary {
+	std::vector<AfucExpr> exprs;      /* shared and deduplicated, 0 is unknown */
+	std::vector<AfucEffect> effects;  /* sorted by site */
+	bool complete = true;             /* false if a walk bound or indirect jump was hit */
+};
+
+/*
+ * Symbolically execute handler 'entry', callees included, and express
+ * what it writes in terms of the payload dwords and the register values
+ * on entry. Paths are merged where they join: a value that differs
+ * between them becomes unknown, as does anything a loop changes.
+ */
+void afuc_handler_effects(AfucGpuVer gpuver, const uint32_t* code, size_t count,
+                          uint64_t entry, AfucEffectSummary& out);
+
+/* "(p0 + 0x8800)", "@SCRATCH_BASE", "mem[($02 + 0x10)]", "?" */
+std::string afuc_expr_text(AfucGpuVer gpuver, const AfucEffectSummary& s, uint32_t expr);
+
+/* "REG[(p0 + 0x8800)] = p1", "@DRAW_STATE_SET_HDR = p0", ...; unchanged
+ * writes are marked "(unchanged)" */
+std::string afuc_effect_text(AfucGpuVer gpuver, const AfucEffectSummary& s, const AfucEffect& e);
+
+/* ─── GPU register footprint ───────────────────────────────── */
+
+struct AfucRegWrite {
+	uint32_t reg;             /* GPU register (dword offset) */
+	uint32_t writes;          /* write sites */
+	uint32_t unchanged;       /* of which rewrite the value already held */
+	bool constant;            /* every site writes the same constant */
+	bool repeated;            /* written inside a loop or a (rep) run */
+	std::vector<uint64_t> sites;
+};
+
+struct AfucRegFootprint {
+	std::vector<AfucRegWrite> regs;    /* resolved registers, by offset */
+	std::vector<uint64_t> unresolved;  /* sites whose register depends on the payload or state */
+	uint32_t pipe_writes = 0;          /* writes to pipe registers, not counted above */
+	bool complete = true;
+};
+
+/* The GPU registers written by a handler, from its effect summary */
+void afuc_reg_footprint(const AfucEffectSummary& s, AfucRegFootprint& out);
+
+/* ─── IB levels ────────────────────────────────────────────── */
+
+#define AFUC_IB_LEVELS 4      /* ring buffer, IB1, IB2, IB3 (a7xx) */
+
+struct AfucIbLevelPath {
+	std::vector<uint64_t> insns;   /* instructions reachable at this level, sorted */
+	uint32_t cost = 0;             /* their summed afuc_insn_cost */
+	bool finishes = false;         /* some path reaches waitin */
+	std::vector<std::pair<uint64_t, uint32_t>> ib_writes;  /* site, IBn_* / @IB_LEVEL offset */
+};
+
+/* A branch whose condition is computed from the level and goes another
+ * way at some level than at another: bit L of 'taken' / 'not_taken' is
+ * set if that direction is followed at level L */
+struct AfucIbBranch {
+	uint64_t addr;
+	uint8_t taken, not_taken;
+};
+
+struct AfucIbLevelSummary {
+	uint32_t levels = 0;           /* levels of this generation, 0 without @IB_LEVEL */
+	AfucIbLevelPath path[AFUC_IB_LEVELS];
+	std::vector<uint64_t> level_reads;   /* @IB_LEVEL reads reached */
+	std::vector<AfucIbBranch> branches;  /* level-dependent ones, sorted by address */
+	bool complete = true;
+};
+
+/*
+ * Walk handler 'entry', callees included, once per IB level with
+ * @IB_LEVEL reading that level. Values computed from it are followed
+ * through the ALU, and branches on them only take the feasible side, so
+ * each level gets the instructions it can actually reach.
+ */
+void afuc_ib_level_paths(AfucGpuVer gpuver, const uint32_t* code, size_t count,
+                         uint64_t entry, AfucIbLevelSummary& out);
+
+/* True if some level reaches different instructions than another */
+bool afuc_ib_level_differs(const AfucIbLevelSummary& s);
+
+/* "RB", "IB1", "IB2", "IB3" */
+const char* afuc_ib_level_name(uint32_t level);
+
+/* ─── Handler equivalence ──────────────────────────────────── */
+
+enum AfucEquivVerdict {
+	AFUC_EQUIV_IDENTICAL,     /* same words at the same address */
+	AFUC_EQUIV_EQUIVALENT,    /* no difference found within the bounds */
+	AFUC_EQUIV_MISMATCH,      /* 'payload' makes the two versions differ */
+	AFUC_EQUIV_UNKNOWN,       /* summaries differ, but no sampled payload shows it */
+};
+
+struct AfucEquivResult {
+	AfucEquivVerdict verdict = AFUC_EQUIV_EQUIVALENT;
+	bool symbolic_equal = false;     /* exact effect summaries agree, no runs needed */
+	uint32_t samples = 0;            /* concrete runs compared */
+	std::vector<uint32_t> payload;   /* counterexample */
+	std::string reason;              /* what differs under 'payload', or between the summaries */
+};
+
+/*
+ * Check that handler 'entry_a' in 'code_a' and 'entry_b' in 'code_b'
+ * have the same control register, SQE, GPU register, pipe register and
+ * memory writes, in the same order, and consume the same payload. The
+ * symbolic effect summaries are compared first and decide the check
+ * when both handlers are branch-free and fully known. Otherwise both
+ * versions are run on up to 'samples' payloads built from the constants
+ * their branches test plus seeded random values, from identical GPR and
+ * memory state; if the summaries differ and no run shows it, the result
+ * is AFUC_EQUIV_UNKNOWN. GPR contents at waitin are not compared.
+ */
+void afuc_check_equivalence(AfucGpuVer gpuver,
+                            const uint32_t* code_a, size_t count_a, uint64_t entry_a,
+                            const uint32_t* code_b, size_t count_b, uint64_t entry_b,
+                            uint32_t samples, AfucEquivResult& out);
@@ -0,0 +1,397 @@
+/*
+ * Polling loops.
+ *
+ * Firmware waits by spinning: a short loop re-reads a control register,
+ * an SQE register, memory or a FIFO and branches back until the value
+ * changes. Each such loop is found from its back edge, the re-read value
+ * is followed through and / ubfx to the branch that tests it, and a
+ * second register stepped by a constant and tested on the way out is
+ * taken as a timeout counter, bounding the loop when its start value is
+ * loaded just before the loop.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <map>
+#include <set>
+
+#include "binaryninjaapi.h"
+#include "afuc.h"
+#include "afuc_pm4.h"
+#include "afuc_view.h"
+
+using namespace BinaryNinja;
+using namespace std;
+
+/* Longest spin loop body, in words */
+static const size_t s_max_loop_words = 16;
+
+/* How far back a counter's start value is looked for */
+static const size_t s_window = 6;
+
+static const uint32_t s_fifo_regs = (1u << REG_MEMDATA) | (1u << REG_REGDATA);
+
+/* ─── Analysis ─────────────────────────────────────────────── */
+
+static bool is_test(AfucOp op)
+{
+	return op == AFUC_BRNE_IMM || op == AFUC_BREQ_IMM || op == AFUC_BRNE_BIT || op == AFUC_BREQ_BIT;
+}
+
+/* Constant loaded into 'enc' in the straight-line code falling into word 'head' */
+static bool start_value(AfucGpuVer gpuver, const AfucFlowMap& map, size_t head,
+                        uint32_t enc, uint32_t& value)
+{
+	for (size_t k = 1; k <= s_window && k <= head; k++) {
+		size_t i = head - k;
+		if (map.is_term(i) || (k > 1 && map.is_leader(i + 1)))
+			return false;
+		AfucInsn insn;
+		if (!afuc_decode((const uint8_t*)&map.words[i], 4, map.base + i * 4, insn, gpuver))
+			return false;
+		if (!(afuc_insn_dst_regs(insn) & (1u << enc)))
+			continue;
+
+		if (insn.op == AFUC_MOVI)
+			value = insn.immed << insn.shift;
+		else if ((insn.op == AFUC_OR || insn.op == AFUC_ADD) && insn.is_immed && insn.src1_enc == 0)
+			value = insn.immed;
+		else if (insn.op == AFUC_MOV && insn.src2_enc == 0 && !insn.xmov)
+			value = 0;   /* mov $r, $00 */
+		else
+			return false;
+		return insn.dst_enc == enc && !insn.rep;
+	}
+	return false;
+}
+
+/* The loop from word 'head' to its back edge at word 't' (slot included
+ * in 'end'), if it spins on a re-read value */
+static bool classify_loop(AfucGpuVer gpuver, const AfucFlowMap& map, size_t head, size_t end,
+                          AfucPollLoop& loop)
+{
+	uint64_t lo = map.base + head * 4, hi = map.base + end * 4;
+	auto leaves = [&](uint64_t target) { return target < lo || target >= hi; };
+
+	vector<AfucInsn> body(end - head);
+	for (size_t j = head; j < end; j++) {
+		if (!afuc_decode((const uint8_t*)&map.words[j], 4, map.base + j * 4, body[j - head], gpuver))
+			return false;
+		AfucFlowKind k = afuc_insn_flow(body[j - head], map.base + j * 4).kind;
+		if (k == AFUC_FLOW_CALL || k == AFUC_FLOW_RET || k == AFUC_FLOW_WAITIN || k == AFUC_FLOW_INDIRECT)
+			return false;
+	}
+
+	loop = {};
+	loop.head = lo;
+	loop.end = hi;
+	loop.mask = ~0u;
+	loop.counter = ~0u;
+	loop.bound = -1;
+
+	/* Follow the re-read value to its test */
+	uint32_t holds = 0;
+	bool found = false;
+	for (size_t j = head; j < end && !found; j++) {
+		const AfucInsn& insn = body[j - head];
+		uint64_t addr = map.base + j * 4;
+		uint32_t dst = afuc_insn_dst_regs(insn);
+
+		if ((insn.op == AFUC_CREAD || insn.op == AFUC_SREAD || insn.op == AFUC_LOAD) && !insn.rep) {
+			loop.read = addr;
+			loop.source = insn.op == AFUC_CREAD ? AFUC_POLL_CTRL :
+				insn.op == AFUC_SREAD ? AFUC_POLL_SQE : AFUC_POLL_MEM;
+			loop.reg = insn.base;
+			loop.mask = ~0u;
+			holds = 1u << insn.dst_enc;
+			continue;
+		}
+		if (is_test(insn.op) && ((holds & (1u << insn.src1_enc)) || (s_fifo_regs & (1u << insn.src1_enc)))) {
+			if (!(holds & (1u << insn.src1_enc))) {
+				loop.read = addr;
+				loop.source = insn.src1_enc == REG_REGDATA ? AFUC_POLL_REGDATA : AFUC_POLL_MEMDATA;
+				loop.mask = ~0u;
+			}
+			loop.test = addr;
+			loop.test_op = insn.op;
+			loop.value = insn.op == AFUC_BRNE_BIT || insn.op == AFUC_BREQ_BIT ? insn.bit : insn.immed;
+			loop.exit_taken = leaves(afuc_insn_flow(insn, addr).target);
+			found = true;
+			continue;
+		}
+		if ((insn.op == AFUC_AND || insn.op == AFUC_UBFX) && (holds & (1u << insn.src1_enc))) {
+			if (insn.op == AFUC_AND && insn.is_immed)
+				loop.mask &= insn.immed;
+			else if (insn.op == AFUC_UBFX)
+				loop.mask &= (insn.hi >= 31 ? ~0u : (2u << insn.hi) - 1) & (~0u << insn.lo);
+			holds |= 1u << insn.dst_enc;
+			continue;
+		}
+		if ((afuc_insn_src_regs(insn) & s_fifo_regs) && dst && !insn.rep &&
+		    afuc_insn_flow(insn, addr).kind == AFUC_FLOW_NEXT) {
+			/* mov $02, $regdata and friends */
+			loop.read = addr;
+			loop.source = afuc_insn_src_regs(insn) & (1u << REG_REGDATA) ? AFUC_POLL_REGDATA : AFUC_POLL_MEMDATA;
+			loop.mask = ~0u;
+			holds = 1u << insn.dst_enc;
+			continue;
+		}
+		holds &= ~dst;
+	}
+	if (!found)
+		return false;
+
+	/* A counter stepped by a constant and tested on the way out */
+	for (size_t j = head; j < end; j++) {
+		const AfucInsn& br = body[j - head];
+		uint64_t addr = map.base + j * 4;
+		if (addr == loop.test || !is_test(br.op) || br.src1_enc == 0 || br.src1_enc >= REG_MEMDATA)
+			continue;
+		uint64_t target = afuc_insn_flow(br, addr).target;
+		bool exit_taken = leaves(target);
+		if (!exit_taken && target != lo)
+			continue;
+
+		/* exactly one write to it in the body, an add or sub of a constant */
+		int64_t step = 0;
+		size_t writes = 0;
+		for (const AfucInsn& s : body) {
+			if (!(afuc_insn_dst_regs(s) & (1u << br.src1_enc)))
+				continue;
+			writes++;
+			if (afuc_op_form(s.op) != AFUC_FORM_ALU || s.dst_enc != br.src1_enc ||
+			    s.src1_enc != br.src1_enc || !s.is_immed || s.rep)
+				continue;
+			if (s.op == AFUC_ADD)
+				step = s.immed;
+			else if (s.op == AFUC_SUB)
+				step = -(int64_t)s.immed;
+		}
+		if (!step || writes != 1)
+			continue;
+
+		uint32_t start;
+		bool imm = br.op == AFUC_BRNE_IMM || br.op == AFUC_BREQ_IMM;
+		if (imm && start_value(gpuver, map, head, br.src1_enc, start)) {
+			/* breq / brne on an immediate only stop on an exact hit; a
+			 * counter stepping away from or over the value never times
+			 * out, and the loop is as unbounded as one without it */
+			int64_t dist = (int64_t)br.immed - (int64_t)start;
+			if ((dist != 0 && (dist > 0) != (step > 0)) || dist % step != 0)
+				break;
+			loop.bound = max<int64_t>(llabs(dist) / llabs(step), 1);
+		}
+		loop.counter = br.src1_enc;
+		loop.counter_test = addr;
+		break;
+	}
+	return true;
+}
+
+void afuc_poll_loops(AfucGpuVer gpuver, const AfucFlowMap& map, vector<AfucPollLoop>& out)
+{
+	out.clear();
+	size_t count = map.words.size();
+	set<pair<uint64_t, uint64_t>> seen;
+
+	for (size_t t = afuc_flow_next(map.term, 0, count); t < count; t = afuc_flow_next(map.term, t + 1, count)) {
+		AfucInsn insn;
+		uint64_t addr = map.base + t * 4;
+		if (!afuc_decode((const uint8_t*)&map.words[t], 4, addr, insn, gpuver))
+			continue;
+		AfucFlow f = afuc_insn_flow(insn, addr);
+		if ((f.kind != AFUC_FLOW_COND && f.kind != AFUC_FLOW_JUMP) || f.target < map.base ||
+		    f.target > addr || (addr - f.target) / 4 >= s_max_loop_words)
+			continue;
+
+		size_t head = (f.target - map.base) / 4;
+		size_t end = min(count, t + (f.delay_slot ? 2 : 1));
+		AfucPollLoop loop;
+		if (classify_loop(gpuver, map, head, end, loop) && seen.insert({ loop.head, loop.test }).second)
+			out.push_back(loop);
+	}
+}
+
+string afuc_poll_source_text(AfucGpuVer gpuver, const AfucPollLoop& loop)
+{
+	char buf[32];
+	const char* name = nullptr;
+	switch (loop.source) {
+	case AFUC_POLL_CTRL:
+		if ((name = afuc_ctrl_reg_name(gpuver, loop.reg)))
+			return string("@") + name;
+		snprintf(buf, sizeof(buf), "@0x%03x", loop.reg);
+		return buf;
+	case AFUC_POLL_SQE:
+		if ((name = afuc_sqe_reg_name(loop.reg)))
+			return string("%") + name;
+		snprintf(buf, sizeof(buf), "%%0x%03x", loop.reg);
+		return buf;
+	case AFUC_POLL_MEM:
+		return "mem";
+	case AFUC_POLL_REGDATA:
+		return "$regdata";
+	default:
+		return "$memdata";
+	}
+}
+
+string afuc_poll_until_text(const AfucPollLoop& loop)
+{
+	char buf[48];
+	if (loop.test_op == AFUC_BRNE_BIT || loop.test_op == AFUC_BREQ_BIT) {
+		/* breq on a bit is taken when it is set */
+		bool set = (loop.test_op == AFUC_BREQ_BIT) == loop.exit_taken;
+		snprintf(buf, sizeof(buf), "b%u %s", loop.value, set ? "set" : "clear");
+		return buf;
+	}
+	bool eq = (loop.test_op == AFUC_BREQ_IMM) == loop.exit_taken;
+	string text;
+	if (loop.mask != ~0u) {
+		snprintf(buf, sizeof(buf), "& 0x%x ", loop.mask);
+		text = buf;
+	}
+	snprintf(buf, sizeof(buf), "%s 0x%x", eq ? "==" : "!=", loop.value);
+	return text + buf;
+}
+
+/* ─── Binary Ninja glue ────────────────────────────────────── */
+
+static string bound_text(const AfucPollLoop& loop)
+{
+	if (loop.bound >= 0)
+		return "≤ " + to_string(loop.bound) + " iterations";
+	return loop.counter != ~0u ? "counter, start unknown" : "unbounded";
+}
+
+static void show_poll_loops(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	if (!afuc_view_gpuver(view, gpuver))
+		return;
+
+	Ref<Metadata> md = view->QueryMetadata("afuc.packet_table");
+	vector<uint64_t> table;
+	if (md && md->IsArray())
+		table = md->GetUnsignedIntegerList();
+
+	Ref<BinaryView> ref = view;
+	WorkerEnqueue([=]() {
+		Ref<BackgroundTask> task = new BackgroundTask("Finding AFUC polling loops...", true);
+		shared_ptr<const AfucFlowMap> map = afuc_view_flow_map(ref);
+		if (!map) {
+			task->Finish();
+			return;
+		}
+
+		vector<AfucPollLoop> loops;
+		afuc_poll_loops(gpuver, *map, loops);
+
+		/* Handlers reaching each loop, callees included */
+		std::map<uint64_t, size_t> users;
+		for (uint64_t h : table)
+			users[h]++;
+		std::map<uint64_t, vector<size_t>> by_handler;
+		vector<vector<uint64_t>> reached_by(loops.size());
+		for (const auto& [h, n] : users) {
+			if (task->IsCancelled()) {
+				task->Finish();
+				return;
+			}
+			if (n > AFUC_PM4_SHARED_HANDLER_MAX || h / 4 >= map->words.size())
+				continue;
+			vector<uint64_t> addrs;
+			afuc_handler_insns(gpuver, map->words.data(), map->words.size(), h, addrs);
+			for (size_t i = 0; i < loops.size(); i++) {
+				if (binary_search(addrs.begin(), addrs.end(), loops[i].test)) {
+					by_handler[h].push_back(i);
+					reached_by[i].push_back(h);
+				}
+			}
+		}
+
+		auto packet_name = [&](uint64_t h) {
+			size_t op = find(table.begin(), table.end(), h) - table.begin();
+			const char* name = afuc_pm4_packet_name(gpuver, (uint32_t)op);
+			char buf[32];
+			snprintf(buf, sizeof(buf), "0x%" PRIx64, h);
+			return name ? string(name) : string(buf);
+		};
+
+		string report = "# AFUC polling loops\n\n"
+			"| Loop | Read | Polls | Until | Timeout counter | Bound | Handlers |\n"
+			"|---|---|---|---|---|---|---|\n";
+		char buf[160];
+		vector<uint64_t> reads, bounds;
+		for (size_t i = 0; i < loops.size(); i++) {
+			const AfucPollLoop& l = loops[i];
+			string src = afuc_poll_source_text(gpuver, l);
+			string until = afuc_poll_until_text(l);
+			string counter = l.counter != ~0u ? afuc_src_reg_name(l.counter) : "";
+			string handlers;
+			for (size_t k = 0; k < reached_by[i].size() && k < 6; k++)
+				handlers += (k ? ", " : "") + packet_name(reached_by[i][k]);
+			if (reached_by[i].size() > 6)
+				handlers += ", ...";
+
+			snprintf(buf, sizeof(buf), "| 0x%" PRIx64 "-0x%" PRIx64 " | 0x%" PRIx64 " | ",
+				l.head, l.end, l.read);
+			report += buf + src + " | " + until + " | " + counter + " | " + bound_text(l) +
+				" | " + handlers + " |\n";
+
+			if (ref->GetCommentForAddress(l.read).empty())
+				ref->SetCommentForAddress(l.read, "poll: " + src + " until " + until + ", " + bound_text(l));
+			reads.push_back(l.read);
+			bounds.push_back(l.bound >= 0 ? (uint64_t)l.bound : ~0ull);
+		}
+
+		report += "\n## Per handler\n\n| Packet | Handler | Loops | Unbounded | Polls |\n|---|---|---|---|---|\n";
+		for (const auto& [h, idx] : by_handler) {
+			size_t unbounded = 0;
+			vector<string> srcs;
+			for (size_t i : idx) {
+				unbounded += loops[i].bound < 0;
+				string s = afuc_poll_source_text(gpuver, loops[i]);
+				if (find(srcs.begin(), srcs.end(), s) == srcs.end())
+					srcs.push_back(s);
+			}
+			string polls;
+			for (const string& s : srcs)
+				polls += (polls.empty() ? "" : ", ") + s;
+			snprintf(buf, sizeof(buf), " | 0x%" PRIx64 " | %zu | %zu | ", h, idx.size(), unbounded);
+			report += "| " + packet_name(h) + buf + polls + " |\n";
+		}
+
+		size_t unbounded = count_if(loops.begin(), loops.end(), [](const AfucPollLoop& l) { return l.bound < 0; });
+		snprintf(buf, sizeof(buf), "\n%zu polling loops (%zu unbounded), reached from %zu handlers\n",
+			loops.size(), unbounded, by_handler.size());
+		report += buf;
+
+		/* stall sites for matching against hang dumps */
+		std::map<string, Ref<Metadata>> kv;
+		kv["reads"] = new Metadata(reads);
+		kv["bounds"] = new Metadata(bounds);
+		ref->StoreMetadata("afuc.poll_loops", new Metadata(kv), true);
+
+		task->Finish();
+		ShowMarkdownReport("AFUC Polling Loops", report, report);
+	}, "AFUC polling loops");
+}
+
+static bool is_afuc_view(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	return afuc_view_gpuver(view, gpuver);
+}
+
+void afuc_register_poll_commands()
+{
+	PluginCommand::Register("AFUC\\Polling Loops",
+		"Find loops spinning on a register, memory or FIFO, their timeout counters and bounds",
+		show_poll_loops, is_afuc_view);
+}
@@ -0,0 +1,488 @@
+/*
+ * Preemption context-save record layout.
+ *
+ * The save and restore paths address their records through values read
+ * from the save-area control registers. A forward data flow from the
+ * packet handlers and the preemption handlers tracks which GPRs hold
+ * such a value plus a constant offset; every load and store through one
+ * is a field of that record.
+ * The recovered layouts are applied as structure types so the amount of
+ * state moved on a preemption can be compared between firmware builds.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cinttypes>
+#include <cstdio>
+#include <map>
+
+#include "binaryninjaapi.h"
+#include "afuc.h"
+#include "afuc_view.h"
+
+using namespace BinaryNinja;
+using namespace std;
+
+/* ─── Data flow ────────────────────────────────────────────── */
+
+static const char* const s_base_reg_names[] = {
+	"SAVE_REGISTER_SMMU_INFO",
+	"SAVE_REGISTER_PRIV_NON_SECURE",
+	"SAVE_REGISTER_PRIV_SECURE",
+	"SAVE_REGISTER_NON_PRIV",
+	"SAVE_REGISTER_COUNTER",
+	"PREEMPT_COOKIE",
+};
+
+vector<uint32_t> afuc_context_base_regs(AfucGpuVer gpuver)
+{
+	vector<uint32_t> regs;
+	for (const char* name : s_base_reg_names) {
+		uint32_t off;
+		if (afuc_ctrl_reg_offset(gpuver, name, off))
+			regs.push_back(off);
+	}
+	return regs;
+}
+
+namespace {
+
+const uint32_t s_literal = ~1u;
+
+/* GPR contents: the value read from control register 'reg', plus 'off';
+ * or, for s_literal, the constant 'off' */
+struct Sym {
+	uint32_t reg;
+	int64_t off;
+
+	bool known() const { return reg < AFUC_CTRL_REG_COUNT; }
+	bool literal() const { return reg == s_literal; }
+	bool operator==(const Sym& o) const { return reg == o.reg && off == o.off; }
+};
+
+const Sym s_unknown = { ~0u, 0 };
+
+using State = array<Sym, 32>;
+
+struct Access {
+	uint32_t base_reg;
+	int64_t offset;
+	bool store;
+	bool run;             /* (rep) with post-increment: $rem dwords */
+	uint32_t value_reg;
+};
+
+}
+
+/* $00 reads as zero; the FIFOs and ports aren't tracked */
+static Sym read_reg(const State& st, uint32_t enc)
+{
+	if (enc == 0)
+		return { s_literal, 0 };
+	return enc < 0x1d ? st[enc] : s_unknown;
+}
+
+/* Apply 'insn' to 'st'; returns the memory access it makes, if tracked */
+static bool step(const AfucInsn& insn, State& st, Access& acc)
+{
+	auto get = [&](uint32_t enc) { return read_reg(st, enc); };
+	bool accessed = false;
+
+	/* new values, applied after every written register is cleared */
+	uint32_t set_reg[2] = { ~0u, ~0u };
+	Sym set_val[2];
+	auto assign = [&](int slot, uint32_t enc, Sym v) { set_reg[slot] = enc; set_val[slot] = v; };
+
+	switch (insn.op) {
+	case AFUC_CREAD:
+		if (insn.src1_enc == 0 && !insn.rep)
+			assign(0, insn.dst_enc, { insn.base, 0 });
+		break;
+	case AFUC_MOVI:
+		if (!insn.rep)
+			assign(0, insn.dst_enc, { s_literal, (int64_t)((uint64_t)insn.immed << insn.shift & 0xffffffff) });
+		break;
+	case AFUC_ADD:
+	case AFUC_SUB:
+	{
+		Sym a = get(insn.src1_enc);
+		if (insn.rep || !(a.known() || a.literal()))
+			break;
+		if (insn.is_immed)
+			a.off += insn.op == AFUC_ADD ? (int64_t)insn.immed : -(int64_t)insn.immed;
+		else if (insn.src2_enc != 0)
+			break;
+		assign(0, insn.dst_enc, a);
+		break;
+	}
+	case AFUC_OR:
+	{
+		Sym a = get(insn.src1_enc);
+		if (insn.rep)
+			break;
+		if (insn.is_immed ? insn.immed == 0 : insn.src2_enc == 0)
+			assign(0, insn.dst_enc, a);
+		else if (insn.is_immed && a.literal())
+			assign(0, insn.dst_enc, { s_literal, a.off | insn.immed });
+		break;
+	}
+	case AFUC_MOV:
+		if (!insn.rep && !insn.is_immed)
+			assign(0, insn.dst_enc, get(insn.src2_enc));
+		break;
+	case AFUC_LOAD:
+	case AFUC_STORE:
+	{
+		bool store = insn.op == AFUC_STORE;
+		uint32_t base_enc = store ? insn.src2_enc : insn.src1_enc;
+		Sym a = get(base_enc);
+		if (!a.known())
+			break;
+		a.off += insn.immed;
+
+		Sym v = store ? get(insn.src1_enc) : s_unknown;
+		acc = { a.reg, a.off, store, insn.rep && insn.preincrement,
+			v.known() && v.off == 0 ? v.reg : ~0u };
+		accessed = true;
+
+		/* a run leaves the base advanced by an unknown amount */
+		if (insn.preincrement && !insn.rep)
+			assign(1, base_enc, a);
+		break;
+	}
+	default:
+		break;
+	}
+
+	uint32_t dst = afuc_insn_dst_regs(insn);
+	for (uint32_t r = 1; r < 0x1d; r++)
+		if (dst & (1u << r))
+			st[r] = s_unknown;
+	for (int i = 0; i < 2; i++)
+		if (set_reg[i] > 0 && set_reg[i] < 0x1d)
+			st[set_reg[i]] = set_val[i];
+	return accessed;
+}
+
+/* Forward data flow from 'seeds' to a fixed point. The return of a call
+ * loses what the callee may write. */
+static void propagate(const vector<AfucInsn>& insns, const vector<uint8_t>& valid,
+                      const vector<AfucWordSuccs>& succs, const vector<uint32_t>& call_clobbers,
+                      const vector<uint32_t>& seeds, vector<State>& in, vector<uint8_t>& seen)
+{
+	size_t count = insns.size();
+	State empty;
+	empty.fill(s_unknown);
+	in.assign(count, empty);
+	seen.assign(count, 0);
+	vector<uint8_t> queued(count);
+	vector<uint32_t> work;
+	for (uint32_t i : seeds) {
+		if (i >= count || !valid[i] || seen[i])
+			continue;
+		seen[i] = queued[i] = 1;
+		work.push_back(i);
+	}
+
+	/* each register only ever goes from known to unknown, so this ends */
+	while (!work.empty()) {
+		uint32_t i = work.back();
+		work.pop_back();
+		queued[i] = 0;
+		if (!valid[i])
+			continue;
+
+		State st = in[i];
+		Access acc;
+		step(insns[i], st, acc);
+		for (int k = 0; k < 2; k++) {
+			uint32_t t = succs[i].s[k];
+			if (t == AFUC_NO_WORD)
+				continue;
+			State out = st;
+			if (k == 1 && call_clobbers[i])
+				for (uint32_t r = 1; r < 0x1d; r++)
+					if (call_clobbers[i] & (1u << r))
+						out[r] = s_unknown;
+
+			bool changed = !seen[t];
+			if (!seen[t]) {
+				in[t] = out;
+				seen[t] = 1;
+			} else {
+				for (size_t r = 0; r < out.size(); r++) {
+					if (in[t][r] == out[r] || in[t][r] == s_unknown)
+						continue;
+					in[t][r] = s_unknown;
+					changed = true;
+				}
+			}
+			if (changed && !queued[t]) {
+				queued[t] = 1;
+				work.push_back(t);
+			}
+		}
+	}
+}
+
+void afuc_context_records(AfucGpuVer gpuver, const AfucFlowMap& map,
+                          const vector<uint32_t>& base_regs,
+                          const vector<uint64_t>& entries,
+                          const std::map<uint64_t, uint32_t>& clobbers,
+                          vector<AfucContextRecord>& out)
+{
+	out.clear();
+	size_t count = map.words.size();
+	if (!count || base_regs.empty())
+		return;
+
+	vector<AfucInsn> insns(count);
+	vector<uint8_t> valid(count);
+	for (size_t i = 0; i < count; i++)
+		valid[i] = afuc_decode((const uint8_t*)&map.words[i], 4, map.base + i * 4, insns[i], gpuver);
+
+	vector<AfucWordSuccs> succs;
+	afuc_word_succs(gpuver, map, succs);
+
+	/* Registers lost across each call, on the word whose second successor
+	 * is the return (the delay slot, if there is one) */
+	vector<uint32_t> call_clobbers(count);
+	for (size_t i = 0; i < count; i++) {
+		if (!valid[i])
+			continue;
+		AfucFlow f = afuc_insn_flow(insns[i], map.base + i * 4);
+		if (f.kind != AFUC_FLOW_CALL)
+			continue;
+		auto it = clobbers.find(f.target);
+		size_t from = f.delay_slot && i + 1 < count ? i + 1 : i;
+		call_clobbers[from] = it != clobbers.end() ? it->second : ~0u;
+	}
+
+	vector<uint32_t> seeds;
+	for (uint64_t e : entries)
+		if (e >= map.base && (e - map.base) % 4 == 0)
+			seeds.push_back((uint32_t)((e - map.base) / 4));
+
+	/* Handlers installed with a constant write to PREEMPT_INSTR run on a
+	 * preemption rather than from the packet table; follow them too */
+	uint32_t preempt_ctrl = ~0u, preempt_sqe = ~0u;
+	afuc_ctrl_reg_offset(gpuver, "PREEMPT_INSTR", preempt_ctrl);
+	afuc_sqe_reg_offset("PREEMPT_INSTR", preempt_sqe);
+
+	vector<State> in;
+	vector<uint8_t> seen;
+	for (;;) {
+		propagate(insns, valid, succs, call_clobbers, seeds, in, seen);
+		size_t before = seeds.size();
+		for (size_t i = 0; i < count; i++) {
+			const AfucInsn& insn = insns[i];
+			if (!seen[i] || !valid[i] || insn.src2_enc != 0 ||
+			    !((insn.op == AFUC_CWRITE && insn.base == preempt_ctrl) ||
+			      (insn.op == AFUC_SWRITE && insn.base == preempt_sqe)))
+				continue;
+			/* a code word address, like a call target */
+			Sym v = read_reg(in[i], insn.src1_enc);
+			if (v.literal() && v.off > 0 && (uint64_t)v.off < count &&
+			    find(seeds.begin(), seeds.end(), (uint32_t)v.off) == seeds.end())
+				seeds.push_back((uint32_t)v.off);
+		}
+		if (seeds.size() == before)
+			break;
+	}
+
+	/* Collect the accesses made with the final states */
+	std::map<uint32_t, std::map<uint32_t, AfucRecordField>> fields;
+	for (size_t i = 0; i < count; i++) {
+		if (!seen[i] || !valid[i])
+			continue;
+		State st = in[i];
+		Access acc;
+		if (!step(insns[i], st, acc) || acc.offset < 0 || acc.offset > 0xffff ||
+		    find(base_regs.begin(), base_regs.end(), acc.base_reg) == base_regs.end())
+			continue;
+
+		auto it = fields[acc.base_reg].try_emplace((uint32_t)acc.offset,
+			AfucRecordField{ (uint32_t)acc.offset, 4, 0, 0, acc.value_reg, {} }).first;
+		AfucRecordField& f = it->second;
+		if (acc.run)
+			f.size = 0;
+		(acc.store ? f.stores : f.loads)++;
+		if (f.value_reg == ~0u)
+			f.value_reg = acc.value_reg;
+		f.addrs.push_back(map.base + i * 4);
+	}
+
+	for (auto& [reg, by_off] : fields) {
+		AfucContextRecord rec = { reg, {}, 0, 0, 0, false };
+		for (auto& [off, f] : by_off) {
+			if (f.size)
+				rec.size = max(rec.size, off + f.size);
+			else
+				rec.variable = true;
+			/* each offset once, however many paths reach it */
+			if (f.stores)
+				rec.bytes_saved += f.size;
+			if (f.loads)
+				rec.bytes_restored += f.size;
+			rec.fields.push_back(std::move(f));
+		}
+		out.push_back(std::move(rec));
+	}
+}
+
+/* ─── Binary Ninja glue ────────────────────────────────────── */
+
+static string lower(string s)
+{
+	for (char& c : s)
+		c = (char)tolower((unsigned char)c);
+	return s;
+}
+
+static string ctrl_name(AfucGpuVer gpuver, uint32_t reg)
+{
+	const char* name = afuc_ctrl_reg_name(gpuver, reg);
+	char buf[16];
+	if (!name) {
+		snprintf(buf, sizeof(buf), "CTRL_%03X", reg);
+		name = buf;
+	}
+	return name;
+}
+
+/* Member names: the saved control register where known */
+static vector<string> field_names(AfucGpuVer gpuver, const AfucContextRecord& rec)
+{
+	vector<string> names;
+	char buf[32];
+	for (const AfucRecordField& f : rec.fields) {
+		string n;
+		if (f.value_reg != ~0u)
+			n = lower(ctrl_name(gpuver, f.value_reg));
+		if (n.empty() || find(names.begin(), names.end(), n) != names.end()) {
+			snprintf(buf, sizeof(buf), f.size ? "field_%03x" : "run_%03x", f.offset);
+			n = buf;
+		}
+		names.push_back(n);
+	}
+	return names;
+}
+
+static void define_record_type(BinaryView* view, const string& name,
+                               const AfucContextRecord& rec, const vector<string>& names)
+{
+	/* (rep) runs have no fixed size and stay out of the type */
+	StructureBuilder sb;
+	for (size_t i = 0; i < rec.fields.size(); i++)
+		if (rec.fields[i].size)
+			sb.AddMemberAtOffset(Type::IntegerType(4, false), names[i], rec.fields[i].offset);
+	sb.SetWidth(rec.size);
+	view->DefineType("afuc:ctx:" + name, QualifiedName(name), Type::StructureType(sb.Finalize()));
+}
+
+static void show_context_records(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	if (!afuc_view_gpuver(view, gpuver))
+		return;
+
+	Ref<BinaryView> ref = view;
+	WorkerEnqueue([=]() {
+		Ref<BackgroundTask> task = new BackgroundTask("Recovering AFUC context records...", false);
+		shared_ptr<const AfucFlowMap> map = afuc_view_flow_map(ref);
+		if (!map) {
+			task->Finish();
+			return;
+		}
+
+		/* the bootstrap and every packet handler */
+		vector<uint64_t> entries = { map->base };
+		if (Ref<Metadata> md = ref->QueryMetadata("afuc.packet_table"); md && md->IsArray())
+			for (uint64_t h : md->GetUnsignedIntegerList())
+				entries.push_back(h);
+
+		std::map<uint64_t, uint32_t> clobbers;
+		for (const Ref<Function>& f : ref->GetAnalysisFunctionList()) {
+			Ref<Metadata> md = f->QueryMetadata("afuc.clobbers");
+			if (md && md->IsUnsignedInteger())
+				clobbers[f->GetStart()] = (uint32_t)md->GetUnsignedInteger();
+		}
+
+		vector<AfucContextRecord> records;
+		afuc_context_records(gpuver, *map, afuc_context_base_regs(gpuver), entries, clobbers, records);
+
+		string report = "# AFUC preemption context records\n\n";
+		vector<Ref<Metadata>> summary;
+		uint32_t total_saved = 0, total_restored = 0;
+		char buf[160];
+
+		for (const AfucContextRecord& rec : records) {
+			string base = ctrl_name(gpuver, rec.base_reg);
+			string type = "afuc_ctx_" + lower(base);
+			vector<string> names = field_names(gpuver, rec);
+			define_record_type(ref, type, rec, names);
+			total_saved += rec.bytes_saved;
+			total_restored += rec.bytes_restored;
+
+			snprintf(buf, sizeof(buf), "## `%s` (@%s)\n\n%u bytes%s, %u saved, %u restored\n\n",
+				type.c_str(), base.c_str(), rec.size, rec.variable ? " + runs" : "",
+				rec.bytes_saved, rec.bytes_restored);
+			report += buf;
+			report += "| Offset | Field | Size | Stores | Loads | Accessed at |\n|---|---|---|---|---|---|\n";
+
+			for (size_t i = 0; i < rec.fields.size(); i++) {
+				const AfucRecordField& f = rec.fields[i];
+				string at;
+				for (uint64_t a : f.addrs) {
+					snprintf(buf, sizeof(buf), "%s0x%" PRIx64, at.empty() ? "" : " ", a);
+					at += buf;
+
+					/* comment the access like a payload read */
+					if (ref->GetCommentForAddress(a).empty())
+						ref->SetCommentForAddress(a, type + "." + names[i]);
+				}
+				snprintf(buf, sizeof(buf), "| 0x%03x | %s | %s | %u | %u | ", f.offset,
+					names[i].c_str(), f.size ? "4" : "$rem dwords", f.stores, f.loads);
+				report += buf + at + " |\n";
+			}
+			report += "\n";
+
+			std::map<string, Ref<Metadata>> kv;
+			kv["base"] = new Metadata(base);
+			kv["size"] = new Metadata((uint64_t)rec.size);
+			kv["saved"] = new Metadata((uint64_t)rec.bytes_saved);
+			kv["restored"] = new Metadata((uint64_t)rec.bytes_restored);
+			kv["fields"] = new Metadata((uint64_t)rec.fields.size());
+			kv["variable"] = new Metadata(rec.variable);
+			summary.push_back(new Metadata(kv));
+		}
+		ref->StoreMetadata("afuc.context_records", new Metadata(summary), true);
+
+		if (records.empty())
+			report += "No accesses through the save-area registers were found.\n";
+		snprintf(buf, sizeof(buf), "\n%zu records, %u bytes saved, %u bytes restored\n",
+			records.size(), total_saved, total_restored);
+		report += buf;
+
+		task->Finish();
+		ShowMarkdownReport("AFUC Context Records", report, report);
+	}, "AFUC context records");
+}
+
+static bool has_base_regs(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	return afuc_view_gpuver(view, gpuver) && !afuc_context_base_regs(gpuver).empty();
+}
+
+void afuc_register_preempt_commands()
+{
+	PluginCommand::Register("AFUC\\Preemption Context Records",
+		"Recover the context-save record layouts and the bytes each preemption moves",
+		show_context_records, has_base_regs);
+}
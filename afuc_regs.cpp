@@ -8,6 +8,12 @@
 
 #include "afuc.h"
 #include <cstddef>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+
+using namespace std;
 
 /* ─── Lookup table entry ──────────────────────────────────── */
 
@@ -200,42 +206,181 @@ static const RegEntry s_a7xx_pipe[] = {
 	{ 0xeb, "EVENT_TS_DATA" },
 };
 
-/* ─── Generic linear-scan lookup ──────────────────────────── */
+/* ─── Per-firmware overlays ───────────────────────────────── */
+
+#define COUNT(tbl) (sizeof(tbl)/sizeof(tbl[0]))
+
+/*
+ * Differences from the generation base for a given firmware ID. An entry
+ * with a null name removes the base register (not present on that chip).
+ */
+
+/* a630 / a650: LPAC arrived with a660 */
+static const RegEntry s_a6xx_no_lpac_ctrl[] = {
+	{ 0x04c, nullptr },   /* DRAW_STATE_SET_HDR_LPAC */
+	{ 0x04f, nullptr },   /* DRAW_STATE_SET_BASE_LPAC */
+};
+
+struct RegOverlay {
+	AfucGpuVer gpuver;
+	uint32_t fw_id;
+	const RegEntry* ctrl;
+	size_t ctrl_count;
+	const RegEntry* pipe;
+	size_t pipe_count;
+};
+
+static const RegOverlay s_overlays[] = {
+	{ AFUC_A6XX, 0x6ee, s_a6xx_no_lpac_ctrl, COUNT(s_a6xx_no_lpac_ctrl), nullptr, 0 },  /* a630 */
+	{ AFUC_A6XX, 0x6dc, s_a6xx_no_lpac_ctrl, COUNT(s_a6xx_no_lpac_ctrl), nullptr, 0 },  /* a650 */
+};
+
+/* ─── Flattened tables ────────────────────────────────────── */
 
-static const char* lookup(const RegEntry* table, size_t count, uint32_t offset)
+struct BaseTables {
+	const RegEntry* ctrl;
+	size_t ctrl_count;
+	const RegEntry* pipe;
+	size_t pipe_count;
+};
+
+static BaseTables base_tables(AfucGpuVer gpuver)
+{
+	switch (gpuver) {
+	case AFUC_A5XX: return { s_a5xx_ctrl, COUNT(s_a5xx_ctrl), nullptr, 0 };
+	case AFUC_A7XX: return { s_a7xx_ctrl, COUNT(s_a7xx_ctrl), s_a7xx_pipe, COUNT(s_a7xx_pipe) };
+	default:        return { s_a6xx_ctrl, COUNT(s_a6xx_ctrl), s_a6xx_pipe, COUNT(s_a6xx_pipe) };
+	}
+}
+
+static void apply(const char** dst, size_t size, const RegEntry* src, size_t count)
 {
 	for (size_t i = 0; i < count; i++) {
-		if (table[i].offset == offset)
-			return table[i].name;
+		if (src[i].offset < size)
+			dst[src[i].offset] = src[i].name;
 	}
-	return nullptr;
 }
 
-#define LOOKUP(tbl, off) lookup(tbl, sizeof(tbl)/sizeof(tbl[0]), off)
+static unsigned gen_index(AfucGpuVer gpuver)
+{
+	switch (gpuver) {
+	case AFUC_A5XX: return 0;
+	case AFUC_A7XX: return 2;
+	default:        return 1;
+	}
+}
+
+static mutex s_tables_lock;
+static map<pair<unsigned, uint32_t>, unique_ptr<AfucRegTable>> s_tables;
+
+const AfucRegTable* afuc_reg_table(AfucGpuVer gpuver, uint32_t fw_id)
+{
+	unsigned gen = gen_index(gpuver);
+
+	/* Only IDs with an overlay get their own table */
+	const RegOverlay* ov = nullptr;
+	for (const RegOverlay& o : s_overlays) {
+		if (gen_index(o.gpuver) == gen && o.fw_id == fw_id)
+			ov = &o;
+	}
+	if (!ov)
+		fw_id = 0;
+
+	lock_guard<mutex> lock(s_tables_lock);
+	unique_ptr<AfucRegTable>& tab = s_tables[{ gen, fw_id }];
+	if (tab)
+		return tab.get();
+
+	tab = make_unique<AfucRegTable>();
+	tab->gpuver = gpuver;
+	tab->fw_id = fw_id;
+	BaseTables base = base_tables(gpuver);
+	apply(tab->ctrl, AFUC_CTRL_REG_COUNT, base.ctrl, base.ctrl_count);
+	apply(tab->pipe, AFUC_PIPE_REG_COUNT, base.pipe, base.pipe_count);
+	if (ov) {
+		apply(tab->ctrl, AFUC_CTRL_REG_COUNT, ov->ctrl, ov->ctrl_count);
+		apply(tab->pipe, AFUC_PIPE_REG_COUNT, ov->pipe, ov->pipe_count);
+	}
+	for (uint32_t i = 0; i < AFUC_CTRL_REG_COUNT; i++) {
+		if (tab->ctrl[i])
+			tab->ctrl_offsets.emplace(tab->ctrl[i], i);
+	}
+	return tab.get();
+}
+
+static const AfucRegTable* base_table(AfucGpuVer gpuver)
+{
+	static const AfucRegTable* const s_base[3] = {
+		afuc_reg_table(AFUC_A5XX, 0), afuc_reg_table(AFUC_A6XX, 0), afuc_reg_table(AFUC_A7XX, 0),
+	};
+	return s_base[gen_index(gpuver)];
+}
 
 /* ─── Public API ──────────────────────────────────────────── */
 
+const char* afuc_ctrl_reg_name(const AfucRegTable* regs, uint32_t offset)
+{
+	return offset < AFUC_CTRL_REG_COUNT ? regs->ctrl[offset] : nullptr;
+}
+
 const char* afuc_ctrl_reg_name(AfucGpuVer gpuver, uint32_t offset)
 {
-	switch (gpuver) {
-	case AFUC_A5XX: return LOOKUP(s_a5xx_ctrl, offset);
-	case AFUC_A6XX: return LOOKUP(s_a6xx_ctrl, offset);
-	case AFUC_A7XX: return LOOKUP(s_a7xx_ctrl, offset);
-	default:        return nullptr;
-	}
+	return afuc_ctrl_reg_name(base_table(gpuver), offset);
 }
 
 const char* afuc_sqe_reg_name(uint32_t offset)
 {
-	return LOOKUP(s_sqe_regs, offset);
+	for (const RegEntry& e : s_sqe_regs) {
+		if (e.offset == offset)
+			return e.name;
+	}
+	return nullptr;
 }
 
-const char* afuc_pipe_reg_name(AfucGpuVer gpuver, uint32_t offset)
+bool afuc_ctrl_reg_offset(const AfucRegTable* regs, const char* name, uint32_t& offset)
 {
-	switch (gpuver) {
-	case AFUC_A5XX: return nullptr; /* a5xx pipe regs not documented */
-	case AFUC_A6XX: return LOOKUP(s_a6xx_pipe, offset);
-	case AFUC_A7XX: return LOOKUP(s_a7xx_pipe, offset);
-	default:        return nullptr;
+	auto it = regs->ctrl_offsets.find(name);
+	if (it == regs->ctrl_offsets.end())
+		return false;
+	offset = it->second;
+	return true;
+}
+
+bool afuc_ctrl_reg_offset(AfucGpuVer gpuver, const char* name, uint32_t& offset)
+{
+	return afuc_ctrl_reg_offset(base_table(gpuver), name, offset);
+}
+
+bool afuc_sqe_reg_offset(const char* name, uint32_t& offset)
+{
+	for (const RegEntry& e : s_sqe_regs) {
+		if (strcmp(e.name, name) == 0) {
+			offset = e.offset;
+			return true;
+		}
 	}
+	return false;
+}
+
+bool afuc_sds_regs(AfucGpuVer gpuver, uint32_t (&offsets)[3])
+{
+	uint32_t base, dwords;
+	if (!afuc_ctrl_reg_offset(gpuver, "SDS_BASE", base) ||
+	    !afuc_ctrl_reg_offset(gpuver, "SDS_DWORDS", dwords))
+		return false;
+	offsets[0] = base;
+	offsets[1] = base + 1;
+	offsets[2] = dwords;
+	return true;
+}
+
+const char* afuc_pipe_reg_name(const AfucRegTable* regs, uint32_t offset)
+{
+	/* a5xx pipe regs not documented: its base table is empty */
+	return offset < AFUC_PIPE_REG_COUNT ? regs->pipe[offset] : nullptr;
+}
+
+const char* afuc_pipe_reg_name(AfucGpuVer gpuver, uint32_t offset)
+{
+	return afuc_pipe_reg_name(base_table(gpuver), offset);
 }
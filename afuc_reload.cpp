@@ -0,0 +1,420 @@
+/*
+ * Watch-and-reload: apply a rebuilt firmware image to the open view in
+ * place instead of reopening it.
+ *
+ * The new image is diffed word by word against the loaded one. Words
+ * that only differ because a branch or call target moved with the code
+ * count as unchanged, so an insertion becomes one splice plus a shift of
+ * everything after it. Only the changed words are written; symbols,
+ * functions and comments in the shifted region move with it.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <thread>
+
+#include "binaryninjaapi.h"
+#include "afuc.h"
+#include "afuc_view.h"
+
+using namespace BinaryNinja;
+using namespace std;
+
+/* ─── Image diff ───────────────────────────────────────────── */
+
+/*
+ * Target of a direct branch or call, in words relative to the start of
+ * the image; -1 if 'w' isn't one. Relative branches are offset from the
+ * next word, call/bl/jumpa are absolute code words (image word 1 is code
+ * word 0, which cancels out when comparing).
+ */
+static int64_t word_target(uint32_t w, size_t index)
+{
+	switch (w >> 26) {
+	case 0x30: case 0x31: case 0x32: case 0x33:
+		return (int64_t)index + 1 + (int16_t)(w & 0xffff);
+	case 0x35: case 0x38: case 0x39:
+		return (int64_t)(w & 0x03ffffff) + 1;
+	default:
+		return -1;
+	}
+}
+
+/* Same instruction, allowing for a target that moved with the code */
+static bool same_word(uint32_t a, size_t ia, uint32_t b, size_t ib, int64_t shift)
+{
+	if (a == b)
+		return true;
+	if ((a >> 26) != (b >> 26))
+		return false;
+	int64_t ta = word_target(a, ia), tb = word_target(b, ib);
+	if (ta < 0 || tb < 0)
+		return false;
+	uint32_t field = (a >> 26) >= 0x35 ? 0xfc000000 : 0xffff0000;
+	return (a & field) == (b & field) && (tb == ta || tb == ta + shift);
+}
+
+void afuc_diff_images(const uint32_t* old_words, size_t old_count,
+                      const uint32_t* new_words, size_t new_count, AfucImageDiff& diff)
+{
+	diff = AfucImageDiff();
+	diff.shift = (int64_t)new_count - (int64_t)old_count;
+	size_t common = min(old_count, new_count);
+
+	if (!diff.shift) {
+		diff.prefix = common;
+		for (size_t i = 0; i < common; i++)
+			if (old_words[i] != new_words[i])
+				diff.patched.push_back(i);
+		return;
+	}
+
+	/* the header word never moves */
+	if (common) {
+		diff.prefix = 1;
+		if (old_words[0] != new_words[0])
+			diff.patched.push_back(0);
+	}
+	while (diff.prefix < common &&
+	       same_word(old_words[diff.prefix], diff.prefix, new_words[diff.prefix], diff.prefix, diff.shift))
+		diff.prefix++;
+	while (diff.prefix + diff.suffix < common) {
+		size_t io = old_count - 1 - diff.suffix, in = new_count - 1 - diff.suffix;
+		if (!same_word(old_words[io], io, new_words[in], in, diff.shift))
+			break;
+		diff.suffix++;
+	}
+
+	/* matched words whose encoding still changed (their target moved) */
+	for (size_t i = 1; i < diff.prefix; i++)
+		if (old_words[i] != new_words[i])
+			diff.patched.push_back(i);
+	for (size_t k = 0; k < diff.suffix; k++) {
+		size_t io = old_count - 1 - k, in = new_count - 1 - k;
+		if (old_words[io] != new_words[in])
+			diff.patched.push_back(in);
+	}
+	sort(diff.patched.begin(), diff.patched.end());
+}
+
+/* ─── Applying a reload ────────────────────────────────────── */
+
+namespace {
+
+struct MovedFunction {
+	uint64_t start;
+	bool user;                          /* made by the user, not analysis */
+	Ref<Type> type;                     /* user-set type, else null */
+	string comment;
+	vector<pair<uint64_t, string>> comments;
+	map<string, Ref<Metadata>> metadata;    /* user (non-auto) entries */
+};
+
+struct MovedSymbol {
+	uint64_t addr;
+	string name;
+	BNSymbolType type;
+	bool is_auto;
+};
+
+}
+
+bool afuc_reload_image(BinaryView* view, const vector<uint32_t>& image)
+{
+	AfucGpuVer gpuver;
+	Ref<BinaryView> parent = view->GetParentView();
+	if (!parent || !afuc_view_gpuver(view, gpuver) || image.size() < 2)
+		return false;
+
+	vector<uint32_t> old(parent->GetLength() / 4);
+	if (!old.empty())
+		parent->Read(old.data(), 0, old.size() * 4);
+	if (old.size() < 2 || (((old[1] ^ image[1]) >> 12) & 0xfff)) {
+		LogWarn("AFUC: firmware ID changed, reopen the file instead of reloading");
+		return false;
+	}
+
+	AfucImageDiff diff;
+	afuc_diff_images(old.data(), old.size(), image.data(), image.size(), diff);
+	if (!diff.shift && diff.patched.empty())
+		return true;
+
+	auto t0 = chrono::steady_clock::now();
+	Ref<Platform> plat = view->GetDefaultPlatform();
+	set<uint64_t> changed;   /* code addresses whose word changed */
+
+	/* every write would walk the cached handlers; do that once below */
+	afuc_hold_handler_metrics(view, true);
+
+	if (diff.shift) {
+		/* Image word i is code address (i - 1) * 4 */
+		size_t old_mid = old.size() - diff.suffix - diff.prefix;
+		size_t new_mid = image.size() - diff.suffix - diff.prefix;
+		uint64_t moved_from = (old.size() - diff.suffix - 1) * 4;
+		int64_t delta = diff.shift * 4;
+
+		/* Remember what lives in the shifted region before it moves */
+		vector<MovedFunction> funcs;
+		for (const Ref<Function>& f : view->GetAnalysisFunctionList()) {
+			if (f->GetStart() < moved_from)
+				continue;
+			MovedFunction mf;
+			mf.start = f->GetStart();
+			mf.user = !f->WasAutomaticallyDiscovered();
+			if (f->HasUserType())
+				mf.type = f->GetType();
+			mf.comment = f->GetComment();
+			for (uint64_t a : f->GetCommentedAddresses())
+				mf.comments.push_back({ a, f->GetCommentForAddress(a) });
+			Ref<Metadata> md = f->GetMetadata(), md_auto = f->GetAutoMetadata();
+			if (md && md->IsKeyValueStore()) {
+				mf.metadata = md->GetKeyValueStore();
+				if (md_auto && md_auto->IsKeyValueStore())
+					for (const auto& [key, value] : md_auto->GetKeyValueStore())
+						mf.metadata.erase(key);
+			}
+			funcs.push_back(std::move(mf));
+			view->RemoveAnalysisFunction(f);
+		}
+		vector<MovedSymbol> syms;
+		for (const Ref<Symbol>& s : view->GetSymbols()) {
+			if (s->GetAddress() < moved_from)
+				continue;
+			syms.push_back({ s->GetAddress(), s->GetShortName(), s->GetType(), s->IsAutoDefined() });
+			if (s->IsAutoDefined())
+				view->UndefineAutoSymbol(s);
+			else
+				view->UndefineUserSymbol(s);
+		}
+		vector<pair<uint64_t, string>> comments;
+		for (uint64_t a = moved_from; a < (old.size() - 1) * 4; a += 4) {
+			string c = view->GetCommentForAddress(a);
+			if (!c.empty()) {
+				comments.push_back({ a, c });
+				view->SetCommentForAddress(a, "");
+			}
+		}
+
+		/* Splice the changed middle into the file and resize the code */
+		parent->Remove(diff.prefix * 4, old_mid * 4);
+		parent->Insert(diff.prefix * 4, DataBuffer(&image[diff.prefix], new_mid * 4));
+		uint64_t old_len = (old.size() - 1) * 4, new_len = (image.size() - 1) * 4;
+		view->RemoveAutoSection("code");
+		view->RemoveAutoSegment(0, old_len);
+		view->AddAutoSegment(0, new_len, 4, new_len, SegmentExecutable | SegmentReadable);
+		view->AddAutoSection("code", 0, new_len, ReadOnlyCodeSectionSemantics);
+		for (size_t i = diff.prefix; i < diff.prefix + new_mid; i++)
+			changed.insert((i - 1) * 4);
+
+		for (const MovedSymbol& s : syms) {
+			Ref<Symbol> sym = new Symbol(s.type, s.name, s.addr + delta);
+			if (s.is_auto)
+				view->DefineAutoSymbol(sym);
+			else
+				view->DefineUserSymbol(sym);
+		}
+		for (const auto& [a, c] : comments)
+			view->SetCommentForAddress(a + delta, c);
+		size_t user_funcs = 0;
+		for (const MovedFunction& mf : funcs) {
+			if (!plat)
+				break;
+			Ref<Function> f;
+			if (mf.user) {
+				f = view->CreateUserFunction(plat, mf.start + delta);
+				user_funcs++;
+			} else {
+				view->AddFunctionForAnalysis(plat, mf.start + delta);
+				f = view->GetAnalysisFunction(plat, mf.start + delta);
+			}
+			if (!f)
+				continue;
+			if (mf.type)
+				f->SetUserType(mf.type);
+			if (!mf.comment.empty())
+				f->SetComment(mf.comment);
+			for (const auto& [a, c] : mf.comments)
+				f->SetCommentForAddress(a + delta, c);
+			for (const auto& [key, value] : mf.metadata)
+				f->StoreMetadata(key, value, false);
+		}
+		if (user_funcs)
+			LogWarn("AFUC: %zu user functions moved with the code; their names, types, comments "
+				"and metadata were kept, but variable names and types, tags and highlights "
+				"inside them were not", user_funcs);
+	}
+
+	/* One write, and one change notification, per run of adjacent words */
+	for (size_t k = 0; k < diff.patched.size();) {
+		size_t i = diff.patched[k];
+		if (i == 0) {
+			parent->Write(0, &image[0], 4);
+			k++;
+			continue;
+		}
+		size_t n = 1;
+		while (k + n < diff.patched.size() && diff.patched[k + n] == i + n)
+			n++;
+		view->Write((i - 1) * 4, &image[i], n * 4);
+		for (size_t j = i; j < i + n; j++)
+			changed.insert((j - 1) * 4);
+		k += n;
+	}
+
+	/* Only functions containing a changed word are redone */
+	set<uint64_t> redone;
+	for (uint64_t addr : changed)
+		for (const Ref<Function>& f : view->GetAnalysisFunctionsContainingAddress(addr))
+			if (redone.insert(f->GetStart()).second)
+				f->Reanalyze();
+	afuc_hold_handler_metrics(view, false);
+	afuc_invalidate_handler_metrics(view, changed, diff.shift != 0);
+
+	afuc_apply_packet_table(view, plat, gpuver, image, afuc_view_on_demand(view));
+	afuc_apply_nop_metadata(view, image);
+	view->UpdateAnalysis();
+
+	auto ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - t0).count();
+	LogInfo("AFUC: reloaded firmware: %zu words changed, shifted %+lld words, "
+		"%zu functions reanalyzed (%lld ms)",
+		changed.size(), (long long)diff.shift, redone.size(), (long long)ms);
+	return true;
+}
+
+/* ─── File watcher ─────────────────────────────────────────── */
+
+static const chrono::milliseconds s_poll_interval(1000);
+
+class AfucFileWatcher
+{
+	Ref<BinaryView> m_view;
+	string m_path;
+	mutex m_lock;
+	condition_variable m_cv;
+	bool m_stop = false;
+	shared_ptr<atomic<bool>> m_stopped = make_shared<atomic<bool>>(false);
+	thread m_thread;
+
+	static bool stamp(const string& path, filesystem::file_time_type& time, uintmax_t& size)
+	{
+		error_code ec;
+		time = filesystem::last_write_time(path, ec);
+		if (ec)
+			return false;
+		size = filesystem::file_size(path, ec);
+		return !ec;
+	}
+
+	void run()
+	{
+		filesystem::file_time_type seen_time, pending_time;
+		uintmax_t seen_size = 0, pending_size = 0;
+		bool pending = false;
+		stamp(m_path, seen_time, seen_size);
+
+		unique_lock<mutex> lock(m_lock);
+		while (!m_cv.wait_for(lock, s_poll_interval, [this] { return m_stop; })) {
+			filesystem::file_time_type t;
+			uintmax_t size;
+			if (!stamp(m_path, t, size) || (t == seen_time && size == seen_size)) {
+				pending = false;
+				continue;
+			}
+
+			/* Act once the file has been stable for a whole interval, so a
+			 * build that is still writing isn't picked up half done */
+			if (!pending || t != pending_time || size != pending_size) {
+				pending = true;
+				pending_time = t;
+				pending_size = size;
+				continue;
+			}
+			pending = false;
+			seen_time = t;
+			seen_size = size;
+
+			vector<uint32_t> image(size / 4);
+			ifstream in(m_path, ios::binary);
+			if (!in.read((char*)image.data(), image.size() * 4))
+				continue;
+
+			apply(m_view, m_path, move(image), m_stopped);
+		}
+	}
+
+	/* Analysis state belongs to the main thread, and one reload is one undo step */
+	static void apply(Ref<BinaryView> view, const string& path, vector<uint32_t> image,
+	                  shared_ptr<atomic<bool>> stopped)
+	{
+		ExecuteOnMainThread([=]() {
+			if (*stopped)
+				return;
+			string id = view->BeginUndoActions();
+			if (afuc_reload_image(view, image)) {
+				view->CommitUndoActions(id);
+				return;
+			}
+			view->RevertUndoActions(id);
+			LogWarn("AFUC: could not apply %s, reopen it to pick up the changes", path.c_str());
+		});
+	}
+
+public:
+	AfucFileWatcher(BinaryView* view, const string& path) : m_view(view), m_path(path)
+	{
+		m_thread = thread([this] { run(); });
+	}
+
+	~AfucFileWatcher()
+	{
+		*m_stopped = true;
+		{
+			lock_guard<mutex> lock(m_lock);
+			m_stop = true;
+		}
+		m_cv.notify_all();
+		m_thread.join();
+	}
+};
+
+shared_ptr<AfucFileWatcher> afuc_watch_file(BinaryView* view, const string& path)
+{
+	error_code ec;
+	if (!filesystem::exists(path, ec))
+		return nullptr;
+	return make_shared<AfucFileWatcher>(view, path);
+}
+
+/* ─── Plugin commands ──────────────────────────────────────── */
+
+static void toggle_watch(BinaryView* view)
+{
+	bool watching;
+	if (!afuc_toggle_watch(view, watching)) {
+		LogError("AFUC: the firmware file behind this view can't be watched");
+		return;
+	}
+	LogInfo("AFUC: %s %s", watching ? "watching" : "stopped watching",
+		view->GetFile()->GetOriginalFilename().c_str());
+}
+
+static bool is_afuc_view(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	return afuc_view_gpuver(view, gpuver) && view->GetParentView();
+}
+
+void afuc_register_reload_commands()
+{
+	PluginCommand::Register("AFUC\\Watch Firmware File",
+		"Toggle reloading this firmware in place whenever the file on disk is rebuilt",
+		toggle_watch, is_afuc_view);
+}
@@ -0,0 +1,79 @@
+/*
+ * SIMD word scan shared by the pattern search and the metadata sweeps.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define AFUC_SCAN_SSE2 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define AFUC_SCAN_NEON 1
+#endif
+
+/*
+ * Prefilter: call 'fn(i)' for every i with (words[i] & mask) == value.
+ * Candidates are rare, so the vector loop only has to be fast at
+ * rejecting whole lanes.
+ */
+template <typename Fn>
+inline void afuc_scan_masked(const uint32_t* words, size_t count, uint32_t mask,
+                             uint32_t value, Fn fn)
+{
+	size_t i = 0;
+
+#if defined(__AVX2__)
+	const __m256i vm8 = _mm256_set1_epi32((int)mask);
+	const __m256i vv8 = _mm256_set1_epi32((int)value);
+	for (; i + 8 <= count; i += 8) {
+		__m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+		__m256i eq = _mm256_cmpeq_epi32(_mm256_and_si256(w, vm8), vv8);
+		unsigned bits = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(eq));
+		for (unsigned b = 0; bits; b++, bits >>= 1) {
+			if (bits & 1)
+				fn(i + b);
+		}
+	}
+#endif
+
+#if defined(AFUC_SCAN_SSE2)
+	const __m128i vm = _mm_set1_epi32((int)mask);
+	const __m128i vv = _mm_set1_epi32((int)value);
+	for (; i + 4 <= count; i += 4) {
+		__m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i));
+		__m128i eq = _mm_cmpeq_epi32(_mm_and_si128(w, vm), vv);
+		unsigned bits = (unsigned)_mm_movemask_ps(_mm_castsi128_ps(eq));
+		for (unsigned b = 0; bits; b++, bits >>= 1) {
+			if (bits & 1)
+				fn(i + b);
+		}
+	}
+#elif defined(AFUC_SCAN_NEON)
+	const uint32x4_t vm = vdupq_n_u32(mask);
+	const uint32x4_t vv = vdupq_n_u32(value);
+	for (; i + 4 <= count; i += 4) {
+		uint32x4_t eq = vceqq_u32(vandq_u32(vld1q_u32(words + i), vm), vv);
+		if (vmaxvq_u32(eq) == 0)
+			continue;
+		uint32_t lanes[4];
+		vst1q_u32(lanes, eq);
+		for (unsigned b = 0; b < 4; b++) {
+			if (lanes[b])
+				fn(i + b);
+		}
+	}
+#endif
+
+	for (; i < count; i++) {
+		if ((words[i] & mask) == value)
+			fn(i);
+	}
+}
@@ -0,0 +1,870 @@
+/*
+ * AFUC instruction pattern search.
+ *
+ * Compiles a small wildcard pattern language over AFUC assembly into
+ * per-word mask/value pairs, scans code with SIMD and verifies the
+ * candidates against the decoder.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <cctype>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "binaryninjaapi.h"
+#include "afuc.h"
+#include "afuc_scan.h"
+#include "afuc_view.h"
+
+using namespace BinaryNinja;
+using namespace std;
+
+/* ─── Encoding layouts ─────────────────────────────────────── */
+
+/*
+ * Operand form characters, in textual (disassembly) order:
+ *   d = dst reg    s = src1 reg   t = src2 reg
+ *   i = immediate  I = immediate with optional '<< shift'
+ *   b = bit        l / h = bitfield lo / hi
+ *   C = control register offset   Q = SQE register offset
+ *   T = branch / call target      [ ] = memory operand brackets
+ */
+
+struct FieldPos {
+	AfucPatField field;
+	uint8_t shift;
+	uint8_t width;
+};
+
+struct EncDesc {
+	AfucOp op;
+	uint32_t mask;
+	uint32_t value;
+	const char* form;
+	FieldPos pos[6];
+};
+
+#define F(f, sh, w) { AFUC_PF_##f, sh, w }
+
+static const FieldPos s_alu2_pos[6] = {
+	F(DST, 11, 5), F(SRC1, 21, 5), F(SRC2, 16, 5),
+	F(REP, 26, 1), F(PEEK, 8, 1), F(XMOV, 9, 2),
+};
+
+static void add_enc(vector<EncDesc>& v, AfucOp op, uint32_t mask,
+                    uint32_t value, const char* form,
+                    std::initializer_list<FieldPos> pos)
+{
+	EncDesc e = { op, mask, value, form, {} };
+	size_t n = 0;
+	for (const FieldPos& p : pos)
+		e.pos[n++] = p;
+	for (; n < 6; n++)
+		e.pos[n] = { AFUC_PF_DST, 0, 0 };
+	v.push_back(e);
+}
+
+static void build_encodings(AfucGpuVer gpuver, vector<EncDesc>& v)
+{
+	for (const AfucIsaDesc& d : afuc_isa) {
+		if (d.form != AFUC_FORM_ALU && d.form != AFUC_FORM_ALU1)
+			continue;
+		AfucOp op = d.op;
+		bool one_src = (d.form == AFUC_FORM_ALU1);
+		uint32_t opc;
+
+		if (afuc_alu_opcode(gpuver, op, false, opc)) {
+			EncDesc e = { op, 0xf800001f, (0x13u << 27) | opc,
+			              one_src ? "dt" : "dst", {} };
+			memcpy(e.pos, s_alu2_pos, sizeof(e.pos));
+			v.push_back(e);
+
+			/* mov $dst, $src is "or $dst, $00, $src" */
+			if (op == AFUC_OR) {
+				e.op = AFUC_MOV;
+				e.mask |= 0x1fu << 21;
+				e.form = "dt";
+				v.push_back(e);
+			}
+		}
+
+		if (afuc_alu_opcode(gpuver, op, true, opc)) {
+			add_enc(v, op, 0xf8000000, opc << 27, one_src ? "di" : "dsi",
+				{ F(DST, 16, 5), F(SRC1, 21, 5), F(IMMED, 0, 16), F(REP, 26, 1) });
+		}
+	}
+
+	if (gpuver >= AFUC_A7XX) {
+		static const AfucOp shift_ops[] = { AFUC_SHL, AFUC_USHR, AFUC_ISHR, AFUC_ROT };
+		for (uint32_t sel = 2; sel <= 5; sel++) {
+			add_enc(v, shift_ops[sel - 2], 0xf800f000, (0x12u << 27) | (sel << 12), "dsi",
+				{ F(DST, 16, 5), F(SRC1, 21, 5), F(IMMED, 0, 12), F(REP, 26, 1) });
+		}
+		add_enc(v, AFUC_UBFX, 0xf800f000, (0x12u << 27) | (0x7 << 12), "dslh",
+			{ F(DST, 16, 5), F(SRC1, 21, 5), F(LO, 0, 5), F(HI, 5, 5), F(REP, 26, 1) });
+		add_enc(v, AFUC_BFI, 0xf800f000, (0x12u << 27) | (0x8 << 12), "dslh",
+			{ F(DST, 16, 5), F(SRC1, 21, 5), F(LO, 0, 5), F(HI, 5, 5), F(REP, 26, 1) });
+	}
+
+	add_enc(v, AFUC_SETBIT, 0xf8000001, (0x12u << 27) | 1, "dsb",
+		{ F(DST, 16, 5), F(SRC1, 21, 5), F(BIT, 1, 5), F(REP, 26, 1) });
+	add_enc(v, AFUC_CLRBIT, 0xf8000001, (0x12u << 27), "dsb",
+		{ F(DST, 16, 5), F(SRC1, 21, 5), F(BIT, 1, 5), F(REP, 26, 1) });
+
+	add_enc(v, AFUC_MOVI, 0xf8000000,
+		(gpuver >= AFUC_A7XX ? 0x0eu : 0x11u) << 27, "dI",
+		{ F(DST, 16, 5), F(SHIFT, 21, 5), F(IMMED, 0, 16), F(REP, 26, 1) });
+
+	add_enc(v, AFUC_STORE, 0xf8000000, 0x14u << 27, "s[ti]",
+		{ F(SRC1, 16, 5), F(SRC2, 21, 5), F(IMMED, 0, 12), F(PREINC, 14, 1), F(REP, 26, 1) });
+
+	add_enc(v, AFUC_CWRITE, 0xf8000000, 0x15u << 27, "s[tC]",
+		{ F(SRC1, 16, 5), F(SRC2, 21, 5), F(BASE, 0, 12), F(SDS, 12, 2),
+		  F(PREINC, 14, 1), F(REP, 26, 1) });
+
+	if (gpuver >= AFUC_A6XX) {
+		add_enc(v, AFUC_SWRITE, 0xf800b000, (0x15u << 27) | (1u << 15), "s[tQ]",
+			{ F(SRC1, 16, 5), F(SRC2, 21, 5), F(BASE, 0, 12), F(PREINC, 14, 1), F(REP, 26, 1) });
+		add_enc(v, AFUC_LOAD, 0xf8008000, 0x16u << 27, "d[si]",
+			{ F(DST, 16, 5), F(SRC1, 21, 5), F(IMMED, 0, 12), F(PREINC, 14, 1), F(REP, 26, 1) });
+		add_enc(v, AFUC_CREAD, 0xf8008000, 0x17u << 27, "d[sC]",
+			{ F(DST, 16, 5), F(SRC1, 21, 5), F(BASE, 0, 12), F(PREINC, 14, 1), F(REP, 26, 1) });
+		add_enc(v, AFUC_SREAD, 0xf8008000, (0x17u << 27) | (1u << 15), "d[sQ]",
+			{ F(DST, 16, 5), F(SRC1, 21, 5), F(BASE, 0, 12), F(PREINC, 14, 1), F(REP, 26, 1) });
+	} else {
+		add_enc(v, AFUC_CREAD, 0xf8000000, 0x16u << 27, "d[sC]",
+			{ F(DST, 16, 5), F(SRC1, 21, 5), F(BASE, 0, 12), F(PREINC, 14, 1), F(REP, 26, 1) });
+	}
+
+	add_enc(v, AFUC_BRNE_IMM, 0xfc000000, 0x30u << 26, "siT",
+		{ F(SRC1, 21, 5), F(IMMED, 16, 5) });
+	add_enc(v, AFUC_BREQ_IMM, 0xfc000000, 0x31u << 26, "siT",
+		{ F(SRC1, 21, 5), F(IMMED, 16, 5) });
+	add_enc(v, AFUC_BRNE_BIT, 0xfc000000, 0x32u << 26, "sbT",
+		{ F(SRC1, 21, 5), F(BIT, 16, 5) });
+	add_enc(v, AFUC_BREQ_BIT, 0xfc000000, 0x33u << 26, "sbT",
+		{ F(SRC1, 21, 5), F(BIT, 16, 5) });
+	add_enc(v, AFUC_JUMP, 0xffff0000, 0x32u << 26, "T", {});
+	add_enc(v, AFUC_RET, 0xfe000000, 0x34u << 26, "", {});
+	add_enc(v, AFUC_IRET, 0xfe000000, (0x34u << 26) | (1u << 25), "", {});
+	add_enc(v, AFUC_CALL, 0xfc000000, 0x35u << 26, "T", {});
+	add_enc(v, AFUC_WAITIN, 0xfc000000, 0x36u << 26, "", {});
+	add_enc(v, AFUC_BL, 0xfc000000, 0x38u << 26, "T", {});
+	add_enc(v, AFUC_SETSECURE, 0xfc000000, 0x3bu << 26, "", {});
+
+	if (gpuver >= AFUC_A7XX) {
+		add_enc(v, AFUC_JUMPR, 0xfff00000, (0x37u << 26) | (0x37u << 20), "s",
+			{ F(SRC1, 0, 5) });
+		add_enc(v, AFUC_SRET, 0xfff00000, (0x37u << 26) | (0x36u << 20), "", {});
+		add_enc(v, AFUC_JUMPA, 0xfc000000, 0x39u << 26, "T", {});
+	}
+
+	add_enc(v, AFUC_NOP, 0xf8000000, 0, "", { F(REP, 26, 1) });
+}
+
+#undef F
+
+/* ─── Pattern parsing ──────────────────────────────────────── */
+
+static string trim(const string& s)
+{
+	size_t b = 0, e = s.size();
+	while (b < e && isspace((unsigned char)s[b]))
+		b++;
+	while (e > b && isspace((unsigned char)s[e - 1]))
+		e--;
+	return s.substr(b, e - b);
+}
+
+static bool parse_number(const string& s, uint32_t& val)
+{
+	if (s.empty())
+		return false;
+	char* end = nullptr;
+	unsigned long v = strtoul(s.c_str(), &end, 0);
+	if (*end != '\0')
+		return false;
+	val = static_cast<uint32_t>(v);
+	return true;
+}
+
+/* "*", "N" or "lo..hi" (each side parsed by 'one') */
+template <typename Fn>
+static bool parse_range(const string& s, uint32_t& lo, uint32_t& hi, bool& any, Fn one)
+{
+	any = false;
+	if (s == "*") {
+		any = true;
+		return true;
+	}
+	size_t dots = s.find("..");
+	if (dots == string::npos) {
+		if (!one(s, lo))
+			return false;
+		hi = lo;
+		return true;
+	}
+	return one(trim(s.substr(0, dots)), lo) && one(trim(s.substr(dots + 2)), hi) && lo <= hi;
+}
+
+static bool parse_reg(const string& s, bool dst, uint32_t& enc)
+{
+	if (s.size() < 2 || s[0] != '$')
+		return false;
+	for (uint32_t i = 0; i < 0x20; i++) {
+		const char* name = dst ? afuc_dst_reg_name(i) : afuc_src_reg_name(i);
+		if (s == name) {
+			enc = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+struct Operand {
+	char kind;       /* '$', 'b', '#', '@', '%', 'n' (number / '*'), '[', ']' */
+	string text;     /* without sigil */
+};
+
+static bool tokenize_operands(const string& text, vector<Operand>& ops, bool& preinc)
+{
+	preinc = false;
+	string cur;
+	auto flush = [&]() -> bool {
+		string t = trim(cur);
+		cur.clear();
+		if (t.empty())
+			return true;
+		char c = t[0];
+		if (c == '$' && t != "$*")
+			ops.push_back({ '$', t });
+		else if (c == '$')
+			ops.push_back({ '$', "*" });
+		else if (c == '#' || c == '@' || c == '%')
+			ops.push_back({ c, trim(t.substr(1)) });
+		else if (c == 'b' && t.size() > 1 && (isdigit((unsigned char)t[1]) || t[1] == '*'))
+			ops.push_back({ 'b', t.substr(1) });
+		else
+			ops.push_back({ 'n', t });
+		return true;
+	};
+
+	for (size_t i = 0; i < text.size(); i++) {
+		char c = text[i];
+		if (c == ',' || c == '+') {
+			flush();
+		} else if (c == '[' || c == ']') {
+			flush();
+			ops.push_back({ c, "" });
+		} else if (c == '!') {
+			flush();
+			preinc = true;
+		} else {
+			cur += c;
+		}
+	}
+	flush();
+	return true;
+}
+
+/* Can operand 'o' fill form slot 'f'? */
+static bool operand_fits(char f, const Operand& o)
+{
+	switch (f) {
+	case 'd': case 's': case 't':
+		return o.kind == '$';
+	case 'i': case 'I':
+		return o.kind == 'n';
+	case 'b': case 'l': case 'h':
+		return o.kind == 'b';
+	case 'C':
+		return o.kind == '@' || o.kind == 'n';
+	case 'Q':
+		return o.kind == '%' || o.kind == 'n';
+	case 'T':
+		return o.kind == '#';
+	case '[': case ']':
+		return o.kind == f;
+	default:
+		return false;
+	}
+}
+
+static bool form_matches(const char* form, const vector<Operand>& ops)
+{
+	if (strlen(form) != ops.size())
+		return false;
+	for (size_t i = 0; i < ops.size(); i++) {
+		if (!operand_fits(form[i], ops[i]))
+			return false;
+	}
+	return true;
+}
+
+static void add_cons(vector<AfucPatConstraint>& cons, AfucPatField f,
+                     uint32_t lo, uint32_t hi)
+{
+	cons.push_back({ f, lo, hi });
+}
+
+/* Translate operand 'o' in slot 'f' into constraints */
+static bool operand_constraints(char f, const Operand& o, AfucGpuVer gpuver,
+                                vector<AfucPatConstraint>& cons, string& error)
+{
+	uint32_t lo = 0, hi = 0;
+	bool any = false;
+
+	auto reg_one = [&](bool dst) {
+		return [dst](const string& s, uint32_t& v) {
+			string r = (s.empty() || s[0] == '$') ? s : "$" + s;
+			return parse_reg(r, dst, v);
+		};
+	};
+	auto num_one = [](const string& s, uint32_t& v) { return parse_number(s, v); };
+
+	switch (f) {
+	case 'd': case 's': case 't':
+	{
+		if (!parse_range(o.text, lo, hi, any, reg_one(f == 'd'))) {
+			error = "bad register '" + o.text + "'";
+			return false;
+		}
+		if (!any) {
+			AfucPatField pf = (f == 'd') ? AFUC_PF_DST
+			                : (f == 's') ? AFUC_PF_SRC1 : AFUC_PF_SRC2;
+			add_cons(cons, pf, lo, hi);
+		}
+		return true;
+	}
+
+	case 'i':
+	case 'I':
+	{
+		string imm = o.text;
+		if (f == 'I') {
+			size_t sh = imm.find("<<");
+			if (sh != string::npos) {
+				if (!parse_range(trim(imm.substr(sh + 2)), lo, hi, any, num_one)) {
+					error = "bad shift '" + imm + "'";
+					return false;
+				}
+				if (!any)
+					add_cons(cons, AFUC_PF_SHIFT, lo, hi);
+				imm = trim(imm.substr(0, sh));
+			}
+		}
+		if (!parse_range(imm, lo, hi, any, num_one)) {
+			error = "bad immediate '" + imm + "'";
+			return false;
+		}
+		if (!any)
+			add_cons(cons, AFUC_PF_IMMED, lo, hi);
+		return true;
+	}
+
+	case 'b': case 'l': case 'h':
+		if (!parse_range(o.text, lo, hi, any, num_one) || hi > 31) {
+			error = "bad bit 'b" + o.text + "'";
+			return false;
+		}
+		if (!any)
+			add_cons(cons, f == 'b' ? AFUC_PF_BIT : f == 'l' ? AFUC_PF_LO : AFUC_PF_HI, lo, hi);
+		return true;
+
+	case 'C':
+	case 'Q':
+	{
+		auto name_one = [&](const string& s, uint32_t& v) {
+			if (parse_number(s, v))
+				return true;
+			return (f == 'C') ? afuc_ctrl_reg_offset(gpuver, s.c_str(), v)
+			                  : afuc_sqe_reg_offset(s.c_str(), v);
+		};
+		if (!parse_range(o.text, lo, hi, any, name_one)) {
+			error = "unknown register '" + o.text + "'";
+			return false;
+		}
+		if (!any)
+			add_cons(cons, AFUC_PF_BASE, lo, hi);
+		return true;
+	}
+
+	case 'T':
+		if (!parse_range(o.text, lo, hi, any, num_one)) {
+			error = "bad target '#" + o.text + "'";
+			return false;
+		}
+		if (!any)
+			add_cons(cons, AFUC_PF_TARGET, lo, hi);
+		return true;
+
+	default:
+		return true;
+	}
+}
+
+/* Bits that are fixed across every value of [lo, hi] */
+static void range_prefix(uint32_t lo, uint32_t hi, unsigned width,
+                         uint32_t& mask, uint32_t& value)
+{
+	uint32_t full = (width >= 32) ? ~0u : ((1u << width) - 1);
+	uint32_t diff = lo ^ hi;
+	uint32_t m = full;
+	while (diff) {
+		m &= ~diff;
+		diff >>= 1;
+		m &= ~diff;
+	}
+	mask = m;
+	value = lo & m;
+}
+
+static bool compile_insn(const string& text, AfucGpuVer gpuver,
+                         const vector<EncDesc>& encs, AfucPatInsn& pi,
+                         string& error)
+{
+	string s = trim(text);
+	pi = AfucPatInsn();
+
+	if (s == "*") {
+		pi.any = true;
+		return true;
+	}
+
+	/* Prefix modifiers */
+	vector<AfucPatConstraint> mods;
+	while (!s.empty() && s[0] == '(') {
+		size_t close = s.find(')');
+		if (close == string::npos) {
+			error = "unterminated modifier in '" + text + "'";
+			return false;
+		}
+		string m = s.substr(1, close - 1);
+		if (m == "rep")
+			add_cons(mods, AFUC_PF_REP, 1, 1);
+		else if (m == "peek")
+			add_cons(mods, AFUC_PF_PEEK, 1, 1);
+		else if (m.size() == 4 && m.compare(0, 3, "sds") == 0 && m[3] >= '1' && m[3] <= '3')
+			add_cons(mods, AFUC_PF_SDS, m[3] - '0', m[3] - '0');
+		else if (m.size() == 5 && m.compare(0, 4, "xmov") == 0 && m[4] >= '1' && m[4] <= '3')
+			add_cons(mods, AFUC_PF_XMOV, m[4] - '0', m[4] - '0');
+		else {
+			error = "unknown modifier '(" + m + ")'";
+			return false;
+		}
+		s = trim(s.substr(close + 1));
+	}
+
+	size_t sp = 0;
+	while (sp < s.size() && !isspace((unsigned char)s[sp]))
+		sp++;
+	string mnem = s.substr(0, sp);
+
+	vector<Operand> ops;
+	bool preinc;
+	tokenize_operands(s.substr(sp), ops, preinc);
+	if (preinc)
+		add_cons(mods, AFUC_PF_PREINC, 1, 1);
+
+	bool first = true;
+	for (const EncDesc& e : encs) {
+		if (mnem != afuc_op_name(e.op) || !form_matches(e.form, ops))
+			continue;
+
+		vector<AfucPatConstraint> cons = mods;
+		for (size_t i = 0; i < ops.size(); i++) {
+			if (!operand_constraints(e.form[i], ops[i], gpuver, cons, error))
+				return false;
+		}
+
+		/* Every constraint must land on a field this encoding has */
+		uint32_t mask = e.mask, value = e.value;
+		bool ok = true;
+		for (const AfucPatConstraint& c : cons) {
+			if (c.field == AFUC_PF_TARGET)
+				continue;
+			const FieldPos* fp = nullptr;
+			for (const FieldPos& p : e.pos) {
+				if (p.width && p.field == c.field)
+					fp = &p;
+			}
+			if (!fp) {
+				ok = false;
+				break;
+			}
+			uint32_t fm, fv;
+			range_prefix(c.lo, c.hi, fp->width, fm, fv);
+			if (fp->width < 32 && (c.hi >> fp->width)) {
+				ok = false;
+				break;
+			}
+			mask |= fm << fp->shift;
+			value = (value & ~(fm << fp->shift)) | (fv << fp->shift);
+		}
+		if (!ok)
+			continue;
+
+		/* Merge with earlier candidates: keep only the bits they agree on */
+		if (first) {
+			pi.mask = mask;
+			pi.value = value;
+			pi.cons = cons;
+			first = false;
+		} else {
+			pi.mask &= mask & ~(pi.value ^ value);
+			pi.value &= pi.mask;
+			if (cons.size() != pi.cons.size()) {
+				error = "ambiguous operands in '" + text + "'";
+				return false;
+			}
+		}
+		pi.ops.push_back(e.op);
+		if (e.op == AFUC_OR && (e.value >> 27) == 0x13)
+			pi.ops.push_back(AFUC_MOV);
+	}
+
+	if (first) {
+		error = "no encoding of '" + s + "' on a" + to_string((int)gpuver) + "xx";
+		return false;
+	}
+	return true;
+}
+
+bool afuc_pattern_compile(const string& text, AfucGpuVer gpuver,
+                          AfucPattern& pat, string& error)
+{
+	vector<EncDesc> encs;
+	build_encodings(gpuver, encs);
+
+	pat.gpuver = gpuver;
+	pat.steps.clear();
+
+	uint32_t gap = 0;
+	size_t start = 0;
+	while (start <= text.size()) {
+		size_t end = text.find_first_of(";\n", start);
+		if (end == string::npos)
+			end = text.size();
+		string step = trim(text.substr(start, end - start));
+		start = end + 1;
+
+		if (step.empty())
+			continue;
+
+		if (step.compare(0, 3, "...") == 0) {
+			uint32_t n = 8;
+			string rest = trim(step.substr(3));
+			if (!rest.empty() && !parse_number(rest, n)) {
+				error = "bad gap '" + step + "'";
+				return false;
+			}
+			gap += n;
+			continue;
+		}
+
+		AfucPatStep ps;
+		if (!compile_insn(step, gpuver, encs, ps.insn, error))
+			return false;
+		if (pat.steps.empty() && (gap || ps.insn.any)) {
+			error = "pattern must start with an instruction template";
+			return false;
+		}
+		ps.max_gap = gap;
+		gap = 0;
+		pat.steps.push_back(ps);
+	}
+
+	if (pat.steps.empty()) {
+		error = "empty pattern";
+		return false;
+	}
+	return true;
+}
+
+/* ─── Matching ─────────────────────────────────────────────── */
+
+static uint32_t field_value(const AfucInsn& insn, AfucPatField f, uint64_t addr)
+{
+	switch (f) {
+	case AFUC_PF_DST:    return insn.dst_enc;
+	case AFUC_PF_SRC1:   return insn.src1_enc;
+	case AFUC_PF_SRC2:   return insn.src2_enc;
+	case AFUC_PF_IMMED:  return insn.immed;
+	case AFUC_PF_SHIFT:  return insn.shift;
+	case AFUC_PF_BIT:    return insn.bit;
+	case AFUC_PF_LO:     return insn.lo;
+	case AFUC_PF_HI:     return insn.hi;
+	case AFUC_PF_BASE:   return insn.base;
+	case AFUC_PF_PREINC: return insn.preincrement;
+	case AFUC_PF_REP:    return insn.rep;
+	case AFUC_PF_SDS:    return insn.sds;
+	case AFUC_PF_XMOV:   return insn.xmov;
+	case AFUC_PF_PEEK:   return insn.peek;
+	case AFUC_PF_TARGET:
+		switch (insn.op) {
+		case AFUC_CALL: case AFUC_BL: case AFUC_JUMPA:
+			return insn.branch_target * 4;
+		default:
+			return static_cast<uint32_t>(addr + 4 + (int64_t)insn.branch_offset * 4);
+		}
+	}
+	return 0;
+}
+
+static bool insn_matches(const AfucPatInsn& pi, AfucGpuVer gpuver,
+                         const uint32_t* words, size_t idx, uint64_t base)
+{
+	if (pi.any)
+		return true;
+	uint32_t w = words[idx];
+	if ((w & pi.mask) != pi.value)
+		return false;
+
+	uint64_t addr = base + idx * 4;
+	AfucInsn insn;
+	afuc_decode(reinterpret_cast<const uint8_t*>(&words[idx]), 4, addr, insn, gpuver);
+
+	bool op_ok = false;
+	for (AfucOp op : pi.ops)
+		op_ok |= (op == insn.op);
+	if (!op_ok)
+		return false;
+
+	for (const AfucPatConstraint& c : pi.cons) {
+		uint32_t v = field_value(insn, c.field, addr);
+		if (v < c.lo || v > c.hi)
+			return false;
+	}
+	return true;
+}
+
+static bool steps_match(const AfucPattern& pat, size_t step, const uint32_t* words,
+                        size_t count, size_t idx, uint64_t base)
+{
+	if (step == pat.steps.size())
+		return true;
+	const AfucPatStep& ps = pat.steps[step];
+	for (uint32_t g = 0; g <= ps.max_gap && idx + g < count; g++) {
+		if (insn_matches(ps.insn, pat.gpuver, words, idx + g, base) &&
+		    steps_match(pat, step + 1, words, count, idx + g + 1, base))
+			return true;
+	}
+	return false;
+}
+
+void afuc_pattern_scan(const AfucPattern& pat, const uint32_t* words,
+                       size_t count, uint64_t base, vector<uint64_t>& hits)
+{
+	if (pat.steps.empty())
+		return;
+	const AfucPatInsn& anchor = pat.steps[0].insn;
+	afuc_scan_masked(words, count, anchor.mask, anchor.value, [&](size_t i) {
+		if (steps_match(pat, 0, words, count, i, base))
+			hits.push_back(base + i * 4);
+	});
+}
+
+/* ─── Plugin commands ──────────────────────────────────────── */
+
+static const char* s_tag_name = "AFUC Pattern";
+static const size_t s_report_limit = 2000;
+
+static string insn_text(Architecture* arch, BinaryView* view, uint64_t addr)
+{
+	uint8_t data[8] = {};
+	size_t len = view->Read(data, addr, sizeof(data));
+	vector<InstructionTextToken> tokens;
+	if (!arch->GetInstructionText(data, addr, len, tokens))
+		return "";
+	string text;
+	for (const InstructionTextToken& t : tokens)
+		text += t.text;
+	return text;
+}
+
+static void search_view(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	if (!afuc_view_gpuver(view, gpuver)) {
+		LogError("AFUC pattern search: not an AFUC view");
+		return;
+	}
+
+	string text;
+	if (!GetTextLineInput(text, "Pattern:", "Find AFUC Instruction Pattern"))
+		return;
+
+	AfucPattern pat;
+	string error;
+	if (!afuc_pattern_compile(text, gpuver, pat, error)) {
+		LogError("AFUC pattern search: %s", error.c_str());
+		return;
+	}
+
+	uint64_t base;
+	vector<uint32_t> words = afuc_read_code(view, base);
+	vector<uint64_t> hits;
+
+	auto t0 = chrono::steady_clock::now();
+	afuc_pattern_scan(pat, words.data(), words.size(), base, hits);
+	auto us = chrono::duration_cast<chrono::microseconds>(
+		chrono::steady_clock::now() - t0).count();
+
+	LogInfo("AFUC pattern search: %zu matches in %zu words (%lld us)",
+		hits.size(), words.size(), (long long)us);
+
+	/* Replace the previous result set with tags (Tags sidebar = result list) */
+	Ref<TagType> tagType = view->GetTagType(s_tag_name);
+	if (!tagType) {
+		tagType = new TagType(view, s_tag_name, "\xF0\x9F\x94\x8D");
+		view->AddTagType(tagType);
+	}
+	for (const TagReference& ref : view->GetAllTagReferencesOfType(tagType)) {
+		if (ref.autoDefined)
+			view->RemoveAutoDataTag(ref.addr, ref.tag);
+	}
+
+	Ref<Architecture> arch = view->GetDefaultArchitecture();
+	string report = "# AFUC pattern matches\n\n`" + text + "`\n\n";
+	char buf[64];
+	snprintf(buf, sizeof(buf), "%zu matches in %zu words\n\n", hits.size(), words.size());
+	report += buf;
+	report += "| Address | Function | Instruction |\n|---|---|---|\n";
+
+	for (size_t i = 0; i < hits.size(); i++) {
+		uint64_t addr = hits[i];
+		view->AddAutoDataTag(addr, new Tag(tagType, text));
+		if (i >= s_report_limit)
+			continue;
+
+		string func;
+		auto funcs = view->GetAnalysisFunctionsContainingAddress(addr);
+		if (!funcs.empty())
+			func = funcs[0]->GetSymbol()->GetShortName();
+		snprintf(buf, sizeof(buf), "0x%" PRIx64, addr);
+		report += string("| ") + buf + " | " + func + " | `" + insn_text(arch, view, addr) + "` |\n";
+	}
+	if (hits.size() > s_report_limit)
+		report += "\n(report truncated; all matches are tagged)\n";
+
+	ShowMarkdownReport("AFUC Pattern Search", report, report);
+}
+
+/* Scan every AFUC firmware file below a directory */
+static void search_corpus(BinaryView*)
+{
+	string dir;
+	if (!GetDirectoryNameInput(dir, "Firmware directory"))
+		return;
+
+	string text;
+	if (!GetTextLineInput(text, "Pattern:", "Find AFUC Instruction Pattern in Corpus"))
+		return;
+
+	/* Validate once up front; the generation is only known per file */
+	AfucPattern pats[3];
+	bool valid[3];
+	string errors[3];
+	bool any_valid = false;
+	for (int g = 0; g < 3; g++) {
+		valid[g] = afuc_pattern_compile(text, (AfucGpuVer)(AFUC_A5XX + g), pats[g], errors[g]);
+		any_valid |= valid[g];
+	}
+	if (!any_valid) {
+		for (int g = 0; g < 3; g++)
+			LogError("AFUC pattern search (a%dxx): %s", 5 + g, errors[g].c_str());
+		return;
+	}
+
+	WorkerEnqueue([=]() {
+		Ref<BackgroundTask> task = new BackgroundTask("Searching AFUC corpus...", true);
+		string report = "# AFUC corpus pattern matches\n\n`" + text + "`\n\n";
+		/* files of a generation the pattern doesn't compile for are skipped */
+		for (int g = 0; g < 3; g++)
+			if (!valid[g])
+				report += "a" + to_string(5 + g) + "xx files skipped: " + errors[g] + "\n\n";
+		report += "| File | fw_id | Version | Words | Matches | First matches |\n|---|---|---|---|---|---|\n";
+		size_t files = 0, total_words = 0, total_hits = 0;
+		auto t0 = chrono::steady_clock::now();
+
+		error_code ec;
+		for (auto it = filesystem::recursive_directory_iterator(dir, ec);
+		     !ec && it != filesystem::recursive_directory_iterator(); it.increment(ec)) {
+			if (task->IsCancelled())
+				break;
+			if (!it->is_regular_file())
+				continue;
+
+			ifstream f(it->path(), ios::binary);
+			vector<char> bytes((istreambuf_iterator<char>(f)), istreambuf_iterator<char>());
+			if (bytes.size() < 8)
+				continue;
+
+			/* fw_id / version straight from the header nop, no decode */
+			uint32_t header[2], fw_id, version;
+			memcpy(header, bytes.data(), sizeof(header));
+			if ((header[1] >> 26) != 0 || !afuc_fw_version(header, 2, fw_id, version))
+				continue;
+			int g = afuc_detect_gpuver(fw_id) - AFUC_A5XX;
+			if (!valid[g])
+				continue;
+
+			/* Instruction space starts after the header word */
+			vector<uint32_t> words((bytes.size() - 4) / 4);
+			memcpy(words.data(), bytes.data() + 4, words.size() * 4);
+
+			vector<uint64_t> hits;
+			afuc_pattern_scan(pats[g], words.data(), words.size(), 0, hits);
+
+			files++;
+			total_words += words.size();
+			total_hits += hits.size();
+			if (hits.empty())
+				continue;
+
+			char buf[64];
+			string first;
+			for (size_t i = 0; i < hits.size() && i < 8; i++) {
+				snprintf(buf, sizeof(buf), "%s0x%" PRIx64, i ? ", " : "", hits[i]);
+				first += buf;
+			}
+			snprintf(buf, sizeof(buf), " | 0x%03x | 0x%03x | %zu | %zu | ",
+				fw_id, version, words.size(), hits.size());
+			report += "| " + it->path().filename().string() + buf + first + " |\n";
+		}
+
+		auto ms = chrono::duration_cast<chrono::milliseconds>(
+			chrono::steady_clock::now() - t0).count();
+		char buf[128];
+		snprintf(buf, sizeof(buf), "\n%zu matches in %zu files, %zu words (%lld ms)\n",
+			total_hits, files, total_words, (long long)ms);
+		report += buf;
+
+		task->Finish();
+		ShowMarkdownReport("AFUC Corpus Pattern Search", report, report);
+	}, "AFUC corpus search");
+}
+
+static bool is_afuc_view(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	return afuc_view_gpuver(view, gpuver);
+}
+
+void afuc_register_search_commands()
+{
+	PluginCommand::Register("AFUC\\Find Instruction Pattern...",
+		"Search the code for an AFUC instruction pattern with wildcards",
+		search_view, is_afuc_view);
+	PluginCommand::Register("AFUC\\Find Instruction Pattern in Corpus...",
+		"Search every AFUC firmware file in a directory for an instruction pattern",
+		search_corpus);
+}
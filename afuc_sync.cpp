@@ -0,0 +1,520 @@
+/*
+ * a7xx BR/BV/LPAC thread synchronization points.
+ *
+ * Finds every access to the thread synchronization control registers,
+ * works out which flag bits a write sets and a read tests, recognizes
+ * spin loops, attributes each point to its thread and pairs producers
+ * with consumers in other threads. The report groups them per packet
+ * handler and lists the chains of handlers that may wait on one another.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <map>
+#include <set>
+
+#include "binaryninjaapi.h"
+#include "afuc.h"
+#include "afuc_pm4.h"
+#include "afuc_view.h"
+
+using namespace BinaryNinja;
+using namespace std;
+
+/* ─── Threads ──────────────────────────────────────────────── */
+
+static const char* const s_thread_names[AFUC_THREAD_COUNT] = { "BR", "BV", "LPAC" };
+
+const char* afuc_thread_name(uint32_t thread)
+{
+	return thread < AFUC_THREAD_COUNT ? s_thread_names[thread] : "?";
+}
+
+vector<size_t> afuc_thread_starts(const AfucFlowMap& map)
+{
+	vector<AfucNopPayload> nops;
+	afuc_nop_payloads(map.words.data(), map.words.size(), map.base, nops);
+
+	vector<size_t> starts = { 0 };
+	for (const AfucNopPayload& n : nops) {
+		size_t i = (n.addr - map.base) / 4;
+		if (n.kind == AFUC_NOP_FW_HEADER && i > 0 && starts.size() < AFUC_THREAD_COUNT)
+			starts.push_back(i);
+	}
+	return starts;
+}
+
+/* ─── Sync points ──────────────────────────────────────────── */
+
+static const char* const s_sync_reg_names[] = {
+	"THREAD_SYNC",
+	"COPROCESSOR_LOCK",
+};
+
+/* How far a read value is traced to the branch that tests it */
+static const size_t s_window = 6;
+
+/* Longest spin loop body, in words */
+static const uint64_t s_max_poll_words = 16;
+
+namespace {
+
+/* Constant GPR values before a word, by encoding; $00 is always known */
+struct Consts {
+	uint32_t known = 1;
+	uint32_t v[32] = {};
+
+	bool get(uint32_t enc, uint32_t& out) const
+	{
+		if (enc >= 32 || !(known & (1u << enc)))
+			return false;
+		out = v[enc];
+		return true;
+	}
+};
+
+}
+
+/* The flag-building ops a write's value goes through */
+static bool fold_const(const AfucInsn& insn, const Consts& st, uint32_t& out)
+{
+	uint32_t a, b;
+	if (insn.rep)
+		return false;
+	switch (insn.op) {
+	case AFUC_MOVI:
+		out = insn.immed << insn.shift;
+		return true;
+	case AFUC_MOV:
+		return st.get(insn.src2_enc, out);
+	case AFUC_SETBIT:
+	case AFUC_CLRBIT:
+		if (!st.get(insn.src1_enc, a))
+			return false;
+		out = insn.op == AFUC_SETBIT ? a | (1u << insn.bit) : a & ~(1u << insn.bit);
+		return true;
+	case AFUC_ADD: case AFUC_SUB: case AFUC_AND: case AFUC_OR:
+	case AFUC_XOR: case AFUC_BIC: case AFUC_SHL: case AFUC_USHR:
+		if (!st.get(insn.src1_enc, a))
+			return false;
+		if (insn.is_immed)
+			b = insn.immed;
+		else if (!st.get(insn.src2_enc, b))
+			return false;
+		switch (insn.op) {
+		case AFUC_ADD:  out = a + b; break;
+		case AFUC_SUB:  out = a - b; break;
+		case AFUC_AND:  out = a & b; break;
+		case AFUC_OR:   out = a | b; break;
+		case AFUC_XOR:  out = a ^ b; break;
+		case AFUC_BIC:  out = a & ~b; break;
+		case AFUC_SHL:  out = b >= 32 ? 0 : a << b; break;
+		default:        out = b >= 32 ? 0 : a >> b; break;
+		}
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+ * Constants held before every word, by a forward data flow over the
+ * flow map. Words nothing flows into (packet handlers, interrupt and
+ * thread entries) start with nothing known and a value that differs
+ * between paths is dropped, so what is left holds on every path. A call
+ * returns with nothing known.
+ */
+static void const_flow(AfucGpuVer gpuver, const AfucFlowMap& map, vector<Consts>& in)
+{
+	size_t count = map.words.size();
+	vector<AfucInsn> insns(count);
+	vector<uint8_t> valid(count), seen(count), queued(count), call_ret(count);
+	for (size_t i = 0; i < count; i++)
+		valid[i] = afuc_decode((const uint8_t*)&map.words[i], 4, map.base + i * 4, insns[i], gpuver);
+
+	vector<AfucWordSuccs> succs;
+	afuc_word_succs(gpuver, map, succs);
+	vector<uint8_t> has_pred(count);
+	for (size_t i = 0; i < count; i++) {
+		for (uint32_t t : succs[i].s)
+			if (t != AFUC_NO_WORD)
+				has_pred[t] = 1;
+		if (!valid[i])
+			continue;
+		AfucFlow f = afuc_insn_flow(insns[i], map.base + i * 4);
+		if (f.kind == AFUC_FLOW_CALL)
+			call_ret[f.delay_slot && i + 1 < count ? i + 1 : i] = 1;
+	}
+
+	in.assign(count, Consts());
+	vector<uint32_t> work;
+	for (size_t i = count; i-- > 0;) {
+		if (!has_pred[i] && valid[i]) {
+			seen[i] = queued[i] = 1;
+			work.push_back((uint32_t)i);
+		}
+	}
+
+	/* registers only ever go from known to unknown, so this ends */
+	while (!work.empty()) {
+		uint32_t i = work.back();
+		work.pop_back();
+		queued[i] = 0;
+		if (!valid[i])
+			continue;
+
+		Consts st = in[i];
+		uint32_t v;
+		bool folded = fold_const(insns[i], st, v);
+		st.known &= ~afuc_insn_dst_regs(insns[i]) | 1u;
+		if (folded && insns[i].dst_enc > 0 && insns[i].dst_enc < 0x1d) {
+			st.known |= 1u << insns[i].dst_enc;
+			st.v[insns[i].dst_enc] = v;
+		}
+
+		for (int k = 0; k < 2; k++) {
+			uint32_t t = succs[i].s[k];
+			if (t == AFUC_NO_WORD)
+				continue;
+			Consts out = k == 1 && call_ret[i] ? Consts() : st;
+			bool changed = !seen[t];
+			if (!seen[t]) {
+				in[t] = out;
+				seen[t] = 1;
+			} else {
+				uint32_t keep = in[t].known & out.known;
+				for (uint32_t r = 1; r < 32; r++)
+					if ((keep & (1u << r)) && in[t].v[r] != out.v[r])
+						keep &= ~(1u << r);
+				changed = keep != in[t].known;
+				in[t].known = keep;
+			}
+			if (changed && !queued[t]) {
+				queued[t] = 1;
+				work.push_back(t);
+			}
+		}
+	}
+}
+
+/* Follow the value read at word 'at' to the branch that tests it */
+static void classify_read(AfucGpuVer gpuver, const AfucFlowMap& map, size_t at,
+                          uint32_t dst, AfucSyncPoint& pt)
+{
+	uint32_t holds = 1u << dst;   /* registers carrying (part of) the value */
+	uint32_t mask = ~0u;
+
+	for (size_t k = 1; k <= s_window && at + k < map.words.size(); k++) {
+		size_t i = at + k;
+		AfucInsn insn;
+		uint64_t addr = map.base + i * 4;
+		if (!afuc_decode((const uint8_t*)&map.words[i], 4, addr, insn, gpuver))
+			return;
+
+		switch (insn.op) {
+		case AFUC_AND:
+		case AFUC_UBFX:
+			if (!(holds & (1u << insn.src1_enc)))
+				break;
+			if (insn.op == AFUC_AND && insn.is_immed)
+				mask &= insn.immed;
+			else if (insn.op == AFUC_UBFX)
+				mask &= (insn.hi >= 31 ? ~0u : (2u << insn.hi) - 1) & (~0u << insn.lo);
+			holds |= 1u << insn.dst_enc;
+			continue;
+		case AFUC_BRNE_BIT:
+		case AFUC_BREQ_BIT:
+		case AFUC_BRNE_IMM:
+		case AFUC_BREQ_IMM:
+		{
+			if (!(holds & (1u << insn.src1_enc)))
+				break;
+			bool bit = insn.op == AFUC_BRNE_BIT || insn.op == AFUC_BREQ_BIT;
+			pt.bits = bit ? 1u << insn.bit : (mask != ~0u ? mask : insn.immed);
+			pt.branch = addr;
+
+			/* branching back over the read keeps spinning on it */
+			AfucFlow f = afuc_insn_flow(insn, addr);
+			if (f.target <= pt.addr && pt.addr - f.target < s_max_poll_words * 4)
+				pt.kind = AFUC_SYNC_POLL;
+			return;
+		}
+		default:
+			break;
+		}
+
+		/* anything else overwriting the value ends the trace */
+		holds &= ~afuc_insn_dst_regs(insn);
+		if (!holds || (map.words[i] >> 30) == 3)
+			return;
+	}
+}
+
+void afuc_sync_points(AfucGpuVer gpuver, const AfucFlowMap& map, vector<AfucSyncPoint>& out)
+{
+	out.clear();
+	vector<uint32_t> regs;
+	for (const char* name : s_sync_reg_names) {
+		uint32_t off;
+		if (afuc_ctrl_reg_offset(gpuver, name, off))
+			regs.push_back(off);
+	}
+	if (regs.empty())
+		return;
+
+	vector<size_t> starts = afuc_thread_starts(map);
+	uint32_t thread = 0;
+	vector<Consts> consts;
+	const_flow(gpuver, map, consts);
+
+	for (size_t i = 0; i < map.words.size(); i++) {
+		while (thread + 1 < starts.size() && i >= starts[thread + 1])
+			thread++;
+
+		AfucInsn insn;
+		uint64_t addr = map.base + i * 4;
+		if (!afuc_decode((const uint8_t*)&map.words[i], 4, addr, insn, gpuver))
+			continue;
+		bool write = insn.op == AFUC_CWRITE;
+		if ((!write && insn.op != AFUC_CREAD) ||
+		    find(regs.begin(), regs.end(), insn.base) == regs.end())
+			continue;
+
+		/* only fixed register addresses ($00 + base) */
+		if ((write ? insn.src2_enc : insn.src1_enc) != 0)
+			continue;
+
+		AfucSyncPoint pt = { addr, write ? AFUC_SYNC_WRITE : AFUC_SYNC_READ, insn.base, 0, thread, 0 };
+		if (write) {
+			uint32_t v;
+			if (consts[i].get(insn.src1_enc, v))
+				pt.bits = v;
+		} else if (insn.dst_enc > 0 && insn.dst_enc < 0x1d) {
+			classify_read(gpuver, map, i, insn.dst_enc, pt);
+		}
+		out.push_back(pt);
+	}
+}
+
+void afuc_sync_pairs(const vector<AfucSyncPoint>& points, vector<AfucSyncPair>& out)
+{
+	out.clear();
+	for (size_t p = 0; p < points.size(); p++) {
+		if (points[p].kind != AFUC_SYNC_WRITE)
+			continue;
+		for (size_t c = 0; c < points.size(); c++) {
+			const AfucSyncPoint& a = points[p];
+			const AfucSyncPoint& b = points[c];
+			if (b.kind == AFUC_SYNC_WRITE || a.reg != b.reg || a.thread == b.thread)
+				continue;
+			if (a.bits && b.bits && !(a.bits & b.bits))
+				continue;
+			out.push_back({ p, c });
+		}
+	}
+}
+
+/* ─── Binary Ninja glue ────────────────────────────────────── */
+
+static const char* s_kind_names[] = { "read", "poll", "write" };
+
+static const size_t s_max_chains = 64;
+static const size_t s_max_chain_len = 4;
+
+static void show_sync_points(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	if (!afuc_view_gpuver(view, gpuver))
+		return;
+
+	Ref<BinaryView> ref = view;
+	const AfucRegTable* regs = afuc_view_reg_table(view);
+	WorkerEnqueue([=]() {
+		Ref<BackgroundTask> task = new BackgroundTask("Finding AFUC thread sync points...", false);
+		shared_ptr<const AfucFlowMap> map = afuc_view_flow_map(ref);
+		if (!map) {
+			task->Finish();
+			return;
+		}
+
+		vector<AfucSyncPoint> points;
+		vector<AfucSyncPair> pairs;
+		char buf[160];
+		afuc_sync_points(gpuver, *map, points);
+		afuc_sync_pairs(points, pairs);
+
+		/* Attribute points to the packet handlers that reach them, callees
+		 * included; code no handler reaches (the other threads' dispatch)
+		 * falls back to the functions containing it */
+		std::map<uint64_t, string> names;
+		vector<vector<uint64_t>> owners(points.size());
+		std::map<uint64_t, size_t> point_at;
+		for (size_t i = 0; i < points.size(); i++)
+			point_at[points[i].addr] = i;
+
+		std::map<uint64_t, vector<uint32_t>> ops;
+		if (Ref<Metadata> md = ref->QueryMetadata("afuc.packet_table"); md && md->IsArray()) {
+			vector<uint64_t> table = md->GetUnsignedIntegerList();
+			for (size_t op = 0; op < table.size(); op++)
+				ops[table[op]].push_back((uint32_t)op);
+		}
+		for (const auto& [entry, opcodes] : ops) {
+			if (opcodes.size() > AFUC_PM4_SHARED_HANDLER_MAX || entry < map->base)
+				continue;
+			vector<uint64_t> addrs;
+			afuc_handler_insns(gpuver, map->words.data(), map->words.size(), entry - map->base, addrs);
+			bool any = false;
+			for (uint64_t a : addrs) {
+				auto it = point_at.find(a + map->base);
+				if (it == point_at.end())
+					continue;
+				owners[it->second].push_back(entry);
+				any = true;
+			}
+			if (!any)
+				continue;
+			for (uint32_t op : opcodes) {
+				const char* name = afuc_pm4_packet_name(gpuver, op);
+				snprintf(buf, sizeof(buf), "CP_UNKNOWN_%02x", op);
+				names[entry] += (names[entry].empty() ? "" : ", ") + string(name ? name : buf);
+			}
+		}
+		for (size_t i = 0; i < points.size(); i++) {
+			if (!owners[i].empty())
+				continue;
+			for (const Ref<Function>& f : ref->GetAnalysisFunctionsContainingAddress(points[i].addr)) {
+				owners[i].push_back(f->GetStart());
+				Ref<Symbol> sym = f->GetSymbol();
+				if (!names.count(f->GetStart()))
+					names[f->GetStart()] = sym ? sym->GetShortName() : "";
+			}
+		}
+		auto func_name = [&](uint64_t start) {
+			char buf[32];
+			snprintf(buf, sizeof(buf), "sub_%" PRIx64, start);
+			return names[start].empty() ? string(buf) : names[start];
+		};
+		auto point_text = [&](const AfucSyncPoint& pt) {
+			char buf[96];
+			const char* reg = afuc_ctrl_reg_name(regs, pt.reg);
+			snprintf(buf, sizeof(buf), "0x%" PRIx64 " %s @%s", pt.addr,
+				afuc_thread_name(pt.thread), reg ? reg : "?");
+			return string(buf);
+		};
+		auto bits_text = [](uint32_t bits) {
+			char buf[16];
+			snprintf(buf, sizeof(buf), "0x%x", bits);
+			return bits ? string(buf) : string("?");
+		};
+
+		string report = "# AFUC thread synchronization\n\n";
+		vector<size_t> starts = afuc_thread_starts(*map);
+		for (size_t t = 0; t < starts.size(); t++) {
+			snprintf(buf, sizeof(buf), "%s%s at 0x%" PRIx64, t ? ", " : "Threads: ",
+				afuc_thread_name((uint32_t)t), map->base + starts[t] * 4);
+			report += buf;
+		}
+		report += "\n\n## Per handler\n\n| Handler | Thread | Reads | Polls | Writes |\n|---|---|---|---|---|\n";
+
+		struct Counts { uint32_t thread; uint32_t n[3]; };
+		std::map<uint64_t, Counts> per_func;
+		for (size_t i = 0; i < points.size(); i++) {
+			for (uint64_t f : owners[i]) {
+				auto it = per_func.try_emplace(f, Counts{ points[i].thread, { 0, 0, 0 } }).first;
+				it->second.n[points[i].kind]++;
+			}
+			if (ref->GetCommentForAddress(points[i].addr).empty() && points[i].kind != AFUC_SYNC_WRITE) {
+				snprintf(buf, sizeof(buf), "sync: %s on %s", s_kind_names[points[i].kind],
+					bits_text(points[i].bits).c_str());
+				ref->SetCommentForAddress(points[i].addr, buf);
+			}
+		}
+		for (const auto& [f, c] : per_func) {
+			snprintf(buf, sizeof(buf), " | %s | %u | %u | %u |\n", afuc_thread_name(c.thread),
+				c.n[AFUC_SYNC_READ], c.n[AFUC_SYNC_POLL], c.n[AFUC_SYNC_WRITE]);
+			report += "| " + func_name(f) + buf;
+		}
+
+		report += "\n## Producer → consumer\n\n| Producer | Consumer | Kind | Flags |\n|---|---|---|---|\n";
+		for (const AfucSyncPair& p : pairs) {
+			const AfucSyncPoint& a = points[p.producer];
+			const AfucSyncPoint& b = points[p.consumer];
+			report += "| " + point_text(a) + " | " + point_text(b) + " | " + s_kind_names[b.kind] +
+				" | " + bits_text(a.bits & (b.bits ? b.bits : ~0u)) + " |\n";
+		}
+
+		/* Handler F waits on G when F reads flags G writes from another thread */
+		std::map<uint64_t, set<uint64_t>> waits_on;
+		for (const AfucSyncPair& p : pairs)
+			for (uint64_t f : owners[p.consumer])
+				for (uint64_t g : owners[p.producer])
+					waits_on[f].insert(g);
+
+		vector<string> chains;
+		vector<uint64_t> path;
+		auto thread_of = [&](uint64_t f) {
+			auto it = per_func.find(f);
+			return afuc_thread_name(it == per_func.end() ? ~0u : it->second.thread);
+		};
+		auto walk = [&](auto&& self, uint64_t f) -> void {
+			if (chains.size() >= s_max_chains)
+				return;
+			bool cycle = find(path.begin(), path.end(), f) != path.end();
+			path.push_back(f);
+			auto it = waits_on.find(f);
+			if (cycle || it == waits_on.end() || path.size() > s_max_chain_len) {
+				if (path.size() > 2 || cycle) {
+					string text;
+					for (uint64_t g : path)
+						text += (text.empty() ? "" : " → ") + func_name(g) + " (" + thread_of(g) + ")";
+					chains.push_back(text + (cycle ? " **cycle**" : ""));
+				}
+			} else {
+				for (uint64_t g : it->second)
+					self(self, g);
+			}
+			path.pop_back();
+		};
+		for (const auto& [f, targets] : waits_on)
+			walk(walk, f);
+
+		report += "\n## Wait chains\n\n";
+		if (chains.empty())
+			report += "No chains longer than one hop.\n";
+		for (const string& c : chains)
+			report += "- " + c + "\n";
+
+		size_t polls = count_if(points.begin(), points.end(),
+			[](const AfucSyncPoint& p) { return p.kind == AFUC_SYNC_POLL; });
+		snprintf(buf, sizeof(buf), "\n%zu sync points (%zu poll loops), %zu producer/consumer pairs\n",
+			points.size(), polls, pairs.size());
+		report += buf;
+
+		std::map<string, Ref<Metadata>> kv;
+		kv["points"] = new Metadata((uint64_t)points.size());
+		kv["polls"] = new Metadata((uint64_t)polls);
+		kv["pairs"] = new Metadata((uint64_t)pairs.size());
+		ref->StoreMetadata("afuc.thread_sync", new Metadata(kv), true);
+
+		task->Finish();
+		ShowMarkdownReport("AFUC Thread Sync", report, report);
+	}, "AFUC thread sync");
+}
+
+static bool is_a7xx(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	return afuc_view_gpuver(view, gpuver) && gpuver >= AFUC_A7XX;
+}
+
+void afuc_register_sync_commands()
+{
+	PluginCommand::Register("AFUC\\Thread Sync Points",
+		"Find BR/BV/LPAC synchronization reads, writes and spin loops and pair them across threads",
+		show_sync_points, is_a7xx);
+}
@@ -0,0 +1,251 @@
+/*
+ * Packet handler cost across firmware generations.
+ *
+ * Handlers are matched by packet name: each file's packet table is
+ * recovered by running its bootstrap, and every handler is measured with
+ * that generation's decoder, so an a5xx, a6xx and a7xx build of the same
+ * CP_* packet line up in one row. Files are processed in parallel.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <thread>
+
+#include "binaryninjaapi.h"
+#include "afuc_emu.h"
+#include "afuc_pm4.h"
+#include "afuc_view.h"
+
+using namespace BinaryNinja;
+using namespace std;
+
+/* ─── Measurement ──────────────────────────────────────────── */
+
+bool afuc_image_handler_costs(const vector<uint32_t>& image, AfucImageCosts& out)
+{
+	out.handlers.clear();
+	out.has_table = false;
+	if (!afuc_fw_version(image.data(), image.size(), out.fw_id, out.version))
+		return false;
+	out.gpuver = afuc_detect_gpuver(out.fw_id);
+
+	uint32_t table[AFUC_PACKET_TABLE_SIZE];
+	if (afuc_find_packet_table(out.gpuver, image.data(), image.size(), table) != AFUC_PACKET_TABLE_SIZE)
+		return true;
+	out.has_table = true;
+
+	const uint32_t* code = image.data() + 1;
+	size_t count = image.size() - 1;
+	map<uint32_t, size_t> users;
+	for (uint32_t h : table)
+		users[h]++;
+
+	map<uint32_t, AfucImageHandler> measured;
+	for (uint32_t op = 0; op < AFUC_PACKET_TABLE_SIZE; op++) {
+		uint32_t h = table[op];
+		if (h >= count || users[h] > AFUC_PM4_SHARED_HANDLER_MAX)
+			continue;
+
+		AfucImageHandler m = { op, "", (uint64_t)h * 4, 0, 0, 0.0 };
+		auto it = measured.find(h);
+		if (it != measured.end()) {
+			m = it->second;
+			m.opcode = op;
+		} else {
+			vector<uint64_t> addrs;
+			afuc_handler_insns(out.gpuver, code, count, m.entry, addrs);
+			m.insns = (uint32_t)addrs.size();
+			for (uint64_t addr : addrs) {
+				AfucInsn insn;
+				if (afuc_decode((const uint8_t*)&code[addr / 4], 4, addr, insn, out.gpuver))
+					m.cost += afuc_insn_cost(insn);
+			}
+			m.expected = afuc_expected_cost(out.gpuver, code, count, m.entry, {});
+			measured[h] = m;
+		}
+
+		const char* name = afuc_pm4_packet_name(out.gpuver, op);
+		char buf[16];
+		snprintf(buf, sizeof(buf), "0x%02x", op);
+		m.packet = name ? name : buf;
+		out.handlers.push_back(m);
+	}
+	return true;
+}
+
+/* ─── Binary Ninja glue ────────────────────────────────────── */
+
+static const char* s_gen_names[] = { "a5xx", "a6xx", "a7xx" };
+
+namespace {
+
+struct FileCosts {
+	string name;
+	bool valid = false;
+	AfucImageCosts costs;
+};
+
+/* One generation's measurements of a packet */
+struct GenStats {
+	vector<uint32_t> cost, insns;
+	vector<double> expected;
+};
+
+}
+
+template <typename T>
+static T median(vector<T> v)
+{
+	sort(v.begin(), v.end());
+	return v[v.size() / 2];
+}
+
+static string cell_text(const GenStats& s)
+{
+	if (s.cost.empty())
+		return "";
+	char buf[96];
+	uint32_t lo = *min_element(s.cost.begin(), s.cost.end());
+	uint32_t hi = *max_element(s.cost.begin(), s.cost.end());
+	snprintf(buf, sizeof(buf), "%u / %.0f (%u insns)", median(s.cost), median(s.expected),
+		median(s.insns));
+	string text = buf;
+	if (lo != hi) {
+		snprintf(buf, sizeof(buf), " [%u-%u]", lo, hi);
+		text += buf;
+	}
+	return text;
+}
+
+static void show_cost_trend(BinaryView*)
+{
+	string dir;
+	if (!GetDirectoryNameInput(dir, "Firmware directory"))
+		return;
+
+	WorkerEnqueue([=]() {
+		Ref<BackgroundTask> task = new BackgroundTask("Measuring AFUC handler costs...", true);
+		auto t0 = chrono::steady_clock::now();
+
+		vector<filesystem::path> paths;
+		error_code ec;
+		for (auto it = filesystem::recursive_directory_iterator(dir, ec);
+		     !ec && it != filesystem::recursive_directory_iterator(); it.increment(ec))
+			if (it->is_regular_file())
+				paths.push_back(it->path());
+		sort(paths.begin(), paths.end());
+
+		/* Each file is independent: emulate its bootstrap and walk its
+		 * handlers on a pool of threads */
+		vector<FileCosts> files(paths.size());
+		atomic<size_t> next(0);
+		auto work = [&]() {
+			for (size_t i; (i = next++) < paths.size() && !task->IsCancelled();) {
+				files[i].name = paths[i].filename().string();
+				ifstream f(paths[i], ios::binary);
+				vector<char> bytes((istreambuf_iterator<char>(f)), istreambuf_iterator<char>());
+				if (bytes.size() < 8)
+					continue;
+				vector<uint32_t> image(bytes.size() / 4);
+				memcpy(image.data(), bytes.data(), image.size() * 4);
+				files[i].valid = afuc_image_handler_costs(image, files[i].costs);
+			}
+		};
+		size_t nthreads = min<size_t>(max(1u, thread::hardware_concurrency()), paths.size());
+		vector<thread> pool;
+		for (size_t t = 1; t < nthreads; t++)
+			pool.emplace_back(work);
+		work();
+		for (thread& t : pool)
+			t.join();
+		if (task->IsCancelled()) {
+			task->Finish();
+			return;
+		}
+
+		string report = "# AFUC handler cost across generations\n\n"
+			"| File | Generation | fw_id | Version | Handlers |\n|---|---|---|---|---|\n";
+		map<string, array<GenStats, 3>> packets;
+		char buf[160];
+		size_t measured = 0;
+		for (const FileCosts& f : files) {
+			if (!f.valid)
+				continue;
+			const AfucImageCosts& c = f.costs;
+			int g = c.gpuver - AFUC_A5XX;
+			snprintf(buf, sizeof(buf), " | %s | 0x%03x | 0x%03x | ", s_gen_names[g], c.fw_id, c.version);
+			report += "| " + f.name + buf +
+				(c.has_table ? to_string(c.handlers.size()) : string("no packet table")) + " |\n";
+			if (c.has_table)
+				measured++;
+			for (const AfucImageHandler& h : c.handlers) {
+				GenStats& s = packets[h.packet][g];
+				s.cost.push_back(h.cost);
+				s.insns.push_back(h.insns);
+				s.expected.push_back(h.expected);
+			}
+		}
+
+		/* Largest change between neighbouring generations first */
+		struct Row { string packet; double change; string trend; };
+		vector<Row> rows;
+		for (const auto& [packet, gens] : packets) {
+			Row r = { packet, 0.0, "" };
+			int prev = -1;
+			for (int g = 0; g < 3; g++) {
+				if (gens[g].cost.empty())
+					continue;
+				if (prev >= 0) {
+					double a = median(gens[prev].cost), b = median(gens[g].cost);
+					double pct = a ? (b - a) * 100.0 / a : 0.0;
+					snprintf(buf, sizeof(buf), "%s%s→%s %+.0f%%", r.trend.empty() ? "" : ", ",
+						s_gen_names[prev], s_gen_names[g], pct);
+					r.trend += buf;
+					r.change = max(r.change, fabs(pct));
+				}
+				prev = g;
+			}
+			rows.push_back(r);
+		}
+		stable_sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.change > b.change; });
+
+		report += "\n## Per packet\n\nMedian cost / expected cost (instructions) over each "
+			"generation's files, with the range if they differ.\n\n"
+			"| Packet | a5xx | a6xx | a7xx | Change |\n|---|---|---|---|---|\n";
+		for (const Row& r : rows) {
+			const array<GenStats, 3>& gens = packets[r.packet];
+			report += "| " + r.packet + " | " + cell_text(gens[0]) + " | " + cell_text(gens[1]) +
+				" | " + cell_text(gens[2]) + " | " + r.trend + " |\n";
+		}
+
+		auto ms = chrono::duration_cast<chrono::milliseconds>(
+			chrono::steady_clock::now() - t0).count();
+		snprintf(buf, sizeof(buf), "\n%zu packets from %zu firmware files with a packet table "
+			"(%zu files scanned, %zu threads, %lld ms)\n",
+			packets.size(), measured, paths.size(), nthreads, (long long)ms);
+		report += buf;
+
+		task->Finish();
+		ShowMarkdownReport("AFUC Handler Cost Trend", report, report);
+	}, "AFUC handler cost trend");
+}
+
+void afuc_register_trend_commands()
+{
+	PluginCommand::Register("AFUC\\Handler Cost Trend in Corpus...",
+		"Compare the cost of each packet's handler across the firmware files in a directory",
+		show_cost_trend);
+}
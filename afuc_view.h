@@ -0,0 +1,147 @@
+/*
+ * Binary Ninja glue shared between the AFUC plugin modules.
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "binaryninjaapi.h"
+#include "afuc.h"
+
+/* ─── View / architecture helpers ──────────────────────────── */
+
+/* GPU generation of an AFUC architecture; false for foreign archs */
+bool afuc_arch_gpuver(BinaryNinja::Architecture* arch, AfucGpuVer& gpuver);
+bool afuc_view_gpuver(BinaryNinja::BinaryView* view, AfucGpuVer& gpuver);
+
+/* Validity check for per-function commands: 'func' is AFUC code */
+bool afuc_is_function(BinaryNinja::BinaryView* view, BinaryNinja::Function* func);
+
+/* View metadata of the fw_id whose register overlay applies (0: none) */
+#define AFUC_REG_OVERLAY_KEY "afuc.reg_overlay"
+
+/* Register names of the chip the view was opened for: the generation
+ * base table with the overlay named by AFUC_REG_OVERLAY_KEY */
+const AfucRegTable* afuc_view_reg_table(BinaryNinja::BinaryView* view);
+
+/* Read the whole instruction space as words; 'base' receives the
+ * address of word 0. */
+std::vector<uint32_t> afuc_read_code(BinaryNinja::BinaryView* view, uint64_t& base);
+
+/* Control-flow bitmaps of the view's code, built on first use and
+ * rebuilt after the code is written to; null for non-AFUC views. */
+std::shared_ptr<const AfucFlowMap> afuc_view_flow_map(BinaryNinja::BinaryView* view);
+
+/* Whole-image register liveness, cached alongside the flow map */
+std::shared_ptr<const AfucLiveness> afuc_view_liveness(BinaryNinja::BinaryView* view);
+
+/* Function symbols of the view by address, built on first use and kept
+ * current from symbol notifications; null for non-AFUC views. */
+std::shared_ptr<AfucLabelIndex> afuc_view_label_index(BinaryNinja::BinaryView* view);
+
+/* View metadata of the payload field names, auto: "addrs" (sorted) and
+ * "text" ("CP_DRAW_INDX_OFFSET.num_indices, ...") */
+#define AFUC_PM4_FIELDS_KEY "afuc.pm4_fields"
+
+/* Recover the packet table from the bootstrap, name the handlers after
+ * their packets and name each payload read's field in the
+ * AFUC_PM4_FIELDS_KEY metadata, which the payload fields layer draws.
+ * 'image' is the whole firmware file, header word included. With
+ * 'on_demand' the handlers are only named, not queued for analysis. */
+void afuc_apply_packet_table(BinaryNinja::BinaryView* view, BinaryNinja::Platform* plat,
+                             AfucGpuVer gpuver, const std::vector<uint32_t>& image,
+                             bool on_demand);
+
+/* Name one handler's payload reads, as afuc_apply_packet_table does
+ * for every handler when not on demand */
+void afuc_annotate_packet_handler(BinaryNinja::BinaryView* view, uint64_t addr);
+
+/* ─── On-demand analysis ───────────────────────────────────── */
+
+/* View setting: only name the handlers on load and analyze each one
+ * when it is first asked for */
+#define AFUC_ON_DEMAND_SETTING "afuc.analysis.onDemand"
+
+bool afuc_view_on_demand(BinaryNinja::BinaryView* view);
+
+/* Analyze the function at 'addr' now if it isn't yet, annotate it if it
+ * is a packet handler, and prefetch its callees in the background */
+void afuc_demand_function(BinaryNinja::BinaryView* view, uint64_t addr);
+
+/* Called by the workflow for each analyzed function: in on-demand views
+ * a function the user created is treated as demanded */
+void afuc_demand_analyzed(BinaryNinja::Function* func);
+
+/* Comment firmware header / tag nops and store their payloads as view
+ * metadata ("afuc.firmware", "afuc.nop_payloads"). */
+void afuc_apply_nop_metadata(BinaryNinja::BinaryView* view, const std::vector<uint32_t>& image);
+
+/* Function metadata key of the cached handler effect summaries */
+#define AFUC_HANDLER_EFFECTS_KEY "afuc.handler_effects"
+
+/* View metadata of the user's branch probability overrides ("addrs",
+ * "percent"), and function metadata of the estimated block frequencies
+ * ("starts", "freq" in thousandths, "branches", "taken" in percent,
+ * "hints") */
+#define AFUC_BRANCH_PROB_KEY "afuc.branch_prob"
+#define AFUC_BLOCK_FREQ_KEY "afuc.block_freq"
+
+/* Branch address -> taken percent, as set with Set Branch Probability */
+std::map<uint64_t, uint32_t> afuc_branch_overrides(BinaryNinja::BinaryView* view);
+
+/* Drop cached handler metrics and effect summaries that cover any of
+ * 'changed' (or all) */
+void afuc_invalidate_handler_metrics(BinaryNinja::BinaryView* view,
+                                     const std::set<uint64_t>& changed, bool all);
+
+/* While held, afuc_invalidate_handler_metrics() does nothing for the
+ * view; the holder invalidates once when done. Calls nest. */
+void afuc_hold_handler_metrics(BinaryNinja::BinaryView* view, bool hold);
+
+/* ─── Reloading ────────────────────────────────────────────── */
+
+/* Apply a rebuilt image (header word included) to the open view in
+ * place; false if it can't be, e.g. it is for another chip. */
+bool afuc_reload_image(BinaryNinja::BinaryView* view, const std::vector<uint32_t>& image);
+
+/* Polls 'path' and reloads 'view' from it on the main thread whenever
+ * it settles after a change; holds a reference to the view until
+ * destroyed. Null if the file doesn't exist. */
+class AfucFileWatcher;
+std::shared_ptr<AfucFileWatcher> afuc_watch_file(BinaryNinja::BinaryView* view, const std::string& path);
+
+/* Start or stop watching the view's file; 'watching' receives the new state */
+bool afuc_toggle_watch(BinaryNinja::BinaryView* view, bool& watching);
+
+/* Stop watching, e.g. because the view is being closed */
+void afuc_stop_watch(BinaryNinja::BinaryView* view);
+
+/* ─── Module registration (called from CorePluginInit) ─────── */
+
+void afuc_register_search_commands();
+void afuc_register_dashboard_commands();
+void afuc_register_workflow();
+void afuc_register_liveness_layer();
+void afuc_register_reload_commands();
+void afuc_register_preempt_commands();
+void afuc_register_sync_commands();
+void afuc_register_pend_commands();
+void afuc_register_fetch_commands();
+void afuc_register_effects_commands();
+void afuc_register_equiv_commands();
+void afuc_register_freq_commands();
+void afuc_register_trend_commands();
+void afuc_register_demand_commands();
+void afuc_register_poll_commands();
+void afuc_register_footprint_commands();
+void afuc_register_iblevel_commands();
+void afuc_register_labels_layer();
+void afuc_register_pm4_layer();
@@ -0,0 +1,309 @@
+/*
+ * AFUC function analysis workflow.
+ *
+ * Per-function analyses run as activities in the core's function
+ * workflow, on its worker threads alongside normal analysis, and are
+ * redone whenever the function is reanalyzed. Results are stored as
+ * function metadata:
+ *   afuc.ctrl_regs   control registers read and written
+ *   afuc.fifo        $data dwords consumed (~0 if it depends on $rem)
+ *   afuc.clobbers    registers written, including by analyzed callees
+ *   afuc.secure      blocks only reached through a setsecure success
+ *   afuc.block_freq  estimated executions of each block per call
+ *   afuc.demanded    a user function already annotated and prefetched
+ *                    from, in on-demand views
+ *
+ * Based on the freedreno project's AFUC tools by Rob Clark,
+ * Connor Abbott, and the freedreno contributors.
+ * https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/afuc
+ */
+
+#include <cmath>
+#include <map>
+#include <set>
+
+#include "binaryninjaapi.h"
+#include "afuc.h"
+#include "afuc_pm4.h"
+#include "afuc_view.h"
+
+using namespace BinaryNinja;
+using namespace std;
+
+static const char* s_secure_tag = "AFUC Secure";
+
+/* Activities only apply to functions in AFUC firmware views */
+static const char* s_eligibility =
+	R"("eligibility": {"auto": {}, "predicates": [)"
+	R"({"type": "viewType", "value": ["AFUC"], "operator": "in"}]})";
+
+namespace {
+
+struct FuncInsn {
+	uint64_t addr;
+	AfucInsn insn;
+};
+
+}
+
+/* ─── Helpers ──────────────────────────────────────────────── */
+
+static bool decode_function(Function* func, AfucGpuVer& gpuver, vector<FuncInsn>& out)
+{
+	if (!afuc_arch_gpuver(func->GetArchitecture(), gpuver))
+		return false;
+	Ref<BinaryView> view = func->GetView();
+	for (const Ref<BasicBlock>& bb : func->GetBasicBlocks()) {
+		DataBuffer buf = view->ReadBuffer(bb->GetStart(), bb->GetLength());
+		const uint8_t* data = (const uint8_t*)buf.GetData();
+		for (size_t off = 0; off + 4 <= buf.GetLength(); off += 4) {
+			FuncInsn fi;
+			fi.addr = bb->GetStart() + off;
+			if (afuc_decode(data + off, 4, fi.addr, fi.insn, gpuver))
+				out.push_back(fi);
+		}
+	}
+	return true;
+}
+
+/* ─── Activities ───────────────────────────────────────────── */
+
+static void annotate_ctrl_regs(Ref<AnalysisContext> ac)
+{
+	Ref<Function> func = ac->GetFunction();
+	AfucGpuVer gpuver;
+	vector<FuncInsn> insns;
+	if (!func || !decode_function(func, gpuver, insns))
+		return;
+
+	set<uint64_t> reads, writes;
+	for (const FuncInsn& fi : insns) {
+		if (fi.insn.op == AFUC_CREAD)
+			reads.insert(fi.insn.base);
+		else if (fi.insn.op == AFUC_CWRITE)
+			writes.insert(fi.insn.base);
+	}
+
+	map<string, Ref<Metadata>> kv;
+	kv["reads"] = new Metadata(vector<uint64_t>(reads.begin(), reads.end()));
+	kv["writes"] = new Metadata(vector<uint64_t>(writes.begin(), writes.end()));
+	func->StoreMetadata("afuc.ctrl_regs", new Metadata(kv), true);
+}
+
+static void account_fifo(Ref<AnalysisContext> ac)
+{
+	Ref<Function> func = ac->GetFunction();
+	AfucGpuVer gpuver;
+	if (!func || !afuc_arch_gpuver(func->GetArchitecture(), gpuver))
+		return;
+	shared_ptr<const AfucFlowMap> map = afuc_view_flow_map(func->GetView());
+	if (!map)
+		return;
+
+	/* walks into callees, so use the whole image rather than the blocks */
+	vector<AfucPayloadRead> reads;
+	int dwords;
+	afuc_payload_reads(gpuver, map->words.data(), map->words.size(),
+		func->GetStart() - map->base, reads, &dwords);
+	uint64_t consumed = dwords < 0 ? ~0ull : (uint64_t)dwords;
+	func->StoreMetadata("afuc.fifo", new Metadata(consumed), true);
+}
+
+static void summarize_clobbers(Ref<AnalysisContext> ac)
+{
+	Ref<Function> func = ac->GetFunction();
+	AfucGpuVer gpuver;
+	vector<FuncInsn> insns;
+	if (!func || !decode_function(func, gpuver, insns))
+		return;
+
+	/* $00 writes are discarded */
+	uint64_t mask = 0;
+	for (const FuncInsn& fi : insns)
+		mask |= afuc_insn_dst_regs(fi.insn) & ~1u;
+
+	/* callees analyzed so far; a callee that changes reanalyzes us */
+	Ref<BinaryView> view = func->GetView();
+	Ref<Platform> plat = view->GetDefaultPlatform();
+	for (uint64_t callee : func->GetCallees()) {
+		Ref<Function> cf = plat ? view->GetAnalysisFunction(plat, callee) : nullptr;
+		if (!cf || cf->GetStart() == func->GetStart())
+			continue;
+		Ref<Metadata> md = cf->QueryMetadata("afuc.clobbers");
+		if (md && md->IsUnsignedInteger())
+			mask |= md->GetUnsignedInteger();
+	}
+
+	Ref<Metadata> old = func->QueryMetadata("afuc.clobbers");
+	if (old && old->IsUnsignedInteger() && old->GetUnsignedInteger() == mask)
+		return;
+	func->StoreMetadata("afuc.clobbers", new Metadata(mask), true);
+
+	/* masks only grow, so this settles even through recursion */
+	set<uint64_t> callers;
+	for (const ReferenceSource& ref : view->GetCallers(func->GetStart())) {
+		if (!ref.func || ref.func->GetStart() == func->GetStart())
+			continue;
+		if (callers.insert(ref.func->GetStart()).second)
+			ref.func->Reanalyze();
+	}
+}
+
+static void mark_secure_paths(Ref<AnalysisContext> ac)
+{
+	Ref<Function> func = ac->GetFunction();
+	AfucGpuVer gpuver;
+	if (!func || !afuc_arch_gpuver(func->GetArchitecture(), gpuver))
+		return;
+	Ref<Architecture> arch = func->GetArchitecture();
+	Ref<BinaryView> view = func->GetView();
+
+	/* Success edges: the taken side of a block ending in setsecure */
+	set<uint64_t> entries;
+	map<uint64_t, Ref<BasicBlock>> blocks;
+	for (const Ref<BasicBlock>& bb : func->GetBasicBlocks()) {
+		blocks[bb->GetStart()] = bb;
+		if (bb->GetLength() < 4)
+			continue;
+		DataBuffer buf = view->ReadBuffer(bb->GetEnd() - 4, 4);
+		AfucInsn insn;
+		if (buf.GetLength() < 4 ||
+		    !afuc_decode((const uint8_t*)buf.GetData(), 4, bb->GetEnd() - 4, insn, gpuver) ||
+		    insn.op != AFUC_SETSECURE)
+			continue;
+		for (const BasicBlockEdge& e : bb->GetOutgoingEdges())
+			if (e.type == TrueBranch && e.target)
+				entries.insert(e.target->GetStart());
+	}
+
+	auto reach = [&](vector<uint64_t> work, bool skip_success) {
+		set<uint64_t> seen;
+		while (!work.empty()) {
+			uint64_t at = work.back();
+			work.pop_back();
+			auto it = blocks.find(at);
+			if (it == blocks.end() || !seen.insert(at).second)
+				continue;
+			for (const BasicBlockEdge& e : it->second->GetOutgoingEdges()) {
+				if (!e.target)
+					continue;
+				if (skip_success && e.type == TrueBranch && entries.count(e.target->GetStart()))
+					continue;
+				work.push_back(e.target->GetStart());
+			}
+		}
+		return seen;
+	};
+
+	/* Secure: reachable from a success edge but not without one */
+	set<uint64_t> open = reach({ func->GetStart() }, true);
+	set<uint64_t> secure;
+	for (uint64_t b : reach(vector<uint64_t>(entries.begin(), entries.end()), false))
+		if (!open.count(b))
+			secure.insert(b);
+
+	Ref<TagType> tagType = view->GetTagType(s_secure_tag);
+	if (!tagType) {
+		tagType = new TagType(view, s_secure_tag, "\xF0\x9F\x94\x92");
+		view->AddTagType(tagType);
+	}
+
+	/* Drop the previous run's tags before placing new ones */
+	Ref<Metadata> old = func->QueryMetadata("afuc.secure");
+	if (old && old->IsArray())
+		for (uint64_t addr : old->GetUnsignedIntegerList())
+			func->RemoveAutoAddressTagsOfType(arch, addr, tagType);
+
+	vector<uint64_t> starts(secure.begin(), secure.end());
+	for (uint64_t b : entries)
+		if (secure.count(b))
+			func->AddAutoAddressTag(arch, b, tagType, "setsecure succeeded", true);
+	func->StoreMetadata("afuc.secure", new Metadata(starts), true);
+}
+
+static void estimate_block_freq(Ref<AnalysisContext> ac)
+{
+	Ref<Function> func = ac->GetFunction();
+	AfucGpuVer gpuver;
+	if (!func || !afuc_arch_gpuver(func->GetArchitecture(), gpuver))
+		return;
+	Ref<BinaryView> view = func->GetView();
+	shared_ptr<const AfucFlowMap> flow = afuc_view_flow_map(view);
+	if (!flow)
+		return;
+
+	/* the walk works in word-array addresses, the view in its own */
+	map<uint64_t, uint32_t> overrides;
+	for (const auto& [a, p] : afuc_branch_overrides(view))
+		overrides[a - flow->base] = p;
+
+	vector<AfucFreqBlock> blocks;
+	afuc_block_frequencies(gpuver, flow->words.data(), flow->words.size(),
+		func->GetStart() - flow->base, overrides, blocks);
+
+	vector<uint64_t> starts, freq, branches, taken, hints;
+	for (const AfucFreqBlock& b : blocks) {
+		starts.push_back(b.start + flow->base);
+		freq.push_back((uint64_t)llround(b.freq * 1000));
+		branches.push_back(b.branch == ~0ull ? b.branch : b.branch + flow->base);
+		taken.push_back((uint64_t)llround(b.taken * 100));
+		hints.push_back(b.hint);
+	}
+	map<string, Ref<Metadata>> kv;
+	kv["starts"] = new Metadata(starts);
+	kv["freq"] = new Metadata(freq);
+	kv["branches"] = new Metadata(branches);
+	kv["taken"] = new Metadata(taken);
+	kv["hints"] = new Metadata(hints);
+	func->StoreMetadata(AFUC_BLOCK_FREQ_KEY, new Metadata(kv), true);
+}
+
+static void prefetch_neighbors(Ref<AnalysisContext> ac)
+{
+	Ref<Function> func = ac->GetFunction();
+	if (func)
+		afuc_demand_analyzed(func);
+}
+
+/* ─── Registration ─────────────────────────────────────────── */
+
+namespace {
+
+struct ActivityDef {
+	const char* name;
+	const char* title;
+	const char* description;
+	void (*fn)(Ref<AnalysisContext>);
+};
+
+}
+
+static const ActivityDef s_activities[] = {
+	{ "afuc.function.ctrlRegs", "AFUC Control Registers",
+	  "Record the control registers each function reads and writes", annotate_ctrl_regs },
+	{ "afuc.function.fifo", "AFUC FIFO Accounting",
+	  "Count the $data dwords each function consumes", account_fifo },
+	{ "afuc.function.clobbers", "AFUC Clobbers",
+	  "Summarize the registers each function and its callees write", summarize_clobbers },
+	{ "afuc.function.securePaths", "AFUC Secure Paths",
+	  "Tag blocks only reached after a successful setsecure", mark_secure_paths },
+	{ "afuc.function.blockFreq", "AFUC Block Frequency",
+	  "Estimate branch probabilities and per-block execution frequencies", estimate_block_freq },
+	{ "afuc.function.onDemand", "AFUC On-Demand Prefetch",
+	  "Annotate a handler the user asked for and prefetch its callees", prefetch_neighbors },
+};
+
+void afuc_register_workflow()
+{
+	Ref<Workflow> wf = Workflow::Instance("core.function.metaAnalysis")->Clone("core.function.metaAnalysis");
+
+	vector<string> names;
+	for (const ActivityDef& a : s_activities) {
+		string config = string("{\"name\": \"") + a.name + "\", \"title\": \"" + a.title +
+			"\", \"description\": \"" + a.description + "\", " + s_eligibility + "}";
+		wf->RegisterActivity(new Activity(config, a.fn));
+		names.push_back(a.name);
+	}
+	wf->InsertAfter("core.function.basicBlockAnalysis", names);
+	Workflow::RegisterWorkflow(wf);
+}
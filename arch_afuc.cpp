@@ -12,19 +12,26 @@
 #include <cinttypes>
 #include <cstdio>
 #include <cstring>
+#include <map>
+#include <mutex>
+#include <tuple>
 
 #include "binaryninjaapi.h"
 #include "lowlevelilinstruction.h"
 #include "afuc.h"
+#include "afuc_view.h"
 
 using namespace BinaryNinja;
 using namespace std;
 
 /* ─── Forward declarations ─────────────────────────────────── */
 
-extern const char* afuc_op_name(AfucOp op);
 bool afuc_get_llil(Architecture* arch, uint64_t addr, LowLevelILFunction& il,
                    const AfucInsn& insn, AfucGpuVer gpuver);
+bool afuc_lift_function(Architecture* arch, LowLevelILFunction& il,
+                        FunctionLifterContext& ctx, AfucGpuVer gpuver);
+bool afuc_analyze_blocks(Architecture* arch, Function* func, BasicBlockAnalysisContext& ctx,
+                         AfucGpuVer gpuver, const AfucFlowMap& map);
 
 /* ─── Architecture class ───────────────────────────────────── */
 
@@ -124,6 +131,7 @@ public:
 		AFUC_INTRIN_CMP,
 		AFUC_INTRIN_MSB,
 		AFUC_INTRIN_SETSECURE,
+		AFUC_INTRIN_SET_DRAW_STATE,
 		AFUC_INTRIN_COUNT,
 	};
 
@@ -135,6 +143,7 @@ public:
 		case AFUC_INTRIN_CMP:       return "cmp";
 		case AFUC_INTRIN_MSB:       return "msb";
 		case AFUC_INTRIN_SETSECURE: return "setsecure";
+		case AFUC_INTRIN_SET_DRAW_STATE: return "set_draw_state";
 		default:                    return "";
 		}
 	}
@@ -161,6 +170,13 @@ public:
 			return { NameAndType("val", Type::IntegerType(4, false)) };
 		case AFUC_INTRIN_SETSECURE:
 			return { NameAndType("mode", Type::IntegerType(4, false)) };
+		case AFUC_INTRIN_SET_DRAW_STATE:
+			return {
+				NameAndType("reg", Type::IntegerType(4, false)),
+				NameAndType("hdr", Type::IntegerType(4, false)),
+				NameAndType("sds_base", Type::IntegerType(8, false)),
+				NameAndType("sds_dwords", Type::IntegerType(4, false)),
+			};
 		default:
 			return {};
 		}
@@ -173,9 +189,8 @@ public:
 		case AFUC_INTRIN_MAX:
 		case AFUC_INTRIN_CMP:
 		case AFUC_INTRIN_MSB:
+		case AFUC_INTRIN_SETSECURE:   /* non-zero if the switch succeeded */
 			return { Type::IntegerType(4, false) };
-		case AFUC_INTRIN_SETSECURE:
-			return {};
 		default:
 			return {};
 		}
@@ -238,6 +253,12 @@ public:
 			result.AddBranch(UnresolvedBranch, 0, nullptr, true);
 			break;
 
+		case AFUC_SETSECURE:
+			/* on success execution resumes three instructions later */
+			result.AddBranch(TrueBranch, addr + 16);
+			result.AddBranch(FalseBranch, addr + 4);
+			break;
+
 		case AFUC_RET:
 		case AFUC_IRET:
 		case AFUC_SRET:
@@ -313,18 +334,18 @@ public:
 		char buf[64];
 
 		/* ── Operands by instruction type ───────────────── */
-		switch (insn.op) {
+		switch (afuc_op_form(insn.op)) {
 
 		/* ── NOP ──────────────────────────────────────── */
-		case AFUC_NOP:
+		case AFUC_FORM_NOP:
+			if (insn.nop_payload) {
+				snprintf(buf, sizeof(buf), "0x%06x", insn.nop_payload);
+				result.emplace_back(IntegerToken, buf, insn.nop_payload);
+			}
 			break;
 
 		/* ── ALU 2-source register ────────────────────── */
-		case AFUC_ADD: case AFUC_ADDHI: case AFUC_SUB: case AFUC_SUBHI:
-		case AFUC_AND: case AFUC_OR: case AFUC_XOR:
-		case AFUC_SHL: case AFUC_USHR: case AFUC_ISHR: case AFUC_ROT:
-		case AFUC_MUL8: case AFUC_MIN: case AFUC_MAX: case AFUC_CMP:
-		case AFUC_BIC: case AFUC_SETBIT_R:
+		case AFUC_FORM_ALU:
 		{
 			if (insn.is_immed) {
 				/* Immediate form */
@@ -350,8 +371,7 @@ public:
 		}
 
 		/* ── NOT / MSB (1-source) ─────────────────────── */
-		case AFUC_NOT:
-		case AFUC_MSB:
+		case AFUC_FORM_ALU1:
 		{
 			result.emplace_back(RegisterToken, afuc_dst_reg_name(insn.dst_enc));
 			result.emplace_back(OperandSeparatorToken, ", ");
@@ -366,14 +386,14 @@ public:
 		}
 
 		/* ── MOV (pseudo for OR with $00) ─────────────── */
-		case AFUC_MOV:
+		case AFUC_FORM_MOV:
 			result.emplace_back(RegisterToken, afuc_dst_reg_name(insn.dst_enc));
 			result.emplace_back(OperandSeparatorToken, ", ");
 			result.emplace_back(RegisterToken, afuc_src_reg_name(insn.src2_enc));
 			break;
 
 		/* ── MOVI (move immediate with shift) ─────────── */
-		case AFUC_MOVI:
+		case AFUC_FORM_MOVI:
 		{
 			result.emplace_back(RegisterToken, afuc_dst_reg_name(insn.dst_enc));
 			result.emplace_back(OperandSeparatorToken, ", ");
@@ -400,8 +420,7 @@ public:
 		}
 
 		/* ── SETBIT / CLRBIT ──────────────────────────── */
-		case AFUC_SETBIT:
-		case AFUC_CLRBIT:
+		case AFUC_FORM_BIT:
 			result.emplace_back(RegisterToken, afuc_dst_reg_name(insn.dst_enc));
 			result.emplace_back(OperandSeparatorToken, ", ");
 			result.emplace_back(RegisterToken, afuc_src_reg_name(insn.src1_enc));
@@ -411,8 +430,7 @@ public:
 			break;
 
 		/* ── UBFX / BFI ───────────────────────────────── */
-		case AFUC_UBFX:
-		case AFUC_BFI:
+		case AFUC_FORM_BITFIELD:
 			result.emplace_back(RegisterToken, afuc_dst_reg_name(insn.dst_enc));
 			result.emplace_back(OperandSeparatorToken, ", ");
 			result.emplace_back(RegisterToken, afuc_src_reg_name(insn.src1_enc));
@@ -425,8 +443,7 @@ public:
 			break;
 
 		/* ── CWRITE / SWRITE ──────────────────────────── */
-		case AFUC_CWRITE:
-		case AFUC_SWRITE:
+		case AFUC_FORM_CWRITE:
 		{
 			result.emplace_back(RegisterToken, afuc_src_reg_name(insn.src1_enc));
 			result.emplace_back(OperandSeparatorToken, ", ");
@@ -441,7 +458,7 @@ public:
 			if (rname) {
 				string sym = (insn.op == AFUC_SWRITE) ? string("%") : string("@");
 				sym += rname;
-				result.emplace_back(TextToken, sym);
+				result.emplace_back(TextToken, sym, insn.base);
 			} else {
 				snprintf(buf, sizeof(buf), "0x%03x", insn.base);
 				result.emplace_back(IntegerToken, buf, insn.base);
@@ -453,8 +470,7 @@ public:
 		}
 
 		/* ── CREAD / SREAD ────────────────────────────── */
-		case AFUC_CREAD:
-		case AFUC_SREAD:
+		case AFUC_FORM_CREAD:
 		{
 			result.emplace_back(RegisterToken, afuc_dst_reg_name(insn.dst_enc));
 			result.emplace_back(OperandSeparatorToken, ", ");
@@ -469,7 +485,7 @@ public:
 			if (rname) {
 				string sym = (insn.op == AFUC_SREAD) ? string("%") : string("@");
 				sym += rname;
-				result.emplace_back(TextToken, sym);
+				result.emplace_back(TextToken, sym, insn.base);
 			} else {
 				snprintf(buf, sizeof(buf), "0x%03x", insn.base);
 				result.emplace_back(IntegerToken, buf, insn.base);
@@ -481,7 +497,7 @@ public:
 		}
 
 		/* ── STORE ────────────────────────────────────── */
-		case AFUC_STORE:
+		case AFUC_FORM_STORE:
 			result.emplace_back(RegisterToken, afuc_src_reg_name(insn.src1_enc));
 			result.emplace_back(OperandSeparatorToken, ", ");
 			result.emplace_back(BeginMemoryOperandToken, "[");
@@ -495,7 +511,7 @@ public:
 			break;
 
 		/* ── LOAD ─────────────────────────────────────── */
-		case AFUC_LOAD:
+		case AFUC_FORM_LOAD:
 			result.emplace_back(RegisterToken, afuc_dst_reg_name(insn.dst_enc));
 			result.emplace_back(OperandSeparatorToken, ", ");
 			result.emplace_back(BeginMemoryOperandToken, "[");
@@ -509,8 +525,7 @@ public:
 			break;
 
 		/* ── Conditional branches (immediate compare) ── */
-		case AFUC_BRNE_IMM:
-		case AFUC_BREQ_IMM:
+		case AFUC_FORM_BR_IMM:
 		{
 			result.emplace_back(RegisterToken, afuc_src_reg_name(insn.src1_enc));
 			result.emplace_back(OperandSeparatorToken, ", ");
@@ -524,8 +539,7 @@ public:
 		}
 
 		/* ── Conditional branches (bit test) ───────────── */
-		case AFUC_BRNE_BIT:
-		case AFUC_BREQ_BIT:
+		case AFUC_FORM_BR_BIT:
 		{
 			result.emplace_back(RegisterToken, afuc_src_reg_name(insn.src1_enc));
 			result.emplace_back(OperandSeparatorToken, ", ");
@@ -539,7 +553,7 @@ public:
 		}
 
 		/* ── Unconditional relative jump ───────────────── */
-		case AFUC_JUMP:
+		case AFUC_FORM_REL:
 		{
 			uint64_t target = addr + 4 + (int64_t)insn.branch_offset * 4;
 			snprintf(buf, sizeof(buf), "#0x%" PRIx64, target);
@@ -547,18 +561,8 @@ public:
 			break;
 		}
 
-		/* ── CALL / BL ─────────────────────────────────── */
-		case AFUC_CALL:
-		case AFUC_BL:
-		{
-			uint64_t target = (uint64_t)insn.branch_target * 4;
-			snprintf(buf, sizeof(buf), "#0x%" PRIx64, target);
-			result.emplace_back(PossibleAddressToken, buf, target);
-			break;
-		}
-
-		/* ── JUMPA (absolute) ──────────────────────────── */
-		case AFUC_JUMPA:
+		/* ── CALL / BL / JUMPA (absolute) ──────────────── */
+		case AFUC_FORM_ABS:
 		{
 			uint64_t target = (uint64_t)insn.branch_target * 4;
 			snprintf(buf, sizeof(buf), "#0x%" PRIx64, target);
@@ -567,18 +571,15 @@ public:
 		}
 
 		/* ── JUMPR (indirect) ──────────────────────────── */
-		case AFUC_JUMPR:
+		case AFUC_FORM_INDIRECT:
 			result.emplace_back(RegisterToken, afuc_src_reg_name(insn.src1_enc));
 			break;
 
-		/* ── RET / IRET / SRET / WAITIN / SETSECURE ──── */
-		case AFUC_RET:
-		case AFUC_IRET:
-		case AFUC_SRET:
-		case AFUC_WAITIN:
+		/* ── RET / IRET / SRET / WAITIN ───────────────── */
+		case AFUC_FORM_NONE:
 			break;
 
-		case AFUC_SETSECURE:
+		case AFUC_FORM_SECURE:
 			result.emplace_back(RegisterToken, "$02");
 			result.emplace_back(OperandSeparatorToken, ", ");
 			{
@@ -616,6 +617,30 @@ public:
 		return afuc_get_llil(this, addr, il, insn, m_gpuver);
 	}
 
+	/*
+	 * Block recovery from the view's precomputed leader/terminator
+	 * bitmaps instead of a GetInstructionInfo call per word.
+	 */
+	void AnalyzeBasicBlocks(Function* func, BasicBlockAnalysisContext& ctx) override
+	{
+		shared_ptr<const AfucFlowMap> map = afuc_view_flow_map(func->GetView());
+		if (map && afuc_analyze_blocks(this, func, ctx, m_gpuver, *map))
+			return;
+		DefaultAnalyzeBasicBlocks(func, ctx);
+	}
+
+	/*
+	 * Whole-function lifting: the core hands us the recovered blocks and
+	 * we lift them in one pass, which sees delay slots, (rep) and the
+	 * setsecure skip. GetInstructionLowLevelIL stays as the fallback.
+	 */
+	bool LiftFunction(LowLevelILFunction* il, FunctionLifterContext& ctx) override
+	{
+		if (afuc_lift_function(this, *il, ctx, m_gpuver))
+			return true;
+		return DefaultLiftFunction(il, ctx);
+	}
+
 	/* ── NOP conversion for patching ──────────────────── */
 
 	bool ConvertToNop(uint8_t* data, uint64_t addr, size_t len) override
@@ -641,7 +666,7 @@ public:
  *   0x6ee = A630 (a6xx)    0x6dc = A650 (a6xx)   0x6dd = A660 (a6xx)
  *   0x5ff = A530 (a5xx)
  */
-static AfucGpuVer afuc_detect_gpuver(uint32_t fw_id)
+AfucGpuVer afuc_detect_gpuver(uint32_t fw_id)
 {
 	switch (fw_id) {
 	case 0x730: case 0x740: case 0x512: case 0x520:
@@ -672,11 +697,281 @@ static uint32_t afuc_get_fwid(BinaryView* data)
 	return (word1 >> 12) & 0xfff;
 }
 
+/* ─── View / architecture helpers ─────────────────────────── */
+
+bool afuc_arch_gpuver(Architecture* arch, AfucGpuVer& gpuver)
+{
+	if (!arch)
+		return false;
+	string name = arch->GetName();
+	if (name == "afuc-a5xx")
+		gpuver = AFUC_A5XX;
+	else if (name == "afuc-a6xx")
+		gpuver = AFUC_A6XX;
+	else if (name == "afuc-a7xx")
+		gpuver = AFUC_A7XX;
+	else
+		return false;
+	return true;
+}
+
+bool afuc_view_gpuver(BinaryView* view, AfucGpuVer& gpuver)
+{
+	if (!view)
+		return false;
+	return afuc_arch_gpuver(view->GetDefaultArchitecture(), gpuver);
+}
+
+bool afuc_is_function(BinaryView*, Function* func)
+{
+	AfucGpuVer gpuver;
+	return func && afuc_arch_gpuver(func->GetArchitecture(), gpuver);
+}
+
+const AfucRegTable* afuc_view_reg_table(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	if (!afuc_view_gpuver(view, gpuver))
+		return nullptr;
+	Ref<Metadata> md = view->QueryMetadata(AFUC_REG_OVERLAY_KEY);
+	uint32_t fw_id = md && md->IsUnsignedInteger() ? (uint32_t)md->GetUnsignedInteger() : 0;
+	return afuc_reg_table(gpuver, fw_id);
+}
+
+vector<uint32_t> afuc_read_code(BinaryView* view, uint64_t& base)
+{
+	base = view->GetStart();
+	vector<uint32_t> words((view->GetEnd() - base) / 4);
+	if (!words.empty())
+		view->Read(words.data(), base, words.size() * 4);
+	return words;
+}
+
+/*
+ * Flow maps and liveness are shared by every function of a view.
+ * Commands and analysis callbacks get wrapper BinaryView objects, so the
+ * cache is keyed by the core handle; AfucBinaryView registers itself on
+ * load and drops its entry when it goes away, so a handle is never
+ * reused stale.
+ */
+struct ViewCache {
+	BinaryView* self = nullptr;
+	shared_ptr<const AfucFlowMap> flow;
+	shared_ptr<const AfucLiveness> live;
+	shared_ptr<AfucLabelIndex> labels;
+	shared_ptr<AfucFileWatcher> watcher;
+	uint64_t generation = 0;    /* bumped on every code change */
+
+	/* function symbols added (true) or removed while 'labels' is built */
+	vector<tuple<bool, uint64_t, string>> label_changes;
+	size_t label_builders = 0;
+};
+
+static mutex s_cache_lock;
+static map<BNBinaryView*, ViewCache> s_view_cache;
+
+shared_ptr<const AfucFlowMap> afuc_view_flow_map(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	if (!afuc_view_gpuver(view, gpuver))
+		return nullptr;
+
+	uint64_t generation;
+	{
+		lock_guard<mutex> lock(s_cache_lock);
+		auto it = s_view_cache.find(view->GetObject());
+		if (it == s_view_cache.end())
+			return nullptr;
+		if (it->second.flow)
+			return it->second.flow;
+		generation = it->second.generation;
+	}
+
+	uint64_t base;
+	auto map = make_shared<AfucFlowMap>();
+	afuc_build_flow_map(gpuver, afuc_read_code(view, base), base, *map);
+
+	/* a write while building may have been read half-applied: don't keep it */
+	lock_guard<mutex> lock(s_cache_lock);
+	auto it = s_view_cache.find(view->GetObject());
+	if (it == s_view_cache.end() || it->second.generation != generation)
+		return map;
+	if (!it->second.flow)
+		it->second.flow = map;
+	return it->second.flow;
+}
+
+shared_ptr<const AfucLiveness> afuc_view_liveness(BinaryView* view)
+{
+	AfucGpuVer gpuver;
+	shared_ptr<const AfucFlowMap> map = afuc_view_flow_map(view);
+	if (!map || !afuc_view_gpuver(view, gpuver))
+		return nullptr;
+
+	{
+		lock_guard<mutex> lock(s_cache_lock);
+		auto it = s_view_cache.find(view->GetObject());
+		if (it != s_view_cache.end() && it->second.live && it->second.flow == map)
+			return it->second.live;
+	}
+
+	auto live = make_shared<AfucLiveness>();
+	afuc_liveness(gpuver, *map, *live);
+
+	/* only keep it if the code didn't change underneath us */
+	lock_guard<mutex> lock(s_cache_lock);
+	auto it = s_view_cache.find(view->GetObject());
+	if (it != s_view_cache.end() && it->second.flow == map && !it->second.live)
+		it->second.live = live;
+	return live;
+}
+
+shared_ptr<AfucLabelIndex> afuc_view_label_index(BinaryView* view)
+{
+	size_t from;
+	{
+		lock_guard<mutex> lock(s_cache_lock);
+		auto it = s_view_cache.find(view->GetObject());
+		if (it == s_view_cache.end())
+			return nullptr;
+		ViewCache& entry = it->second;
+		if (entry.labels)
+			return entry.labels;
+		if (!entry.label_builders++)
+			entry.label_changes.clear();
+		from = entry.label_changes.size();
+	}
+
+	/* filled outside the lock and only published complete */
+	auto labels = make_shared<AfucLabelIndex>();
+	for (const Ref<Symbol>& sym : view->GetSymbolsOfType(FunctionSymbol))
+		labels->set(sym->GetAddress(), sym->GetShortName());
+
+	lock_guard<mutex> lock(s_cache_lock);
+	auto it = s_view_cache.find(view->GetObject());
+	if (it == s_view_cache.end())
+		return nullptr;
+	ViewCache& entry = it->second;
+	entry.label_builders--;
+	if (entry.labels)
+		return entry.labels;
+
+	/* changes since the symbol list was taken, in order; replaying one
+	 * the list already has is harmless */
+	for (size_t i = from; i < entry.label_changes.size(); i++) {
+		const auto& [added, start, name] = entry.label_changes[i];
+		if (added)
+			labels->set(start, name);
+		else
+			labels->erase(start, name);
+	}
+	entry.label_changes.clear();
+	return entry.labels = labels;
+}
+
+bool afuc_toggle_watch(BinaryView* view, bool& watching)
+{
+	shared_ptr<AfucFileWatcher> old;
+	lock_guard<mutex> lock(s_cache_lock);
+	auto it = s_view_cache.find(view->GetObject());
+	if (it == s_view_cache.end())
+		return false;
+
+	/* the watcher outlives any wrapper the command was given */
+	ViewCache& entry = it->second;
+	if (entry.watcher) {
+		old = std::move(entry.watcher);
+		watching = false;
+		return true;
+	}
+	entry.watcher = afuc_watch_file(entry.self, view->GetFile()->GetOriginalFilename());
+	watching = entry.watcher != nullptr;
+	return watching;
+}
+
+void afuc_stop_watch(BinaryView* view)
+{
+	/* joined outside the lock */
+	shared_ptr<AfucFileWatcher> old;
+	lock_guard<mutex> lock(s_cache_lock);
+	auto it = s_view_cache.find(view->GetObject());
+	if (it != s_view_cache.end())
+		old = std::move(it->second.watcher);
+}
+
 /* ─── BinaryView for AFUC firmware files ──────────────────── */
 
 class AfucBinaryView : public BinaryView
 {
+	/* Drops the cached analyses when the code is patched or resized */
+	class CacheInvalidator : public BinaryDataNotification
+	{
+		static void drop(BinaryView* view)
+		{
+			lock_guard<mutex> lock(s_cache_lock);
+			auto it = s_view_cache.find(view->GetObject());
+			if (it == s_view_cache.end())
+				return;
+			it->second.flow.reset();
+			it->second.live.reset();
+			it->second.generation++;
+		}
+
+		/* the label index is kept rather than rebuilt: only the one name
+		 * changes. One still being built gets the change replayed. */
+		static void relabel(BinaryView* view, Symbol* sym, bool added)
+		{
+			if (sym->GetType() != FunctionSymbol)
+				return;
+			shared_ptr<AfucLabelIndex> index;
+			{
+				lock_guard<mutex> lock(s_cache_lock);
+				auto it = s_view_cache.find(view->GetObject());
+				if (it == s_view_cache.end())
+					return;
+				ViewCache& entry = it->second;
+				if (!entry.labels) {
+					if (entry.label_builders)
+						entry.label_changes.emplace_back(added, sym->GetAddress(), sym->GetShortName());
+					return;
+				}
+				index = entry.labels;
+			}
+			if (added)
+				index->set(sym->GetAddress(), sym->GetShortName());
+			else
+				index->erase(sym->GetAddress(), sym->GetShortName());
+		}
+
+	public:
+		void OnBinaryDataWritten(BinaryView* view, uint64_t offset, size_t len) override
+		{
+			drop(view);
+			set<uint64_t> changed;
+			for (uint64_t addr = offset & ~3ull; addr < offset + len; addr += 4)
+				changed.insert(addr);
+			afuc_invalidate_handler_metrics(view, changed, false);
+		}
+		/* everything after the edit moved */
+		void OnBinaryDataInserted(BinaryView* view, uint64_t, size_t) override
+		{
+			drop(view);
+			afuc_invalidate_handler_metrics(view, {}, true);
+		}
+		void OnBinaryDataRemoved(BinaryView* view, uint64_t, uint64_t) override
+		{
+			drop(view);
+			afuc_invalidate_handler_metrics(view, {}, true);
+		}
+
+		void OnSymbolAdded(BinaryView* view, Symbol* sym) override { relabel(view, sym, true); }
+		void OnSymbolUpdated(BinaryView* view, Symbol* sym) override { relabel(view, sym, true); }
+		void OnSymbolRemoved(BinaryView* view, Symbol* sym) override { relabel(view, sym, false); }
+	};
+
 	bool m_parseOnly;
+	bool m_cached = false;
+	CacheInvalidator m_invalidator;
 
 public:
 	AfucBinaryView(BinaryView* data, bool parseOnly = false)
@@ -684,6 +979,17 @@ public:
 	{
 	}
 
+	~AfucBinaryView() override
+	{
+		if (!m_cached)
+			return;
+		UnregisterNotification(&m_invalidator);
+
+		/* a watcher holds a reference, so it was stopped when the view closed */
+		lock_guard<mutex> lock(s_cache_lock);
+		s_view_cache.erase(GetObject());
+	}
+
 	bool Init() override
 	{
 		try {
@@ -732,9 +1038,32 @@ public:
 			if (m_parseOnly)
 				return true;
 
-			if (plat)
+			/* The chip's register names, for reports and rendering; the
+			 * architecture only knows the generation */
+			StoreMetadata(AFUC_REG_OVERLAY_KEY,
+				new Metadata((uint64_t)afuc_reg_table(gpuver, fw_id)->fw_id), true);
+
+			{
+				lock_guard<mutex> lock(s_cache_lock);
+				s_view_cache[GetObject()].self = this;
+			}
+			RegisterNotification(&m_invalidator);
+			m_cached = true;
+
+			/* On demand nothing is queued: handlers are only named, and
+			 * analyzed once they are asked for */
+			bool on_demand = afuc_view_on_demand(this);
+			if (on_demand)
+				Settings::Instance()->Set("analysis.linearSweep.autorun", false, this, SettingsResourceScope);
+			else if (plat)
 				AddEntryPointForAnalysis(plat, 0);
 
+			/* Name packet handlers and their payload reads */
+			vector<uint32_t> image(fileLen / 4);
+			parent->Read(image.data(), 0, image.size() * 4);
+			afuc_apply_packet_table(this, plat, gpuver, image, on_demand);
+			afuc_apply_nop_metadata(this, image);
+
 			LogInfo("AFUC firmware loaded: fw_id=0x%03x arch=%s size=%zu instructions",
 				fw_id, arch_name, codeLen / 4);
 
@@ -863,6 +1192,8 @@ extern "C"
 
 	BINARYNINJAPLUGIN bool CorePluginInit()
 	{
+		/* Architectures name registers from the generation base table;
+		 * a view's chip overlay is applied when rendering */
 		auto* a5 = new AfucArchitecture("afuc-a5xx", AFUC_A5XX);
 		auto* a6 = new AfucArchitecture("afuc-a6xx", AFUC_A6XX);
 		auto* a7 = new AfucArchitecture("afuc-a7xx", AFUC_A7XX);
@@ -885,6 +1216,27 @@ extern "C"
 		a7->SetDefaultCallingConvention(cc7);
 
 		BinaryViewType::Register(new AfucFirmwareViewType());
+		BinaryViewType::RegisterBinaryViewFinalizationEvent([](BinaryView* view) { afuc_stop_watch(view); });
+
+		afuc_register_search_commands();
+		afuc_register_dashboard_commands();
+		afuc_register_workflow();
+		afuc_register_liveness_layer();
+		afuc_register_reload_commands();
+		afuc_register_preempt_commands();
+		afuc_register_sync_commands();
+		afuc_register_pend_commands();
+		afuc_register_fetch_commands();
+		afuc_register_effects_commands();
+		afuc_register_equiv_commands();
+		afuc_register_freq_commands();
+		afuc_register_trend_commands();
+		afuc_register_demand_commands();
+		afuc_register_poll_commands();
+		afuc_register_footprint_commands();
+		afuc_register_iblevel_commands();
+		afuc_register_labels_layer();
+		afuc_register_pm4_layer();
 
 		LogInfo("AFUC architecture plugin loaded (a5xx/a6xx/a7xx)");
 		return true;
@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+#
+# Generate afuc_pm4_table.h from freedreno's adreno_pm4.xml.
+#
+#   gen_pm4.py path/to/adreno_pm4.xml afuc_pm4_table.h
+#
+# Each type-7 packet becomes one AfucPm4Packet row per payload layout:
+# opcode, the generations that share the layout, and the names of its
+# payload dwords ('|'-separated). The layout is collected separately for
+# each generation, so <stripe variants=...> of one generation never leak
+# into another's row. Stripes keyed on a payload field instead of the
+# chip (<bitfield addvariant="yes">) describe alternative modes of the
+# same packet; only the first, default mode is used. Naming rules:
+#   reg32 with one bitfield      -> bitfield name
+#   reg32 with several bitfields -> first bitfield on that generation
+#   reg32 without bitfields      -> reg name, or dwordN if numeric
+#   reg64                        -> name_lo, name_hi
+#   array                        -> repeating group (repeat_from/stride)
+#
+# Based on the freedreno project's register database by Rob Clark,
+# Connor Abbott, and the freedreno contributors.
+# https://gitlab.freedesktop.org/mesa/mesa/-/tree/main/src/freedreno/registers
+
+import sys
+import xml.etree.ElementTree as ET
+
+GENS = (5, 6, 7)
+GEN_MACRO = {5: "AFUC_PM4_A5XX", 6: "AFUC_PM4_A6XX", 7: "AFUC_PM4_A7XX"}
+
+# Packets whose payload ends in a variable-length run that the XML
+# doesn't describe as an array: name -> (repeat_from, field name)
+TRAILING_DATA = {
+    "CP_MEM_WRITE": (2, "data"),
+}
+
+
+def tag(e):
+    return e.tag.split("}")[-1]
+
+
+def variant_gens(v):
+    """'A6XX-' / 'A5XX-A6XX' / 'A7XX' -> set of generations"""
+    if not v:
+        return set(GENS)
+    gens = set()
+    for part in v.split(","):
+        lo, sep, hi = part.strip().partition("-")
+        lo_n = int(lo[1])
+        hi_n = int(hi[1]) if hi else (99 if sep else lo_n)
+        gens |= {g for g in GENS if lo_n <= g <= hi_n}
+    return gens
+
+
+def gens_expr(gens):
+    if gens == set(GENS):
+        return "AFUC_PM4_ALL"
+    return " | ".join(GEN_MACRO[g] for g in sorted(gens))
+
+
+def on_gens(e, gens):
+    """generations in 'gens' that element 'e' exists on"""
+    return variant_gens(e.get("variants")) & gens
+
+
+def field_name(reg, gens):
+    fields = [b for b in reg if tag(b) == "bitfield" and on_gens(b, gens)]
+    if fields:
+        return fields[0].get("name").lower()
+    name = reg.get("name", "")
+    if name.isdigit():
+        return "dword%s" % reg.get("offset")
+    return name.lower()
+
+
+def collect(elem, base, gens, out, repeat, modes):
+    for e in elem:
+        t = tag(e)
+        if t == "stripe" and e.get("varset", "chip") != "chip":
+            mode = modes.setdefault(e.get("varset"), e.get("variants"))
+            if mode == e.get("variants"):
+                collect(e, base, gens, out, repeat, modes)
+            continue
+        if not on_gens(e, gens):
+            continue
+        if t == "stripe":
+            collect(e, base, on_gens(e, gens), out, repeat, modes)
+        elif t == "array":
+            off = base + int(e.get("offset"), 0)
+            repeat.setdefault("from", off)
+            repeat.setdefault("stride", int(e.get("stride"), 0))
+            collect(e, off, gens, out, repeat, modes)
+        elif t == "reg32":
+            out[base + int(e.get("offset"), 0)] = field_name(e, gens)
+        elif t == "reg64":
+            off = base + int(e.get("offset"), 0)
+            name = e.get("name").lower()
+            out[off] = name + "_lo"
+            out[off + 1] = name + "_hi"
+
+
+def layout(domain, name, gen):
+    """Payload of packet 'name' on generation 'gen': (names, repeat_from, stride)"""
+    fields, repeat = {}, {}
+    if domain is not None:
+        collect(domain, 0, {gen}, fields, repeat, {})
+    if name in TRAILING_DATA:
+        rf, fname = TRAILING_DATA[name]
+        fields[rf] = fname
+        repeat = {"from": rf, "stride": 1}
+    n = max(fields) + 1 if fields else 0
+    names = "|".join(fields.get(i, "dword%d" % i) for i in range(n))
+    return names, repeat.get("from", 0), repeat.get("stride", 0)
+
+
+def main():
+    root = ET.parse(sys.argv[1]).getroot()
+
+    opcodes = []
+    for enum in root.iter():
+        if tag(enum) == "enum" and enum.get("name") == "adreno_pm4_type3_packets":
+            for v in enum:
+                if tag(v) != "value":
+                    continue
+                gens = variant_gens(v.get("variants"))
+                if gens:
+                    opcodes.append((int(v.get("value"), 0), v.get("name"), gens))
+
+    domains = {d.get("name"): d for d in root.iter() if tag(d) == "domain"}
+
+    rows = []
+    for opc, name, gens in sorted(opcodes, key=lambda o: (o[0], min(o[2]))):
+        if opc >= 0x80:
+            continue
+        # generations with the same layout share a row, in generation order
+        layouts = {}
+        for g in sorted(gens):
+            layouts.setdefault(layout(domains.get(name), name, g), set()).add(g)
+        for (names, rf, stride), lgens in layouts.items():
+            rows.append("\t{ 0x%02x, %s, %d, %d, \"%s\", \"%s\" },"
+                        % (opc, gens_expr(lgens), rf, stride, name, names))
+
+    with open(sys.argv[2], "w") as f:
+        f.write("/*\n * Generated by gen_pm4.py from adreno_pm4.xml -- do not edit.\n */\n\n")
+        f.write("static const AfucPm4Packet s_pm4_packets[] = {\n")
+        f.write("\n".join(rows))
+        f.write("\n};\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,72 @@
+/*
+ * Generated by gen_pm4.py from adreno_pm4.xml -- do not edit.
+ */
+
+static const AfucPm4Packet s_pm4_packets[] = {
+	{ 0x10, AFUC_PM4_ALL, 0, 0, "CP_NOP", "" },
+	{ 0x11, AFUC_PM4_ALL, 0, 0, "CP_RECORD_PFP_TIMESTAMP", "" },
+	{ 0x12, AFUC_PM4_ALL, 0, 0, "CP_WAIT_MEM_WRITES", "" },
+	{ 0x13, AFUC_PM4_ALL, 0, 0, "CP_WAIT_FOR_ME", "" },
+	{ 0x17, AFUC_PM4_A7XX, 0, 0, "CP_THREAD_CONTROL", "thread" },
+	{ 0x19, AFUC_PM4_ALL, 0, 0, "CP_DRAW_PRED_ENABLE_GLOBAL", "enable" },
+	{ 0x1a, AFUC_PM4_ALL, 0, 0, "CP_DRAW_PRED_ENABLE_LOCAL", "enable" },
+	{ 0x1c, AFUC_PM4_ALL, 0, 0, "CP_PREEMPT_ENABLE", "" },
+	{ 0x1d, AFUC_PM4_ALL, 0, 0, "CP_SKIP_IB2_ENABLE_GLOBAL", "" },
+	{ 0x21, AFUC_PM4_ALL, 0, 0, "CP_REG_RMW", "dst_reg|src0|src1" },
+	{ 0x23, AFUC_PM4_ALL, 0, 0, "CP_SKIP_IB2_ENABLE_LOCAL", "" },
+	{ 0x24, AFUC_PM4_ALL, 0, 0, "CP_DRAW_AUTO", "prim_type|num_instances|bytecount_lo|bytecount_hi|byte_offset|vertex_stride" },
+	{ 0x26, AFUC_PM4_ALL, 0, 0, "CP_WAIT_FOR_IDLE", "" },
+	{ 0x28, AFUC_PM4_ALL, 0, 0, "CP_DRAW_INDIRECT", "prim_type|indirect_lo|indirect_hi" },
+	{ 0x29, AFUC_PM4_ALL, 0, 0, "CP_DRAW_INDX_INDIRECT", "prim_type|indx_base_lo|indx_base_hi|max_indices|indirect_lo|indirect_hi" },
+	{ 0x2a, AFUC_PM4_A6XX | AFUC_PM4_A7XX, 0, 0, "CP_DRAW_INDIRECT_MULTI", "prim_type|dst_off|draw_count|indirect_lo|indirect_hi|stride" },
+	{ 0x2c, AFUC_PM4_ALL, 0, 0, "CP_BLIT", "op|src_x1|src_x2|dst_x1|dst_x2" },
+	{ 0x2e, AFUC_PM4_ALL, 0, 0, "CP_SET_BIN_DATA5_OFFSET", "vsc_size|bin_prim_strm|bin_data_offset|bin_size_offset" },
+	{ 0x2f, AFUC_PM4_ALL, 0, 0, "CP_SET_BIN_DATA5", "vsc_size|bin_data_addr_lo|bin_data_addr_hi|bin_size_address_lo|bin_size_address_hi|bin_prim_strm_lo|bin_prim_strm_hi" },
+	{ 0x30, AFUC_PM4_A5XX, 0, 0, "CP_LOAD_STATE4", "dst_off|state_type|ext_src_addr_hi" },
+	{ 0x32, AFUC_PM4_A6XX | AFUC_PM4_A7XX, 0, 0, "CP_LOAD_STATE6_GEOM", "dst_off|ext_src_addr_lo|ext_src_addr_hi" },
+	{ 0x33, AFUC_PM4_ALL, 0, 0, "CP_EXEC_CS", "dword0|ngroups_x|ngroups_y|ngroups_z" },
+	{ 0x34, AFUC_PM4_A6XX | AFUC_PM4_A7XX, 0, 0, "CP_LOAD_STATE6_FRAG", "dst_off|ext_src_addr_lo|ext_src_addr_hi" },
+	{ 0x35, AFUC_PM4_ALL, 0, 0, "CP_SET_SUBDRAW_SIZE", "subdraw_size" },
+	{ 0x36, AFUC_PM4_A6XX | AFUC_PM4_A7XX, 0, 0, "CP_LOAD_STATE6", "dst_off|ext_src_addr_lo|ext_src_addr_hi" },
+	{ 0x37, AFUC_PM4_ALL, 0, 0, "CP_INDIRECT_BUFFER_PFD", "ib_base_lo|ib_base_hi|ib_size" },
+	{ 0x38, AFUC_PM4_ALL, 0, 0, "CP_DRAW_INDX_OFFSET", "prim_type|num_instances|num_indices|first_indx|indx_base_lo|indx_base_hi|max_indices" },
+	{ 0x39, AFUC_PM4_ALL, 0, 0, "CP_REG_TEST", "reg" },
+	{ 0x3c, AFUC_PM4_ALL, 0, 0, "CP_WAIT_REG_MEM", "function|poll_addr_lo|poll_addr_hi|ref|mask|delay_loop_cycles" },
+	{ 0x3d, AFUC_PM4_ALL, 2, 1, "CP_MEM_WRITE", "addr_lo|addr_hi|data" },
+	{ 0x3e, AFUC_PM4_ALL, 0, 0, "CP_REG_TO_MEM", "reg|dest_lo|dest_hi" },
+	{ 0x3f, AFUC_PM4_ALL, 0, 0, "CP_INDIRECT_BUFFER", "ib_base_lo|ib_base_hi|ib_size" },
+	{ 0x40, AFUC_PM4_ALL, 0, 0, "CP_INTERRUPT", "" },
+	{ 0x41, AFUC_PM4_ALL, 0, 0, "CP_EXEC_CS_INDIRECT", "dword0|addr_lo|addr_hi|localsizex" },
+	{ 0x42, AFUC_PM4_ALL, 0, 0, "CP_MEM_TO_REG", "reg|src_lo|src_hi" },
+	{ 0x43, AFUC_PM4_ALL, 0, 3, "CP_SET_DRAW_STATE", "count|addr_lo|addr_hi" },
+	{ 0x44, AFUC_PM4_ALL, 0, 0, "CP_COND_EXEC", "bo0_lo|bo0_hi|bo1_lo|bo1_hi|ref|dwords" },
+	{ 0x45, AFUC_PM4_ALL, 0, 0, "CP_COND_WRITE5", "function|poll_addr_lo|poll_addr_hi|ref|mask|write_addr_lo|write_addr_hi|write_data" },
+	{ 0x46, AFUC_PM4_A5XX | AFUC_PM4_A6XX, 0, 0, "CP_EVENT_WRITE", "event|addr_lo|addr_hi|data" },
+	{ 0x46, AFUC_PM4_A7XX, 0, 0, "CP_EVENT_WRITE7", "event|addr_lo|addr_hi|payload_0" },
+	{ 0x47, AFUC_PM4_ALL, 0, 0, "CP_COND_REG_EXEC", "reg0|dwords" },
+	{ 0x4c, AFUC_PM4_ALL, 0, 0, "CP_REG_TO_SCRATCH", "reg" },
+	{ 0x4d, AFUC_PM4_ALL, 0, 0, "CP_SCRATCH_TO_REG", "reg" },
+	{ 0x4e, AFUC_PM4_ALL, 0, 0, "CP_DRAW_PRED_SET", "src|addr_lo|addr_hi" },
+	{ 0x4f, AFUC_PM4_ALL, 0, 0, "CP_MEM_WRITE_CNTR", "" },
+	{ 0x50, AFUC_PM4_ALL, 0, 0, "CP_START_BIN", "bin_count|prefix_addr_lo|prefix_addr_hi|prefix_dwords|body_dwords" },
+	{ 0x51, AFUC_PM4_ALL, 0, 0, "CP_END_BIN", "" },
+	{ 0x53, AFUC_PM4_ALL, 0, 0, "CP_SMMU_TABLE_UPDATE", "ttbr0_lo|ttbr0_hi|contextidr|contextbank" },
+	{ 0x55, AFUC_PM4_ALL, 0, 0, "CP_SET_CTXSWITCH_IB", "addr_lo|addr_hi|dwords" },
+	{ 0x56, AFUC_PM4_ALL, 0, 3, "CP_SET_PSEUDO_REG", "pseudo_reg|lo|hi" },
+	{ 0x57, AFUC_PM4_ALL, 0, 0, "CP_INDIRECT_BUFFER_CHAIN", "ib_base_lo|ib_base_hi|ib_size" },
+	{ 0x58, AFUC_PM4_ALL, 0, 0, "CP_EVENT_WRITE_SHD", "event|addr_lo|addr_hi" },
+	{ 0x59, AFUC_PM4_ALL, 0, 0, "CP_EVENT_WRITE_CFL", "event|addr_lo|addr_hi" },
+	{ 0x5b, AFUC_PM4_ALL, 0, 0, "CP_EVENT_WRITE_ZPD", "event|addr_lo|addr_hi" },
+	{ 0x5c, AFUC_PM4_ALL, 0, 2, "CP_CONTEXT_REG_BUNCH", "reg|value" },
+	{ 0x5d, AFUC_PM4_ALL, 0, 0, "CP_WAIT_IB_PFD_COMPLETE", "" },
+	{ 0x5e, AFUC_PM4_ALL, 0, 0, "CP_CONTEXT_UPDATE", "" },
+	{ 0x5f, AFUC_PM4_ALL, 0, 0, "CP_SET_PROTECTED_MODE", "mode" },
+	{ 0x63, AFUC_PM4_ALL, 0, 0, "CP_SET_MODE", "mode" },
+	{ 0x64, AFUC_PM4_ALL, 0, 0, "CP_SET_VISIBILITY_OVERRIDE", "override" },
+	{ 0x65, AFUC_PM4_ALL, 0, 0, "CP_SET_MARKER", "mode" },
+	{ 0x66, AFUC_PM4_ALL, 0, 0, "CP_SET_SECURE_MODE", "mode" },
+	{ 0x6b, AFUC_PM4_ALL, 0, 0, "CP_CONTEXT_SWITCH_YIELD", "" },
+	{ 0x6d, AFUC_PM4_ALL, 0, 0, "CP_REG_WRITE", "tracker|reg|value" },
+	{ 0x73, AFUC_PM4_ALL, 0, 0, "CP_MEM_TO_MEM", "neg_a|dst_lo|dst_hi|src_a_lo|src_a_hi|src_b_lo|src_b_hi" },
+	{ 0x7f, AFUC_PM4_A6XX | AFUC_PM4_A7XX, 0, 0, "CP_FIXED_STRIDE_DRAW_TABLE", "ib_base_lo|ib_base_hi|stride|count" },
+};